@@ -304,6 +304,9 @@ extension BLEManager: CBPeripheralDelegate {
             return
         }
 
+        // The ESP32 waits for an answer carrying this key
+        let key = jsonDict["idempotencyKey"] as? String ?? ""
+
         // Add the API key and connection type
         jsonDict["apiKey"] = sfApiKey
         jsonDict["connectionType"] = "Phone"
@@ -312,6 +315,7 @@ extension BLEManager: CBPeripheralDelegate {
 
         guard let finalData = try? JSONSerialization.data(withJSONObject: jsonDict) else {
             addLog("Failed to create JSON")
+            answerRelay(key: key, ok: false)
             return
         }
 
@@ -324,21 +328,34 @@ extension BLEManager: CBPeripheralDelegate {
             DispatchQueue.main.async {
                 if let error = error {
                     self?.addLog("SF Error: \(error.localizedDescription)")
+                    self?.answerRelay(key: key, ok: false)
                     return
                 }
 
                 if let httpResponse = response as? HTTPURLResponse {
                     if httpResponse.statusCode == 200 || httpResponse.statusCode == 201 {
                         self?.addLog("SF: Success!")
+                        self?.answerRelay(key: key, ok: true)
                     } else {
                         let responseStr = data.flatMap { String(data: $0, encoding: .utf8) } ?? "No response"
                         self?.addLog("SF Error \(httpResponse.statusCode): \(responseStr)")
+                        self?.answerRelay(key: key, ok: false)
                     }
                 }
             }
         }.resume()
     }
 
+    // Tell the ESP32 how its relayed reading went; without an OK it counts
+    // the relay as failed and sends the reading over its own WiFi or cellular
+    private func answerRelay(key: String, ok: Bool) {
+        guard let characteristic = salesforceCharacteristic,
+              let peripheral = esp32Peripheral else { return }
+        let answer = "\(ok ? "OK" : "ERR"):\(key)"
+        let data = answer.data(using: .utf8)!
+        peripheral.writeValue(data, for: characteristic, type: .withResponse)
+    }
+
     private func parseWifiNetworks(_ json: String) {
         guard let data = json.data(using: .utf8) else {
             addLog("Failed to parse WiFi data")
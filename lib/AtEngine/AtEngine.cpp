@@ -0,0 +1,180 @@
+#include "AtEngine.h"
+
+#include <string.h>
+
+static bool startsWith(const char* s, const char* prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+AtEngine::AtEngine(AtPort& port)
+    : _port(port), _head(0), _queued(0), _active(false), _promptSent(false), _gotOk(false),
+      _startedMs(0), _lineLength(0), _urcCount(0), _timeouts(0), _unsolicited(0) {
+    memset(&_result, 0, sizeof(_result));
+    _line[0] = '\0';
+}
+
+bool AtEngine::submit(const AtRequest& request) {
+    if (_queued >= QUEUE_SIZE || request.command == NULL) return false;
+    if (strlen(request.command) >= AT_COMMAND_MAX) return false;
+
+    Entry& entry = _queue[(_head + _queued) % QUEUE_SIZE];
+    entry.request = request;
+    strcpy(entry.command, request.command);
+    entry.request.command = entry.command;
+    if (request.result) {
+        request.result->status = AT_PENDING;
+        request.result->line[0] = '\0';
+        request.result->elapsedMs = 0;
+    }
+    _queued++;
+    return true;
+}
+
+bool AtEngine::onUrc(const char* prefix, AtUrcHandler handler, void* context) {
+    if (_urcCount >= MAX_URC_HANDLERS) return false;
+    _urcs[_urcCount].prefix = prefix;
+    _urcs[_urcCount].handler = handler;
+    _urcs[_urcCount].context = context;
+    _urcCount++;
+    return true;
+}
+
+void AtEngine::startNext(uint32_t nowMs) {
+    if (_active || _queued == 0) return;
+
+    _current = _queue[_head];
+    _current.request.command = _current.command;
+    _head = (_head + 1) % QUEUE_SIZE;
+    _queued--;
+
+    _active = true;
+    _promptSent = false;
+    _gotOk = false;
+    _startedMs = nowMs;
+    _result.status = AT_PENDING;
+    _result.line[0] = '\0';
+    _result.elapsedMs = 0;
+
+    _port.write((const uint8_t*)"AT", 2);
+    _port.write((const uint8_t*)_current.command, strlen(_current.command));
+    _port.write((const uint8_t*)"\r", 1);
+}
+
+void AtEngine::finish(AtStatus status, uint32_t nowMs) {
+    _active = false;
+    _result.status = status;
+    _result.elapsedMs = nowMs - _startedMs;
+    if (status == AT_TIMEOUT) _timeouts++;
+
+    const AtRequest& request = _current.request;
+    if (request.result) *request.result = _result;
+    if (request.callback) request.callback(_result, request.context);
+}
+
+bool AtEngine::dispatchUrc(const char* line) {
+    for (uint8_t i = 0; i < _urcCount; i++) {
+        if (startsWith(line, _urcs[i].prefix)) {
+            _urcs[i].handler(line, _urcs[i].context);
+            return true;
+        }
+    }
+    return false;
+}
+
+void AtEngine::checkPrompt() {
+    // Prompts such as "> " arrive without a line ending
+    const AtRequest& request = _current.request;
+    if (!_active || _promptSent || request.prompt == NULL) return;
+
+    size_t promptLength = strlen(request.prompt);
+    if (_lineLength < promptLength || strncmp(_line, request.prompt, promptLength) != 0) return;
+
+    _promptSent = true;
+    _lineLength = 0;
+    _line[0] = '\0';
+    if (request.payload && request.payloadLength > 0) {
+        _port.write(request.payload, request.payloadLength);
+    }
+}
+
+void AtEngine::handleLine(uint32_t nowMs) {
+    const char* line = _line;
+    if (_lineLength == 0) return;
+
+    if (!_active) {
+        if (!dispatchUrc(line)) _unsolicited++;
+        return;
+    }
+
+    const AtRequest& request = _current.request;
+
+    // Command echo (ATE1)
+    if (line[0] == 'A' && line[1] == 'T' && strcmp(line + 2, _current.command) == 0) return;
+
+    if (request.prefix && startsWith(line, request.prefix)) {
+        const char* value = line + strlen(request.prefix);
+        while (*value == ' ') value++;
+        strncpy(_result.line, value, AT_LINE_MAX - 1);
+        _result.line[AT_LINE_MAX - 1] = '\0';
+        if (request.untilPrefix && _gotOk) finish(AT_OK, nowMs);
+        return;
+    }
+
+    if (strcmp(line, "OK") == 0) {
+        if (request.untilPrefix) {
+            _gotOk = true;  // Result arrives later as a URC-style line
+        } else {
+            finish(AT_OK, nowMs);
+        }
+        return;
+    }
+
+    if (strcmp(line, "ERROR") == 0 || startsWith(line, "+CME ERROR:") || startsWith(line, "+CMS ERROR:")) {
+        strncpy(_result.line, line, AT_LINE_MAX - 1);
+        _result.line[AT_LINE_MAX - 1] = '\0';
+        finish(AT_ERROR, nowMs);
+        return;
+    }
+
+    if (request.onLine && request.onLine(line, request.context)) return;
+    if (dispatchUrc(line)) return;
+
+    // Bare information response (e.g. ATI), only when no prefix was given
+    if (request.prefix == NULL && _result.line[0] == '\0') {
+        strncpy(_result.line, line, AT_LINE_MAX - 1);
+        _result.line[AT_LINE_MAX - 1] = '\0';
+        return;
+    }
+    _unsolicited++;
+}
+
+void AtEngine::poll(uint32_t nowMs) {
+    startNext(nowMs);
+
+    while (_port.available() > 0) {
+        int c = _port.read();
+        if (c < 0) break;
+
+        if (c == '\r' || c == '\n') {
+            _line[_lineLength] = '\0';
+            handleLine(nowMs);
+            _lineLength = 0;
+            _line[0] = '\0';
+            // The next command may go out as soon as this one finishes
+            startNext(nowMs);
+            continue;
+        }
+
+        // Over-long lines are truncated rather than split
+        if (_lineLength < AT_LINE_MAX - 1) {
+            _line[_lineLength++] = (char)c;
+            _line[_lineLength] = '\0';
+        }
+        checkPrompt();
+    }
+
+    if (_active && nowMs - _startedMs >= _current.request.timeoutMs) {
+        finish(AT_TIMEOUT, nowMs);
+        startNext(nowMs);
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef AT_ENGINE_H
+#define AT_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte stream to the modem (the UART on the device)
+class AtPort {
+public:
+    virtual ~AtPort() {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+};
+
+enum AtStatus : uint8_t {
+    AT_PENDING,
+    AT_OK,
+    AT_ERROR,    // ERROR / +CME ERROR / +CMS ERROR
+    AT_TIMEOUT,
+};
+
+#define AT_LINE_MAX 128
+#define AT_COMMAND_MAX 160
+
+// Outcome of one command. Usable as a future: poll done().
+struct AtResult {
+    AtStatus status;
+    char line[AT_LINE_MAX];  // Last line matching the prefix, prefix and leading spaces removed
+    uint32_t elapsedMs;
+
+    bool done() const { return status != AT_PENDING; }
+    bool ok() const { return status == AT_OK; }
+};
+
+typedef void (*AtCallback)(const AtResult& result, void* context);
+typedef void (*AtUrcHandler)(const char* line, void* context);
+typedef bool (*AtLineHandler)(const char* line, void* context);  // Return true to claim the line
+
+struct AtRequest {
+    const char* command;     // Without "AT", e.g. "+CBC". Copied on submit.
+    const char* prefix;      // Response line to capture, e.g. "+CBC:" (NULL = first info line)
+    uint32_t timeoutMs;
+    const char* prompt;      // Send the payload when this arrives ("DOWNLOAD", ">")
+    const uint8_t* payload;  // Must stay valid until the command completes
+    size_t payloadLength;
+    bool untilPrefix;        // Finish on the prefix line after OK (e.g. +HTTPACTION)
+    AtResult* result;        // Optional future, filled in on completion
+    AtCallback callback;     // Optional, called on completion
+    AtLineHandler onLine;    // Optional, sees every other response line (e.g. "AT+CBC;+CSQ")
+    void* context;
+
+    explicit AtRequest(const char* command, const char* prefix = NULL, uint32_t timeoutMs = 1000)
+        : command(command), prefix(prefix), timeoutMs(timeoutMs), prompt(NULL), payload(NULL),
+          payloadLength(0), untilPrefix(false), result(NULL), callback(NULL), onLine(NULL),
+          context(NULL) {}
+};
+
+// Non-blocking AT command engine.
+//
+// Commands are queued with submit() and sent one at a time; poll() reads
+// whatever the modem has sent, matches lines against the active command
+// (its prefix, prompt and final result code) and finishes it on OK, an
+// error or its timeout. Lines the active command is not waiting for are
+// offered to the registered URC handlers, so an unsolicited +CGNSINF or a
+// late +HTTPACTION never completes the wrong command. A command line with
+// several commands joined by ';' answers with one line each and a single
+// final OK; an onLine handler picks those up as they arrive. poll() never waits;
+// time is passed in so the engine can run against a scripted port.
+class AtEngine {
+public:
+    static const uint8_t QUEUE_SIZE = 8;
+    static const uint8_t MAX_URC_HANDLERS = 8;
+
+    explicit AtEngine(AtPort& port);
+
+    // Returns false if the queue is full or the command too long
+    bool submit(const AtRequest& request);
+
+    // Lines starting with prefix that no command is waiting for
+    bool onUrc(const char* prefix, AtUrcHandler handler, void* context = NULL);
+
+    // Read input, send queued commands and expire timeouts
+    void poll(uint32_t nowMs);
+
+    // No command active or queued
+    bool idle() const { return !_active && _queued == 0; }
+    uint8_t queued() const { return _queued + (_active ? 1 : 0); }
+
+    uint32_t timeouts() const { return _timeouts; }
+    uint32_t unsolicited() const { return _unsolicited; }  // Lines nobody claimed
+
+private:
+    struct Entry {
+        AtRequest request;
+        char command[AT_COMMAND_MAX];
+        Entry() : request(NULL) {}
+    };
+
+    struct Urc {
+        const char* prefix;
+        AtUrcHandler handler;
+        void* context;
+    };
+
+    void startNext(uint32_t nowMs);
+    void handleLine(uint32_t nowMs);
+    void checkPrompt();
+    void finish(AtStatus status, uint32_t nowMs);
+    bool dispatchUrc(const char* line);
+
+    AtPort& _port;
+    Entry _queue[QUEUE_SIZE];
+    uint8_t _head;
+    uint8_t _queued;
+
+    Entry _current;
+    AtResult _result;
+    bool _active;
+    bool _promptSent;
+    bool _gotOk;       // untilPrefix commands: OK seen, waiting for the prefix line
+    uint32_t _startedMs;
+
+    char _line[AT_LINE_MAX];
+    size_t _lineLength;
+
+    Urc _urcs[MAX_URC_HANDLERS];
+    uint8_t _urcCount;
+
+    uint32_t _timeouts;
+    uint32_t _unsolicited;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "AtParse.h"
+
+#include <string.h>
+
+AtFields::AtFields(const char* line)
+    : _pos(line), _start(line), _length(0), _index(-1), _quoted(false) {
+    if (_pos == NULL) _pos = _start = "";
+}
+
+bool AtFields::next() {
+    if (_pos == NULL) return false;
+
+    const char* p = _pos;
+    while (*p == ' ') p++;
+
+    _quoted = (*p == '"');
+    if (_quoted) {
+        _start = ++p;
+        while (*p && *p != '"') p++;
+        _length = (size_t)(p - _start);
+        if (*p == '"') p++;
+        // Skip anything between the closing quote and the comma
+        while (*p && *p != ',') p++;
+    } else {
+        _start = p;
+        while (*p && *p != ',') p++;
+        const char* end = p;
+        while (end > _start && (end[-1] == ' ' || end[-1] == '\r' || end[-1] == '\n')) end--;
+        _length = (size_t)(end - _start);
+    }
+
+    _pos = (*p == ',') ? p + 1 : NULL;
+    _index++;
+    return true;
+}
+
+bool AtFields::seek(int index) {
+    while (_index < index) {
+        if (!next()) return false;
+    }
+    return _index == index;
+}
+
+// Plain decimal: [+-]digits[.digits]. The modem never sends exponents,
+// and a hand-rolled parse is several times cheaper than strtod().
+static bool parseDecimal(const char* s, size_t length, int64_t& mantissa, uint8_t& decimals) {
+    const char* end = s + length;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        s++;
+    }
+
+    bool digits = false;
+    bool point = false;
+    mantissa = 0;
+    decimals = 0;
+    for (; s < end; s++) {
+        if (*s == '.' && !point) {
+            point = true;
+        } else if (*s >= '0' && *s <= '9') {
+            // Ignore precision beyond what a double can hold
+            if (point && decimals >= 18) {
+                // Drop further fraction digits
+            } else if (mantissa < 100000000000000000LL) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (point) decimals++;
+            } else if (!point) {
+                return false;  // Integer part out of range
+            }
+            digits = true;
+        } else {
+            return false;
+        }
+    }
+    if (negative) mantissa = -mantissa;
+    return digits;
+}
+
+bool AtFields::toInt(int32_t& value) const {
+    int64_t mantissa;
+    uint8_t decimals;
+    if (!parseDecimal(_start, _length, mantissa, decimals) || decimals > 0) return false;
+    if (mantissa > INT32_MAX || mantissa < INT32_MIN) return false;
+    value = (int32_t)mantissa;
+    return true;
+}
+
+bool AtFields::toDouble(double& value) const {
+    static const double SCALE[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                   1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    int64_t mantissa;
+    uint8_t decimals;
+    if (!parseDecimal(_start, _length, mantissa, decimals)) return false;
+    value = (double)mantissa / SCALE[decimals];
+    return true;
+}
+
+bool AtFields::toFloat(float& value) const {
+    double v;
+    if (!toDouble(v)) return false;
+    value = (float)v;
+    return true;
+}
+
+size_t AtFields::copy(char* out, size_t size) const {
+    if (size == 0) return 0;
+    size_t n = _length < size - 1 ? _length : size - 1;
+    memcpy(out, _start, n);
+    out[n] = '\0';
+    return n;
+}
+
+bool AtFields::equals(const char* text) const {
+    return strlen(text) == _length && strncmp(_start, text, _length) == 0;
+}
+
+bool parseCgnsinf(const char* line, GnssInfo& info) {
+    memset(&info, 0, sizeof(info));
+    AtFields f(line);
+    int32_t v;
+
+    if (!f.seek(0) || !f.toInt(v)) return false;
+    info.running = v == 1;
+    // GNSS powered off reports only the run status
+    if (f.next() && f.toInt(v)) info.fix = v == 1;
+
+    if (f.next()) f.copy(info.utc, sizeof(info.utc));
+
+    // A fix needs at least a usable position
+    bool position = f.next() && f.toDouble(info.latitude);
+    position = f.next() && f.toDouble(info.longitude) && position;
+    if (!position) info.fix = false;
+
+    if (f.next()) f.toFloat(info.altitude);
+    if (f.next()) f.toFloat(info.speedKmh);
+    if (f.next()) f.toFloat(info.course);
+    if (f.seek(10)) f.toFloat(info.hdop);
+    if (f.seek(14)) f.toInt(info.satellitesInView);
+    if (f.seek(15)) f.toInt(info.satellitesUsed);
+    if (f.seek(16)) f.toInt(info.glonassUsed);
+    return true;
+}
+
+bool parseCbc(const char* line, BatteryInfo& info) {
+    AtFields f(line);
+    return f.seek(0) && f.toInt(info.chargeState) &&
+           f.next() && f.toInt(info.percent) &&
+           f.next() && f.toInt(info.millivolts);
+}
+
+bool parseCops(const char* line, OperatorInfo& info) {
+    info.format = -1;
+    info.name[0] = '\0';
+    info.accessTech = -1;
+
+    AtFields f(line);
+    if (!f.seek(0) || !f.toInt(info.mode)) return false;
+    // Not registered: only the mode is reported
+    if (!f.next()) return true;
+    if (!f.toInt(info.format)) return false;
+    if (!f.next() || !f.quoted()) return false;
+    f.copy(info.name, sizeof(info.name));
+    if (f.next()) f.toInt(info.accessTech);
+    return true;
+}
+
+bool parseCsq(const char* line, SignalInfo& info) {
+    AtFields f(line);
+    return f.seek(0) && f.toInt(info.rssi) &&
+           f.next() && f.toInt(info.ber);
+}
+
+bool parseCreg(const char* line, RegistrationInfo& info) {
+    AtFields f(line);
+    return f.seek(0) && f.toInt(info.mode) &&
+           f.next() && f.toInt(info.status);
+}
+
+// Value after "prefix" and its spaces, or NULL if line doesn't start with it
+static const char* afterPrefix(const char* line, const char* prefix) {
+    size_t n = strlen(prefix);
+    if (strncmp(line, prefix, n) != 0) return NULL;
+    line += n;
+    while (*line == ' ') line++;
+    return line;
+}
+
+bool parseModemStatusLine(const char* line, ModemStatus& status) {
+    if (line[0] != '+' || line[1] != 'C') return false;
+
+    const char* value;
+    if ((value = afterPrefix(line, "+CBC:")) != NULL) {
+        if (parseCbc(value, status.battery)) status.fields |= STATUS_BATTERY;
+    } else if ((value = afterPrefix(line, "+CSQ:")) != NULL) {
+        if (parseCsq(value, status.signal)) status.fields |= STATUS_SIGNAL;
+    } else if ((value = afterPrefix(line, "+COPS:")) != NULL) {
+        if (parseCops(value, status.network)) status.fields |= STATUS_OPERATOR;
+    } else if ((value = afterPrefix(line, "+CREG:")) != NULL) {
+        if (parseCreg(value, status.registration)) status.fields |= STATUS_REGISTRATION;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseHttpAction(const char* line, HttpActionInfo& info) {
+    AtFields f(line);
+    return f.seek(0) && f.toInt(info.method) &&
+           f.next() && f.toInt(info.status) &&
+           f.next() && f.toInt(info.length);
+}
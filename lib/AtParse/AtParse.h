@@ -0,0 +1,137 @@
+#ifndef AT_PARSE_H
+#define AT_PARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Comma separated AT response fields, read in place from the line buffer.
+// Quoted fields may contain commas; the quotes are not part of the value.
+// Nothing is copied or allocated unless copy() is asked to.
+class AtFields {
+public:
+    explicit AtFields(const char* line);
+
+    // Advance to the next field. Returns false past the last field.
+    bool next();
+
+    // Advance to field number index (0-based) from the current position
+    bool seek(int index);
+
+    int index() const { return _index; }
+    const char* data() const { return _start; }
+    size_t length() const { return _length; }
+    bool empty() const { return _length == 0; }
+    bool quoted() const { return _quoted; }
+
+    // Typed reads of the current field. Return false (value untouched)
+    // for empty or malformed fields.
+    bool toInt(int32_t& value) const;
+    bool toFloat(float& value) const;
+    bool toDouble(double& value) const;
+
+    // Copy the field NUL terminated, truncating to size - 1
+    size_t copy(char* out, size_t size) const;
+
+    bool equals(const char* text) const;
+
+private:
+    const char* _pos;    // Start of the next field, NULL when done
+    const char* _start;
+    size_t _length;
+    int _index;
+    bool _quoted;
+};
+
+// +CGNSINF (SIM7000):
+//   0 run, 1 fix, 2 UTC yyyyMMddhhmmss.sss, 3 lat, 4 lon, 5 MSL alt (m),
+//   6 speed (km/h), 7 course, 8 fix mode, 9 reserved, 10 HDOP, 11 PDOP,
+//   12 VDOP, 13 reserved, 14 sats in view, 15 GNSS sats used,
+//   16 GLONASS sats used, 17 reserved, 18 C/N0 max, 19 HPA, 20 VPA
+struct GnssInfo {
+    bool running;
+    bool fix;
+    char utc[19];
+    double latitude;
+    double longitude;
+    float altitude;
+    float speedKmh;
+    float course;
+    float hdop;
+    int32_t satellitesInView;
+    int32_t satellitesUsed;
+    int32_t glonassUsed;
+};
+
+// +CBC: charge state, percent, millivolts
+struct BatteryInfo {
+    int32_t chargeState;
+    int32_t percent;
+    int32_t millivolts;
+};
+
+// +COPS?: mode[,format,"operator"[,access technology]]
+struct OperatorInfo {
+    int32_t mode;
+    int32_t format;
+    char name[24];       // Empty when not registered
+    int32_t accessTech;  // -1 if not reported
+};
+
+// +CSQ: rssi, ber (99 = unknown)
+struct SignalInfo {
+    int32_t rssi;
+    int32_t ber;
+};
+
+// +CREG?: n, stat[,lac,ci]. stat 1 = home, 5 = roaming, 2 = searching.
+struct RegistrationInfo {
+    int32_t mode;
+    int32_t status;
+
+    bool registered() const { return status == 1 || status == 5; }
+};
+
+// +HTTPACTION: method, HTTP status (or 6xx modem error), body length
+struct HttpActionInfo {
+    int32_t method;
+    int32_t status;
+    int32_t length;
+};
+
+// Each parser takes the line after its "+XXX: " prefix and returns false
+// if required fields are missing or malformed. GnssInfo is still filled
+// as far as the line goes; a position is only trusted when fix is true.
+bool parseCgnsinf(const char* line, GnssInfo& info);
+bool parseCbc(const char* line, BatteryInfo& info);
+bool parseCops(const char* line, OperatorInfo& info);
+bool parseCsq(const char* line, SignalInfo& info);
+bool parseCreg(const char* line, RegistrationInfo& info);
+bool parseHttpAction(const char* line, HttpActionInfo& info);
+
+// Battery, signal, operator and registration in one round trip: the
+// modem answers "AT" MODEM_STATUS_COMMAND with one line per query and a
+// single OK. If one query fails the rest of the line is abandoned, so
+// fields records which answers actually arrived.
+#define MODEM_STATUS_COMMAND "+CBC;+CSQ;+COPS?;+CREG?"
+
+enum ModemStatusField : uint8_t {
+    STATUS_BATTERY = 1 << 0,
+    STATUS_SIGNAL = 1 << 1,
+    STATUS_OPERATOR = 1 << 2,
+    STATUS_REGISTRATION = 1 << 3,
+    STATUS_ALL = 0x0F,
+};
+
+struct ModemStatus {
+    BatteryInfo battery;
+    SignalInfo signal;
+    OperatorInfo network;
+    RegistrationInfo registration;
+    uint8_t fields;  // ModemStatusField bits
+};
+
+// Route one response line (prefix included) to its parser. Returns false
+// for lines that are not part of the status answer.
+bool parseModemStatusLine(const char* line, ModemStatus& status);
+
+#endif
@@ -0,0 +1,121 @@
+#include "CoopScheduler.h"
+
+#include <string.h>
+
+CoopScheduler::CoopScheduler(Clock millisClock, Clock microsClock)
+    : _millis(millisClock), _micros(microsClock), _count(0) {
+    memset(_tasks, 0, sizeof(_tasks));
+}
+
+int CoopScheduler::add(const char* name, TaskFunction function, uint32_t periodMs, uint32_t deadlineMs) {
+    if (_count >= MAX_TASKS || function == NULL) return -1;
+
+    Task& task = _tasks[_count];
+    memset(&task, 0, sizeof(task));
+    task.name = name;
+    task.function = function;
+    task.periodMs = periodMs;
+    task.deadlineMs = deadlineMs;
+    task.enabled = true;
+    // Periodic tasks run on the first pass; triggered ones wait
+    task.scheduled = periodMs > 0;
+    task.due = _millis();
+    return _count++;
+}
+
+void CoopScheduler::trigger(int id, uint32_t delayMs) {
+    if (id < 0 || id >= _count) return;
+    Task& task = _tasks[id];
+    uint32_t due = _millis() + delayMs;
+    if (!task.scheduled || before(due, task.due)) {
+        task.due = due;
+        task.scheduled = true;
+    }
+}
+
+void CoopScheduler::setEnabled(int id, bool enabled) {
+    if (id < 0 || id >= _count) return;
+    Task& task = _tasks[id];
+    if (enabled && !task.enabled && task.periodMs > 0) {
+        // Resume on the period from now instead of bursting to catch up
+        task.due = _millis() + task.periodMs;
+        task.scheduled = true;
+    }
+    task.enabled = enabled;
+}
+
+void CoopScheduler::setPeriod(int id, uint32_t periodMs) {
+    if (id < 0 || id >= _count) return;
+    Task& task = _tasks[id];
+    task.periodMs = periodMs;
+    if (periodMs > 0) {
+        uint32_t due = _millis() + periodMs;
+        if (!task.scheduled || before(due, task.due)) task.due = due;
+        task.scheduled = true;
+    }
+}
+
+uint32_t CoopScheduler::deadlineOf(const Task& task) const {
+    uint32_t window = task.deadlineMs ? task.deadlineMs : task.periodMs;
+    return task.due + window;
+}
+
+uint32_t CoopScheduler::runOnce() {
+    uint32_t now = _millis();
+
+    // Earliest deadline first among the due tasks
+    int next = -1;
+    for (int i = 0; i < _count; i++) {
+        const Task& task = _tasks[i];
+        if (!task.enabled || !task.scheduled || before(now, task.due)) continue;
+        if (next < 0 || before(deadlineOf(task), deadlineOf(_tasks[next]))) next = i;
+    }
+
+    if (next >= 0) {
+        Task& task = _tasks[next];
+        bool hasDeadline = task.deadlineMs > 0 || task.periodMs > 0;
+        if (hasDeadline && before(deadlineOf(task), now)) {
+            task.stats.missedDeadlines++;
+        }
+
+        // Reschedule before running so the task can trigger() itself
+        if (task.periodMs > 0) {
+            task.due += task.periodMs;
+            // Fell more than a period behind: skip the missed slots
+            if (before(task.due, now)) task.due = now + task.periodMs;
+        } else {
+            task.scheduled = false;
+        }
+
+        uint32_t start = _micros ? _micros() : 0;
+        task.function();
+        if (_micros) {
+            uint32_t elapsed = _micros() - start;
+            task.stats.lastRunUs = elapsed;
+            task.stats.totalRunUs += elapsed;
+            if (elapsed > task.stats.maxRunUs) task.stats.maxRunUs = elapsed;
+        }
+        task.stats.runs++;
+        now = _millis();
+    }
+
+    uint32_t idle = UINT32_MAX;
+    for (int i = 0; i < _count; i++) {
+        const Task& task = _tasks[i];
+        if (!task.enabled || !task.scheduled) continue;
+        if (!before(now, task.due)) return 0;
+        uint32_t wait = task.due - now;
+        if (wait < idle) idle = wait;
+    }
+    return idle;
+}
+
+const char* CoopScheduler::name(int id) const {
+    if (id < 0 || id >= _count) return NULL;
+    return _tasks[id].name;
+}
+
+const CoopScheduler::TaskStats* CoopScheduler::stats(int id) const {
+    if (id < 0 || id >= _count) return NULL;
+    return &_tasks[id].stats;
+}
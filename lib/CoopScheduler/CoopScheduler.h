@@ -0,0 +1,71 @@
+#ifndef COOP_SCHEDULER_H
+#define COOP_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cooperative run-to-yield scheduler for loop().
+//
+// Tasks are plain functions that do a bounded slice of work and return.
+// A periodic task becomes due every periodMs; a task with period 0 only
+// runs when trigger()ed. Each run has a deadline (due time + deadlineMs);
+// starting late counts as a missed deadline. When several tasks are due
+// the earliest deadline runs first. Time comes from injected clocks so
+// the scheduler can run against a virtual clock.
+class CoopScheduler {
+public:
+    typedef uint32_t (*Clock)();
+    typedef void (*TaskFunction)();
+
+    static const int MAX_TASKS = 16;
+
+    struct TaskStats {
+        uint32_t runs;
+        uint32_t missedDeadlines;
+        uint32_t lastRunUs;
+        uint32_t maxRunUs;
+        uint64_t totalRunUs;
+    };
+
+    // millisClock drives scheduling; microsClock (optional) times each run
+    CoopScheduler(Clock millisClock, Clock microsClock = NULL);
+
+    // Returns a task id, or -1 if the table is full.
+    // deadlineMs 0 = same as the period (or no deadline for triggered tasks).
+    int add(const char* name, TaskFunction function, uint32_t periodMs, uint32_t deadlineMs = 0);
+
+    // Make a task due after delayMs (sooner than its period if needed)
+    void trigger(int id, uint32_t delayMs = 0);
+    void setEnabled(int id, bool enabled);
+    void setPeriod(int id, uint32_t periodMs);
+
+    // Run the most urgent due task, if any. Returns ms until the next
+    // task is due (0 = something is already due).
+    uint32_t runOnce();
+
+    int taskCount() const { return _count; }
+    const char* name(int id) const;
+    const TaskStats* stats(int id) const;
+
+private:
+    struct Task {
+        const char* name;
+        TaskFunction function;
+        uint32_t periodMs;
+        uint32_t deadlineMs;
+        uint32_t due;
+        bool scheduled;
+        bool enabled;
+        TaskStats stats;
+    };
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+    uint32_t deadlineOf(const Task& task) const;
+
+    Clock _millis;
+    Clock _micros;
+    Task _tasks[MAX_TASKS];
+    int _count;
+};
+
+#endif
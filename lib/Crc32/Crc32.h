@@ -0,0 +1,11 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3). Pass the previous result as crc to checksum
+// data in pieces.
+uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+
+#endif
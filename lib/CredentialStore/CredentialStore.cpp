@@ -0,0 +1,185 @@
+#include "CredentialStore.h"
+
+#include <string.h>
+
+// Record layout (little endian):
+//   magic u32, version u8, count u8, checksum u32 (FNV-1a of the entries)
+//   per entry: ssid length u8, ssid, password length u8, password
+#define RECORD_MAGIC 0x57494649  // "WIFI"
+#define RECORD_VERSION 1
+#define HEADER_SIZE 10
+#define RECORD_MAX (HEADER_SIZE + CredentialStore::CAPACITY * (2 + CredentialStore::SSID_MAX + CredentialStore::PASSWORD_MAX))
+
+static uint32_t fnv1a(const uint8_t* data, size_t length, uint32_t hash = 2166136261u) {
+    for (size_t i = 0; i < length; i++) hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static uint32_t hashSsid(const char* ssid) {
+    return fnv1a((const uint8_t*)ssid, strlen(ssid));
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Bounded copy into a fixed field; false if it doesn't fit
+static bool copyField(char* out, size_t max, const char* value) {
+    size_t length = strlen(value);
+    if (length > max) return false;
+    memcpy(out, value, length + 1);
+    return true;
+}
+
+CredentialStore::CredentialStore(BlobStorage& storage) : _storage(storage), _count(0), _writes(0) {
+    memset(_index, EMPTY, sizeof(_index));
+}
+
+bool CredentialStore::begin() {
+    uint8_t record[RECORD_MAX];
+    size_t length = _storage.load(record, sizeof(record));
+    if (length > 0 && deserialize(record, length)) {
+        rebuildIndex();
+        return true;
+    }
+    _count = 0;
+    rebuildIndex();
+    return false;
+}
+
+int CredentialStore::find(const char* ssid) const {
+    if (ssid == NULL || ssid[0] == '\0') return -1;
+    uint8_t slot = (uint8_t)(hashSsid(ssid) & (INDEX_SIZE - 1));
+    for (uint8_t probe = 0; probe < INDEX_SIZE; probe++) {
+        uint8_t entry = _index[slot];
+        if (entry == EMPTY) return -1;
+        if (strcmp(_entries[entry].ssid, ssid) == 0) return entry;
+        slot = (uint8_t)((slot + 1) & (INDEX_SIZE - 1));
+    }
+    return -1;
+}
+
+void CredentialStore::rebuildIndex() {
+    memset(_index, EMPTY, sizeof(_index));
+    for (uint8_t i = 0; i < _count; i++) {
+        uint8_t slot = (uint8_t)(hashSsid(_entries[i].ssid) & (INDEX_SIZE - 1));
+        while (_index[slot] != EMPTY) slot = (uint8_t)((slot + 1) & (INDEX_SIZE - 1));
+        _index[slot] = i;
+    }
+}
+
+void CredentialStore::remove(uint8_t index) {
+    memmove(&_entries[index], &_entries[index + 1], (size_t)(_count - index - 1) * sizeof(Entry));
+    _count--;
+}
+
+const char* CredentialStore::password(const char* ssid) const {
+    int i = find(ssid);
+    return i >= 0 ? _entries[i].password : NULL;
+}
+
+bool CredentialStore::save(const char* ssid, const char* password) {
+    if (ssid == NULL || ssid[0] == '\0' || strlen(ssid) > SSID_MAX) return false;
+    if (password == NULL) password = "";
+    if (strlen(password) > PASSWORD_MAX) return false;
+
+    int i = find(ssid);
+    if (i >= 0) {
+        if (strcmp(_entries[i].password, password) == 0) return true;  // Nothing to write
+        copyField(_entries[i].password, PASSWORD_MAX, password);
+        return persist();
+    }
+
+    if (_count == CAPACITY) remove(0);  // Evict the oldest
+    Entry& entry = _entries[_count++];
+    copyField(entry.ssid, SSID_MAX, ssid);
+    copyField(entry.password, PASSWORD_MAX, password);
+    rebuildIndex();
+    return persist();
+}
+
+bool CredentialStore::forget(const char* ssid) {
+    int i = find(ssid);
+    if (i < 0) return false;
+    remove((uint8_t)i);
+    rebuildIndex();
+    return persist();
+}
+
+bool CredentialStore::clear() {
+    _count = 0;
+    rebuildIndex();
+    return persist();
+}
+
+size_t CredentialStore::recordSize() const {
+    size_t size = HEADER_SIZE;
+    for (uint8_t i = 0; i < _count; i++) {
+        size += 2 + strlen(_entries[i].ssid) + strlen(_entries[i].password);
+    }
+    return size;
+}
+
+size_t CredentialStore::serialize(uint8_t* out, size_t size) const {
+    size_t length = recordSize();
+    if (length > size) return 0;
+
+    uint8_t* p = out + HEADER_SIZE;
+    for (uint8_t i = 0; i < _count; i++) {
+        size_t ssidLength = strlen(_entries[i].ssid);
+        size_t passwordLength = strlen(_entries[i].password);
+        *p++ = (uint8_t)ssidLength;
+        memcpy(p, _entries[i].ssid, ssidLength);
+        p += ssidLength;
+        *p++ = (uint8_t)passwordLength;
+        memcpy(p, _entries[i].password, passwordLength);
+        p += passwordLength;
+    }
+
+    putU32(out, RECORD_MAGIC);
+    out[4] = RECORD_VERSION;
+    out[5] = _count;
+    putU32(out + 6, fnv1a(out + HEADER_SIZE, length - HEADER_SIZE));
+    return length;
+}
+
+bool CredentialStore::deserialize(const uint8_t* data, size_t length) {
+    if (length < HEADER_SIZE || getU32(data) != RECORD_MAGIC || data[4] != RECORD_VERSION) return false;
+    if (data[5] > CAPACITY) return false;
+    if (getU32(data + 6) != fnv1a(data + HEADER_SIZE, length - HEADER_SIZE)) return false;
+
+    const uint8_t* p = data + HEADER_SIZE;
+    const uint8_t* end = data + length;
+    uint8_t count = data[5];
+    for (uint8_t i = 0; i < count; i++) {
+        if (p >= end || *p == 0 || *p > SSID_MAX || p + 1 + *p >= end) return false;
+        size_t ssidLength = *p++;
+        memcpy(_entries[i].ssid, p, ssidLength);
+        _entries[i].ssid[ssidLength] = '\0';
+        p += ssidLength;
+
+        if (*p > PASSWORD_MAX || p + 1 + *p > end) return false;
+        size_t passwordLength = *p++;
+        memcpy(_entries[i].password, p, passwordLength);
+        _entries[i].password[passwordLength] = '\0';
+        p += passwordLength;
+    }
+    if (p != end) return false;
+    _count = count;
+    return true;
+}
+
+bool CredentialStore::persist() {
+    uint8_t record[RECORD_MAX];
+    size_t length = serialize(record, sizeof(record));
+    if (length == 0) return false;
+    _writes++;
+    return _storage.save(record, length);
+}
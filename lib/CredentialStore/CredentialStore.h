@@ -0,0 +1,77 @@
+#ifndef CREDENTIAL_STORE_H
+#define CREDENTIAL_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One persistent binary value (a single NVS key on the device)
+class BlobStorage {
+public:
+    virtual ~BlobStorage() {}
+    // Copies the stored value into data. Returns its length, 0 if there
+    // is none or it doesn't fit.
+    virtual size_t load(void* data, size_t size) = 0;
+    virtual bool save(const void* data, size_t length) = 0;
+};
+
+// Saved WiFi networks as one versioned, checksummed record.
+//
+// The record is read once by begin() and kept in RAM with a hash index
+// on the SSID, so lookups never touch flash. Every change is a single
+// record write. Networks keep the order they were first saved in (the
+// order connectWiFi() tries them); saving to a full store evicts the
+// oldest. Not thread safe.
+class CredentialStore {
+public:
+    static const uint8_t CAPACITY = 16;
+    static const size_t SSID_MAX = 32;
+    static const size_t PASSWORD_MAX = 64;
+
+    explicit CredentialStore(BlobStorage& storage);
+
+    // Load the record. Returns false if there was none (or it was
+    // unreadable) and the store starts empty.
+    bool begin();
+
+    // Add a network or update its password
+    bool save(const char* ssid, const char* password);
+    bool forget(const char* ssid);
+    bool clear();
+
+    // NULL if the network isn't saved. "" for an open network.
+    const char* password(const char* ssid) const;
+    bool contains(const char* ssid) const { return find(ssid) >= 0; }
+
+    uint8_t count() const { return _count; }
+    const char* ssid(uint8_t index) const { return _entries[index].ssid; }        // 0 = oldest
+    const char* passwordAt(uint8_t index) const { return _entries[index].password; }
+
+    uint32_t writes() const { return _writes; }
+
+    // Serialized size of the current contents
+    size_t recordSize() const;
+
+private:
+    struct Entry {
+        char ssid[SSID_MAX + 1];
+        char password[PASSWORD_MAX + 1];
+    };
+
+    static const uint8_t INDEX_SIZE = 32;  // Power of two, >= 2 * CAPACITY
+    static const uint8_t EMPTY = 0xFF;
+
+    int find(const char* ssid) const;
+    void rebuildIndex();
+    void remove(uint8_t index);
+    bool persist();
+    size_t serialize(uint8_t* out, size_t size) const;
+    bool deserialize(const uint8_t* data, size_t length);
+
+    BlobStorage& _storage;
+    Entry _entries[CAPACITY];
+    uint8_t _count;
+    uint8_t _index[INDEX_SIZE];  // Open addressing: hash -> entry, EMPTY = free
+    uint32_t _writes;
+};
+
+#endif
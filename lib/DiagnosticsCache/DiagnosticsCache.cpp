@@ -0,0 +1,67 @@
+#include "DiagnosticsCache.h"
+
+#include <string.h>
+
+DiagnosticsCache::DiagnosticsCache() {
+    memset(&_values, 0, sizeof(_values));
+    _values.signalQuality = 99;
+    for (uint8_t i = 0; i < DIAG_METRIC_COUNT; i++) {
+        _ttlMs[i] = 60000;
+        _updatedMs[i] = 0;
+        _attemptedMs[i] = 0;
+        _everUpdated[i] = false;
+        _everAttempted[i] = false;
+    }
+}
+
+void DiagnosticsCache::setTtl(DiagnosticMetric metric, uint32_t ttlMs) {
+    _ttlMs[metric] = ttlMs;
+}
+
+bool DiagnosticsCache::due(DiagnosticMetric metric, uint32_t nowMs) const {
+    if (!_everAttempted[metric]) return true;
+    return nowMs - _attemptedMs[metric] >= _ttlMs[metric];
+}
+
+void DiagnosticsCache::attempted(DiagnosticMetric metric, uint32_t nowMs) {
+    _attemptedMs[metric] = nowMs;
+    _everAttempted[metric] = true;
+}
+
+void DiagnosticsCache::updated(DiagnosticMetric metric, uint32_t nowMs) {
+    _updatedMs[metric] = nowMs;
+    _everUpdated[metric] = true;
+}
+
+void DiagnosticsCache::setBattery(int32_t millivolts, uint32_t nowMs) {
+    _values.batteryVoltage = millivolts;
+    updated(DIAG_BATTERY, nowMs);
+}
+
+void DiagnosticsCache::setSignal(int32_t csq, uint32_t nowMs) {
+    _values.signalQuality = csq;
+    updated(DIAG_SIGNAL, nowMs);
+}
+
+void DiagnosticsCache::setOperator(const char* name, uint32_t nowMs) {
+    strncpy(_values.networkOperator, name ? name : "", sizeof(_values.networkOperator) - 1);
+    _values.networkOperator[sizeof(_values.networkOperator) - 1] = '\0';
+    updated(DIAG_OPERATOR, nowMs);
+}
+
+void DiagnosticsCache::setRegistered(bool registered, uint32_t nowMs) {
+    _values.registered = registered;
+    updated(DIAG_REGISTRATION, nowMs);
+}
+
+uint32_t DiagnosticsCache::ageMs(DiagnosticMetric metric, uint32_t nowMs) const {
+    if (!_everUpdated[metric]) return NEVER;
+    return nowMs - _updatedMs[metric];
+}
+
+void DiagnosticsCache::snapshot(uint32_t nowMs, DiagnosticsSnapshot& out) const {
+    out.values = _values;
+    for (uint8_t i = 0; i < DIAG_METRIC_COUNT; i++) {
+        out.ageMs[i] = ageMs((DiagnosticMetric)i, nowMs);
+    }
+}
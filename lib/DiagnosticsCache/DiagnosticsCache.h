@@ -0,0 +1,68 @@
+#ifndef DIAGNOSTICS_CACHE_H
+#define DIAGNOSTICS_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum DiagnosticMetric : uint8_t {
+    DIAG_BATTERY,
+    DIAG_SIGNAL,
+    DIAG_OPERATOR,
+    DIAG_REGISTRATION,
+    DIAG_METRIC_COUNT,
+};
+
+// Last known modem values
+struct ModemDiagnostics {
+    int32_t batteryVoltage;     // millivolts, 0 = unknown
+    int32_t signalQuality;      // CSQ (0-31, 99 = unknown)
+    char networkOperator[24];   // Empty = unknown / not registered
+    bool registered;            // Home or roaming (+CREG)
+};
+
+struct DiagnosticsSnapshot {
+    ModemDiagnostics values;
+    uint32_t ageMs[DIAG_METRIC_COUNT];  // DiagnosticsCache::NEVER if never read
+};
+
+// Modem status with a staleness budget per metric. (GPS streams in
+// continuously and lives in a LatestFix instead.)
+//
+// The owner refreshes the metrics due() when the modem is idle and stores
+// the results with the set*() calls; readers take a snapshot() that
+// includes how old each value is. A failed refresh leaves the old value
+// in place (getting older) and is not retried until another TTL has
+// passed. Not thread safe - the owner guards access.
+class DiagnosticsCache {
+public:
+    static const uint32_t NEVER = 0xFFFFFFFF;
+
+    DiagnosticsCache();
+
+    void setTtl(DiagnosticMetric metric, uint32_t ttlMs);
+    uint32_t ttl(DiagnosticMetric metric) const { return _ttlMs[metric]; }
+
+    // Stale and not attempted within the last TTL
+    bool due(DiagnosticMetric metric, uint32_t nowMs) const;
+    void attempted(DiagnosticMetric metric, uint32_t nowMs);
+
+    void setBattery(int32_t millivolts, uint32_t nowMs);
+    void setSignal(int32_t csq, uint32_t nowMs);
+    void setOperator(const char* name, uint32_t nowMs);
+    void setRegistered(bool registered, uint32_t nowMs);
+
+    uint32_t ageMs(DiagnosticMetric metric, uint32_t nowMs) const;
+    void snapshot(uint32_t nowMs, DiagnosticsSnapshot& out) const;
+
+private:
+    void updated(DiagnosticMetric metric, uint32_t nowMs);
+
+    ModemDiagnostics _values;
+    uint32_t _ttlMs[DIAG_METRIC_COUNT];
+    uint32_t _updatedMs[DIAG_METRIC_COUNT];
+    uint32_t _attemptedMs[DIAG_METRIC_COUNT];
+    bool _everUpdated[DIAG_METRIC_COUNT];
+    bool _everAttempted[DIAG_METRIC_COUNT];
+};
+
+#endif
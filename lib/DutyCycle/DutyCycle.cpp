@@ -0,0 +1,89 @@
+#include "DutyCycle.h"
+
+#include <stddef.h>
+
+#include "Crc32.h"
+
+#define STATE_MAGIC 0x44435943  // "DCYC"
+#define STATE_VERSION 1
+
+void dutyCycleSeal(DutyCycleState& state) {
+    state.magic = STATE_MAGIC;
+    state.version = STATE_VERSION;
+    state.size = sizeof(DutyCycleState);
+    state.checksum = crc32(&state, offsetof(DutyCycleState, checksum));
+}
+
+bool dutyCycleValid(const DutyCycleState& state) {
+    return state.magic == STATE_MAGIC && state.version == STATE_VERSION && state.size == sizeof(DutyCycleState) &&
+           state.checksum == crc32(&state, offsetof(DutyCycleState, checksum));
+}
+
+uint32_t dutyCycleUptimeMs(const DutyCycleState& state, uint32_t nowS) {
+    uint32_t sleptS = nowS >= state.sleptAt ? nowS - state.sleptAt : 0;
+    return state.uptimeMs + sleptS * 1000;
+}
+
+WakeScheduler::WakeScheduler(const DutyCycleConfig& config)
+    : _config(config), _reason(WAKE_POWER_ON), _wakeMs(0), _activityMs(0), _interactive(false) {}
+
+bool WakeScheduler::wake(WakeReason reason, uint32_t nowS, uint32_t nowMs, uint32_t& nextReportAt) {
+    _reason = reason;
+    _wakeMs = nowMs;
+    // The first boot stays up for setup over BLE, like a button wake
+    _interactive = reason != WAKE_TIMER;
+    _activityMs = nowMs;
+
+    if (reason == WAKE_POWER_ON || nextReportAt == 0) {
+        nextReportAt = nowS + _config.intervalS;
+        return true;
+    }
+    if (nowS < nextReportAt) return false;
+    nextReportAt += _config.intervalS;
+    return true;
+}
+
+void WakeScheduler::activity(uint32_t nowMs) {
+    _interactive = true;
+    _activityMs = nowMs;
+}
+
+bool WakeScheduler::shouldSleep(uint32_t nowMs, bool busy) const {
+    uint32_t since = nowMs - _activityMs;
+    if (since >= _config.maxAwakeMs) return true;
+    if (busy) return false;
+    return !_interactive || since >= _config.interactiveWindowMs;
+}
+
+uint32_t WakeScheduler::sleepSeconds(uint32_t nowS, uint32_t& nextReportAt) const {
+    bool ahead = nextReportAt > nowS + _config.intervalS;
+    bool behind = nextReportAt + _config.intervalS <= nowS;
+    if (ahead || behind) {
+        nextReportAt = nowS + _config.intervalS;
+    } else if (nextReportAt <= nowS) {
+        nextReportAt += _config.intervalS;  // Overran: skip it
+    }
+
+    uint32_t sleepS = nextReportAt - nowS;
+    return sleepS < _config.minSleepS ? _config.minSleepS : sleepS;
+}
+
+const char* wakeReasonName(WakeReason reason) {
+    switch (reason) {
+        case WAKE_POWER_ON: return "power";
+        case WAKE_TIMER: return "timer";
+        case WAKE_BUTTON: return "button";
+        case WAKE_TOUCH: return "touch";
+    }
+    return "";
+}
+
+const char* wakeReadingFunction(WakeReason reason, bool periodicDue) {
+    switch (reason) {
+        case WAKE_POWER_ON: return "Startup";
+        case WAKE_TIMER: return periodicDue ? "Periodic" : NULL;
+        case WAKE_BUTTON: return "Single";
+        case WAKE_TOUCH: return "Touch";
+    }
+    return NULL;
+}
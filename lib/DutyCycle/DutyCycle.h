@@ -0,0 +1,89 @@
+#ifndef DUTY_CYCLE_H
+#define DUTY_CYCLE_H
+
+#include <stdint.h>
+
+#include "GnssAssist.h"
+#include "TransportHealth.h"
+
+// What ended the last deep sleep. Power-on covers every other reset.
+enum WakeReason : uint8_t {
+    WAKE_POWER_ON,
+    WAKE_TIMER,   // Periodic reading due
+    WAKE_BUTTON,  // ext0 on the tap button
+    WAKE_TOUCH,   // Touch pad
+};
+
+struct DutyCycleConfig {
+    uint32_t intervalS;            // Between periodic readings
+    uint32_t minSleepS;            // Never arm the timer for less
+    uint32_t interactiveWindowMs;  // Stay up this long after user activity
+    uint32_t maxAwakeMs;           // Sleep this long after wake/activity even if busy
+};
+
+#define DUTY_CYCLE_HEALTH_SLOTS 3
+
+// Kept in RTC memory across deep sleep. Deep sleep powers the CPU and
+// main RAM down, so this is all a wake inherits: sealed just before
+// sleeping and checked on wake. Garbage after a power-on fails the check.
+struct DutyCycleState {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t cycles;           // Wakes since power-on
+    uint32_t bootCount;        // NVS boot count; not bumped per wake
+    uint32_t readingSequence;  // Idempotency keys carry on across wakes
+    uint32_t nextReportAt;     // Clock seconds of the next periodic reading
+    uint32_t sleptAt;          // Clock seconds when it went to sleep
+    uint32_t uptimeMs;         // Since power-on, counting sleep, at sleptAt
+    uint32_t lastAwakeMs;      // How long the previous cycle was awake
+    StoredFix lastFix;         // version 0 = none
+    TransportHealthState health[DUTY_CYCLE_HEALTH_SLOTS];
+    uint32_t checksum;
+};
+
+void dutyCycleSeal(DutyCycleState& state);
+bool dutyCycleValid(const DutyCycleState& state);
+
+// Milliseconds since power-on at wake. The clock (time()) runs on the
+// RTC through deep sleep; millis() restarts.
+uint32_t dutyCycleUptimeMs(const DutyCycleState& state, uint32_t nowS);
+
+// When to take readings and when to go back to sleep. Clock values are
+// time() seconds, which may jump once SNTP sets them; awake time is
+// millis(). Decides only - the owner arms the wake sources and sleeps.
+class WakeScheduler {
+public:
+    explicit WakeScheduler(const DutyCycleConfig& config);
+
+    // Start of a cycle. Returns true when the periodic reading is due
+    // and moves nextReportAt on past it. Power-on always reads.
+    bool wake(WakeReason reason, uint32_t nowS, uint32_t nowMs, uint32_t& nextReportAt);
+
+    // Button, touch, phone: stay up for the interactive window
+    void activity(uint32_t nowMs);
+
+    // busy = work in flight (uploads, a connected phone). Past
+    // maxAwakeMs since wake or the last activity it sleeps regardless.
+    bool shouldSleep(uint32_t nowMs, bool busy) const;
+
+    // Timer for the next periodic reading. A reading overrun by this
+    // cycle is skipped, and a slot that no longer fits the clock (set or
+    // stepped meanwhile) is rescheduled a whole interval out.
+    uint32_t sleepSeconds(uint32_t nowS, uint32_t& nextReportAt) const;
+
+    WakeReason reason() const { return _reason; }
+
+private:
+    DutyCycleConfig _config;
+    WakeReason _reason;
+    uint32_t _wakeMs;
+    uint32_t _activityMs;
+    bool _interactive;
+};
+
+const char* wakeReasonName(WakeReason reason);
+// Reading function for a wake, NULL when there's nothing to send
+const char* wakeReadingFunction(WakeReason reason, bool periodicDue);
+
+#endif
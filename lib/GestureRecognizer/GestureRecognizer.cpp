@@ -0,0 +1,84 @@
+#include "GestureRecognizer.h"
+
+GestureRecognizer::GestureRecognizer(const GestureConfig& config)
+    : _config(config), _raw(false), _rawMs(0), _stable(false), _taps(0), _lastTapMs(0), _touching(false),
+      _lastTouchMs(0), _eventHead(0), _eventCount(0), _lost(0) {}
+
+void GestureRecognizer::buttonEdge(uint32_t atMs, bool pressed) {
+    settle(atMs);  // The level before this edge may have held long enough
+    _raw = pressed;
+    _rawMs = atMs;
+}
+
+void GestureRecognizer::touchPulse(uint32_t atMs) {
+    advance(atMs);  // Button events before the touch come out first
+    if (!_touching || atMs - _lastTouchMs >= _config.touchQuietMs) {
+        emit(INPUT_GESTURE, 0, GESTURE_TOUCH, atMs);
+    }
+    _touching = true;
+    _lastTouchMs = atMs;
+}
+
+void GestureRecognizer::advance(uint32_t nowMs) {
+    settle(nowMs);
+    expire(nowMs);
+}
+
+void GestureRecognizer::settle(uint32_t nowMs) {
+    if (_raw == _stable || nowMs - _rawMs < _config.debounceMs) return;
+
+    // Taps that ended before this change came first
+    expire(_rawMs);
+    _stable = _raw;
+    emit(_stable ? INPUT_PRESS : INPUT_RELEASE, 0, GESTURE_SINGLE, _rawMs);
+    if (_stable) tap(_rawMs);
+}
+
+void GestureRecognizer::expire(uint32_t nowMs) {
+    if (_taps == 0 || nowMs - _lastTapMs < _config.tapWindowMs) return;
+    emit(INPUT_GESTURE, _taps, (Gesture)(GESTURE_SINGLE + _taps - 1), _lastTapMs + _config.tapWindowMs);
+    _taps = 0;
+}
+
+void GestureRecognizer::tap(uint32_t atMs) {
+    _taps++;
+    _lastTapMs = atMs;
+    emit(INPUT_TAP, _taps, GESTURE_SINGLE, atMs);
+    if (_taps >= MAX_TAPS) {
+        emit(INPUT_GESTURE, _taps, GESTURE_OTA, atMs);
+        _taps = 0;
+    }
+}
+
+void GestureRecognizer::emit(InputEventType type, uint8_t taps, Gesture gesture, uint32_t atMs) {
+    if (_eventCount == EVENT_QUEUE) {
+        _lost++;
+        return;
+    }
+    InputEvent& event = _events[(_eventHead + _eventCount) % EVENT_QUEUE];
+    event.type = type;
+    event.taps = taps;
+    event.gesture = gesture;
+    event.atMs = atMs;
+    _eventCount++;
+}
+
+bool GestureRecognizer::next(InputEvent& event) {
+    if (_eventCount == 0) return false;
+    event = _events[_eventHead];
+    _eventHead = (uint8_t)((_eventHead + 1) % EVENT_QUEUE);
+    _eventCount--;
+    return true;
+}
+
+const char* gestureName(Gesture gesture) {
+    switch (gesture) {
+        case GESTURE_SINGLE: return "single";
+        case GESTURE_DOUBLE: return "double";
+        case GESTURE_SCAN: return "scan";
+        case GESTURE_BLE_TOGGLE: return "ble";
+        case GESTURE_OTA: return "ota";
+        case GESTURE_TOUCH: return "touch";
+    }
+    return "";
+}
@@ -0,0 +1,143 @@
+#ifndef GESTURE_RECOGNIZER_H
+#define GESTURE_RECOGNIZER_H
+
+#include <stdint.h>
+
+// Interrupt handlers must not call into flash: the queue's producer side
+// is inline and placed in IRAM on the target
+#ifdef ARDUINO
+#include <esp_attr.h>
+#define EDGE_QUEUE_ISR IRAM_ATTR
+#else
+#define EDGE_QUEUE_ISR
+#endif
+
+// Raw input edge as captured by an interrupt handler
+struct InputEdge {
+    uint32_t atMs;
+    bool active;  // Pressed / touched
+};
+
+// Lock-free ring for one producer (an ISR) and one consumer (a task).
+// Each side only writes its own index; a full queue drops the new edge
+// and counts it. Capacity is Size - 1; Size must be a power of two.
+template <uint8_t Size>
+class EdgeQueue {
+public:
+    EdgeQueue() : _head(0), _tail(0), _dropped(0) {}
+
+    inline bool EDGE_QUEUE_ISR push(uint32_t atMs, bool active) {
+        uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        uint8_t next = (uint8_t)((head + 1) & (Size - 1));
+        if (next == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE)) {
+            _dropped++;
+            return false;
+        }
+        _edges[head].atMs = atMs;
+        _edges[head].active = active;
+        __atomic_store_n(&_head, next, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool peek(InputEdge& edge) const {
+        uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+        if (tail == __atomic_load_n(&_head, __ATOMIC_ACQUIRE)) return false;
+        edge = _edges[tail];
+        return true;
+    }
+
+    void pop() {
+        uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+        if (tail == __atomic_load_n(&_head, __ATOMIC_ACQUIRE)) return;
+        __atomic_store_n(&_tail, (uint8_t)((tail + 1) & (Size - 1)), __ATOMIC_RELEASE);
+    }
+
+    uint32_t dropped() const { return _dropped; }
+
+private:
+    InputEdge _edges[Size];
+    uint8_t _head;  // Producer
+    uint8_t _tail;  // Consumer
+    volatile uint32_t _dropped;
+};
+
+enum Gesture : uint8_t {
+    GESTURE_SINGLE,      // 1 tap
+    GESTURE_DOUBLE,      // 2 taps
+    GESTURE_SCAN,        // 3 taps
+    GESTURE_BLE_TOGGLE,  // 4 taps
+    GESTURE_OTA,         // 5 taps, reported at the fifth without waiting
+    GESTURE_TOUCH,       // Touch pad
+};
+
+enum InputEventType : uint8_t {
+    INPUT_PRESS,    // Debounced button state changes
+    INPUT_RELEASE,
+    INPUT_TAP,      // A press counted towards a gesture (taps = count so far)
+    INPUT_GESTURE,
+};
+
+struct InputEvent {
+    InputEventType type;
+    uint8_t taps;
+    Gesture gesture;
+    uint32_t atMs;
+};
+
+struct GestureConfig {
+    uint32_t debounceMs;      // Button level must hold this long
+    uint32_t tapWindowMs;     // Gap that ends a tap sequence
+    uint32_t touchQuietMs;    // Touch pulses closer than this are one touch
+};
+
+// Turns raw button edges and touch pulses into taps and gestures.
+//
+// Feed edges in time order (from the interrupt queues) and call advance()
+// with the current time; events come out of next() in the order they
+// happened, whenever the edges were drained. A button level counts once
+// it has held for debounceMs, timed from its last bounce. A press more
+// than tapWindowMs after the previous one starts a new sequence; the
+// gesture for a sequence is reported once the window passes with no
+// further press (five taps report at once). The touch pad interrupts
+// repeatedly while touched, so pulses with gaps under touchQuietMs are
+// one touch. Not thread safe.
+class GestureRecognizer {
+public:
+    explicit GestureRecognizer(const GestureConfig& config);
+
+    void buttonEdge(uint32_t atMs, bool pressed);
+    void touchPulse(uint32_t atMs);
+    void advance(uint32_t nowMs);
+
+    bool next(InputEvent& event);
+
+    bool pressed() const { return _stable; }
+    uint8_t pendingTaps() const { return _taps; }  // In the current sequence
+    uint32_t lostEvents() const { return _lost; }
+
+    static const uint8_t MAX_TAPS = 5;
+    static const uint8_t EVENT_QUEUE = 32;
+
+private:
+    void settle(uint32_t nowMs);
+    void expire(uint32_t nowMs);
+    void tap(uint32_t atMs);
+    void emit(InputEventType type, uint8_t taps, Gesture gesture, uint32_t atMs);
+
+    GestureConfig _config;
+    bool _raw;
+    uint32_t _rawMs;
+    bool _stable;
+    uint8_t _taps;
+    uint32_t _lastTapMs;
+    bool _touching;
+    uint32_t _lastTouchMs;
+    InputEvent _events[EVENT_QUEUE];
+    uint8_t _eventHead;
+    uint8_t _eventCount;
+    uint32_t _lost;
+};
+
+const char* gestureName(Gesture gesture);
+
+#endif
@@ -0,0 +1,69 @@
+#include "GnssAssist.h"
+
+#include <string.h>
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+uint32_t gnssUnixTime(uint32_t utcDate, uint32_t utcTime) {
+    uint32_t day = utcDate / 10000;
+    uint32_t month = (utcDate / 100) % 100;
+    uint32_t year = 2000 + utcDate % 100;
+    if (day < 1 || day > 31 || month < 1 || month > 12) return 0;
+
+    uint32_t hhmmss = utcTime / 100;
+    uint32_t seconds = (hhmmss / 10000) * 3600 + ((hhmmss / 100) % 100) * 60 + hhmmss % 100;
+    return (uint32_t)daysFromCivil((int32_t)year, month, day) * 86400 + seconds;
+}
+
+bool storeFix(const GnssFix& fix, StoredFix& out) {
+    if (!fix.valid) return false;
+    memset(&out, 0, sizeof(out));
+    out.version = STORED_FIX_VERSION;
+    out.latitude = fix.latitude;
+    out.longitude = fix.longitude;
+    out.altitude = fix.altitude;
+    out.unixTime = gnssUnixTime(fix.utcDate, fix.utcTime);
+    return true;
+}
+
+bool storedFixValid(const StoredFix& stored) {
+    return stored.version == STORED_FIX_VERSION &&
+           stored.latitude >= -90 && stored.latitude <= 90 &&
+           stored.longitude >= -180 && stored.longitude <= 180;
+}
+
+GnssStart chooseGnssStart(const StoredFix* stored, uint32_t nowUnix) {
+    if (stored == NULL || !storedFixValid(*stored)) return GNSS_START_COLD;
+    if (nowUnix == 0 || stored->unixTime == 0 || nowUnix < stored->unixTime) return GNSS_START_WARM;
+
+    uint32_t age = nowUnix - stored->unixTime;
+    if (age < GNSS_HOT_MAX_AGE_S) return GNSS_START_HOT;
+    if (age < GNSS_WARM_MAX_AGE_S) return GNSS_START_WARM;
+    return GNSS_START_COLD;
+}
+
+const char* gnssStartCommand(GnssStart start) {
+    switch (start) {
+        case GNSS_START_HOT: return "+CGNSHOT";
+        case GNSS_START_WARM: return "+CGNSWARM";
+        default: return NULL;
+    }
+}
+
+const char* gnssStartName(GnssStart start) {
+    switch (start) {
+        case GNSS_START_COLD: return "cold";
+        case GNSS_START_WARM: return "warm";
+        case GNSS_START_HOT: return "hot";
+        case GNSS_START_RUNNING: return "running";
+    }
+    return "";
+}
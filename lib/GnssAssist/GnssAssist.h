@@ -0,0 +1,48 @@
+#ifndef GNSS_ASSIST_H
+#define GNSS_ASSIST_H
+
+#include <stdint.h>
+
+#include "NmeaStream.h"
+
+// How the GNSS engine is (re)started at power-up. Hot reuses the
+// ephemeris the modem still holds (hours old at most); warm starts from
+// the almanac plus a rough position and time; cold searches the sky.
+enum GnssStart : uint8_t {
+    GNSS_START_COLD,
+    GNSS_START_WARM,
+    GNSS_START_HOT,
+    GNSS_START_RUNNING,  // Engine was already on (modem kept power) - left alone
+};
+
+#define GNSS_HOT_MAX_AGE_S (4UL * 3600)       // Broadcast ephemeris validity
+#define GNSS_WARM_MAX_AGE_S (30UL * 86400)    // Almanac stays usable for weeks
+
+// Last good fix as persisted across boots (NVS blob)
+struct StoredFix {
+    uint32_t version;
+    double latitude;
+    double longitude;
+    float altitude;
+    uint32_t unixTime;  // UTC of the fix, 0 = unknown
+};
+
+#define STORED_FIX_VERSION 1
+
+// UTC from the NMEA date (ddmmyy) and time (hhmmss * 100 + hundredths)
+// as Unix seconds; 0 if the date is unknown
+uint32_t gnssUnixTime(uint32_t utcDate, uint32_t utcTime);
+
+bool storeFix(const GnssFix& fix, StoredFix& out);  // false for an invalid fix
+bool storedFixValid(const StoredFix& stored);
+
+// Pick the start for a powered-down engine. nowUnix 0 = clock not set,
+// in which case a stored fix is assumed too old for a hot start.
+GnssStart chooseGnssStart(const StoredFix* stored, uint32_t nowUnix);
+
+// AT command (without "AT") to restart the engine in that mode after
+// +CGNSPWR=1, or NULL when the power-up default (cold) is fine
+const char* gnssStartCommand(GnssStart start);
+const char* gnssStartName(GnssStart start);
+
+#endif
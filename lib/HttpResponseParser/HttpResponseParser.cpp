@@ -0,0 +1,191 @@
+#include "HttpResponseParser.h"
+
+#include <ctype.h>
+#include <string.h>
+
+// Case-insensitive "name:" match; returns the value with leading spaces skipped
+static const char* headerValue(const char* line, const char* name) {
+    size_t n = strlen(name);
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)line[i]) != name[i]) return NULL;
+    }
+    if (line[n] != ':') return NULL;
+    const char* value = line + n + 1;
+    while (*value == ' ' || *value == '\t') value++;
+    return value;
+}
+
+static bool containsToken(const char* value, const char* token) {
+    size_t n = strlen(token);
+    for (const char* p = value; *p; p++) {
+        size_t i = 0;
+        while (i < n && p[i] && tolower((unsigned char)p[i]) == token[i]) i++;
+        if (i == n) return true;
+    }
+    return false;
+}
+
+HttpResponseParser::HttpResponseParser(char* body, size_t bodySize)
+    : _body(body), _bodySize(bodySize) {
+    reset();
+}
+
+void HttpResponseParser::reset() {
+    _lineLength = 0;
+    _line[0] = '\0';
+    _state = STATUS_LINE;
+    _status = 0;
+    _keepAlive = true;
+    _chunked = false;
+    _hasLength = false;
+    _remaining = 0;
+    _bodyLength = 0;
+    _received = 0;
+    if (_body && _bodySize > 0) _body[0] = '\0';
+}
+
+bool HttpResponseParser::lineByte(char c) {
+    if (c == '\n') {
+        if (_lineLength > 0 && _line[_lineLength - 1] == '\r') _lineLength--;
+        _line[_lineLength] = '\0';
+        _lineLength = 0;
+        return true;
+    }
+    // Long header lines (cookies) are truncated; only short ones matter
+    if (_lineLength < sizeof(_line) - 1) _line[_lineLength++] = c;
+    return false;
+}
+
+void HttpResponseParser::handleStatusLine() {
+    // "HTTP/1.1 200 OK"
+    if (strncmp(_line, "HTTP/1.", 7) != 0 || _line[8] != ' ') {
+        _state = FAILED;
+        return;
+    }
+    _keepAlive = _line[7] != '0';  // HTTP/1.0 closes unless told otherwise
+    _status = 0;
+    for (const char* p = _line + 9; *p >= '0' && *p <= '9'; p++) {
+        _status = _status * 10 + (*p - '0');
+    }
+    _state = _status >= 100 ? HEADERS : FAILED;
+}
+
+void HttpResponseParser::handleHeader() {
+    const char* value;
+    if ((value = headerValue(_line, "content-length")) != NULL) {
+        _remaining = 0;
+        for (const char* p = value; *p >= '0' && *p <= '9'; p++) {
+            _remaining = _remaining * 10 + (uint32_t)(*p - '0');
+        }
+        _hasLength = true;
+    } else if ((value = headerValue(_line, "transfer-encoding")) != NULL) {
+        _chunked = containsToken(value, "chunked");
+    } else if ((value = headerValue(_line, "connection")) != NULL) {
+        if (containsToken(value, "close")) _keepAlive = false;
+        else if (containsToken(value, "keep-alive")) _keepAlive = true;
+    }
+}
+
+void HttpResponseParser::headersDone() {
+    if (_status < 200) {
+        // 100 Continue and friends: the real response follows
+        _state = STATUS_LINE;
+        _hasLength = false;
+        _chunked = false;
+        return;
+    }
+    if (_status == 204 || _status == 304) {
+        _state = DONE;
+    } else if (_chunked) {
+        _state = CHUNK_SIZE;
+    } else if (_hasLength) {
+        _state = _remaining > 0 ? BODY : DONE;
+    } else {
+        // Body runs until the server closes the connection
+        _keepAlive = false;
+        _state = BODY;
+    }
+}
+
+void HttpResponseParser::handleChunkSize() {
+    uint32_t size = 0;
+    bool digits = false;
+    for (const char* p = _line; *p; p++) {
+        char c = (char)tolower((unsigned char)*p);
+        if (c >= '0' && c <= '9') size = size * 16 + (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') size = size * 16 + (uint32_t)(c - 'a' + 10);
+        else break;  // Chunk extensions
+        digits = true;
+    }
+    if (!digits) {
+        _state = FAILED;
+        return;
+    }
+    _remaining = size;
+    _state = size > 0 ? CHUNK_DATA : TRAILERS;
+}
+
+void HttpResponseParser::bodyBytes(const uint8_t* data, size_t length) {
+    if (_body && _bodySize > 0 && _bodyLength < _bodySize - 1) {
+        size_t room = _bodySize - 1 - _bodyLength;
+        size_t n = length < room ? length : room;
+        memcpy(_body + _bodyLength, data, n);
+        _body[_bodyLength + n] = '\0';
+    }
+    _bodyLength += length;
+}
+
+size_t HttpResponseParser::feed(const uint8_t* data, size_t length) {
+    size_t i = 0;
+    while (i < length && _state != DONE && _state != FAILED) {
+        if (_state == BODY || _state == CHUNK_DATA) {
+            size_t n = length - i;
+            bool delimited = _state == CHUNK_DATA || _hasLength;
+            if (delimited && n > _remaining) n = _remaining;
+            bodyBytes(data + i, n);
+            i += n;
+            _received += n;
+            if (delimited) {
+                _remaining -= (uint32_t)n;
+                if (_remaining == 0) _state = _state == BODY ? DONE : CHUNK_DATA_END;
+            }
+            continue;
+        }
+
+        char c = (char)data[i++];
+        _received++;
+        if (!lineByte(c)) continue;
+
+        switch (_state) {
+            case STATUS_LINE:
+                // Tolerate blank lines left over from a previous response
+                if (_line[0] != '\0') handleStatusLine();
+                break;
+            case HEADERS:
+                if (_line[0] == '\0') headersDone();
+                else handleHeader();
+                break;
+            case CHUNK_SIZE:
+                handleChunkSize();
+                break;
+            case CHUNK_DATA_END:
+                _state = _line[0] == '\0' ? CHUNK_SIZE : FAILED;
+                break;
+            case TRAILERS:
+                if (_line[0] == '\0') _state = DONE;
+                break;
+            default:
+                break;
+        }
+    }
+    return i;
+}
+
+void HttpResponseParser::finish() {
+    if (_state == BODY && !_hasLength) {
+        _state = DONE;
+    } else if (_state != DONE) {
+        _state = FAILED;
+    }
+    _keepAlive = false;
+}
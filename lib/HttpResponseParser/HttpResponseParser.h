@@ -0,0 +1,69 @@
+#ifndef HTTP_RESPONSE_PARSER_H
+#define HTTP_RESPONSE_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental HTTP/1.x response parser for raw sockets (e.g. a modem TLS
+// socket, where the ESP32 HTTPClient can't be used).
+//
+// Feed bytes as they arrive; the parser stops consuming at the end of the
+// response, so leftover bytes belong to the next response on a kept-alive
+// connection. Handles Content-Length, chunked transfer encoding and
+// bodies delimited by connection close. The body is copied into the
+// caller's buffer (truncated, NUL terminated) or discarded.
+class HttpResponseParser {
+public:
+    HttpResponseParser(char* body = NULL, size_t bodySize = 0);
+
+    void reset();
+
+    // Returns the number of bytes consumed
+    size_t feed(const uint8_t* data, size_t length);
+
+    // The server closed the connection. Completes a close-delimited body.
+    void finish();
+
+    bool done() const { return _state == DONE; }
+    bool failed() const { return _state == FAILED; }
+    bool started() const { return _received > 0; }
+
+    int status() const { return _status; }
+    bool keepAlive() const { return _keepAlive; }
+    size_t bodyLength() const { return _bodyLength; }  // Bytes received, may exceed the buffer
+
+private:
+    enum State : uint8_t {
+        STATUS_LINE,
+        HEADERS,
+        BODY,           // Content-Length or until close
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_DATA_END,  // CRLF after chunk data
+        TRAILERS,
+        DONE,
+        FAILED,
+    };
+
+    bool lineByte(char c);  // Returns true when a complete line is in _line
+    void handleStatusLine();
+    void handleHeader();
+    void headersDone();
+    void handleChunkSize();
+    void bodyBytes(const uint8_t* data, size_t length);
+
+    char* _body;
+    size_t _bodySize;
+    char _line[128];
+    size_t _lineLength;
+    State _state;
+    int _status;
+    bool _keepAlive;
+    bool _chunked;
+    bool _hasLength;
+    uint32_t _remaining;  // Of the body or current chunk
+    size_t _bodyLength;
+    size_t _received;
+};
+
+#endif
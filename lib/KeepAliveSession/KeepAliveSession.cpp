@@ -0,0 +1,69 @@
+#include "KeepAliveSession.h"
+
+#include <string.h>
+
+KeepAliveSession::KeepAliveSession(SessionTransport& transport, const SessionConfig& config)
+    : _transport(transport), _config(config), _address(0), _resolvedMs(0), _lastUsedMs(0),
+      _resolved(false), _lastReused(false), _lastRetried(false), _lastHandshakeMs(0),
+      _lastRequestMs(0), _handshakes(0), _requests(0), _lookups(0) {
+    _host[0] = '\0';
+    _resolvedHost[0] = '\0';
+}
+
+int KeepAliveSession::request(const char* host, const char* path, const char* body, size_t length) {
+    _lastRetried = false;
+    if (strlen(host) >= HOST_MAX) return CONNECT_FAILED;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        _lastReused = isOpen(host, _transport.nowMs());
+        if (!_lastReused && !open(host)) return CONNECT_FAILED;
+
+        uint32_t start = _transport.nowMs();
+        int code = _transport.exchange(host, path, body, length);
+        _lastUsedMs = _transport.nowMs();
+        _lastRequestMs = _lastUsedMs - start;
+        _requests++;
+
+        if (code > 0 || !_lastReused || !_transport.failedBeforeResponse(code)) return code;
+        close();
+        _lastRetried = true;
+    }
+    return CONNECT_FAILED;  // Not reached: the second attempt is never on a reused socket
+}
+
+void KeepAliveSession::close() {
+    _transport.stop();
+    _host[0] = '\0';
+}
+
+bool KeepAliveSession::isOpen(const char* host, uint32_t nowMs) {
+    return _host[0] != '\0' && strcmp(host, _host) == 0 && nowMs - _lastUsedMs < _config.idleCloseMs &&
+           _transport.connected();
+}
+
+bool KeepAliveSession::open(const char* host) {
+    close();
+
+    uint32_t now = _transport.nowMs();
+    if (!_resolved || strcmp(host, _resolvedHost) != 0 || now - _resolvedMs > _config.dnsTtlMs) {
+        _lookups++;
+        if (!_transport.resolve(host, _address)) {
+            _resolved = false;
+            return false;
+        }
+        strcpy(_resolvedHost, host);
+        _resolvedMs = now;
+        _resolved = true;
+    }
+
+    uint32_t start = _transport.nowMs();
+    if (!_transport.connect(_address, host)) {
+        _resolved = false;  // Host may have moved
+        return false;
+    }
+    _lastHandshakeMs = _transport.nowMs() - start;
+    _handshakes++;
+    strcpy(_host, host);
+    _lastUsedMs = _transport.nowMs();
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef KEEP_ALIVE_SESSION_H
+#define KEEP_ALIVE_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The socket and HTTP client under a KeepAliveSession (WiFiClientSecure
+// and HTTPClient on the device)
+class SessionTransport {
+public:
+    virtual ~SessionTransport() {}
+    virtual uint32_t nowMs() = 0;
+    // DNS lookup; the IPv4 address is opaque to the session
+    virtual bool resolve(const char* host, uint32_t& address) = 0;
+    // TCP + TLS to address, sending host for SNI
+    virtual bool connect(uint32_t address, const char* host) = 0;
+    virtual bool connected() = 0;
+    virtual void stop() = 0;
+    // One request/response on the open connection, reading the whole
+    // response. GET when body is NULL. Returns the HTTP status or a
+    // negative error code.
+    virtual int exchange(const char* host, const char* path, const char* body, size_t length) = 0;
+    // The failure happened before any response - what a kept-alive
+    // socket the server has already closed looks like
+    virtual bool failedBeforeResponse(int code) = 0;
+};
+
+struct SessionConfig {
+    uint32_t dnsTtlMs;     // Re-resolve the host after this long
+    uint32_t idleCloseMs;  // Don't reuse a socket idle this long
+};
+
+// HTTPS connection to one host kept open between requests.
+//
+// The resolved address is cached for dnsTtlMs and the socket is reused
+// through HTTP keep-alive, so a request is normally just a
+// request/response instead of DNS + TCP + TLS handshake + request. A
+// reused socket that fails before any response is retried once on a
+// fresh connection; a failed connect forgets the address in case the
+// host moved. Not thread safe.
+class KeepAliveSession {
+public:
+    // Returned when no connection could be opened (HTTPClient's
+    // HTTPC_ERROR_CONNECTION_REFUSED)
+    static const int CONNECT_FAILED = -1;
+    static const size_t HOST_MAX = 64;
+
+    KeepAliveSession(SessionTransport& transport, const SessionConfig& config);
+
+    // Returns the HTTP status or a negative error code
+    int request(const char* host, const char* path, const char* body, size_t length);
+    void close();
+
+    bool lastReused() const { return _lastReused; }    // Last request went out on a kept socket
+    bool lastRetried() const { return _lastRetried; }  // ... which was stale and was replaced
+
+    // Timing of the most recent handshake and request, for diagnostics
+    uint32_t lastHandshakeMs() const { return _lastHandshakeMs; }
+    uint32_t lastRequestMs() const { return _lastRequestMs; }
+    uint32_t handshakes() const { return _handshakes; }
+    uint32_t requests() const { return _requests; }
+    uint32_t lookups() const { return _lookups; }
+
+private:
+    bool isOpen(const char* host, uint32_t nowMs);
+    bool open(const char* host);
+
+    SessionTransport& _transport;
+    SessionConfig _config;
+    char _host[HOST_MAX];          // Host of the open socket, empty = none
+    char _resolvedHost[HOST_MAX];
+    uint32_t _address;
+    uint32_t _resolvedMs;
+    uint32_t _lastUsedMs;
+    bool _resolved;
+    bool _lastReused;
+    bool _lastRetried;
+    uint32_t _lastHandshakeMs;
+    uint32_t _lastRequestMs;
+    uint32_t _handshakes;
+    uint32_t _requests;
+    uint32_t _lookups;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "MelodySequencer.h"
+
+uint32_t melodyDuration(const Melody& melody) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < melody.length; i++) {
+        total += melody.notes[i].durationMs;
+    }
+    return total;
+}
+
+MelodySequencer::MelodySequencer(ToneOutput output)
+    : _output(output), _current(), _playing(false), _index(0), _noteEndMs(0),
+      _frequency(0), _queue(), _queued(0), _dropped(0), _preempted(0) {}
+
+bool MelodySequencer::play(const Melody& melody) {
+    if (melody.length == 0) return true;
+
+    if (_playing && melody.priority > _current.priority) {
+        // Cut off the current melody; update() starts the queue head
+        _playing = false;
+        _preempted++;
+    }
+
+    if (_queued == QUEUE_SIZE) {
+        // Make room by discarding the lowest priority entry (the tail)
+        if (_queue[_queued - 1].priority >= melody.priority) {
+            _dropped++;
+            return false;
+        }
+        _queued--;
+        _dropped++;
+    }
+
+    // Keep the queue ordered by priority, FIFO within a priority
+    uint8_t pos = _queued;
+    while (pos > 0 && _queue[pos - 1].priority < melody.priority) {
+        _queue[pos] = _queue[pos - 1];
+        pos--;
+    }
+    _queue[pos] = melody;
+    _queued++;
+    return true;
+}
+
+void MelodySequencer::start(const Melody& melody, uint32_t nowMs) {
+    _current = melody;
+    _index = 0;
+    _playing = true;
+    setTone(melody.notes[0].frequency);
+    _noteEndMs = nowMs + melody.notes[0].durationMs;
+}
+
+uint32_t MelodySequencer::update(uint32_t nowMs) {
+    for (;;) {
+        if (!_playing) {
+            if (_queued == 0) {
+                setTone(0);
+                return 0;
+            }
+            Melody next = _queue[0];
+            for (uint8_t i = 1; i < _queued; i++) _queue[i - 1] = _queue[i];
+            _queued--;
+            start(next, nowMs);
+        }
+
+        if ((int32_t)(nowMs - _noteEndMs) < 0) {
+            return _noteEndMs - nowMs;
+        }
+
+        // Note finished. Timing is relative to when update() actually ran,
+        // so a late timer stretches a note instead of skipping the next.
+        _index++;
+        if (_index >= _current.length) {
+            _playing = false;
+            continue;
+        }
+        const Note& note = _current.notes[_index];
+        setTone(note.frequency);
+        _noteEndMs = nowMs + note.durationMs;
+    }
+}
+
+void MelodySequencer::stop() {
+    _playing = false;
+    _queued = 0;
+    setTone(0);
+}
+
+void MelodySequencer::setTone(uint16_t frequency) {
+    if (frequency == _frequency) return;
+    _frequency = frequency;
+    if (_output) _output(frequency);
+}
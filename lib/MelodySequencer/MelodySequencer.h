@@ -0,0 +1,83 @@
+#ifndef MELODY_SEQUENCER_H
+#define MELODY_SEQUENCER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One step of a melody. frequency 0 is a rest.
+struct Note {
+    uint16_t frequency;   // Hz
+    uint16_t durationMs;
+};
+
+// Higher priority melodies cut off lower ones
+enum MelodyPriority : uint8_t {
+    MELODY_PRIORITY_CLICK = 0,   // Tap feedback
+    MELODY_PRIORITY_STATUS = 1,  // Connect/disconnect, success
+    MELODY_PRIORITY_ALERT = 2,   // Failures, firmware update
+};
+
+struct Melody {
+    const Note* notes;
+    uint8_t length;
+    uint8_t priority;
+};
+
+// Build a Melody from a note table at compile time:
+//   constexpr Note SUCCESS_NOTES[] = {{1200, 60}, {0, 40}, {1500, 80}};
+//   constexpr Melody SUCCESS = makeMelody(SUCCESS_NOTES, MELODY_PRIORITY_STATUS);
+template <size_t N>
+constexpr Melody makeMelody(const Note (&notes)[N], uint8_t priority) {
+    return Melody{notes, (uint8_t)N, priority};
+}
+
+// Total length of a melody in ms
+uint32_t melodyDuration(const Melody& melody);
+
+// Plays queued melodies note by note without blocking the caller.
+//
+// The owner calls update() with the current time whenever the returned
+// delay expires (from a timer) and right after play(); tone changes go
+// to the output callback. A melody with higher priority than the one
+// playing cuts it off; otherwise it waits in a priority-ordered queue.
+// Not thread safe - the owner serializes play()/update()/stop().
+class MelodySequencer {
+public:
+    typedef void (*ToneOutput)(uint16_t frequency);  // 0 = silence
+
+    static const uint8_t QUEUE_SIZE = 4;
+
+    explicit MelodySequencer(ToneOutput output);
+
+    // Returns false if the melody was discarded (queue full of
+    // equal or higher priority melodies)
+    bool play(const Melody& melody);
+
+    // Start/advance notes due at nowMs. Returns ms until the next note
+    // change, or 0 when idle.
+    uint32_t update(uint32_t nowMs);
+
+    // Silence the buzzer and drop everything queued
+    void stop();
+
+    bool busy() const { return _playing || _queued > 0; }
+    uint32_t dropped() const { return _dropped; }
+    uint32_t preempted() const { return _preempted; }
+
+private:
+    void start(const Melody& melody, uint32_t nowMs);
+    void setTone(uint16_t frequency);
+
+    ToneOutput _output;
+    Melody _current;
+    bool _playing;
+    uint8_t _index;
+    uint32_t _noteEndMs;
+    uint16_t _frequency;  // Currently output tone
+    Melody _queue[QUEUE_SIZE];
+    uint8_t _queued;
+    uint32_t _dropped;
+    uint32_t _preempted;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "MoistureFilter.h"
+
+MedianEmaFilter::MedianEmaFilter(uint8_t window, uint8_t shift) : _shift(shift) {
+    if (window < 1) window = 1;
+    if (window > MAX_WINDOW) window = MAX_WINDOW;
+    if (window % 2 == 0) window--;
+    _window = window;
+    reset();
+}
+
+void MedianEmaFilter::reset() {
+    _head = 0;
+    _count = 0;
+    _average = 0;
+}
+
+uint16_t MedianEmaFilter::median() const {
+    uint8_t n = _count < _window ? (uint8_t)_count : _window;
+    uint16_t sorted[MAX_WINDOW];
+    for (uint8_t i = 0; i < n; i++) {
+        uint16_t v = _ring[i];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    return sorted[n / 2];
+}
+
+void MedianEmaFilter::add(uint16_t sample) {
+    _ring[_head] = sample;
+    _head = (uint8_t)((_head + 1) % _window);
+    bool first = _count == 0;
+    if (_count < 0xFFFFFFFF) _count++;
+
+    uint32_t target = (uint32_t)median() << 16;
+    if (first) {
+        _average = target;
+    } else if (target >= _average) {
+        _average += (target - _average) >> _shift;
+    } else {
+        _average -= (_average - target) >> _shift;
+    }
+}
+
+uint16_t moisturePermille(uint16_t millivolts, uint16_t dryMv, uint16_t wetMv) {
+    if (dryMv <= wetMv) return 0;
+    if (millivolts >= dryMv) return 0;
+    if (millivolts <= wetMv) return 1000;
+    return (uint16_t)(((uint32_t)(dryMv - millivolts) * 1000 + (dryMv - wetMv) / 2) / (dryMv - wetMv));
+}
@@ -0,0 +1,43 @@
+#ifndef MOISTURE_FILTER_H
+#define MOISTURE_FILTER_H
+
+#include <stdint.h>
+
+// Running median of the last `window` samples followed by an exponential
+// moving average with alpha = 1 / 2^shift. The median throws out spikes
+// (pump motors, a WiFi TX burst on the supply) before they can drag the
+// average; the average smooths what is left. Integer only: the average
+// is kept in 16.16 fixed point, so each add() is a few dozen
+// instructions and value() is a load. Not thread safe.
+class MedianEmaFilter {
+public:
+    static const uint8_t MAX_WINDOW = 9;
+
+    // window is clamped to 1..MAX_WINDOW and made odd
+    MedianEmaFilter(uint8_t window, uint8_t shift);
+
+    void add(uint16_t sample);
+    void reset();
+
+    // Filtered value, rounded; 0 before the first sample
+    uint16_t value() const { return (uint16_t)((_average + 0x8000) >> 16); }
+    uint32_t count() const { return _count; }
+    // Enough samples for a full median window
+    bool settled() const { return _count >= _window; }
+
+private:
+    uint16_t median() const;
+
+    uint8_t _window;
+    uint8_t _shift;
+    uint16_t _ring[MAX_WINDOW];
+    uint8_t _head;
+    uint32_t _count;
+    uint32_t _average;  // 16.16
+};
+
+// 0..1000 (tenths of a percent) between the dry and wet probe voltages;
+// a dry probe reads higher
+uint16_t moisturePermille(uint16_t millivolts, uint16_t dryMv, uint16_t wetMv);
+
+#endif
@@ -0,0 +1,193 @@
+#include "NetworkScorer.h"
+
+#include <string.h>
+
+// Record layout: magic u32, version u8, count u8, checksum u32 (FNV-1a of
+// the entries), then count NetworkStats as laid out in memory
+#define RECORD_MAGIC 0x57534352  // "WSCR"
+#define RECORD_VERSION 1
+#define HEADER_SIZE 10
+#define RECORD_MAX (HEADER_SIZE + NetworkScorer::CAPACITY * sizeof(NetworkStats))
+
+#define RSSI_FLOOR -90    // Barely usable
+#define RSSI_CEILING -50  // As good as it gets for throughput
+#define CONNECT_SLOW_MS 7500  // tryConnect() timeout
+
+#define WEIGHT_RSSI 400
+#define WEIGHT_CONNECT 250
+#define WEIGHT_POST 150
+#define WEIGHT_TIME 100
+#define WEIGHT_PREFERENCE 100
+
+static const uint8_t NO_BSSID[6] = {0, 0, 0, 0, 0, 0};
+
+static uint32_t fnv1a(const uint8_t* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// successes / trials with one success and one failure assumed up front
+static uint32_t smoothedRate(uint32_t successes, uint32_t trials, uint32_t weight) {
+    return (successes + 1) * weight / (trials + 2);
+}
+
+uint16_t scoreNetwork(const ScanEntry& entry, const NetworkStats* stats) {
+    int32_t rssi = entry.rssi;
+    if (rssi < RSSI_FLOOR) rssi = RSSI_FLOOR;
+    if (rssi > RSSI_CEILING) rssi = RSSI_CEILING;
+    uint32_t score = (uint32_t)(rssi - RSSI_FLOOR) * WEIGHT_RSSI / (RSSI_CEILING - RSSI_FLOOR);
+
+    uint8_t preference = entry.preference > 100 ? 100 : entry.preference;
+    score += (uint32_t)preference * WEIGHT_PREFERENCE / 100;
+
+    if (stats == NULL) {
+        return (uint16_t)(score + (WEIGHT_CONNECT + WEIGHT_POST + WEIGHT_TIME) / 2);
+    }
+
+    score += smoothedRate(stats->connects, stats->attempts, WEIGHT_CONNECT);
+    score += smoothedRate(stats->postsOk, stats->posts, WEIGHT_POST);
+    if (stats->connects == 0) {
+        score += WEIGHT_TIME / 2;
+    } else {
+        uint32_t ms = stats->connectMs < CONNECT_SLOW_MS ? stats->connectMs : CONNECT_SLOW_MS;
+        score += (CONNECT_SLOW_MS - ms) * WEIGHT_TIME / CONNECT_SLOW_MS;
+    }
+    return (uint16_t)score;
+}
+
+NetworkScorer::NetworkScorer(BlobStorage& storage)
+    : _storage(storage), _count(0), _useCounter(0), _dirty(false) {}
+
+bool NetworkScorer::begin() {
+    uint8_t record[RECORD_MAX];
+    size_t length = _storage.load(record, sizeof(record));
+    _count = 0;
+    _useCounter = 0;
+    _dirty = false;
+
+    if (length < HEADER_SIZE || getU32(record) != RECORD_MAGIC || record[4] != RECORD_VERSION) return false;
+    uint8_t count = record[5];
+    if (count > CAPACITY || length != HEADER_SIZE + count * sizeof(NetworkStats)) return false;
+    if (getU32(record + 6) != fnv1a(record + HEADER_SIZE, length - HEADER_SIZE)) return false;
+
+    memcpy(_stats, record + HEADER_SIZE, count * sizeof(NetworkStats));
+    _count = count;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_stats[i].lastUsed > _useCounter) _useCounter = _stats[i].lastUsed;
+    }
+    return true;
+}
+
+bool NetworkScorer::flush() {
+    if (!_dirty) return true;
+
+    uint8_t record[RECORD_MAX];
+    size_t length = HEADER_SIZE + _count * sizeof(NetworkStats);
+    memcpy(record + HEADER_SIZE, _stats, _count * sizeof(NetworkStats));
+    putU32(record, RECORD_MAGIC);
+    record[4] = RECORD_VERSION;
+    record[5] = _count;
+    putU32(record + 6, fnv1a(record + HEADER_SIZE, length - HEADER_SIZE));
+
+    if (!_storage.save(record, length)) return false;
+    _dirty = false;
+    return true;
+}
+
+const NetworkStats* NetworkScorer::find(const char* ssid, const uint8_t* bssid) const {
+    return const_cast<NetworkScorer*>(this)->lookup(ssid, bssid, false);
+}
+
+NetworkStats* NetworkScorer::lookup(const char* ssid, const uint8_t* bssid, bool create) {
+    if (ssid == NULL || ssid[0] == '\0') return NULL;
+    if (bssid == NULL) bssid = NO_BSSID;
+    uint32_t hash = fnv1a((const uint8_t*)ssid, strlen(ssid));
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_stats[i].ssidHash == hash && memcmp(_stats[i].bssid, bssid, 6) == 0) return &_stats[i];
+    }
+    if (!create) return NULL;
+
+    uint8_t slot = _count;
+    if (_count < CAPACITY) {
+        _count++;
+    } else {
+        slot = 0;
+        for (uint8_t i = 1; i < _count; i++) {
+            if (_stats[i].lastUsed < _stats[slot].lastUsed) slot = i;
+        }
+    }
+    memset(&_stats[slot], 0, sizeof(NetworkStats));
+    _stats[slot].ssidHash = hash;
+    memcpy(_stats[slot].bssid, bssid, 6);
+    return &_stats[slot];
+}
+
+uint16_t NetworkScorer::score(const ScanEntry& entry) const {
+    return scoreNetwork(entry, find(entry.ssid, entry.bssid));
+}
+
+uint8_t NetworkScorer::rank(const ScanEntry* scan, uint8_t count, uint8_t* order) const {
+    uint16_t scores[256];
+    for (uint16_t i = 0; i < count; i++) {
+        scores[i] = score(scan[i]);
+        order[i] = (uint8_t)i;
+    }
+
+    // Insertion sort: scans are short, and equal scores keep scan order
+    for (uint16_t i = 1; i < count; i++) {
+        uint8_t index = order[i];
+        uint16_t j = i;
+        while (j > 0 && scores[order[j - 1]] < scores[index]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = index;
+    }
+    return count;
+}
+
+void NetworkScorer::recordConnect(const char* ssid, const uint8_t* bssid, bool connected, uint32_t elapsedMs) {
+    NetworkStats* stats = lookup(ssid, bssid, true);
+    if (stats == NULL) return;
+
+    if (stats->attempts >= HISTORY_MAX) {
+        stats->attempts /= 2;
+        stats->connects /= 2;
+    }
+    stats->attempts++;
+    if (connected) {
+        uint16_t ms = elapsedMs > 0xFFFF ? 0xFFFF : (uint16_t)elapsedMs;
+        // Average over roughly the last four connects
+        stats->connectMs = stats->connects == 0 ? ms : (uint16_t)((stats->connectMs * 3u + ms) / 4);
+        stats->connects++;
+    }
+    stats->lastUsed = ++_useCounter;
+    _dirty = true;
+}
+
+void NetworkScorer::recordPost(const char* ssid, const uint8_t* bssid, bool ok) {
+    NetworkStats* stats = lookup(ssid, bssid, true);
+    if (stats == NULL) return;
+
+    if (stats->posts >= HISTORY_MAX) {
+        stats->posts /= 2;
+        stats->postsOk /= 2;
+    }
+    stats->posts++;
+    if (ok) stats->postsOk++;
+    stats->lastUsed = ++_useCounter;
+    _dirty = true;
+}
@@ -0,0 +1,75 @@
+#ifndef NETWORK_SCORER_H
+#define NETWORK_SCORER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CredentialStore.h"
+
+// One access point from a scan, as the caller sees it
+struct ScanEntry {
+    const char* ssid;
+    const uint8_t* bssid;  // 6 bytes, NULL if unknown
+    int8_t rssi;           // dBm
+    uint8_t preference;    // 0..100 caller bias, e.g. saved > default > open
+};
+
+// What we've learned about one access point (SSID + BSSID)
+struct NetworkStats {
+    uint32_t ssidHash;
+    uint8_t bssid[6];
+    uint8_t attempts;
+    uint8_t connects;
+    uint8_t posts;
+    uint8_t postsOk;
+    uint16_t connectMs;  // Moving average of successful connects
+    uint32_t lastUsed;   // Store-wide use counter, for eviction
+};
+
+#define SCORE_MAX 1000
+
+// Score 0..SCORE_MAX for connecting to an access point now. Current RSSI
+// counts most; past connect and post success rates (with a 50% prior, so
+// one failure doesn't bury a network) and the average connect time come
+// next; the caller's preference breaks near-ties. stats NULL = never seen.
+uint16_t scoreNetwork(const ScanEntry& entry, const NetworkStats* stats);
+
+// Per access point history, persisted as one record and kept in RAM.
+//
+// Counts halve once attempts or posts reach HISTORY_MAX so the rates
+// follow recent behaviour. Outcomes only update RAM; flush() writes the
+// record, at most once per call, when something changed. The least
+// recently used entry is evicted when full. Not thread safe.
+class NetworkScorer {
+public:
+    static const uint8_t CAPACITY = 24;
+    static const uint8_t HISTORY_MAX = 32;
+
+    explicit NetworkScorer(BlobStorage& storage);
+
+    bool begin();  // false if there was no usable record
+    bool flush();
+    bool dirty() const { return _dirty; }
+
+    uint16_t score(const ScanEntry& entry) const;
+
+    // Fill order with scan indexes, best first. Returns the count.
+    uint8_t rank(const ScanEntry* scan, uint8_t count, uint8_t* order) const;
+
+    void recordConnect(const char* ssid, const uint8_t* bssid, bool connected, uint32_t elapsedMs);
+    void recordPost(const char* ssid, const uint8_t* bssid, bool ok);
+
+    const NetworkStats* find(const char* ssid, const uint8_t* bssid) const;
+    uint8_t count() const { return _count; }
+
+private:
+    NetworkStats* lookup(const char* ssid, const uint8_t* bssid, bool create);
+
+    BlobStorage& _storage;
+    NetworkStats _stats[CAPACITY];
+    uint8_t _count;
+    uint32_t _useCounter;
+    bool _dirty;
+};
+
+#endif
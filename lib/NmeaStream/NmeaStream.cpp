@@ -0,0 +1,216 @@
+#include "NmeaStream.h"
+
+#include <string.h>
+
+#include "AtParse.h"
+
+#define NO_TIME 0xFFFFFFFF
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// hhmmss.ss -> hhmmss * 100 + hundredths
+static uint32_t parseTime(const AtFields& f) {
+    double v;
+    if (!f.toDouble(v) || v < 0) return NO_TIME;
+    return (uint32_t)(v * 100.0 + 0.5);
+}
+
+// (d)ddmm.mmmm at the current field, hemisphere in the next one
+static bool parseCoordinate(AtFields& f, double& degrees) {
+    double raw;
+    bool ok = f.toDouble(raw);
+    if (!f.next() || !ok) return false;
+    int whole = (int)(raw / 100.0);
+    degrees = whole + (raw - whole * 100.0) / 60.0;
+    if (f.equals("S") || f.equals("W")) degrees = -degrees;
+    return true;
+}
+
+NmeaParser::NmeaParser()
+    : _epochTime(NO_TIME), _seen(0), _ggaValid(false), _rmcValid(false), _lineLength(0),
+      _sentences(0), _checksumErrors(0) {
+    memset(&_work, 0, sizeof(_work));
+    memset(&_fix, 0, sizeof(_fix));
+}
+
+void NmeaParser::startEpoch(uint32_t utcTime) {
+    _epochTime = utcTime;
+    _seen = 0;
+    _ggaValid = false;
+    _rmcValid = false;
+}
+
+bool NmeaParser::feed(char c, uint32_t nowMs) {
+    if (c == '$') _lineLength = 0;  // Resync on every sentence start
+    if (c == '\r' || c == '\n') {
+        if (_lineLength == 0) return false;
+        _line[_lineLength] = '\0';
+        _lineLength = 0;
+        return parse(_line, nowMs);
+    }
+    if (_lineLength < SENTENCE_MAX - 1) _line[_lineLength++] = c;
+    return false;
+}
+
+bool NmeaParser::parse(const char* sentence, uint32_t nowMs) {
+    if (sentence[0] != '$') return false;
+
+    // Body between '$' and '*', checksum is the XOR of its bytes
+    const char* star = strchr(sentence, '*');
+    if (star == NULL || (size_t)(star - sentence) >= SENTENCE_MAX) {
+        _checksumErrors++;
+        return false;
+    }
+    // A line cut off after the '*' has no checksum to read
+    if (star[1] == '\0' || star[2] == '\0') {
+        _checksumErrors++;
+        return false;
+    }
+    uint8_t sum = 0;
+    for (const char* p = sentence + 1; p < star; p++) sum ^= (uint8_t)*p;
+    int hi = hexDigit(star[1]);
+    int lo = hexDigit(star[2]);
+    if (hi < 0 || lo < 0 || sum != (uint8_t)(hi << 4 | lo)) {
+        _checksumErrors++;
+        return false;
+    }
+
+    // "GPGGA,..." without the checksum, so the last field ends cleanly
+    char body[SENTENCE_MAX];
+    size_t length = (size_t)(star - sentence - 1);
+    memcpy(body, sentence + 1, length);
+    body[length] = '\0';
+    if (length < 6 || body[5] != ',') return false;  // Proprietary or truncated
+
+    _sentences++;
+    const char* type = body + 2;
+    char* fields = body + 6;
+    if (strncmp(type, "GGA", 3) == 0) {
+        if (parseGga(fields)) return complete(nowMs);
+    } else if (strncmp(type, "RMC", 3) == 0) {
+        if (parseRmc(fields)) return complete(nowMs);
+    } else if (strncmp(type, "GSA", 3) == 0) {
+        parseGsa(fields);
+    }
+    return false;
+}
+
+// time, lat, N/S, lon, E/W, quality, satellites used, HDOP, altitude, M, ...
+bool NmeaParser::parseGga(char* fields) {
+    AtFields f(fields);
+    if (!f.seek(0)) return false;
+    uint32_t time = parseTime(f);
+    if (time != _epochTime) startEpoch(time);
+
+    double latitude = 0, longitude = 0;
+    bool position = f.next() && parseCoordinate(f, latitude);
+    position = f.next() && parseCoordinate(f, longitude) && position;
+
+    int32_t v;
+    if (f.seek(5) && f.toInt(v)) _ggaValid = position && v > 0;
+    if (_ggaValid) {
+        _work.latitude = latitude;
+        _work.longitude = longitude;
+    }
+    if (f.seek(6) && f.toInt(v)) _work.satellitesUsed = v > 0 && v < 256 ? (uint8_t)v : 0;
+    if (f.seek(7)) f.toFloat(_work.hdop);
+    if (f.seek(8)) f.toFloat(_work.altitude);
+
+    _seen |= SEEN_GGA;
+    return true;
+}
+
+// time, status, lat, N/S, lon, E/W, speed (knots), course, date, ...
+bool NmeaParser::parseRmc(char* fields) {
+    AtFields f(fields);
+    if (!f.seek(0)) return false;
+    uint32_t time = parseTime(f);
+    if (time != _epochTime) startEpoch(time);
+
+    _rmcValid = f.next() && f.equals("A");
+
+    double latitude = 0, longitude = 0;
+    bool position = f.next() && parseCoordinate(f, latitude);
+    position = f.next() && parseCoordinate(f, longitude) && position;
+    if (_rmcValid && !position) _rmcValid = false;
+
+    float knots;
+    if (f.seek(6) && f.toFloat(knots)) _work.speedKmh = knots * 1.852f;
+    if (f.seek(7)) f.toFloat(_work.course);
+    int32_t date;
+    if (f.seek(8) && f.toInt(date)) _work.utcDate = (uint32_t)date;
+
+    _seen |= SEEN_RMC;
+    return true;
+}
+
+// mode, fix type, 12 satellite ids, PDOP, HDOP, VDOP[, system]
+void NmeaParser::parseGsa(char* fields) {
+    AtFields f(fields);
+    int32_t v;
+    if (f.seek(1) && f.toInt(v) && v >= 1 && v <= 3) _work.fixMode = (uint8_t)v;
+    if (f.seek(14)) f.toFloat(_work.pdop);
+    if (f.seek(16)) f.toFloat(_work.vdop);
+}
+
+bool NmeaParser::complete(uint32_t nowMs) {
+    if ((_seen & (SEEN_GGA | SEEN_RMC)) != (SEEN_GGA | SEEN_RMC) || (_seen & PUBLISHED)) return false;
+
+    _work.valid = _ggaValid && _rmcValid;
+    _work.utcTime = _epochTime == NO_TIME ? 0 : _epochTime;
+    _work.updatedMs = nowMs;
+    _fix = _work;
+    _seen |= PUBLISHED;
+    return true;
+}
+
+void LatestFix::publish(const GnssFix& fix) {
+    uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+    _sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _fix = fix;
+    _sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool LatestFix::read(GnssFix& out) const {
+    // Bounded so a reader that preempted the writer on its own core can't spin forever
+    for (uint8_t attempt = 0; attempt < 16; attempt++) {
+        uint32_t before = _sequence.load(std::memory_order_acquire);
+        if (before == 0) return false;
+        if (before & 1) continue;  // Publish in progress
+        out = _fix;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_sequence.load(std::memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
+
+FixHistory::FixHistory() : _head(0), _count(0), _lastSampleMs(0) {}
+
+uint32_t FixHistory::intervalMs(float speedKmh) {
+    if (speedKmh < 2.0f) return 60000;   // Stationary (GNSS jitter reads as ~1 km/h)
+    if (speedKmh < 10.0f) return 15000;  // Walking
+    if (speedKmh < 50.0f) return 5000;
+    return 1000;
+}
+
+bool FixHistory::offer(const GnssFix& fix, uint32_t nowMs) {
+    if (!fix.valid) return false;
+    if (_count > 0 && nowMs - _lastSampleMs < intervalMs(fix.speedKmh)) return false;
+
+    _samples[_head] = fix;
+    _head = (uint8_t)((_head + 1) % CAPACITY);
+    if (_count < CAPACITY) _count++;
+    _lastSampleMs = nowMs;
+    return true;
+}
+
+const GnssFix& FixHistory::at(uint8_t index) const {
+    uint8_t oldest = (uint8_t)((_head + CAPACITY - _count) % CAPACITY);
+    return _samples[(oldest + index) % CAPACITY];
+}
@@ -0,0 +1,121 @@
+#ifndef NMEA_STREAM_H
+#define NMEA_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// One navigation epoch, merged from GGA, RMC and GSA
+struct GnssFix {
+    bool valid;              // GGA quality > 0 and RMC status A
+    double latitude;         // Degrees, south negative
+    double longitude;        // Degrees, west negative
+    float altitude;          // m above mean sea level
+    float speedKmh;
+    float course;            // Degrees true
+    float hdop;
+    float pdop;
+    float vdop;
+    uint8_t fixMode;         // GSA: 1 = none, 2 = 2D, 3 = 3D (0 = not reported)
+    uint8_t satellitesUsed;
+    uint32_t utcTime;        // hhmmss * 100 + hundredths
+    uint32_t utcDate;        // ddmmyy, 0 = unknown
+    uint32_t updatedMs;      // Local clock when published
+};
+
+// NMEA 0183 sentence parser for a receiver streaming GGA, RMC and GSA
+// (AT+CGNSTST=1 on the SIM7000). Sentences with a bad or missing
+// checksum are dropped; the talker (GP, GN, GL, ...) is ignored. A fix
+// is complete once GGA and RMC with the same UTC time have arrived; GSA
+// carries no time and applies to the epoch in progress.
+class NmeaParser {
+public:
+    static const size_t SENTENCE_MAX = 96;  // NMEA limit is 82
+
+    NmeaParser();
+
+    // One sentence, "$" through the checksum (a trailing CR/LF is fine).
+    // Returns true when it completed an epoch: fix() has a new value.
+    bool parse(const char* sentence, uint32_t nowMs);
+
+    // Byte stream interface for a raw UART
+    bool feed(char c, uint32_t nowMs);
+
+    const GnssFix& fix() const { return _fix; }
+
+    uint32_t sentences() const { return _sentences; }           // Accepted
+    uint32_t checksumErrors() const { return _checksumErrors; }
+
+private:
+    enum Seen : uint8_t {
+        SEEN_GGA = 1 << 0,
+        SEEN_RMC = 1 << 1,
+        PUBLISHED = 1 << 2,
+    };
+
+    void startEpoch(uint32_t utcTime);
+    bool parseGga(char* fields);
+    bool parseRmc(char* fields);
+    void parseGsa(char* fields);
+    bool complete(uint32_t nowMs);
+
+    GnssFix _work;      // Epoch being assembled
+    GnssFix _fix;       // Last completed epoch
+    uint32_t _epochTime;
+    uint8_t _seen;
+    bool _ggaValid;
+    bool _rmcValid;
+
+    char _line[SENTENCE_MAX];
+    size_t _lineLength;
+
+    uint32_t _sentences;
+    uint32_t _checksumErrors;
+};
+
+// Latest fix shared between cores without a lock (sequence lock).
+// One writer; readers copy and retry if a publish overlapped the copy,
+// so a reader never waits on the writer and never sees a torn fix.
+class LatestFix {
+public:
+    LatestFix() : _sequence(0) {}
+
+    void publish(const GnssFix& fix);
+
+    // Returns false until the first publish (or if publishes keep
+    // overlapping the copy, which only a reader starving the writer sees)
+    bool read(GnssFix& out) const;
+
+private:
+    std::atomic<uint32_t> _sequence;  // Odd while a publish is in progress
+    GnssFix _fix;
+};
+
+// Recent positions, sampled more often the faster the device moves:
+// every minute when stationary down to every second at road speeds.
+// The modem keeps streaming at its fixed 1 Hz; only what is kept here
+// adapts. Single threaded - owned by whoever feeds it.
+class FixHistory {
+public:
+    static const uint8_t CAPACITY = 32;
+
+    FixHistory();
+
+    // Keep the fix if the interval for its speed has passed since the
+    // last sample. Invalid fixes are never kept.
+    bool offer(const GnssFix& fix, uint32_t nowMs);
+
+    static uint32_t intervalMs(float speedKmh);
+
+    uint8_t count() const { return _count; }
+    const GnssFix& at(uint8_t index) const;  // 0 = oldest
+    void clear() { _count = 0; }
+
+private:
+    GnssFix _samples[CAPACITY];
+    uint8_t _head;   // Next slot to write
+    uint8_t _count;
+    uint32_t _lastSampleMs;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "PowerGovernor.h"
+
+PowerLevel powerLevelFor(uint8_t demands) {
+    const uint8_t high = 1 << POWER_DEMAND_TLS | 1 << POWER_DEMAND_OTA | 1 << POWER_DEMAND_BLE;
+    if (demands & high) return POWER_HIGH;
+    if (demands & 1 << POWER_DEMAND_WORK) return POWER_MEDIUM;
+    return POWER_LOW;
+}
+
+PowerGovernor::PowerGovernor(uint32_t holdMs, PowerLevel initial, uint32_t nowMs)
+    : _holdMs(holdMs), _level(initial), _enteredMs(nowMs), _lowering(false), _lowerSinceMs(0),
+      _transitions(0) {
+    for (uint8_t i = 0; i < POWER_DEMANDS; i++) _count[i] = 0;
+    for (uint8_t i = 0; i < POWER_LEVELS; i++) _timeMs[i] = 0;
+}
+
+void PowerGovernor::acquire(PowerDemand demand) {
+    if (_count[demand] < 0xFF) _count[demand]++;
+}
+
+void PowerGovernor::release(PowerDemand demand) {
+    if (_count[demand] > 0) _count[demand]--;
+}
+
+void PowerGovernor::set(PowerDemand demand, bool on) {
+    _count[demand] = on ? 1 : 0;
+}
+
+uint8_t PowerGovernor::demands() const {
+    uint8_t bits = 0;
+    for (uint8_t i = 0; i < POWER_DEMANDS; i++) {
+        if (_count[i] > 0) bits |= 1 << i;
+    }
+    return bits;
+}
+
+void PowerGovernor::enter(PowerLevel level, uint32_t nowMs) {
+    _timeMs[_level] += nowMs - _enteredMs;
+    _level = level;
+    _enteredMs = nowMs;
+    _lowering = false;
+    _transitions++;
+}
+
+bool PowerGovernor::update(uint32_t nowMs) {
+    PowerLevel target = powerLevelFor(demands());
+    if (target > _level) {
+        enter(target, nowMs);
+        return true;
+    }
+    if (target == _level) {
+        _lowering = false;
+        return false;
+    }
+
+    if (!_lowering) {
+        _lowering = true;
+        _lowerSinceMs = nowMs;
+    }
+    if (nowMs - _lowerSinceMs < _holdMs) return false;
+    enter(target, nowMs);
+    return true;
+}
+
+uint64_t PowerGovernor::timeInMs(PowerLevel level, uint32_t nowMs) const {
+    uint64_t total = _timeMs[level];
+    if (level == _level) total += nowMs - _enteredMs;
+    return total;
+}
+
+const char* powerLevelName(PowerLevel level) {
+    switch (level) {
+        case POWER_LOW: return "low";
+        case POWER_MEDIUM: return "medium";
+        case POWER_HIGH: return "high";
+        case POWER_LEVELS: break;
+    }
+    return "";
+}
@@ -0,0 +1,66 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <stdint.h>
+
+// CPU and radio power levels, lowest first. What each means in hardware
+// (clock, WiFi modem sleep, light sleep) is up to the owner.
+enum PowerLevel : uint8_t {
+    POWER_LOW,     // Idle
+    POWER_MEDIUM,  // Network work in progress
+    POWER_HIGH,    // TLS handshake, OTA, BLE session
+    POWER_LEVELS,
+};
+
+// Why the device needs more than the idle level
+enum PowerDemand : uint8_t {
+    POWER_DEMAND_WORK,  // Network jobs queued or running
+    POWER_DEMAND_TLS,   // Handshake in progress (mbedTLS on the CPU)
+    POWER_DEMAND_OTA,   // Firmware download or flash
+    POWER_DEMAND_BLE,   // BLE enabled for the phone
+    POWER_DEMANDS,
+};
+
+// Level needed for a set of demands (bit n = PowerDemand n)
+PowerLevel powerLevelFor(uint8_t demands);
+
+// Picks the power level from the pending demands. Demands are counted,
+// so overlapping holders (two tasks handshaking) release independently.
+// Steps up as soon as a demand needs it and down only once the lower
+// level has sufficed for holdMs, so back-to-back jobs don't flap the
+// clock. Keeps the time spent at each level. Decides only - the owner
+// applies the level when update() reports a change. Not thread safe.
+class PowerGovernor {
+public:
+    PowerGovernor(uint32_t holdMs, PowerLevel initial, uint32_t nowMs);
+
+    void acquire(PowerDemand demand);
+    void release(PowerDemand demand);
+    // For polled demands: held once or not at all
+    void set(PowerDemand demand, bool on);
+
+    // True when the level changed
+    bool update(uint32_t nowMs);
+
+    PowerLevel level() const { return _level; }
+    uint8_t demands() const;
+    // Total time at a level, including the current stint
+    uint64_t timeInMs(PowerLevel level, uint32_t nowMs) const;
+    uint32_t transitions() const { return _transitions; }
+
+private:
+    void enter(PowerLevel level, uint32_t nowMs);
+
+    uint32_t _holdMs;
+    uint8_t _count[POWER_DEMANDS];
+    PowerLevel _level;
+    uint32_t _enteredMs;
+    bool _lowering;
+    uint32_t _lowerSinceMs;
+    uint64_t _timeMs[POWER_LEVELS];
+    uint32_t _transitions;
+};
+
+const char* powerLevelName(PowerLevel level);
+
+#endif
@@ -0,0 +1,285 @@
+#include "ReadingLog.h"
+
+#include <string.h>
+
+#include "Crc32.h"
+
+namespace {
+
+const uint32_t SECTOR_MAGIC = 0x31474C52;  // "RLG1"
+
+// Record states - each transition only clears bits
+const uint8_t STATE_ERASED = 0xFF;    // Written but not committed (or free)
+const uint8_t STATE_VALID = 0x7F;     // Committed, waiting to be sent
+const uint8_t STATE_CONSUMED = 0x3F;  // Delivered
+
+struct SectorHeader {
+    uint32_t magic;
+    uint32_t seq;
+};
+
+struct RecordHeader {
+    uint8_t state;
+    uint8_t reserved;
+    uint16_t length;
+    uint32_t crc;  // Over length and payload
+};
+
+const uint32_t SECTOR_HEADER_SIZE = sizeof(SectorHeader);
+const uint32_t RECORD_HEADER_SIZE = sizeof(RecordHeader);
+
+uint32_t recordSize(uint16_t length) {
+    return RECORD_HEADER_SIZE + (((uint32_t)length + 3) & ~3UL);
+}
+
+uint32_t recordCrc(uint16_t length, const void* data) {
+    uint32_t crc = crc32(&length, sizeof(length));
+    return crc32(data, length, crc);
+}
+
+}  // namespace
+
+ReadingLog::ReadingLog(FlashDevice& flash)
+    : _flash(flash), _sectorSize(0), _sectorCount(0), _headSector(0), _headSeq(0),
+      _writeOffset(0), _pending(0), _dropped(0), _corrupt(0), _mounted(false) {
+    _read.sector = 0;
+    _read.offset = 0;
+    _cursor = _read;
+    _cursorLength = 0;
+}
+
+bool ReadingLog::readSectorSeq(uint16_t sector, uint32_t& seq) {
+    SectorHeader header;
+    if (!_flash.read(sectorBase(sector), &header, sizeof(header))) return false;
+    if (header.magic != SECTOR_MAGIC) return false;
+    seq = header.seq;
+    return true;
+}
+
+bool ReadingLog::startSector(uint16_t sector, uint32_t seq) {
+    if (!_flash.eraseSector(sectorBase(sector))) return false;
+    // Sequence before magic, so a torn header never looks valid
+    uint32_t magic = SECTOR_MAGIC;
+    return _flash.write(sectorBase(sector) + sizeof(magic), &seq, sizeof(seq)) &&
+           _flash.write(sectorBase(sector), &magic, sizeof(magic));
+}
+
+// Offset of the first free byte in a sector, or the sector size if the
+// rest of it cannot be used
+uint32_t ReadingLog::scanWriteOffset(uint16_t sector) {
+    uint32_t offset = SECTOR_HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= _sectorSize) {
+        RecordHeader header;
+        if (!_flash.read(sectorBase(sector) + offset, &header, sizeof(header))) {
+            return _sectorSize;
+        }
+        if (header.state == STATE_ERASED && header.length == 0xFFFF) {
+            return offset;
+        }
+        if (header.length == 0 || header.length > MAX_RECORD ||
+            offset + recordSize(header.length) > _sectorSize) {
+            // Torn header - don't append after something we can't parse
+            return _sectorSize;
+        }
+        offset += recordSize(header.length);
+    }
+    return _sectorSize;
+}
+
+uint32_t ReadingLog::countPending(uint16_t sector, uint32_t from, uint32_t to) {
+    uint32_t count = 0;
+    uint32_t offset = from;
+    while (offset + RECORD_HEADER_SIZE <= to) {
+        RecordHeader header;
+        if (!_flash.read(sectorBase(sector) + offset, &header, sizeof(header))) break;
+        if (header.length == 0 || header.length > MAX_RECORD) break;
+        if (header.state == STATE_VALID) count++;
+        offset += recordSize(header.length);
+    }
+    return count;
+}
+
+bool ReadingLog::mount() {
+    _mounted = false;
+    _pending = 0;
+    _sectorSize = _flash.sectorSize();
+    if (_sectorSize <= SECTOR_HEADER_SIZE + RECORD_HEADER_SIZE) return false;
+    _sectorCount = (uint16_t)(_flash.size() / _sectorSize);
+    if (_sectorCount < 2) return false;
+
+    bool found = false;
+    uint16_t tailSector = 0;
+    uint32_t tailSeq = 0;
+    for (uint16_t s = 0; s < _sectorCount; s++) {
+        uint32_t seq;
+        if (!readSectorSeq(s, seq)) continue;
+        if (!found || seq > _headSeq) {
+            _headSector = s;
+            _headSeq = seq;
+        }
+        if (!found || seq < tailSeq) {
+            tailSector = s;
+            tailSeq = seq;
+        }
+        found = true;
+    }
+
+    if (!found) {
+        // Blank or foreign data - format
+        _headSector = 0;
+        _headSeq = 1;
+        if (!startSector(0, _headSeq)) return false;
+        _writeOffset = SECTOR_HEADER_SIZE;
+        _read.sector = 0;
+        _read.offset = SECTOR_HEADER_SIZE;
+        _mounted = true;
+        return true;
+    }
+
+    _writeOffset = scanWriteOffset(_headSector);
+    _read.sector = tailSector;
+    _read.offset = SECTOR_HEADER_SIZE;
+
+    // Sectors are used in ring order, so tail..head covers all live data
+    uint16_t s = tailSector;
+    while (true) {
+        uint32_t seq;
+        if (readSectorSeq(s, seq)) {
+            _pending += countPending(s, SECTOR_HEADER_SIZE, _sectorSize);
+        }
+        if (s == _headSector) break;
+        s = nextSector(s);
+    }
+
+    _mounted = true;
+    return true;
+}
+
+bool ReadingLog::advanceHead() {
+    uint16_t next = nextSector(_headSector);
+
+    // Wrapping onto live data: the oldest records are lost
+    uint32_t seq;
+    if (readSectorSeq(next, seq)) {
+        uint32_t from = (_read.sector == next) ? _read.offset : SECTOR_HEADER_SIZE;
+        uint32_t lost = countPending(next, from, _sectorSize);
+        _dropped += lost;
+        _pending -= (lost > _pending) ? _pending : lost;
+    }
+    if (_read.sector == next) {
+        _read.sector = nextSector(next);
+        _read.offset = SECTOR_HEADER_SIZE;
+    }
+    _cursorLength = 0;
+    _cursor = _read;
+
+    if (!startSector(next, _headSeq + 1)) return false;
+    _headSector = next;
+    _headSeq++;
+    _writeOffset = SECTOR_HEADER_SIZE;
+    return true;
+}
+
+bool ReadingLog::append(const void* data, uint16_t length) {
+    if (!_mounted || length == 0 || length > MAX_RECORD) return false;
+
+    uint32_t size = recordSize(length);
+    if (size > _sectorSize - SECTOR_HEADER_SIZE) return false;
+    if (_writeOffset + size > _sectorSize && !advanceHead()) return false;
+
+    uint32_t address = sectorBase(_headSector) + _writeOffset;
+    _writeOffset += size;
+
+    // Header and payload first, commit byte last
+    RecordHeader header = {STATE_ERASED, 0xFF, length, recordCrc(length, data)};
+    if (!_flash.write(address, &header, sizeof(header))) return false;
+    if (!_flash.write(address + RECORD_HEADER_SIZE, data, length)) return false;
+    uint8_t state = STATE_VALID;
+    if (!_flash.write(address, &state, 1)) return false;
+
+    _pending++;
+    return true;
+}
+
+// Move pos forward to the next committed record
+bool ReadingLog::findPending(Position& pos, uint16_t& length) {
+    if (!_mounted || _pending == 0) return false;
+
+    while (true) {
+        uint32_t end = (pos.sector == _headSector) ? _writeOffset : _sectorSize;
+
+        while (pos.offset + RECORD_HEADER_SIZE <= end) {
+            RecordHeader header;
+            if (!_flash.read(sectorBase(pos.sector) + pos.offset, &header, sizeof(header))) {
+                return false;
+            }
+            if (header.length == 0 || header.length > MAX_RECORD) break;
+            if (header.state == STATE_VALID) {
+                length = header.length;
+                return true;
+            }
+            pos.offset += recordSize(header.length);
+        }
+
+        if (pos.sector == _headSector) {
+            if (&pos == &_read) {
+                // Counter drifted (e.g. a record failed to commit)
+                _pending = 0;
+            }
+            return false;
+        }
+        pos.sector = nextSector(pos.sector);
+        pos.offset = SECTOR_HEADER_SIZE;
+    }
+}
+
+int ReadingLog::readAtCursor(void* data, size_t size) {
+    uint16_t length;
+    while (findPending(_cursor, length)) {
+        if (length > size) return -1;
+
+        uint32_t address = sectorBase(_cursor.sector) + _cursor.offset;
+        RecordHeader header;
+        if (!_flash.read(address, &header, sizeof(header)) ||
+            !_flash.read(address + RECORD_HEADER_SIZE, data, length)) {
+            return 0;
+        }
+        if (recordCrc(length, data) == header.crc) {
+            _cursorLength = length;
+            return length;
+        }
+
+        // Bit rot - retire the record and keep going
+        uint8_t state = STATE_CONSUMED;
+        _flash.write(address, &state, 1);
+        _cursor.offset += recordSize(length);
+        _pending--;
+        _corrupt++;
+    }
+    return 0;
+}
+
+int ReadingLog::peek(void* data, size_t size) {
+    _cursor = _read;
+    _cursorLength = 0;
+    return readAtCursor(data, size);
+}
+
+int ReadingLog::peekNext(void* data, size_t size) {
+    if (_cursorLength > 0) {
+        _cursor.offset += recordSize(_cursorLength);
+        _cursorLength = 0;
+    }
+    return readAtCursor(data, size);
+}
+
+bool ReadingLog::pop() {
+    uint16_t length;
+    if (!findPending(_read, length)) return false;
+
+    uint8_t state = STATE_CONSUMED;
+    if (!_flash.write(sectorBase(_read.sector) + _read.offset, &state, 1)) return false;
+    _read.offset += recordSize(length);
+    _pending--;
+    return true;
+}
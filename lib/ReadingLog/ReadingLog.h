@@ -0,0 +1,88 @@
+#ifndef READING_LOG_H
+#define READING_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw NOR flash region: erased bytes read 0xFF and writes can only
+// clear bits. Offsets are relative to the start of the region.
+class FlashDevice {
+public:
+    virtual ~FlashDevice() {}
+    virtual uint32_t size() const = 0;
+    virtual uint32_t sectorSize() const { return 4096; }
+    virtual bool read(uint32_t offset, void* data, size_t length) = 0;
+    virtual bool write(uint32_t offset, const void* data, size_t length) = 0;
+    virtual bool eraseSector(uint32_t offset) = 0;
+};
+
+// Append-only ring log of opaque records on a FlashDevice.
+//
+// Each sector starts with a header carrying a sequence number, so the
+// oldest and newest sectors can be found after a reboot. Records are
+// written with their state byte still erased and committed by a second
+// one-byte write, so a power cut mid-append leaves an uncommitted record
+// that recovery skips. Consuming a record clears another bit in place -
+// sectors are only erased when the write head wraps onto them, which
+// spreads erases evenly over the whole region. When the log is full the
+// oldest sector is overwritten and its pending records are counted as
+// dropped.
+class ReadingLog {
+public:
+    static const uint16_t MAX_RECORD = 1024;
+
+    explicit ReadingLog(FlashDevice& flash);
+
+    // Scan the region and rebuild head/tail. Formats an empty region.
+    bool mount();
+
+    bool append(const void* data, uint16_t length);
+
+    // Oldest unconsumed record. Returns its length, 0 if the log is empty,
+    // or -1 if it does not fit in the buffer.
+    int peek(void* data, size_t size);
+
+    // Record after the one last returned by peek()/peekNext(), for
+    // reading a batch ahead of consuming it
+    int peekNext(void* data, size_t size);
+
+    // Mark the oldest record as delivered
+    bool pop();
+
+    uint32_t pending() const { return _pending; }
+    uint32_t dropped() const { return _dropped; }
+    uint32_t corrupt() const { return _corrupt; }
+    bool mounted() const { return _mounted; }
+
+private:
+    struct Position {
+        uint16_t sector;
+        uint32_t offset;  // Within the sector
+    };
+
+    uint32_t sectorBase(uint16_t sector) const { return (uint32_t)sector * _sectorSize; }
+    uint16_t nextSector(uint16_t sector) const { return (uint16_t)((sector + 1) % _sectorCount); }
+    bool readSectorSeq(uint16_t sector, uint32_t& seq);
+    bool startSector(uint16_t sector, uint32_t seq);
+    bool advanceHead();
+    bool findPending(Position& pos, uint16_t& length);
+    int readAtCursor(void* data, size_t size);
+    uint32_t countPending(uint16_t sector, uint32_t from, uint32_t to);
+    uint32_t scanWriteOffset(uint16_t sector);
+
+    FlashDevice& _flash;
+    uint32_t _sectorSize;
+    uint16_t _sectorCount;
+    uint16_t _headSector;
+    uint32_t _headSeq;
+    uint32_t _writeOffset;
+    Position _read;    // Oldest position that may still hold a pending record
+    Position _cursor;  // peek()/peekNext() position
+    uint16_t _cursorLength;
+    uint32_t _pending;
+    uint32_t _dropped;
+    uint32_t _corrupt;
+    bool _mounted;
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include "ReadingSerializer.h"
+
+#include <math.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char* buffer, size_t size)
+    : _buffer(buffer), _size(size), _length(0), _hasItems(0), _depth(0),
+      _afterKey(false), _overflow(size == 0) {
+    if (size > 0) buffer[0] = '\0';
+}
+
+void JsonWriter::put(char c) {
+    // Always keep room for the terminating NUL
+    if (_overflow || _length + 1 >= _size) {
+        _overflow = true;
+        return;
+    }
+    _buffer[_length++] = c;
+    _buffer[_length] = '\0';
+}
+
+void JsonWriter::put(const char* s, size_t n) {
+    if (_overflow || _length + n >= _size) {
+        _overflow = true;
+        return;
+    }
+    memcpy(_buffer + _length, s, n);
+    _length += n;
+    _buffer[_length] = '\0';
+}
+
+void JsonWriter::putEscaped(const char* s) {
+    static const char hex[] = "0123456789abcdef";
+    put('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            put('\\');
+            put((char)c);
+        } else if (c < 0x20) {
+            char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+            put(esc, sizeof(esc));
+        } else {
+            put((char)c);
+        }
+    }
+    put('"');
+}
+
+void JsonWriter::putUnsigned(uint32_t v) {
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (n > 0) put(digits[--n]);
+}
+
+void JsonWriter::putFixed(float v, uint8_t decimals) {
+    // JSON has no NaN/Infinity
+    if (isnan(v) || isinf(v)) {
+        put("null", 4);
+        return;
+    }
+    if (decimals > 6) decimals = 6;
+
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+
+    // Round in double so 6-decimal coordinates survive the scaling
+    double scaled = (double)v * scale;
+    bool negative = scaled < 0;
+    if (negative) scaled = -scaled;
+    uint64_t fixed = (uint64_t)(scaled + 0.5);
+
+    uint64_t whole = fixed / scale;
+    uint32_t frac = (uint32_t)(fixed % scale);
+    if (negative && fixed != 0) put('-');
+
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+    while (n > 0) put(digits[--n]);
+
+    if (decimals == 0) return;
+    put('.');
+    for (uint32_t div = scale / 10; div > 0; div /= 10) {
+        put((char)('0' + (frac / div) % 10));
+    }
+}
+
+void JsonWriter::separator() {
+    if (_afterKey) {
+        _afterKey = false;
+        return;
+    }
+    if (_depth == 0) return;
+    uint32_t bit = 1UL << ((_depth - 1) & 31);
+    if (_hasItems & bit) put(',');
+    _hasItems |= bit;
+}
+
+void JsonWriter::beginObject() {
+    separator();
+    put('{');
+    _depth++;
+    _hasItems &= ~(1UL << ((_depth - 1) & 31));
+}
+
+void JsonWriter::endObject() {
+    if (_depth > 0) _depth--;
+    put('}');
+}
+
+void JsonWriter::beginArray() {
+    separator();
+    put('[');
+    _depth++;
+    _hasItems &= ~(1UL << ((_depth - 1) & 31));
+}
+
+void JsonWriter::endArray() {
+    if (_depth > 0) _depth--;
+    put(']');
+}
+
+void JsonWriter::key(const char* name) {
+    separator();
+    putEscaped(name);
+    put(':');
+    _afterKey = true;
+}
+
+void JsonWriter::value(const char* value) {
+    separator();
+    putEscaped(value ? value : "");
+}
+
+void JsonWriter::value(int32_t value) {
+    separator();
+    if (value < 0) {
+        put('-');
+        putUnsigned((uint32_t)0 - (uint32_t)value);
+    } else {
+        putUnsigned((uint32_t)value);
+    }
+}
+
+void JsonWriter::value(uint32_t value) {
+    separator();
+    putUnsigned(value);
+}
+
+void JsonWriter::value(float value, uint8_t decimals) {
+    separator();
+    putFixed(value, decimals);
+}
+
+void JsonWriter::value(bool value) {
+    separator();
+    if (value) put("true", 4);
+    else put("false", 5);
+}
+
+void JsonWriter::raw(const char* json, size_t length) {
+    separator();
+    put(json, length);
+}
+
+void JsonWriter::field(const char* name, const char* v) { key(name); value(v); }
+void JsonWriter::field(const char* name, int32_t v) { key(name); value(v); }
+void JsonWriter::field(const char* name, uint32_t v) { key(name); value(v); }
+void JsonWriter::field(const char* name, float v, uint8_t decimals) { key(name); value(v, decimals); }
+void JsonWriter::field(const char* name, bool v) { key(name); value(v); }
+
+void writeReadingFields(JsonWriter& json, const SensorReading& r, const SerializeOptions& options) {
+    json.field("temperature", r.temperature, 1);
+    json.field("humidity", r.humidity, 1);
+    if (options.deviceId) {
+        json.field("deviceId", options.deviceId);
+    }
+    json.field("function", r.function);
+    if (r.idempotencyKey[0]) {
+        json.field("idempotencyKey", r.idempotencyKey);
+    }
+    if (options.connectionType) {
+        json.field("connectionType", options.connectionType);
+    }
+    if (r.localIP[0]) {
+        json.field("localIP", r.localIP);
+    }
+    if (r.wifiConnect[0]) {
+        json.field("wifiConnect", r.wifiConnect);
+        json.field("wifiConnectMs", r.wifiConnectMs);
+    }
+    if (r.gpsValid) {
+        json.field("latitude", r.latitude, 6);
+        json.field("longitude", r.longitude, 6);
+        json.field("gpsAltitude", r.gpsAltitude, 2);
+        json.field("gpsSpeed", r.gpsSpeed, 2);
+        json.field("gpsSatellites", (int32_t)r.gpsSatellites);
+        json.field("gpsAge", (uint32_t)r.gpsAge);
+    }
+    if (r.gnssStart[0]) {
+        json.field("gnssStart", r.gnssStart);
+    }
+    if (r.ttffMs > 0) {
+        json.field("ttffMs", r.ttffMs);
+    }
+    if (r.bootReadyMs > 0) {
+        json.key("boot");
+        json.beginObject();
+        json.field("wifi", r.bootWifiMs);
+        json.field("modem", r.bootModemMs);
+        json.field("sensors", r.bootSensorsMs);
+        json.field("ready", r.bootReadyMs);
+        if (r.wake[0]) {
+            json.field("wake", r.wake);
+        }
+        if (r.lastAwakeMs > 0) {
+            json.field("lastAwake", r.lastAwakeMs);
+        }
+        json.endObject();
+    }
+    if (r.batteryVoltage > 0) {
+        json.field("batteryVoltage", (int32_t)r.batteryVoltage);
+        json.field("batteryAge", (uint32_t)r.batteryAge);
+    }
+    if (r.signalQuality != 99) {
+        json.field("signalQuality", (int32_t)r.signalQuality);
+        json.field("signalAge", (uint32_t)r.signalAge);
+    }
+    if (r.networkOperator[0]) {
+        json.field("networkOperator", r.networkOperator);
+        json.field("operatorAge", (uint32_t)r.operatorAge);
+    }
+    if (r.capturedAt > 0) {
+        json.field("capturedAt", r.capturedAt);
+    } else if (r.ageSeconds > 0) {
+        json.field("ageSeconds", r.ageSeconds);
+    }
+    if (options.apiKey) {
+        json.field("apiKey", options.apiKey);
+    }
+}
+
+size_t serializeReading(const SensorReading& reading, const SerializeOptions& options,
+                        char* buffer, size_t size) {
+    JsonWriter json(buffer, size);
+    json.beginObject();
+    writeReadingFields(json, reading, options);
+    json.endObject();
+    return json.ok() ? json.length() : 0;
+}
+
+size_t serializeBatch(const SensorReading* readings, size_t count, const SerializeOptions& options,
+                      char* buffer, size_t size) {
+    SerializeOptions entry = {NULL, NULL, NULL};
+
+    JsonWriter json(buffer, size);
+    json.beginObject();
+    if (options.deviceId) {
+        json.field("deviceId", options.deviceId);
+    }
+    if (options.connectionType) {
+        json.field("connectionType", options.connectionType);
+    }
+    json.key("readings");
+    json.beginArray();
+    for (size_t i = 0; i < count; i++) {
+        json.beginObject();
+        writeReadingFields(json, readings[i], entry);
+        json.endObject();
+    }
+    json.endArray();
+    if (options.apiKey) {
+        json.field("apiKey", options.apiKey);
+    }
+    json.endObject();
+    return json.ok() ? json.length() : 0;
+}
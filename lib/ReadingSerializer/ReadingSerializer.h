@@ -0,0 +1,120 @@
+#ifndef READING_SERIALIZER_H
+#define READING_SERIALIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Upload buffer sizes. Single readings need room for every optional field
+// (and its age), a 24-char operator name and the idempotency key; a
+// backlog replay sends up to BACKLOG_BATCH_SIZE readings per request.
+#define READING_PAYLOAD_SIZE 768
+#define BACKLOG_BATCH_SIZE 10
+
+// Sensor reading as plain data - no String members, so it can be copied
+// into queues or flash and serialized without touching the heap
+struct SensorReading {
+    float temperature;        // Fahrenheit
+    float humidity;           // Soil moisture % (Humidity__c in Salesforce)
+    char function[16];        // "Single", "Double", "Touch", "Startup", ...
+    char idempotencyKey[40];  // DEVICE_ID-boot-sequence; the server drops repeats
+    bool gpsValid;
+    float latitude;
+    float longitude;
+    float gpsAltitude;
+    float gpsSpeed;
+    int gpsSatellites;
+    int batteryVoltage;       // millivolts, 0 = unknown
+    int signalQuality;        // CSQ (0-31, 99 = unknown)
+    char networkOperator[24]; // Empty = unknown
+    uint16_t batteryAge;      // Seconds since each diagnostic was read
+    uint16_t signalAge;
+    uint16_t operatorAge;
+    uint16_t gpsAge;
+    char gnssStart[8];        // Startup only: "hot", "warm", "cold", "running"
+    uint32_t ttffMs;          // Startup only: GNSS time to first fix, 0 = none yet
+    uint32_t bootWifiMs;      // Startup only: ms after power-on each boot phase
+    uint32_t bootModemMs;     // finished (0 = didn't finish in time) and the
+    uint32_t bootSensorsMs;   // reading was built; bootReadyMs 0 = not startup
+    uint32_t bootReadyMs;
+    char wake[8];             // Duty cycle: "timer", "button", ... empty = n/a
+    uint32_t lastAwakeMs;     // Duty cycle: previous cycle's awake time, 0 = n/a
+    char wifiConnect[6];      // After a (re)connect: "fast" or "scan", empty = n/a
+    uint32_t wifiConnectMs;   // After a (re)connect: time to connected
+    char localIP[16];         // Empty = not on WiFi
+    uint32_t capturedAt;      // Unix time when queued offline, 0 = live/unknown
+    uint32_t ageSeconds;      // Delay before upload when capturedAt is unknown
+};
+
+// Per-transport differences in the reading JSON
+struct SerializeOptions {
+    const char* deviceId;        // NULL = omit (batch entries)
+    const char* connectionType;  // NULL = omit (phone relay)
+    const char* apiKey;          // NULL = omit (phone adds its own)
+};
+
+// Minimal JSON writer over a caller-supplied buffer. Never allocates;
+// on overflow it stops writing and ok() returns false.
+class JsonWriter {
+public:
+    JsonWriter(char* buffer, size_t size);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    // Object members
+    void key(const char* name);
+    void field(const char* name, const char* value);
+    void field(const char* name, int32_t value);
+    void field(const char* name, uint32_t value);
+    void field(const char* name, float value, uint8_t decimals);
+    void field(const char* name, bool value);
+
+    // Array elements / values after key()
+    void value(const char* value);
+    void value(int32_t value);
+    void value(uint32_t value);
+    void value(float value, uint8_t decimals);
+    void value(bool value);
+
+    // Pre-encoded JSON (e.g. an already serialized object)
+    void raw(const char* json, size_t length);
+
+    bool ok() const { return !_overflow; }
+    size_t length() const { return _length; }
+    const char* c_str() const { return _buffer; }
+
+private:
+    void separator();
+    void put(char c);
+    void put(const char* s, size_t n);
+    void putEscaped(const char* s);
+    void putUnsigned(uint32_t v);
+    void putFixed(float v, uint8_t decimals);
+
+    char* _buffer;
+    size_t _size;
+    size_t _length;
+    uint32_t _hasItems;  // Bit per nesting level: container already has an item
+    uint8_t _depth;
+    bool _afterKey;
+    bool _overflow;
+};
+
+// Append the reading's members to an open object
+void writeReadingFields(JsonWriter& json, const SensorReading& reading, const SerializeOptions& options);
+
+// Serialize one reading as a JSON object into buffer (NUL terminated).
+// Returns the number of bytes written, or 0 if the buffer is too small.
+size_t serializeReading(const SensorReading& reading, const SerializeOptions& options,
+                        char* buffer, size_t size);
+
+// Serialize several readings as one upload:
+//   {"deviceId":..,"connectionType":..,"readings":[{..},{..}],"apiKey":..}
+// deviceId, connectionType and apiKey are sent once in the envelope.
+// Returns the number of bytes written, or 0 if the buffer is too small.
+size_t serializeBatch(const SensorReading* readings, size_t count, const SerializeOptions& options,
+                      char* buffer, size_t size);
+
+#endif
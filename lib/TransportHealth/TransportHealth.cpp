@@ -0,0 +1,152 @@
+#include "TransportHealth.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define COST_MAX 0xFFFFFFFFu
+
+TransportHealth::TransportHealth(uint32_t typicalMs, uint32_t failureMs)
+    : _state(CLOSED), _consecutiveFailures(0), _successPermille(1000), _latencyMs(typicalMs),
+      _failureMs(failureMs), _openedMs(0), _cooldownMs(BREAKER_COOLDOWN_MS), _attempts(0), _failures(0),
+      _typicalMs(typicalMs), _sampleHead(0), _sampleCount(0) {}
+
+bool TransportHealth::available(uint32_t nowMs) const {
+    return _state != OPEN || nowMs - _openedMs >= _cooldownMs;
+}
+
+bool TransportHealth::allow(uint32_t nowMs) {
+    if (!available(nowMs)) return false;
+    if (_state == OPEN) _state = HALF_OPEN;
+    return true;
+}
+
+void TransportHealth::record(bool ok, uint32_t elapsedMs, uint32_t nowMs) {
+    _attempts++;
+    if (ok) {
+        _latencyMs = (_latencyMs * 3 + elapsedMs) / 4;
+        _samples[_sampleHead] = elapsedMs;
+        _sampleHead = (uint8_t)((_sampleHead + 1) % LATENCY_SAMPLES);
+        if (_sampleCount < LATENCY_SAMPLES) _sampleCount++;
+        _successPermille = (uint16_t)((_successPermille * 7u + 1000) / 8);
+        _consecutiveFailures = 0;
+        _state = CLOSED;
+        _cooldownMs = BREAKER_COOLDOWN_MS;
+        return;
+    }
+
+    _failures++;
+    _failureMs = (_failureMs * 3 + elapsedMs) / 4;
+    _successPermille = (uint16_t)(_successPermille * 7u / 8);
+    if (_consecutiveFailures < 0xFF) _consecutiveFailures++;
+
+    if (_state == HALF_OPEN) {
+        // Probe failed: back off further
+        _cooldownMs = _cooldownMs * 2 > BREAKER_COOLDOWN_MAX_MS ? BREAKER_COOLDOWN_MAX_MS : _cooldownMs * 2;
+        _state = OPEN;
+        _openedMs = nowMs;
+    } else if (_state == CLOSED && _consecutiveFailures >= BREAKER_FAILURES) {
+        _state = OPEN;
+        _openedMs = nowMs;
+    }
+}
+
+uint32_t TransportHealth::expectedCostMs(uint8_t linkQuality) const {
+    if (linkQuality > 100) linkQuality = 100;
+    // p = success per attempt; E = (p * ok + (1 - p) * fail) / p
+    uint32_t p = (uint32_t)_successPermille * linkQuality / 100;
+    if (p == 0) return COST_MAX;
+    uint64_t cost = ((uint64_t)p * _latencyMs + (uint64_t)(1000 - p) * _failureMs) / p;
+    return cost > COST_MAX ? COST_MAX : (uint32_t)cost;
+}
+
+uint32_t TransportHealth::p95LatencyMs() const {
+    if (_sampleCount < 5) return _typicalMs * 2;
+
+    // Nearest rank: the k-th smallest, k = ceil(0.95 * n)
+    uint8_t rank = (uint8_t)((_sampleCount * 95 + 99) / 100);
+    uint32_t sorted[LATENCY_SAMPLES];
+    for (uint8_t i = 0; i < _sampleCount; i++) {
+        uint32_t v = _samples[i];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    return sorted[rank - 1];
+}
+
+void TransportHealth::save(TransportHealthState& out) const {
+    out.state = _state;
+    out.consecutiveFailures = _consecutiveFailures;
+    out.successPermille = _successPermille;
+    out.latencyMs = _latencyMs;
+    out.failureMs = _failureMs;
+    out.cooldownMs = _cooldownMs;
+    out.attempts = _attempts;
+    out.failures = _failures;
+    memcpy(out.samples, _samples, sizeof(out.samples));
+    out.sampleHead = _sampleHead;
+    out.sampleCount = _sampleCount;
+}
+
+void TransportHealth::restore(const TransportHealthState& state, uint32_t nowMs) {
+    if (state.state > HALF_OPEN || state.successPermille > 1000 || state.sampleHead >= LATENCY_SAMPLES ||
+        state.sampleCount > LATENCY_SAMPLES) {
+        return;
+    }
+    _state = (State)state.state;
+    _consecutiveFailures = state.consecutiveFailures;
+    _successPermille = state.successPermille;
+    _latencyMs = state.latencyMs;
+    _failureMs = state.failureMs;
+    _cooldownMs = state.cooldownMs;
+    _attempts = state.attempts;
+    _failures = state.failures;
+    memcpy(_samples, state.samples, sizeof(_samples));
+    _sampleHead = state.sampleHead;
+    _sampleCount = state.sampleCount;
+    _openedMs = nowMs - _cooldownMs;
+}
+
+uint8_t csqQuality(int32_t csq) {
+    if (csq < 0 || csq == 99 || csq > 31) return 50;
+    if (csq >= 15) return 100;   // -83 dBm and better
+    if (csq >= 10) return 80;
+    if (csq >= 5) return 50;
+    if (csq >= 2) return 20;
+    return 5;                    // -111 dBm or worse
+}
+
+uint8_t rankTransports(const TransportHealth* const* health, const uint8_t* linkQuality, uint8_t count,
+                       uint32_t nowMs, uint8_t* order) {
+    uint32_t cost[8];
+    uint8_t ranked = 0;
+    for (uint8_t i = 0; i < count && i < 8; i++) {
+        if (linkQuality[i] == 0 || !health[i]->available(nowMs)) continue;
+
+        // Half-open (or due to be) sorts first
+        bool probe = health[i]->state() != TransportHealth::CLOSED;
+        uint32_t c = probe ? 0 : health[i]->expectedCostMs(linkQuality[i]);
+
+        uint8_t j = ranked++;
+        while (j > 0 && cost[j - 1] > c) {
+            cost[j] = cost[j - 1];
+            order[j] = order[j - 1];
+            j--;
+        }
+        cost[j] = c;
+        order[j] = i;
+    }
+    return ranked;
+}
+
+const char* breakerStateName(TransportHealth::State state) {
+    switch (state) {
+        case TransportHealth::CLOSED: return "closed";
+        case TransportHealth::OPEN: return "open";
+        case TransportHealth::HALF_OPEN: return "half-open";
+    }
+    return "";
+}
@@ -0,0 +1,102 @@
+#ifndef TRANSPORT_HEALTH_H
+#define TRANSPORT_HEALTH_H
+
+#include <stdint.h>
+
+#define BREAKER_FAILURES 3              // Consecutive failures that open the breaker
+#define BREAKER_COOLDOWN_MS 30000       // First wait before a probe
+#define BREAKER_COOLDOWN_MAX_MS 600000  // Doubles per failed probe up to this
+
+struct TransportHealthState;
+
+// Rolling health of one upload path with a circuit breaker.
+//
+// Closed: every upload is allowed. BREAKER_FAILURES failures in a row
+// open it: uploads are refused until the cooldown passes, then it is
+// half-open and the next upload is a probe. A successful probe closes
+// it; a failed one reopens it with twice the cooldown. Latency and
+// success rate are moving averages, seeded with the transport's typical
+// figures so a new boot ranks sensibly. Not thread safe.
+class TransportHealth {
+public:
+    enum State : uint8_t { CLOSED, OPEN, HALF_OPEN };
+
+    // Typical time for a delivered upload and for one that fails
+    TransportHealth(uint32_t typicalMs, uint32_t failureMs);
+
+    // May this transport be tried now? Moves open to half-open once the
+    // cooldown has passed.
+    bool allow(uint32_t nowMs);
+    // Would allow() say yes? (no state change)
+    bool available(uint32_t nowMs) const;
+
+    void record(bool ok, uint32_t elapsedMs, uint32_t nowMs);
+
+    // Expected time to get a reading delivered, counting the failed
+    // attempts before it (retrying until success). linkQuality 0..100
+    // scales the success rate, e.g. from the cellular CSQ.
+    uint32_t expectedCostMs(uint8_t linkQuality) const;
+
+    // 95th percentile of recent delivered latencies; twice the typical
+    // figure until there are enough samples
+    uint32_t p95LatencyMs() const;
+
+    State state() const { return _state; }
+    uint8_t consecutiveFailures() const { return _consecutiveFailures; }
+    uint32_t latencyMs() const { return _latencyMs; }
+    uint16_t successPermille() const { return _successPermille; }
+    uint32_t attempts() const { return _attempts; }
+    uint32_t failures() const { return _failures; }
+
+    static const uint8_t LATENCY_SAMPLES = 20;
+
+    // Copy out and back in across deep sleep. Breaker timing is in
+    // millis(), which restarts on wake; an open breaker comes back due
+    // for its probe, as the sleep outlasts any cooldown.
+    void save(TransportHealthState& out) const;
+    void restore(const TransportHealthState& state, uint32_t nowMs);
+
+private:
+    State _state;
+    uint8_t _consecutiveFailures;
+    uint16_t _successPermille;
+    uint32_t _latencyMs;
+    uint32_t _failureMs;
+    uint32_t _openedMs;
+    uint32_t _cooldownMs;
+    uint32_t _attempts;
+    uint32_t _failures;
+    uint32_t _typicalMs;
+    uint32_t _samples[LATENCY_SAMPLES];  // Ring of delivered latencies
+    uint8_t _sampleHead;
+    uint8_t _sampleCount;
+};
+
+// TransportHealth as plain data
+struct TransportHealthState {
+    uint8_t state;
+    uint8_t consecutiveFailures;
+    uint16_t successPermille;
+    uint32_t latencyMs;
+    uint32_t failureMs;
+    uint32_t cooldownMs;
+    uint32_t attempts;
+    uint32_t failures;
+    uint32_t samples[TransportHealth::LATENCY_SAMPLES];
+    uint8_t sampleHead;
+    uint8_t sampleCount;
+};
+
+// 0..100 from an AT+CSQ value (99 = unknown, taken as middling)
+uint8_t csqQuality(int32_t csq);
+
+// Fill order with the indexes of the transports worth trying now, best
+// first, and return how many. linkQuality 0 means unavailable. A
+// half-open transport goes first so its probe happens while the others
+// are still there to fall back on.
+uint8_t rankTransports(const TransportHealth* const* health, const uint8_t* linkQuality, uint8_t count,
+                       uint32_t nowMs, uint8_t* order);
+
+const char* breakerStateName(TransportHealth::State state);
+
+#endif
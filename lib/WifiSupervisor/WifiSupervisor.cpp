@@ -0,0 +1,101 @@
+#include "WifiSupervisor.h"
+
+#include <stddef.h>
+
+WifiSupervisor::WifiSupervisor(const WifiSupervisorConfig& config, uint32_t seed)
+    : _config(config), _state(WIFI_LINK_DOWN), _failures(0), _attempts(0), _nextAttemptMs(0),
+      _random(seed ? seed : 0x9E3779B9u), _listenerCount(0) {}
+
+bool WifiSupervisor::addListener(Listener listener, void* context) {
+    if (_listenerCount == MAX_LISTENERS) return false;
+    _listeners[_listenerCount] = listener;
+    _contexts[_listenerCount] = context;
+    _listenerCount++;
+    return true;
+}
+
+void WifiSupervisor::seed(uint32_t seed) { _random = seed ? seed : 0x9E3779B9u; }
+
+// xorshift32
+uint32_t WifiSupervisor::random() {
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random;
+}
+
+uint32_t WifiSupervisor::backoffMs() {
+    uint32_t delay = _config.baseDelayMs;
+    for (uint8_t i = 1; i < _failures && delay < _config.maxDelayMs; i++) delay *= 2;
+    if (delay > _config.maxDelayMs) delay = _config.maxDelayMs;
+    uint32_t half = delay / 2;
+    return half + random() % (delay - half + 1);
+}
+
+void WifiSupervisor::setUp() {
+    if (_state == WIFI_LINK_UP) return;
+    _state = WIFI_LINK_UP;
+    _failures = 0;
+    for (uint8_t i = 0; i < _listenerCount; i++) _listeners[i](_contexts[i]);
+}
+
+void WifiSupervisor::linkUp(uint32_t nowMs) {
+    (void)nowMs;
+    setUp();
+}
+
+void WifiSupervisor::linkDown(uint32_t nowMs) {
+    if (_state != WIFI_LINK_UP) return;  // Attempts report their own outcome
+    _state = WIFI_LINK_DOWN;
+    _failures = 0;
+    _nextAttemptMs = nowMs + _config.baseDelayMs;
+}
+
+bool WifiSupervisor::shouldConnect(uint32_t nowMs) {
+    if (_state != WIFI_LINK_DOWN && _state != WIFI_LINK_RESTING) return false;
+    if ((int32_t)(nowMs - _nextAttemptMs) < 0) return false;
+    if (_state == WIFI_LINK_RESTING) _failures = 0;
+    _state = WIFI_LINK_CONNECTING;
+    _attempts++;
+    return true;
+}
+
+void WifiSupervisor::attemptFinished(bool connected, uint32_t nowMs) {
+    if (connected) {
+        setUp();
+        return;
+    }
+    if (_state == WIFI_LINK_UP) return;  // Came up some other way meanwhile
+
+    if (_failures < 0xFF) _failures++;
+    if (_failures >= _config.budget) {
+        _state = WIFI_LINK_RESTING;
+        _nextAttemptMs = nowMs + _config.restMs;
+    } else {
+        _state = WIFI_LINK_DOWN;
+        _nextAttemptMs = nowMs + backoffMs();
+    }
+}
+
+void WifiSupervisor::reset(uint32_t nowMs) {
+    if (_state == WIFI_LINK_UP || _state == WIFI_LINK_CONNECTING) return;
+    _state = WIFI_LINK_DOWN;
+    _failures = 0;
+    _nextAttemptMs = nowMs;
+}
+
+uint32_t WifiSupervisor::retryInMs(uint32_t nowMs) const {
+    if (_state != WIFI_LINK_DOWN && _state != WIFI_LINK_RESTING) return 0;
+    int32_t remaining = (int32_t)(_nextAttemptMs - nowMs);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+const char* wifiLinkStateName(WifiLinkState state) {
+    switch (state) {
+        case WIFI_LINK_DOWN: return "down";
+        case WIFI_LINK_CONNECTING: return "connecting";
+        case WIFI_LINK_UP: return "up";
+        case WIFI_LINK_RESTING: return "resting";
+    }
+    return "";
+}
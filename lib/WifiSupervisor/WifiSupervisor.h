@@ -0,0 +1,79 @@
+#ifndef WIFI_SUPERVISOR_H
+#define WIFI_SUPERVISOR_H
+
+#include <stdint.h>
+
+enum WifiLinkState : uint8_t {
+    WIFI_LINK_DOWN,        // Waiting out the backoff before the next attempt
+    WIFI_LINK_CONNECTING,  // Owner is running an attempt
+    WIFI_LINK_UP,
+    WIFI_LINK_RESTING,     // Reconnect budget spent, long pause
+};
+
+struct WifiSupervisorConfig {
+    uint32_t baseDelayMs;  // First retry; doubles per failed attempt
+    uint32_t maxDelayMs;
+    uint8_t budget;        // Failed attempts in a row before resting
+    uint32_t restMs;
+};
+
+// When to (re)connect WiFi. Decides; never touches the radio.
+//
+// The owner feeds it link events (got IP / disconnected, e.g. from
+// WiFi.onEvent) and polls shouldConnect(). When that says yes it runs one
+// connect attempt and reports back with attemptFinished(). Failed attempts
+// back off exponentially with jitter (half the delay fixed, half random)
+// so a fleet doesn't retry in lockstep. After `budget` failures in a row
+// it rests, then starts over. Listeners run on every transition to up,
+// in the owner's task. Not thread safe: events from another task must be
+// handed over by the owner.
+class WifiSupervisor {
+public:
+    typedef void (*Listener)(void* context);
+    static const uint8_t MAX_LISTENERS = 4;
+
+    WifiSupervisor(const WifiSupervisorConfig& config, uint32_t seed);
+
+    bool addListener(Listener listener, void* context);
+
+    // Restart the jitter sequence, e.g. once a hardware RNG has entropy
+    void seed(uint32_t seed);
+
+    void linkUp(uint32_t nowMs);
+    // A drop while up waits one base delay first: the driver often
+    // reassociates on its own
+    void linkDown(uint32_t nowMs);
+
+    // True when an attempt is due; the state is then CONNECTING
+    bool shouldConnect(uint32_t nowMs);
+    void attemptFinished(bool connected, uint32_t nowMs);
+
+    // Attempt as soon as possible with a fresh budget (new credentials,
+    // user asked)
+    void reset(uint32_t nowMs);
+
+    WifiLinkState state() const { return _state; }
+    uint8_t failures() const { return _failures; }
+    uint32_t attempts() const { return _attempts; }
+    // Until the next attempt, 0 if due or not waiting
+    uint32_t retryInMs(uint32_t nowMs) const;
+
+private:
+    uint32_t backoffMs();
+    uint32_t random();
+    void setUp();
+
+    WifiSupervisorConfig _config;
+    WifiLinkState _state;
+    uint8_t _failures;
+    uint32_t _attempts;
+    uint32_t _nextAttemptMs;
+    uint32_t _random;
+    Listener _listeners[MAX_LISTENERS];
+    void* _contexts[MAX_LISTENERS];
+    uint8_t _listenerCount;
+};
+
+const char* wifiLinkStateName(WifiLinkState state);
+
+#endif
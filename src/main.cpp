@@ -11,10 +11,37 @@
 #include <HTTPUpdate.h>
 #include "esp_coexist.h"
 #include "esp_wifi.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "driver/rtc_io.h"
+#include "esp_pm.h"
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+#include <time.h>
 #include "credentials.h"
-
-// TinyGSM for SIM7000A cellular modem
-#define TINY_GSM_MODEM_SIM7000
+#include "ReadingSerializer.h"
+#include "ReadingLog.h"
+#include "CoopScheduler.h"
+#include "MelodySequencer.h"
+#include "AtEngine.h"
+#include "AtParse.h"
+#include "HttpResponseParser.h"
+#include "KeepAliveSession.h"
+#include "DiagnosticsCache.h"
+#include "NmeaStream.h"
+#include "GnssAssist.h"
+#include "CredentialStore.h"
+#include "NetworkScorer.h"
+#include "TransportHealth.h"
+#include "WifiSupervisor.h"
+#include "DutyCycle.h"
+#include "PowerGovernor.h"
+#include "GestureRecognizer.h"
+#include "MoistureFilter.h"
+
+// TinyGSM for SIM7000A cellular modem (SSL variant: TLS sockets on the modem)
+#define TINY_GSM_MODEM_SIM7000SSL
 #define TINY_GSM_RX_BUFFER 1024
 #include <TinyGsmClient.h>
 
@@ -33,21 +60,188 @@ const char gprsPass[] = "";
 
 // Modem instance
 TinyGsm modem(SerialAT);
-TinyGsmClient cellularClient(modem);
+TinyGsmClientSecure cellularClient(modem);
 bool modemInitialized = false;
 
-// GPS data
-float gpsLatitude = 0.0;
-float gpsLongitude = 0.0;
-float gpsAltitude = 0.0;
-float gpsSpeed = 0.0;
-int gpsSatellites = 0;
-bool gpsValid = false;
+// The modem is shared by the network task and the loop's BLE status
+// updates. Recursive because an upload may re-init or reconnect it.
+SemaphoreHandle_t modemMutex = NULL;
+
+class ModemLock {
+public:
+    explicit ModemLock(TickType_t wait = portMAX_DELAY)
+        : _held(xSemaphoreTakeRecursive(modemMutex, wait) == pdTRUE) {}
+    ~ModemLock() {
+        if (_held) xSemaphoreGiveRecursive(modemMutex);
+    }
+    bool held() const { return _held; }
+
+private:
+    bool _held;
+};
+
+// AT engine on the modem UART. Diagnostics and the HTTP sequence go
+// through it; TinyGSM still handles power-up and network attach. Both
+// read the same UART, so either is only used with modemMutex held.
+class SerialAtPort : public AtPort {
+public:
+    explicit SerialAtPort(Stream& stream) : _stream(stream) {}
+    int available() { return _stream.available(); }
+    int read() { return _stream.read(); }
+    size_t write(const uint8_t* data, size_t length) { return _stream.write(data, length); }
+
+private:
+    Stream& _stream;
+};
+
+SerialAtPort modemPort(SerialAT);
+AtEngine atEngine(modemPort);
+
+// Run the engine on the calling task until the result is in
+void modemWait(const AtResult& result) {
+    while (!result.done()) {
+        atEngine.poll(millis());
+        delay(1);
+    }
+}
+
+// Run the engine until every queued command has finished
+void modemDrain() {
+    while (!atEngine.idle()) {
+        atEngine.poll(millis());
+        delay(1);
+    }
+}
+
+// Modem diagnostics (battery, signal, operator, registration). The network
+// task refreshes whatever has outlived its TTL while the modem is idle;
+// send paths and BLE status read a snapshot and never wait on the modem.
+// Override with build_flags, e.g. -D DIAG_SIGNAL_TTL_MS=10000
+#ifndef DIAG_BATTERY_TTL_MS
+#define DIAG_BATTERY_TTL_MS 60000
+#endif
+#ifndef DIAG_SIGNAL_TTL_MS
+#define DIAG_SIGNAL_TTL_MS 30000
+#endif
+#ifndef DIAG_OPERATOR_TTL_MS
+#define DIAG_OPERATOR_TTL_MS 600000
+#endif
+#ifndef DIAG_REGISTRATION_TTL_MS
+#define DIAG_REGISTRATION_TTL_MS 30000
+#endif
+
+DiagnosticsCache modemDiagnostics;
+portMUX_TYPE diagnosticsMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool cellularDataConnected = false;  // Last known GPRS state
+
+void setupDiagnostics() {
+    modemDiagnostics.setTtl(DIAG_BATTERY, DIAG_BATTERY_TTL_MS);
+    modemDiagnostics.setTtl(DIAG_SIGNAL, DIAG_SIGNAL_TTL_MS);
+    modemDiagnostics.setTtl(DIAG_OPERATOR, DIAG_OPERATOR_TTL_MS);
+    modemDiagnostics.setTtl(DIAG_REGISTRATION, DIAG_REGISTRATION_TTL_MS);
+}
+
+void readDiagnostics(DiagnosticsSnapshot& out) {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&diagnosticsMux);
+    modemDiagnostics.snapshot(now, out);
+    portEXIT_CRITICAL(&diagnosticsMux);
+}
+
+// GNSS. With streaming on, the modem sends NMEA on the AT port
+// (AT+CGNSTST=1) and every epoch lands in gnssFix as it arrives, so
+// readers never query the modem. +CGNSINF is polled only when no epoch
+// has arrived for GNSS_POLL_MS (always, with -D GNSS_STREAMING=0).
+#ifndef GNSS_STREAMING
+#define GNSS_STREAMING 1
+#endif
+#ifndef GNSS_POLL_MS
+#define GNSS_POLL_MS 15000
+#endif
+
+// The last good fix is saved to NVS (at most every GNSS_SAVE_INTERVAL_MS)
+// and picks a hot or warm restart at the next power-up. The startup
+// reading waits up to GNSS_STARTUP_WAIT_MS for a fix after such a start.
+// -D GNSS_XTRA=1 lets the engine use an XTRA file already on the modem.
+#ifndef GNSS_SAVE_INTERVAL_MS
+#define GNSS_SAVE_INTERVAL_MS 1800000
+#endif
+#ifndef GNSS_STARTUP_WAIT_MS
+#define GNSS_STARTUP_WAIT_MS 30000
+#endif
+#ifndef GNSS_XTRA
+#define GNSS_XTRA 0
+#endif
+
+GnssStart gnssStart = GNSS_START_COLD;
+uint32_t gnssStartedMs = 0;
+volatile uint32_t gnssTtffMs = 0;   // Time to first fix this boot, 0 = none yet
+StoredFix pendingFixSave;           // Written by the modem lock holder...
+volatile bool fixSavePending = false;  // ...saved to NVS by the network task
+uint32_t startupReadingDeadline = 0;   // Startup reading waits for a fix until then
+
+// Boot pipeline. WiFi association, modem power-up and sensor warm-up
+// each run in their own one-shot task while setup() carries on. Each phase sets its
+// bit in bootEvents when it finishes (successfully or not); the startup
+// reading waits for all of them, or BOOT_READY_TIMEOUT_MS, and reports
+// when each one finished.
+enum BootPhase : uint8_t {
+    BOOT_WIFI,
+    BOOT_MODEM,
+    BOOT_SENSORS,
+    BOOT_PHASES,
+};
+#define BOOT_ALL_DONE ((1 << BOOT_PHASES) - 1)
+#define BOOT_READY_TIMEOUT_MS 60000
+#define MODEM_PRESENT_TIMEOUT_MS 500   // Modem already on (kept power over an ESP32 reset)?
+#define MODEM_BOOT_TIMEOUT_MS 10000    // PWRKEY to first AT response
+
+EventGroupHandle_t bootEvents = NULL;
+uint32_t bootPhaseMs[BOOT_PHASES];  // millis() when each phase finished, 0 = running
+
+void bootPhaseDone(BootPhase phase) {
+    bootPhaseMs[phase] = millis();
+    xEventGroupSetBits(bootEvents, 1 << phase);
+}
+
+// Battery deployments (-D DUTY_CYCLE=1): a reading every
+// DUTY_CYCLE_INTERVAL_S and deep sleep in between. The timer, the tap
+// button and the touch pad wake it; a button or touch wake sends its
+// reading and stays up DUTY_CYCLE_INTERACTIVE_MS for more taps or the
+// phone. What a wake needs from the last cycle (counters, last fix,
+// transport health, schedule) is kept in RTC memory, like rtcWifiCache.
+#ifndef DUTY_CYCLE
+#define DUTY_CYCLE 0
+#endif
+#ifndef DUTY_CYCLE_INTERVAL_S
+#define DUTY_CYCLE_INTERVAL_S 900
+#endif
+#ifndef DUTY_CYCLE_INTERACTIVE_MS
+#define DUTY_CYCLE_INTERACTIVE_MS 60000
+#endif
+#ifndef DUTY_CYCLE_MAX_AWAKE_MS
+#define DUTY_CYCLE_MAX_AWAKE_MS 120000  // Hung upload or forgotten phone
+#endif
+#define DUTY_CYCLE_MIN_SLEEP_S 10
+
+#if DUTY_CYCLE
+RTC_NOINIT_ATTR DutyCycleState rtcDutyCycle;
+const DutyCycleConfig DUTY_CYCLE_CONFIG = {DUTY_CYCLE_INTERVAL_S, DUTY_CYCLE_MIN_SLEEP_S,
+                                           DUTY_CYCLE_INTERACTIVE_MS, DUTY_CYCLE_MAX_AWAKE_MS};
+WakeScheduler wakeScheduler(DUTY_CYCLE_CONFIG);
+#endif
+bool dutyCycleResumed = false;        // Woke from deep sleep with rtcDutyCycle intact
+const char* wakeReading = "Startup";  // Sent once booted, NULL = nothing due this wake
+uint32_t uptimeBaseMs = 0;            // Power-on to this wake, counting sleep
+
+// Since power-on; unlike millis() this carries on across deep sleep
+uint32_t uptimeMs() {
+    return uptimeBaseMs + millis();
+}
 
-// Modem diagnostics
-int batteryVoltage = 0;    // millivolts
-int signalQuality = 99;    // CSQ (0-31, 99=unknown)
-String networkOperator = "";
+NmeaParser nmeaParser;      // Modem lock holder only (fed from the AT engine)
+FixHistory gnssTrack;       // Modem lock holder only
+LatestFix gnssFix;          // Any task, lock free
 
 // Forward declarations for Salesforce config
 extern const char* SF_ENDPOINT;
@@ -70,9 +264,7 @@ extern const char* FIRMWARE_VERSION;
 // Buzzer on GPIO25
 const int BUZZER_PIN = 25;
 
-// Preferences for storing WiFi credentials
 Preferences preferences;
-#define MAX_SAVED_NETWORKS 5
 
 BLEServer* pServer = NULL;
 BLECharacteristic* pButtonChar = NULL;
@@ -100,6 +292,10 @@ void beepWifiConnect();
 void beepFail();
 void setupBLE();
 void sendReading(const char* function);
+bool clockValid();
+extern uint32_t bootCount;
+void setupScheduler();
+void setupInput();
 
 class MyServerCallbacks: public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
@@ -185,130 +381,509 @@ void updateWifiStatus() {
     }
 }
 
-// Buzzer functions using PWM tones
+// Buzzer: melodies are note tables played by MelodySequencer from an
+// esp_timer, so a beep never blocks the caller (including BLE callbacks,
+// which run on the Bluetooth host task)
 #define BUZZER_CHANNEL 0
 
-void playTone(int frequency, int duration) {
+constexpr Note TAP_ACK_NOTES[] = {{1000, 20}};
+constexpr Note TAP_NOTES[] = {{800, 15}};
+constexpr Note SHORT_NOTES[] = {{1000, 100}};
+constexpr Note SUCCESS_NOTES[] = {{1200, 60}, {0, 40}, {1500, 80}};            // Ding ding!
+constexpr Note FAIL_NOTES[] = {{200, 150}, {0, 80}, {150, 200}};               // Low buzz-buzz
+constexpr Note BLE_CONNECT_NOTES[] = {{523, 60}, {0, 30}, {659, 60}, {0, 30},  // C5 E5
+                                      {784, 60}, {0, 30}, {1047, 100}};        // G5 C6
+constexpr Note BLE_DISCONNECT_NOTES[] = {{784, 80}, {0, 40}, {440, 120}};      // G5 A4
+constexpr Note WIFI_CONNECT_NOTES[] = {{660, 200}};                            // E5
+constexpr Note WIFI_DISCONNECT_NOTES[] = {{330, 200}};                         // E4
+constexpr Note STARTUP_NOTES[] = {{440, 80}, {0, 50}, {554, 80}, {0, 50}, {659, 150}};  // A4 C#5 E5
+constexpr Note SCANNING_NOTES[] = {{1000, 30}, {0, 50}, {1200, 30}};
+constexpr Note BLE_ON_NOTES[] = {{440, 80}, {0, 50}, {660, 80}, {0, 50}, {880, 120}};
+constexpr Note BLE_OFF_NOTES[] = {{880, 80}, {0, 50}, {660, 80}, {0, 50}, {440, 120}};
+constexpr Note CELLULAR_NOTES[] = {{600, 40}, {0, 30}, {800, 60}};
+constexpr Note UPDATE_START_NOTES[] = {{400, 100}, {0, 50}, {600, 100}, {0, 50}, {800, 100}};
+constexpr Note UPDATE_SUCCESS_NOTES[] = {{523, 100}, {0, 50}, {659, 100}, {0, 50}, {784, 200}};  // C E G
+constexpr Note UP_TO_DATE_NOTES[] = {{1000, 100}, {0, 100}, {1000, 100}};
+
+constexpr Melody MELODY_TAP_ACK = makeMelody(TAP_ACK_NOTES, MELODY_PRIORITY_CLICK);
+constexpr Melody MELODY_TAP = makeMelody(TAP_NOTES, MELODY_PRIORITY_CLICK);
+constexpr Melody MELODY_SHORT = makeMelody(SHORT_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_SUCCESS = makeMelody(SUCCESS_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_FAIL = makeMelody(FAIL_NOTES, MELODY_PRIORITY_ALERT);
+constexpr Melody MELODY_BLE_CONNECT = makeMelody(BLE_CONNECT_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_BLE_DISCONNECT = makeMelody(BLE_DISCONNECT_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_WIFI_CONNECT = makeMelody(WIFI_CONNECT_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_WIFI_DISCONNECT = makeMelody(WIFI_DISCONNECT_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_STARTUP = makeMelody(STARTUP_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_SCANNING = makeMelody(SCANNING_NOTES, MELODY_PRIORITY_CLICK);
+constexpr Melody MELODY_BLE_ON = makeMelody(BLE_ON_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_BLE_OFF = makeMelody(BLE_OFF_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody MELODY_CELLULAR = makeMelody(CELLULAR_NOTES, MELODY_PRIORITY_CLICK);
+constexpr Melody MELODY_UPDATE_START = makeMelody(UPDATE_START_NOTES, MELODY_PRIORITY_ALERT);
+constexpr Melody MELODY_UPDATE_SUCCESS = makeMelody(UPDATE_SUCCESS_NOTES, MELODY_PRIORITY_ALERT);
+constexpr Melody MELODY_UP_TO_DATE = makeMelody(UP_TO_DATE_NOTES, MELODY_PRIORITY_STATUS);
+
+void buzzerOutput(uint16_t frequency) {
     ledcWriteTone(BUZZER_CHANNEL, frequency);
-    delay(duration);
-    ledcWriteTone(BUZZER_CHANNEL, 0);
 }
 
-void beep(int duration) {
-    playTone(1000, duration);
-}
+MelodySequencer buzzer(buzzerOutput);
+SemaphoreHandle_t buzzerMutex = NULL;
+esp_timer_handle_t buzzerTimer = NULL;
 
-void beepSuccess() {
-    // Two quick high beeps (ding ding!)
-    playTone(1200, 60);
-    delay(40);
-    playTone(1500, 80);
+// Advance the sequencer and arm the timer for the next note change.
+// Caller holds buzzerMutex.
+void serviceBuzzerLocked() {
+    uint32_t next = buzzer.update(millis());
+    esp_timer_stop(buzzerTimer);  // Fails harmlessly if not armed
+    if (next > 0) {
+        esp_timer_start_once(buzzerTimer, (uint64_t)next * 1000);
+    }
 }
 
-void beepFail() {
-    // Low buzz-buzz (error)
-    playTone(200, 150);
-    delay(80);
-    playTone(150, 200);
-}
+#define BUZZER_RETRY_US 1000  // Timer retry while playMelody() holds the sequencer
 
-void beepTap(int count) {
-    // Short click
-    playTone(800, 15);
+// Runs on the esp_timer task, which every other timer shares, so it never
+// waits for the mutex. A player holding it services the sequencer and
+// re-arms the timer before releasing; the retry is a backstop and fails
+// harmlessly when the timer is already armed.
+void buzzerTimerCallback(void* arg) {
+    if (xSemaphoreTake(buzzerMutex, 0) != pdTRUE) {
+        esp_timer_start_once(buzzerTimer, BUZZER_RETRY_US);
+        return;
+    }
+    serviceBuzzerLocked();
+    xSemaphoreGive(buzzerMutex);
 }
 
-void beepBleConnect() {
-    // Rising arpeggio - phone connected (C-E-G-C)
-    playTone(523, 60);   // C5
-    delay(30);
-    playTone(659, 60);   // E5
-    delay(30);
-    playTone(784, 60);   // G5
-    delay(30);
-    playTone(1047, 100); // C6
-}
+void setupBuzzer() {
+    ledcSetup(BUZZER_CHANNEL, 2000, 8);
+    ledcAttachPin(BUZZER_PIN, BUZZER_CHANNEL);
 
-void beepBleDisconnect() {
-    // Descending two-tone - phone disconnected
-    playTone(784, 80);   // G5
-    delay(40);
-    playTone(440, 120);  // A4
+    buzzerMutex = xSemaphoreCreateMutex();
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = buzzerTimerCallback;
+    timerArgs.name = "buzzer";
+    esp_timer_create(&timerArgs, &buzzerTimer);
 }
 
-void beepWifiConnect() {
-    // Single warm tone - WiFi connected
-    playTone(660, 200);  // E5
+// Safe from any task; returns immediately
+void playMelody(const Melody& melody) {
+    if (buzzerTimer == NULL) return;  // Before setupBuzzer()
+    xSemaphoreTake(buzzerMutex, portMAX_DELAY);
+    buzzer.play(melody);
+    serviceBuzzerLocked();
+    xSemaphoreGive(buzzerMutex);
 }
 
-void beepWifiDisconnect() {
-    // Low single tone - WiFi lost
-    playTone(330, 200);  // E4
-}
+void beepTapAck() { playMelody(MELODY_TAP_ACK); }
+void beepTap(int count) { playMelody(MELODY_TAP); }
+void beepShortTap() { beepTap(1); }
+void beepShort() { playMelody(MELODY_SHORT); }
+void beepSuccess() { playMelody(MELODY_SUCCESS); }
+void beepFail() { playMelody(MELODY_FAIL); }
+void beepBleConnect() { playMelody(MELODY_BLE_CONNECT); }
+void beepBleDisconnect() { playMelody(MELODY_BLE_DISCONNECT); }
+void beepWifiConnect() { playMelody(MELODY_WIFI_CONNECT); }
+void beepWifiDisconnect() { playMelody(MELODY_WIFI_DISCONNECT); }
+void beepStartup() { playMelody(MELODY_STARTUP); }
+void beepScanning() { playMelody(MELODY_SCANNING); }
+void beepBleOn() { playMelody(MELODY_BLE_ON); }
+void beepBleOff() { playMelody(MELODY_BLE_OFF); }
+void beepCellular() { playMelody(MELODY_CELLULAR); }
+void beepUpdateStart() { playMelody(MELODY_UPDATE_START); }
+void beepUpdateSuccess() { playMelody(MELODY_UPDATE_SUCCESS); }
+void beepUpToDate() { playMelody(MELODY_UP_TO_DATE); }
+
+// Sounds requested on the network task are completion events: they go
+// back to the loop task, which owns user feedback.
+typedef void (*SoundFunction)();
+
+struct NetEvent {
+    SoundFunction sound;
+};
 
-void beepStartup() {
-    // Three ascending notes - boot (like Mac)
-    playTone(440, 80);   // A4
-    delay(50);
-    playTone(554, 80);   // C#5
-    delay(50);
-    playTone(659, 150);  // E5
-}
+TaskHandle_t netTaskHandle = NULL;
+TaskHandle_t hedgeTaskHandle = NULL;  // Second upload of a hedged reading
+QueueHandle_t netEventQueue = NULL;
 
-void beepScanning() {
-    // Quick chirp - scanning
-    playTone(1000, 30);
-    delay(50);
-    playTone(1200, 30);
+void playSound(SoundFunction sound) {
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    if (netTaskHandle != NULL && (current == netTaskHandle || current == hedgeTaskHandle)) {
+        NetEvent event = {sound};
+        xQueueSend(netEventQueue, &event, 0);  // Drop the sound rather than block
+        return;
+    }
+    sound();
 }
 
-void beepBleOn() {
-    // Rising three-tone - BLE enabled
-    playTone(440, 80);
-    delay(50);
-    playTone(660, 80);
-    delay(50);
-    playTone(880, 120);
+// Power governor. Idle, the CPU runs at 80 MHz with WiFi modem sleep,
+// plus automatic light sleep where the core's power management allows
+// it. Network work gets 160 MHz; TLS handshakes, OTA and BLE sessions get
+// 240 MHz, with modem sleep off unless BLE needs it for coexistence.
+// Tasks hold demands with PowerBoost; the loop task polls the rest.
+// -D POWER_GOVERNOR=0 keeps the fixed 240 MHz without modem sleep.
+#ifndef POWER_GOVERNOR
+#define POWER_GOVERNOR 1
+#endif
+#ifndef POWER_HOLD_MS
+#define POWER_HOLD_MS 3000  // A lower level must suffice this long before stepping down
+#endif
+#define POWER_POLL_MS 100
+
+const uint32_t POWER_CPU_MHZ[POWER_LEVELS] = {80, 160, 240};
+
+PowerGovernor powerGovernor(POWER_HOLD_MS, POWER_HIGH, 0);  // Boot runs flat out
+SemaphoreHandle_t powerMutex = NULL;
+bool powerManagement = true;  // esp_pm usable; cleared once the core says it has none
+volatile bool lightSleepEnabled = false;  // Low level applied with esp_pm; the moisture task paces its DMA
+
+void applyPowerLevel(PowerLevel level, uint8_t demands) {
+    uint32_t mhz = POWER_CPU_MHZ[level];
+    bool managed = false;
+    if (powerManagement) {
+        esp_pm_config_esp32_t pm = {};
+        pm.max_freq_mhz = mhz;
+        pm.min_freq_mhz = POWER_CPU_MHZ[POWER_LOW];
+        pm.light_sleep_enable = level == POWER_LOW;
+        esp_err_t err = esp_pm_configure(&pm);
+        if (err == ESP_OK) {
+            managed = true;
+        } else if (err == ESP_ERR_NOT_SUPPORTED) {
+            // Core built without CONFIG_PM_ENABLE; that won't change
+            powerManagement = false;
+            Serial.println("Power: no power management in this core - fixed clock, no light sleep");
+        } else {
+            // Retried on the next transition
+            Serial.printf("Power: esp_pm_configure failed (%d) - fixed clock this time\n", err);
+        }
+    }
+    if (!managed) setCpuFrequencyMhz(mhz);
+    lightSleepEnabled = managed && level == POWER_LOW;
+    WiFi.setSleep(level != POWER_HIGH || (demands & 1 << POWER_DEMAND_BLE));
 }
 
-void beepBleOff() {
-    // Descending three-tone - BLE disabled
-    playTone(880, 80);
-    delay(50);
-    playTone(660, 80);
-    delay(50);
-    playTone(440, 120);
+// Change a demand with the governor locked, applying any new level
+void governPower(PowerDemand demand, int8_t change) {
+#if POWER_GOVERNOR
+    if (powerMutex == NULL) return;
+    xSemaphoreTake(powerMutex, portMAX_DELAY);
+    if (change > 0) {
+        powerGovernor.acquire(demand);
+    } else if (change < 0) {
+        powerGovernor.release(demand);
+    }
+    if (powerGovernor.update(millis())) applyPowerLevel(powerGovernor.level(), powerGovernor.demands());
+    xSemaphoreGive(powerMutex);
+#endif
 }
 
-void beepCellular() {
-    // Quick double chirp - cellular activity
-    playTone(600, 40);
-    delay(30);
-    playTone(800, 60);
+// For demands the loop task polls
+void setPowerDemand(PowerDemand demand, bool on) {
+#if POWER_GOVERNOR
+    if (powerMutex == NULL) return;
+    xSemaphoreTake(powerMutex, portMAX_DELAY);
+    powerGovernor.set(demand, on);
+    xSemaphoreGive(powerMutex);
+    governPower(demand, 0);
+#endif
 }
 
-void beepUpdateStart() {
-    // Ascending tones - update starting
-    playTone(400, 100);
-    delay(50);
-    playTone(600, 100);
-    delay(50);
-    playTone(800, 100);
-}
+// Holds a demand for its scope, like ModemLock
+class PowerBoost {
+public:
+    explicit PowerBoost(PowerDemand demand) : _demand(demand) { governPower(_demand, 1); }
+    ~PowerBoost() { governPower(_demand, -1); }
+
+private:
+    PowerDemand _demand;
+};
 
-void beepUpdateSuccess() {
-    // Happy melody - update succeeded
-    playTone(523, 100);  // C
-    delay(50);
-    playTone(659, 100);  // E
-    delay(50);
-    playTone(784, 200);  // G
+WiFiClientSecure client;
+
+// HTTPS connection to the Salesforce site kept open between requests
+// (see KeepAliveSession): the resolved address is cached and the TLS
+// socket is reused through HTTP keep-alive.
+#define SF_DNS_TTL_MS 300000   // Re-resolve the site after 5 minutes
+#define SF_IDLE_CLOSE_MS 50000  // Drop sockets the server has likely timed out
+
+static_assert(KeepAliveSession::CONNECT_FAILED == HTTPC_ERROR_CONNECTION_REFUSED, "session error codes");
+
+// "https://host/path?query" -> host copied, path points into url
+bool splitUrl(const char* url, char* host, size_t size, const char*& path) {
+    const char* start = strstr(url, "://");
+    start = start ? start + 3 : url;
+    const char* slash = strchr(start, '/');
+    size_t length = slash ? (size_t)(slash - start) : strlen(start);
+    if (length == 0 || length >= size) return false;
+    memcpy(host, start, length);
+    host[length] = '\0';
+    path = slash ? slash : "/";
+    return true;
 }
 
+// WiFiClientSecure and HTTPClient under the Salesforce session
+class WifiSessionTransport : public SessionTransport {
+public:
+    String* response = NULL;  // Receives the body of the next exchange
+
+    uint32_t nowMs() override { return millis(); }
+
+    bool resolve(const char* host, uint32_t& address) override {
+        IPAddress ip;
+        if (!WiFi.hostByName(host, ip)) {
+            Serial.print("HTTPS: DNS lookup failed for ");
+            Serial.println(host);
+            return false;
+        }
+        address = (uint32_t)ip;
+        return true;
+    }
+
+    // Connect by cached address, still sending the host name for SNI
+    bool connect(uint32_t address, const char* host) override {
+        PowerBoost boost(POWER_DEMAND_TLS);
+        client.setInsecure();
+        if (!client.connect(IPAddress(address), 443, host, NULL, NULL, NULL)) {
+            Serial.println("HTTPS: connect failed");
+            return false;
+        }
+        return true;
+    }
+
+    bool connected() override { return client.connected(); }
+    void stop() override { client.stop(); }
+
+    int exchange(const char* host, const char* path, const char* body, size_t length) override {
+        _http.setReuse(true);
+        _http.setTimeout(10000);
+        _http.begin(client, host, 443, path, true);
+        int code;
+        if (body) {
+            _http.addHeader("Content-Type", "application/json");
+            code = _http.POST((uint8_t*)body, length);
+        } else {
+            code = _http.GET();
+        }
+        if (code > 0) {
+            // Read the whole body so the socket is clean for the next request
+            String payload = _http.getString();
+            if (response) *response = payload;
+        }
+        _http.end();
+        return code;
+    }
+
+    bool failedBeforeResponse(int code) override {
+        return code == HTTPC_ERROR_SEND_HEADER_FAILED ||
+               code == HTTPC_ERROR_SEND_PAYLOAD_FAILED ||
+               code == HTTPC_ERROR_NOT_CONNECTED ||
+               code == HTTPC_ERROR_CONNECTION_LOST;
+    }
+
+private:
+    HTTPClient _http;  // Long-lived: destroying an HTTPClient stops its socket
+};
+
+// The session is shared by the network task and the hedge worker, which
+// can still be finishing an upload after uploadHedged() has returned
+SemaphoreHandle_t salesforceMutex = NULL;
+
+class SalesforceLock {
+public:
+    SalesforceLock() { xSemaphoreTake(salesforceMutex, portMAX_DELAY); }
+    ~SalesforceLock() { xSemaphoreGive(salesforceMutex); }
+};
+
+class SalesforceConnection {
+public:
+    SalesforceConnection() : _session(_transport, SessionConfig{SF_DNS_TTL_MS, SF_IDLE_CLOSE_MS}) {}
+
+    // GET when body is NULL, otherwise POST application/json.
+    // Returns the HTTP status or a negative HTTPC_ERROR_* code.
+    int request(const char* url, const char* body, size_t length, String* response = NULL) {
+        char host[KeepAliveSession::HOST_MAX];
+        const char* path;
+        if (!splitUrl(url, host, sizeof(host), path)) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+        SalesforceLock lock;
+        _transport.response = response;
+        int code = _session.request(host, path, body, length);
+        _transport.response = NULL;
+        if (code == KeepAliveSession::CONNECT_FAILED) return code;
+
+        if (_session.lastRetried()) Serial.println("HTTPS: stale connection, reconnected");
+        if (_session.lastReused()) {
+            Serial.printf("HTTPS: request %lums (reused connection)\n", (unsigned long)_session.lastRequestMs());
+        } else {
+            Serial.printf("HTTPS: handshake %lums, request %lums\n", (unsigned long)_session.lastHandshakeMs(),
+                          (unsigned long)_session.lastRequestMs());
+        }
+        return code;
+    }
+
+    void close() {
+        SalesforceLock lock;
+        _session.close();
+    }
+
+private:
+    WifiSessionTransport _transport;
+    KeepAliveSession _session;
+};
+
+SalesforceConnection salesforce;
+
+// TLS socket to the Salesforce site over the modem, kept open between
+// posts the same way as SalesforceConnection does over WiFi. Replaces the
+// module's HTTP application (HTTPINIT ... HTTPTERM per post): after the
+// first post a reading costs one request/response on a warm socket.
+// Callers hold modemMutex.
+#define CELL_IDLE_CLOSE_MS 50000      // Drop sockets the server has likely timed out
+#define CELL_RESPONSE_TIMEOUT_MS 30000
+#define CELL_COALESCE_MAX 1024        // Header + body up to this size go out in one write
+
+class CellularConnection {
+public:
+    // POST application/json. Returns the HTTP status or a negative
+    // HTTPC_ERROR_* code.
+    int post(const char* url, const char* body, size_t length) {
+        char host[64];
+        const char* path;
+        if (!splitUrl(url, host, sizeof(host), path)) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+        for (int attempt = 0; attempt < 2; attempt++) {
+            bool reused = isOpen(host);
+            if (!reused && !open(host)) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+            unsigned long start = millis();
+            int code = exchange(host, path, body, length);
+            lastRequestMs = millis() - start;
+            requests++;
+            _lastUsed = millis();
+
+            if (reused) {
+                Serial.printf("Cellular: request %lums (reused connection)\n", lastRequestMs);
+            } else {
+                Serial.printf("Cellular: connect %lums, request %lums\n", lastConnectMs, lastRequestMs);
+            }
+
+            if (code > 0) {
+                if (!_response.keepAlive()) close();
+                return code;
+            }
+            close();
+            // A kept-alive socket the server already closed fails before
+            // any response - retry once on a fresh connection
+            if (!reused || _response.started()) return code;
+            Serial.println("Cellular: stale connection, reconnecting");
+        }
+        return HTTPC_ERROR_CONNECTION_LOST;
+    }
+
+    void close() {
+        cellularClient.stop();
+        _host[0] = '\0';
+    }
+
+    // Timing of the most recent connect and request, for diagnostics
+    unsigned long lastConnectMs = 0;
+    unsigned long lastRequestMs = 0;
+    uint32_t connects = 0;
+    uint32_t requests = 0;
+
+private:
+    bool isOpen(const char* host) {
+        return _host[0] != '\0' && strcmp(host, _host) == 0 &&
+               millis() - _lastUsed < CELL_IDLE_CLOSE_MS && cellularClient.connected();
+    }
+
+    bool open(const char* host) {
+        close();
+        unsigned long start = millis();
+        if (!cellularClient.connect(host, 443)) {
+            Serial.println("Cellular: connect failed");
+            return false;
+        }
+        lastConnectMs = millis() - start;
+        connects++;
+        strncpy(_host, host, sizeof(_host) - 1);
+        _host[sizeof(_host) - 1] = '\0';
+        return true;
+    }
+
+    int exchange(const char* host, const char* path, const char* body, size_t length) {
+        char header[256];
+        int headerLength = snprintf(header, sizeof(header),
+                                    "POST %s HTTP/1.1\r\n"
+                                    "Host: %s\r\n"
+                                    "Content-Type: application/json\r\n"
+                                    "Content-Length: %u\r\n"
+                                    "Connection: keep-alive\r\n"
+                                    "\r\n",
+                                    path, host, (unsigned)length);
+        if (headerLength <= 0 || headerLength >= (int)sizeof(header)) return HTTPC_ERROR_SEND_HEADER_FAILED;
+
+        // Header and body in one write (one CASEND) when they fit
+        if ((size_t)headerLength + length <= sizeof(_request)) {
+            memcpy(_request, header, headerLength);
+            memcpy(_request + headerLength, body, length);
+            if (cellularClient.write(_request, headerLength + length) != headerLength + length) {
+                return HTTPC_ERROR_SEND_HEADER_FAILED;
+            }
+        } else {
+            if (cellularClient.write((const uint8_t*)header, headerLength) != (size_t)headerLength) {
+                return HTTPC_ERROR_SEND_HEADER_FAILED;
+            }
+            if (cellularClient.write((const uint8_t*)body, length) != length) {
+                return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+            }
+        }
+
+        // Read the whole response so the socket is clean for the next post
+        _response.reset();
+        unsigned long start = millis();
+        uint8_t buffer[128];
+        while (!_response.done() && !_response.failed()) {
+            int available = cellularClient.available();
+            if (available > 0) {
+                size_t want = available < (int)sizeof(buffer) ? (size_t)available : sizeof(buffer);
+                int n = cellularClient.read(buffer, want);
+                if (n > 0) _response.feed(buffer, n);
+                continue;
+            }
+            if (!cellularClient.connected()) {
+                _response.finish();
+                break;
+            }
+            if (millis() - start > CELL_RESPONSE_TIMEOUT_MS) return HTTPC_ERROR_READ_TIMEOUT;
+            delay(5);
+        }
+
+        if (!_response.done()) {
+            return _response.started() ? HTTPC_ERROR_CONNECTION_LOST : HTTPC_ERROR_NOT_CONNECTED;
+        }
+        if (_response.bodyLength() > 0) {
+            Serial.print("Cellular: response ");
+            Serial.println(_responseBody);
+        }
+        return _response.status();
+    }
+
+    uint8_t _request[CELL_COALESCE_MAX];
+    char _responseBody[128];
+    HttpResponseParser _response{_responseBody, sizeof(_responseBody)};
+    char _host[64] = "";
+    unsigned long _lastUsed = 0;
+};
+
+CellularConnection cellular;
+
 // Check for firmware update from Salesforce and apply if available
 void checkAndUpdateFirmware() {
     if (WiFi.status() != WL_CONNECTED) {
         Serial.println("OTA: WiFi not connected, cannot check for updates");
-        beepFail();
+        playSound(beepFail);
         return;
     }
 
@@ -317,25 +892,19 @@ void checkAndUpdateFirmware() {
     Serial.println(FIRMWARE_VERSION);
 
     // Build the firmware check URL
-    String url = String(SF_FIRMWARE_ENDPOINT) + "?apiKey=" + SF_API_KEY;
+    char url[200];
+    snprintf(url, sizeof(url), "%s?apiKey=%s", SF_FIRMWARE_ENDPOINT, SF_API_KEY);
 
-    HTTPClient http;
-    http.begin(url);
-    http.setTimeout(15000);
-
-    int httpCode = http.GET();
+    String payload;
+    int httpCode = salesforce.request(url, NULL, 0, &payload);
 
     if (httpCode != 200) {
         Serial.print("OTA: Failed to check firmware, HTTP code: ");
         Serial.println(httpCode);
-        http.end();
-        beepFail();
+        playSound(beepFail);
         return;
     }
 
-    String payload = http.getString();
-    http.end();
-
     Serial.print("OTA: Response: ");
     Serial.println(payload);
 
@@ -356,7 +925,7 @@ void checkAndUpdateFirmware() {
     int versionStart = payload.indexOf("version\":\"");
     if (versionStart < 0) {
         Serial.println("OTA: Could not find version in response");
-        beepFail();
+        playSound(beepFail);
         return;
     }
     versionStart += 10;  // Move past 'version":"'
@@ -366,7 +935,7 @@ void checkAndUpdateFirmware() {
     int urlStart = payload.indexOf("downloadUrl\":\"");
     if (urlStart < 0) {
         Serial.println("OTA: Could not find downloadUrl in response");
-        beepFail();
+        playSound(beepFail);
         return;
     }
     urlStart += 14;  // Move past 'downloadUrl":"'
@@ -381,17 +950,15 @@ void checkAndUpdateFirmware() {
     // Compare versions
     if (serverVersion == FIRMWARE_VERSION) {
         Serial.println("OTA: Already on latest version");
-        // Two short beeps - already up to date
-        beep(100);
-        delay(100);
-        beep(100);
+        playSound(beepUpToDate);
         return;
     }
 
     Serial.println("OTA: New version available! Starting update...");
-    beepUpdateStart();
+    playSound(beepUpdateStart);
 
     // Perform HTTP OTA update
+    PowerBoost boost(POWER_DEMAND_OTA);
     WiFiClient otaClient;
 
     t_httpUpdate_return ret = httpUpdate.update(otaClient, downloadUrl);
@@ -401,17 +968,17 @@ void checkAndUpdateFirmware() {
             Serial.printf("OTA: Update failed. Error (%d): %s\n",
                          httpUpdate.getLastError(),
                          httpUpdate.getLastErrorString().c_str());
-            beepFail();
+            playSound(beepFail);
             break;
 
         case HTTP_UPDATE_NO_UPDATES:
             Serial.println("OTA: No update available");
-            beep(100);
+            playSound(beepShort);
             break;
 
         case HTTP_UPDATE_OK:
             Serial.println("OTA: Update successful! Rebooting...");
-            beepUpdateSuccess();
+            playSound(beepUpdateSuccess);
             delay(1000);
             ESP.restart();
             break;
@@ -434,6 +1001,69 @@ void modemPowerOn() {
     #endif
 }
 
+bool loadLastFix(StoredFix& stored) {
+#if DUTY_CYCLE
+    // Fresher than NVS, which is written every GNSS_SAVE_INTERVAL_MS at most
+    if (dutyCycleResumed && storedFixValid(rtcDutyCycle.lastFix)) {
+        stored = rtcDutyCycle.lastFix;
+        return true;
+    }
+#endif
+    Preferences gnssPrefs;
+    gnssPrefs.begin("gnss", true);
+    size_t length = gnssPrefs.getBytes("fix", &stored, sizeof(stored));
+    gnssPrefs.end();
+    return length == sizeof(stored) && storedFixValid(stored);
+}
+
+// Called by the network task; the fix was captured by publishFix()
+void saveLastFix() {
+    if (!fixSavePending) return;
+    fixSavePending = false;
+
+    Preferences gnssPrefs;
+    gnssPrefs.begin("gnss", false);
+    gnssPrefs.putBytes("fix", &pendingFixSave, sizeof(pendingFixSave));
+    gnssPrefs.end();
+    Serial.println("GNSS: saved last fix");
+}
+
+// Power up GNSS, restarting it hot or warm when the fix saved on an
+// earlier boot is recent enough. An engine still running (the modem kept
+// power across an ESP32 reset) is left alone.
+void startGnss() {
+    ModemLock lock;
+
+    AtResult result;
+    AtRequest query("+CGNSPWR?", "+CGNSPWR:");
+    query.result = &result;
+    if (atEngine.submit(query)) modemWait(result);
+
+    if (result.ok() && result.line[0] == '1') {
+        gnssStart = GNSS_START_RUNNING;
+    } else {
+        StoredFix stored;
+        bool haveFix = loadLastFix(stored);
+        gnssStart = chooseGnssStart(haveFix ? &stored : NULL, clockValid() ? (uint32_t)time(NULL) : 0);
+#if GNSS_XTRA
+        atEngine.submit(AtRequest("+CGNSXTRA=1"));  // Must precede power-up
+#endif
+        atEngine.submit(AtRequest("+CGNSPWR=1", NULL, 5000));
+        const char* command = gnssStartCommand(gnssStart);
+        if (command) atEngine.submit(AtRequest(command, NULL, 5000));
+    }
+#if GNSS_STREAMING
+    atEngine.submit(AtRequest("+CGNSTST=1"));  // NMEA sentences on this port
+#endif
+    modemDrain();
+
+    gnssStartedMs = millis();
+    gnssTtffMs = 0;
+    Serial.print("GNSS: ");
+    Serial.print(gnssStartName(gnssStart));
+    Serial.println(" start");
+}
+
 // Initialize cellular modem
 bool initModem() {
     if (modemInitialized) return true;
@@ -442,23 +1072,25 @@ bool initModem() {
 
     // SIM7000A responds at 57600 baud
     // Note: ESP32 3.3V must be connected to SIM7000A 5V pin for logic levels
+    // Room for a few seconds of NMEA while the network task is busy
+    SerialAT.setRxBufferSize(1024);
     SerialAT.begin(57600, SERIAL_8N1, MODEM_RX, MODEM_TX);
-    delay(1000);
 
     // Flush any garbage
     while (SerialAT.available()) SerialAT.read();
 
-    modemPowerOn();
-    delay(3000);
-
+    // testAT() polls AT until the modem answers or the deadline passes.
+    // A modem that is already on is left alone - PWRKEY would turn it off.
     Serial.println("Testing modem with TinyGSM...");
-    if (!modem.testAT()) {
-        Serial.println("Modem not responding, trying again...");
+    if (!modem.testAT(MODEM_PRESENT_TIMEOUT_MS)) {
         modemPowerOn();
-        delay(3000);
-        if (!modem.testAT()) {
-            Serial.println("Modem failed to respond");
-            return false;
+        if (!modem.testAT(MODEM_BOOT_TIMEOUT_MS)) {
+            Serial.println("Modem not responding, trying again...");
+            modemPowerOn();
+            if (!modem.testAT(MODEM_BOOT_TIMEOUT_MS)) {
+                Serial.println("Modem failed to respond");
+                return false;
+            }
         }
     }
 
@@ -469,9 +1101,7 @@ bool initModem() {
 
     // Enable GPS
     Serial.println("Enabling GPS...");
-    modem.sendAT("+CGNSPWR=1");  // Power on GPS
-    modem.waitResponse();
-    delay(1000);
+    startGnss();
 
     modemInitialized = true;
     return true;
@@ -508,6 +1138,9 @@ bool connectCellular() {
     }
     Serial.println("Network registered");
 
+    // Sockets from a previous data session are gone
+    cellular.close();
+
     // Connect GPRS
     Serial.print("Connecting GPRS...");
     if (!modem.gprsConnect(apn, gprsUser, gprsPass)) {
@@ -515,334 +1148,442 @@ bool connectCellular() {
         return false;
     }
     Serial.println("GPRS connected!");
+    cellularDataConnected = true;
 
-    beepCellular();
+    playSound(beepCellular);
     return true;
 }
 
-// Read GPS coordinates
-bool updateGPS() {
-    if (!modemInitialized) return false;
+void publishFix(const GnssFix& fix) {
+    static uint32_t lastSaveMs = 0;
 
-    // Request GPS info
-    modem.sendAT("+CGNSINF");
-    if (modem.waitResponse(10000L, "+CGNSINF:") != 1) {
-        return false;
-    }
+    gnssFix.publish(fix);
+    gnssTrack.offer(fix, fix.updatedMs);
+    if (!fix.valid) return;
 
-    // Parse CGNSINF response: run,fix,date,time,lat,lon,alt,speed,course,...
-    String gpsData = SerialAT.readStringUntil('\n');
-    Serial.print("GPS raw: ");
-    Serial.println(gpsData);
-
-    // Parse fields (CGNSINF has up to 18 fields)
-    int commaIndex = 0;
-    String fields[20];
-    int fieldCount = 0;
-    int lastIndex = 0;
-
-    for (int i = 0; i < gpsData.length() && fieldCount < 20; i++) {
-        if (gpsData.charAt(i) == ',') {
-            fields[fieldCount++] = gpsData.substring(lastIndex, i);
-            lastIndex = i + 1;
-        }
+    if (gnssTtffMs == 0 && gnssStartedMs != 0) {
+        uint32_t ttff = fix.updatedMs - gnssStartedMs;
+        gnssTtffMs = ttff > 0 ? ttff : 1;
+        Serial.printf("GNSS: first fix after %lums (%s start)\n", (unsigned long)ttff, gnssStartName(gnssStart));
     }
-    if (lastIndex < gpsData.length() && fieldCount < 20) {
-        fields[fieldCount++] = gpsData.substring(lastIndex);
+    if ((lastSaveMs == 0 || fix.updatedMs - lastSaveMs >= GNSS_SAVE_INTERVAL_MS) && !fixSavePending &&
+        storeFix(fix, pendingFixSave)) {
+        fixSavePending = true;
+        lastSaveMs = fix.updatedMs;
     }
+}
 
-    // CGNSINF format: run,fix,date,time,lat,lon,alt,speed,course,fixmode,reserved,HDOP,PDOP,VDOP,reserved,sats,HPA,VPA
-    // Field 1 = fix status (1 = valid fix)
-    if (fieldCount >= 6 && fields[1] == "1") {
-        gpsLatitude = fields[3].toFloat();
-        gpsLongitude = fields[4].toFloat();
-        if (fieldCount > 5) gpsAltitude = fields[5].toFloat();
-        if (fieldCount > 6) gpsSpeed = fields[6].toFloat();
-        if (fieldCount > 14) gpsSatellites = fields[14].toInt();
-        gpsValid = true;
+// Decimal digits at s, n of them
+static uint32_t digitsAt(const char* s, int n) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; i++) v = v * 10 + (uint32_t)(s[i] - '0');
+    return v;
+}
+
+// Parse a CGNSINF line (after the "+CGNSINF: " prefix) into gnssFix
+bool parseGpsInfo(const char* line) {
+    Serial.print("GPS raw: ");
+    Serial.println(line);
+
+    GnssInfo info;
+    if (!parseCgnsinf(line, info)) return false;
+
+    GnssFix fix;
+    memset(&fix, 0, sizeof(fix));
+    fix.valid = info.fix;
+    fix.latitude = info.latitude;
+    fix.longitude = info.longitude;
+    fix.altitude = info.altitude;
+    fix.speedKmh = info.speedKmh;
+    fix.course = info.course;
+    fix.hdop = info.hdop;
+    fix.satellitesUsed = (uint8_t)info.satellitesUsed;
+    if (strlen(info.utc) >= 14) {
+        // yyyyMMddhhmmss.sss
+        fix.utcDate = digitsAt(info.utc + 6, 2) * 10000 + digitsAt(info.utc + 4, 2) * 100 + digitsAt(info.utc + 2, 2);
+        fix.utcTime = digitsAt(info.utc + 8, 6) * 100;
+    }
+    fix.updatedMs = millis();
+    publishFix(fix);
+
+    if (info.fix) {
         Serial.print("GPS: ");
-        Serial.print(gpsLatitude, 6);
+        Serial.print(info.latitude, 6);
         Serial.print(", ");
-        Serial.print(gpsLongitude, 6);
+        Serial.print(info.longitude, 6);
         Serial.print(" Alt:");
-        Serial.print(gpsAltitude);
+        Serial.print(info.altitude);
         Serial.print("m Sats:");
-        Serial.println(gpsSatellites);
+        Serial.print(info.satellitesUsed);
+        Serial.print("/");
+        Serial.println(info.satellitesInView);
         return true;
     }
 
-    gpsValid = false;
     Serial.println("No GPS fix yet");
     return false;
 }
 
-// Read battery voltage from SIM7000A
-void updateBatteryVoltage() {
-    if (!modemInitialized) return;
-
-    // AT+CBC returns: +CBC: 0,percent,voltage
-    modem.sendAT("+CBC");
-    if (modem.waitResponse(5000L, "+CBC:") == 1) {
-        String response = SerialAT.readStringUntil('\n');
-        // Parse voltage (third field after commas)
-        int firstComma = response.indexOf(',');
-        int secondComma = response.indexOf(',', firstComma + 1);
-        if (secondComma > 0) {
-            batteryVoltage = response.substring(secondComma + 1).toInt();
-            Serial.print("Battery: ");
-            Serial.print(batteryVoltage);
-            Serial.println("mV");
-        }
-    }
+void onGpsInfo(const AtResult& result, void* context) {
+    if (result.ok()) parseGpsInfo(result.line);
 }
 
-// Read signal quality (CSQ)
-void updateSignalQuality() {
-    if (!modemInitialized) return;
-
-    signalQuality = modem.getSignalQuality();
-    Serial.print("Signal CSQ: ");
-    Serial.println(signalQuality);
+// One line of the combined status answer (AT MODEM_STATUS_COMMAND)
+bool onModemStatusLine(const char* line, void* context) {
+    return parseModemStatusLine(line, *(ModemStatus*)context);
 }
 
-// Read network operator name
-void updateNetworkOperator() {
-    if (!modemInitialized) return;
+// Store whatever part of the combined status query came back
+void applyModemStatus(const ModemStatus& status) {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&diagnosticsMux);
+    if (status.fields & STATUS_BATTERY) modemDiagnostics.setBattery(status.battery.millivolts, now);
+    if (status.fields & STATUS_SIGNAL) modemDiagnostics.setSignal(status.signal.rssi, now);
+    // An empty operator name means not registered
+    if (status.fields & STATUS_OPERATOR) modemDiagnostics.setOperator(status.network.name, now);
+    if (status.fields & STATUS_REGISTRATION) modemDiagnostics.setRegistered(status.registration.registered(), now);
+    portEXIT_CRITICAL(&diagnosticsMux);
+
+    if (status.fields & STATUS_BATTERY) Serial.printf("Battery: %dmV\n", (int)status.battery.millivolts);
+    if (status.fields & STATUS_SIGNAL) Serial.printf("Signal CSQ: %d\n", (int)status.signal.rssi);
+    if (status.fields & STATUS_OPERATOR) {
+        Serial.printf("Operator: %s\n", status.network.name[0] ? status.network.name : "(none)");
+    }
+    if (status.fields & STATUS_REGISTRATION) Serial.printf("Registration: %d\n", (int)status.registration.status);
+}
 
-    // AT+COPS? returns: +COPS: mode,format,"operator",AcT
-    modem.sendAT("+COPS?");
-    if (modem.waitResponse(5000L, "+COPS:") == 1) {
-        String response = SerialAT.readStringUntil('\n');
-        int firstQuote = response.indexOf('"');
-        int secondQuote = response.indexOf('"', firstQuote + 1);
-        if (firstQuote >= 0 && secondQuote > firstQuote) {
-            networkOperator = response.substring(firstQuote + 1, secondQuote);
-            Serial.print("Operator: ");
-            Serial.println(networkOperator);
-        }
-    }
+// Unsolicited GNSS report (AT+CGNSURC) - same format as the query response
+void onGpsUrc(const char* line, void* context) {
+    const char* value = line + strlen("+CGNSINF:");
+    while (*value == ' ') value++;
+    parseGpsInfo(value);
 }
 
-// Update all modem diagnostics
-void updateModemDiagnostics() {
-    if (!modemInitialized) return;
+// NMEA from AT+CGNSTST=1. Runs on whichever task is polling the engine.
+void onNmeaSentence(const char* line, void* context) {
+    if (nmeaParser.parse(line, millis())) publishFix(nmeaParser.fix());
+}
 
-    updateBatteryVoltage();
-    updateSignalQuality();
-    updateNetworkOperator();
-    updateGPS();
+void setupModemUrcs() {
+    atEngine.onUrc("+CGNSINF:", onGpsUrc);
+    atEngine.onUrc("$", onNmeaSentence);
 }
 
-// Send data via cellular HTTP
-bool sendViaCellular(float temperature, float humidity, const char* function) {
-    if (!modemInitialized) {
-        Serial.println("Modem not initialized");
-        if (!initModem()) return false;
-    }
+// Turn the NMEA stream on or off. Caller holds the modem lock.
+void setNmeaStream(bool on) {
+#if GNSS_STREAMING
+    AtResult result;
+    AtRequest request(on ? "+CGNSTST=1" : "+CGNSTST=0");
+    request.result = &result;
+    if (atEngine.submit(request)) modemWait(result);
+    // Sentences already in flight are consumed by the engine before the OK
+#endif
+}
 
-    if (!modem.isGprsConnected()) {
-        Serial.println("GPRS not connected, reconnecting...");
-        if (!connectCellular()) return false;
-    }
+// TinyGSM reads the modem UART directly; keep NMEA out of its way
+class NmeaPause {
+public:
+    NmeaPause() { setNmeaStream(false); }
+    ~NmeaPause() { setNmeaStream(true); }
+};
 
-    // Update all diagnostics
-    updateModemDiagnostics();
+// Queue a query; the callback updates the cache when it completes
+bool requestModemInfo(const char* command, const char* prefix, uint32_t timeoutMs, AtCallback callback) {
+    AtRequest request(command, prefix, timeoutMs);
+    request.callback = callback;
+    return atEngine.submit(request);
+}
 
-    Serial.println("Sending via cellular HTTP...");
-    beepCellular();
+// Query the metrics whose cached values have outlived their TTL. Battery,
+// signal, operator and registration share one command line, so if any of
+// them is due all four are refreshed for the price of one round trip.
+// A failed query keeps the old value and waits out another TTL. With
+// wait = 0 this gives up if an upload holds the modem.
+void refreshDiagnostics(TickType_t wait = portMAX_DELAY) {
+    if (!modemInitialized) return;
 
-    // Build JSON payload with diagnostics
-    String payload = "{";
-    payload += "\"temperature\":" + String(temperature, 1) + ",";
-    payload += "\"humidity\":" + String(humidity, 1) + ",";
-    payload += "\"deviceId\":\"" + String(DEVICE_ID) + "\",";
-    payload += "\"function\":\"" + String(function) + "\",";
-    payload += "\"connectionType\":\"Cellular\",";
-    if (WiFi.status() == WL_CONNECTED) {
-        payload += "\"localIP\":\"" + WiFi.localIP().toString() + "\",";
-    }
-    if (gpsValid) {
-        payload += "\"latitude\":" + String(gpsLatitude, 6) + ",";
-        payload += "\"longitude\":" + String(gpsLongitude, 6) + ",";
-        payload += "\"gpsAltitude\":" + String(gpsAltitude, 2) + ",";
-        payload += "\"gpsSpeed\":" + String(gpsSpeed, 2) + ",";
-        payload += "\"gpsSatellites\":" + String(gpsSatellites) + ",";
-    }
-    if (batteryVoltage > 0) {
-        payload += "\"batteryVoltage\":" + String(batteryVoltage) + ",";
-    }
-    if (signalQuality != 99) {
-        payload += "\"signalQuality\":" + String(signalQuality) + ",";
-    }
-    if (networkOperator.length() > 0) {
-        payload += "\"networkOperator\":\"" + networkOperator + "\",";
-    }
-    payload += "\"apiKey\":\"" + String(SF_API_KEY) + "\"";
-    payload += "}";
+    ModemLock lock(wait);
+    if (!lock.held()) return;
 
-    Serial.println(payload);
+    static const DiagnosticMetric STATUS_METRICS[] = {DIAG_BATTERY, DIAG_SIGNAL, DIAG_OPERATOR, DIAG_REGISTRATION};
 
-    // Use TinyGSM HTTP
-    modem.sendAT("+HTTPINIT");
-    if (modem.waitResponse() != 1) {
-        Serial.println("HTTP init failed");
-        return false;
+    uint32_t now = millis();
+    bool statusDue = false;
+    portENTER_CRITICAL(&diagnosticsMux);
+    for (uint8_t i = 0; i < sizeof(STATUS_METRICS) / sizeof(STATUS_METRICS[0]); i++) {
+        if (modemDiagnostics.due(STATUS_METRICS[i], now)) statusDue = true;
     }
+    if (statusDue) {
+        for (uint8_t i = 0; i < sizeof(STATUS_METRICS) / sizeof(STATUS_METRICS[0]); i++) {
+            modemDiagnostics.attempted(STATUS_METRICS[i], now);
+        }
+    }
+    portEXIT_CRITICAL(&diagnosticsMux);
+
+    // Stream silent (or off): poll, and restart the stream in case the
+    // modem lost the setting. Back off like the other metrics.
+    static uint32_t lastGpsPoll = 0;
+    GnssFix fix;
+    bool gpsDue = !gnssFix.read(fix) || now - fix.updatedMs >= GNSS_POLL_MS;
+    if (gpsDue && lastGpsPoll != 0 && now - lastGpsPoll < GNSS_POLL_MS) gpsDue = false;
+    if (gpsDue) lastGpsPoll = now;
+
+    ModemStatus status;
+    memset(&status, 0, sizeof(status));
+    if (statusDue) {
+        AtRequest request(MODEM_STATUS_COMMAND, NULL, 10000);
+        request.onLine = onModemStatusLine;
+        request.context = &status;
+        atEngine.submit(request);
+    }
+    if (gpsDue) {
+        requestModemInfo("+CGNSINF", "+CGNSINF:", 10000, onGpsInfo);
+#if GNSS_STREAMING
+        atEngine.submit(AtRequest("+CGNSTST=1"));
+#endif
+    }
+    modemDrain();
+
+    // Partial answers still count (e.g. +COPS? failed after +CBC and +CSQ)
+    if (status.fields) applyModemStatus(status);
+}
 
-    modem.sendAT("+HTTPPARA=\"CID\",1");
-    modem.waitResponse();
-
-    String urlCmd = "+HTTPPARA=\"URL\",\"" + String(SF_ENDPOINT) + "\"";
-    modem.sendAT(urlCmd.c_str());
-    modem.waitResponse();
+// Batch mode: live readings are collected and posted together.
+// Override with build_flags, e.g. -D BATCH_MAX_READINGS=10
+#ifndef BATCH_MAX_READINGS
+#define BATCH_MAX_READINGS 1     // 1 = post every reading immediately
+#endif
+#ifndef BATCH_FLUSH_MS
+#define BATCH_FLUSH_MS 60000     // Longest a live reading waits for its batch
+#endif
+#if DUTY_CYCLE && BATCH_MAX_READINGS > 1
+#error "DUTY_CYCLE sleeps between readings; a partial batch would be lost"
+#endif
+
+// Offline backlog ("readings" partition in partitions.csv)
+#define READINGS_PARTITION_SUBTYPE 0x40
+#define BACKLOG_REPLAY_MAX 3     // Uploads per replay, keeps the loop responsive
+
+#define UPLOAD_BATCH_LIMIT (BATCH_MAX_READINGS > BACKLOG_BATCH_SIZE ? BATCH_MAX_READINGS : BACKLOG_BATCH_SIZE)
+
+// How the last connectWiFi() got on. Reported once, in the next reading
+// (the startup reading after boot), and in the stats.
+uint32_t wifiConnectMs = 0;          // 0 = not connected
+const char* wifiConnectPath = "";    // "fast" or "scan"
+bool wifiConnectReported = true;
+
+uint32_t readingSequence = 0;  // Readings created this boot (network task only)
+
+// The reading sent once booted carries the boot timeline
+bool isWakeReading(const char* function) {
+    return wakeReading != NULL && strcmp(function, wakeReading) == 0;
+}
 
-    modem.sendAT("+HTTPPARA=\"CONTENT\",\"application/json\"");
-    modem.waitResponse();
+// Cache age in whole seconds, saturating
+static uint16_t diagnosticAge(uint32_t ageMs) {
+    uint32_t seconds = ageMs / 1000;
+    return seconds > 0xFFFF ? 0xFFFF : (uint16_t)seconds;
+}
 
-    // Set POST data
-    String dataCmd = "+HTTPDATA=" + String(payload.length()) + ",10000";
-    modem.sendAT(dataCmd.c_str());
-    if (modem.waitResponse(10000L, "DOWNLOAD") != 1) {
-        Serial.println("HTTP data setup failed");
-        modem.sendAT("+HTTPTERM");
-        modem.waitResponse();
-        return false;
+// Snapshot sensor values and cached diagnostics into a reading
+void fillReading(SensorReading& reading, float temperature, float humidity, const char* function) {
+    memset(&reading, 0, sizeof(reading));
+    reading.temperature = temperature;
+    reading.humidity = humidity;
+    strncpy(reading.function, function, sizeof(reading.function) - 1);
+    // Unique across reboots. Retries, replays and hedged copies of this
+    // reading all carry it, so the server keeps one record.
+    snprintf(reading.idempotencyKey, sizeof(reading.idempotencyKey), "%s-%lu-%lu", DEVICE_ID,
+             (unsigned long)bootCount, (unsigned long)++readingSequence);
+
+    GnssFix fix;
+    if (gnssFix.read(fix) && fix.valid) {
+        reading.gpsValid = true;
+        reading.latitude = (float)fix.latitude;
+        reading.longitude = (float)fix.longitude;
+        reading.gpsAltitude = fix.altitude;
+        reading.gpsSpeed = fix.speedKmh;
+        reading.gpsSatellites = fix.satellitesUsed;
+        reading.gpsAge = diagnosticAge(millis() - fix.updatedMs);
+    }
+
+    if (modemInitialized && isWakeReading(function)) {
+        strncpy(reading.gnssStart, gnssStartName(gnssStart), sizeof(reading.gnssStart) - 1);
+        reading.ttffMs = gnssTtffMs;
+    }
+    if (isWakeReading(function)) {
+        reading.bootWifiMs = bootPhaseMs[BOOT_WIFI];
+        reading.bootModemMs = bootPhaseMs[BOOT_MODEM];
+        reading.bootSensorsMs = bootPhaseMs[BOOT_SENSORS];
+        reading.bootReadyMs = millis();
+#if DUTY_CYCLE
+        strncpy(reading.wake, wakeReasonName(wakeScheduler.reason()), sizeof(reading.wake) - 1);
+        reading.lastAwakeMs = dutyCycleResumed ? rtcDutyCycle.lastAwakeMs : 0;
+#endif
+    }
+
+    DiagnosticsSnapshot diag;
+    readDiagnostics(diag);
+    reading.batteryVoltage = diag.values.batteryVoltage;
+    reading.signalQuality = diag.values.signalQuality;
+    strncpy(reading.networkOperator, diag.values.networkOperator, sizeof(reading.networkOperator) - 1);
+    reading.batteryAge = diagnosticAge(diag.ageMs[DIAG_BATTERY]);
+    reading.signalAge = diagnosticAge(diag.ageMs[DIAG_SIGNAL]);
+    reading.operatorAge = diagnosticAge(diag.ageMs[DIAG_OPERATOR]);
+    if (!wifiConnectReported && wifiConnectMs > 0) {
+        reading.wifiConnectMs = wifiConnectMs;
+        strncpy(reading.wifiConnect, wifiConnectPath, sizeof(reading.wifiConnect) - 1);
+        wifiConnectReported = true;
+    }
+    if (WiFi.status() == WL_CONNECTED) {
+        IPAddress ip = WiFi.localIP();
+        snprintf(reading.localIP, sizeof(reading.localIP), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
     }
+}
 
-    SerialAT.print(payload);
-    delay(1000);
+// POST a JSON payload via cellular HTTP
+bool sendViaCellular(const char* payload, size_t payloadLen) {
+    ModemLock lock;
 
-    // Execute POST
-    modem.sendAT("+HTTPACTION=1");  // 1 = POST
-    if (modem.waitResponse(30000L, "+HTTPACTION:") != 1) {
-        Serial.println("HTTP POST timeout");
-        modem.sendAT("+HTTPTERM");
-        modem.waitResponse();
-        return false;
+    if (!modemInitialized) {
+        Serial.println("Modem not initialized");
+        if (!initModem()) return false;
     }
 
-    String response = SerialAT.readStringUntil('\n');
-    Serial.print("HTTP response: ");
-    Serial.println(response);
-
-    // Parse response: +HTTPACTION: method,status,length
-    int status = 0;
-    int firstComma = response.indexOf(',');
-    int secondComma = response.indexOf(',', firstComma + 1);
-    if (firstComma > 0 && secondComma > firstComma) {
-        status = response.substring(firstComma + 1, secondComma).toInt();
+    NmeaPause pause;
+    if (!modem.isGprsConnected()) {
+        cellularDataConnected = false;
+        Serial.println("GPRS not connected, reconnecting...");
+        if (!connectCellular()) return false;
     }
 
-    modem.sendAT("+HTTPTERM");
-    modem.waitResponse();
+    Serial.println("Sending via cellular HTTPS...");
+    playSound(beepCellular);
+    Serial.println(payload);
+
+    int status = cellular.post(SF_ENDPOINT, payload, payloadLen);
 
     if (status == 200 || status == 201) {
         Serial.println("Cellular POST success!");
         return true;
     }
 
-    Serial.print("Cellular POST failed with status: ");
-    Serial.println(status);
+    Serial.printf("Cellular POST failed with status: %d\n", status);
     return false;
 }
 
-// WiFi credential storage functions
-void saveWifiCredential(const String& ssid, const String& password) {
-    preferences.begin("wifi", false);
+// CredentialStore's record as a single NVS blob
+class NvsBlob : public BlobStorage {
+public:
+    NvsBlob(const char* space, const char* key) : _space(space), _key(key) {}
 
-    // Find empty slot or existing entry
-    for (int i = 0; i < MAX_SAVED_NETWORKS; i++) {
-        String key = "ssid" + String(i);
-        String existingSSID = preferences.getString(key.c_str(), "");
-
-        if (existingSSID == "" || existingSSID == ssid) {
-            preferences.putString(key.c_str(), ssid);
-            preferences.putString(("pass" + String(i)).c_str(), password);
-            Serial.print("Saved WiFi credentials for: ");
-            Serial.println(ssid);
-            preferences.end();
-            return;
-        }
+    size_t load(void* data, size_t size) override {
+        Preferences prefs;
+        if (!prefs.begin(_space, true)) return 0;
+        size_t length = prefs.getBytesLength(_key);
+        if (length == 0 || length > size || prefs.getBytes(_key, data, length) != length) length = 0;
+        prefs.end();
+        return length;
     }
 
-    // No empty slot, overwrite oldest (slot 0) and shift others
-    for (int i = 0; i < MAX_SAVED_NETWORKS - 1; i++) {
-        String nextSSID = preferences.getString(("ssid" + String(i + 1)).c_str(), "");
-        String nextPass = preferences.getString(("pass" + String(i + 1)).c_str(), "");
-        preferences.putString(("ssid" + String(i)).c_str(), nextSSID);
-        preferences.putString(("pass" + String(i)).c_str(), nextPass);
+    bool save(const void* data, size_t length) override {
+        Preferences prefs;
+        if (!prefs.begin(_space, false)) return false;
+        bool ok = prefs.putBytes(_key, data, length) == length;
+        prefs.end();
+        return ok;
     }
-    preferences.putString(("ssid" + String(MAX_SAVED_NETWORKS - 1)).c_str(), ssid);
-    preferences.putString(("pass" + String(MAX_SAVED_NETWORKS - 1)).c_str(), password);
-    Serial.print("Saved WiFi credentials (shifted): ");
-    Serial.println(ssid);
 
-    preferences.end();
-}
+private:
+    const char* _space;
+    const char* _key;
+};
+
+// Saved WiFi networks, loaded once at boot
+NvsBlob credentialBlob("wifi", "creds");
+CredentialStore wifiCredentials(credentialBlob);
+
+// Connect and post history per access point; decides the order
+// connectWiFi() tries a scan in. Outcomes are kept in RAM and written at
+// most every WIFI_SCORE_SAVE_INTERVAL_MS (and after each connect).
+#ifndef WIFI_SCORE_SAVE_INTERVAL_MS
+#define WIFI_SCORE_SAVE_INTERVAL_MS 600000
+#endif
+NvsBlob scoreBlob("wifi", "scores");
+NetworkScorer wifiScorer(scoreBlob);
+
+// wifiScorer and the transport health below are updated by the network
+// and hedge tasks and printed by the loop's stats task. Held only around
+// the calls themselves, never across a connect or upload.
+SemaphoreHandle_t healthMutex = NULL;
+
+class HealthLock {
+public:
+    HealthLock() { xSemaphoreTake(healthMutex, portMAX_DELAY); }
+    ~HealthLock() { xSemaphoreGive(healthMutex); }
+};
 
-String getSavedPassword(const String& ssid) {
-    preferences.begin("wifi", true);
+void flushWifiScores() {
+    HealthLock lock;
+    wifiScorer.flush();
+}
 
-    for (int i = 0; i < MAX_SAVED_NETWORKS; i++) {
-        String savedSSID = preferences.getString(("ssid" + String(i)).c_str(), "");
-        if (savedSSID == ssid) {
-            String password = preferences.getString(("pass" + String(i)).c_str(), "");
-            preferences.end();
-            return password;
+#define LEGACY_SAVED_NETWORKS 5  // "ssid0".."ssid4" / "pass0".."pass4"
+
+// Load the credential record, converting the per-slot keys older
+// firmware wrote on first boot
+void initCredentials() {
+    if (wifiCredentials.begin()) return;
+
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    int migrated = 0;
+    for (int i = 0; i < LEGACY_SAVED_NETWORKS; i++) {
+        char ssidKey[8], passKey[8];
+        snprintf(ssidKey, sizeof(ssidKey), "ssid%d", i);
+        snprintf(passKey, sizeof(passKey), "pass%d", i);
+        if (prefs.isKey(ssidKey)) {
+            String ssid = prefs.getString(ssidKey, "");
+            String password = prefs.getString(passKey, "");
+            if (ssid.length() > 0 && wifiCredentials.save(ssid.c_str(), password.c_str())) migrated++;
+            prefs.remove(ssidKey);
+            prefs.remove(passKey);
         }
     }
+    prefs.end();
 
-    preferences.end();
-    return "";
+    if (migrated > 0) {
+        Serial.print("Migrated ");
+        Serial.print(migrated);
+        Serial.println(" saved networks");
+    }
 }
 
-void listSavedNetworks() {
-    preferences.begin("wifi", true);
-    Serial.println("Saved networks:");
-    for (int i = 0; i < MAX_SAVED_NETWORKS; i++) {
-        String ssid = preferences.getString(("ssid" + String(i)).c_str(), "");
-        if (ssid != "") {
-            Serial.print("  ");
-            Serial.println(ssid);
-        }
+void saveWifiCredential(const char* ssid, const char* password) {
+    if (wifiCredentials.save(ssid, password)) {
+        Serial.print("Saved WiFi credentials for: ");
+    } else {
+        Serial.print("Could not save WiFi credentials for: ");
     }
-    preferences.end();
+    Serial.println(ssid);
 }
 
-void forgetWifiNetwork(const String& ssid) {
-    preferences.begin("wifi", false);
-
-    int foundIndex = -1;
-    for (int i = 0; i < MAX_SAVED_NETWORKS; i++) {
-        String savedSSID = preferences.getString(("ssid" + String(i)).c_str(), "");
-        if (savedSSID == ssid) {
-            foundIndex = i;
-            break;
-        }
+void listSavedNetworks() {
+    Serial.println("Saved networks:");
+    for (uint8_t i = 0; i < wifiCredentials.count(); i++) {
+        Serial.print("  ");
+        Serial.println(wifiCredentials.ssid(i));
     }
+}
 
-    if (foundIndex == -1) {
+void forgetWifiNetwork(const char* ssid) {
+    if (!wifiCredentials.forget(ssid)) {
         Serial.print("Network not found: ");
         Serial.println(ssid);
-        preferences.end();
         return;
     }
-
-    // Shift remaining networks down to fill the gap
-    for (int i = foundIndex; i < MAX_SAVED_NETWORKS - 1; i++) {
-        String nextSSID = preferences.getString(("ssid" + String(i + 1)).c_str(), "");
-        String nextPass = preferences.getString(("pass" + String(i + 1)).c_str(), "");
-        preferences.putString(("ssid" + String(i)).c_str(), nextSSID);
-        preferences.putString(("pass" + String(i)).c_str(), nextPass);
-    }
-
-    // Clear the last slot
-    preferences.putString(("ssid" + String(MAX_SAVED_NETWORKS - 1)).c_str(), "");
-    preferences.putString(("pass" + String(MAX_SAVED_NETWORKS - 1)).c_str(), "");
-
     Serial.print("Forgot network: ");
     Serial.println(ssid);
-    preferences.end();
 }
 
 void performWifiScanForPhone() {
@@ -868,9 +1609,8 @@ void performWifiScanForPhone() {
         result += (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? "true" : "false";
 
         // Check if we have saved credentials for this network
-        String savedPass = getSavedPassword(ssid);
         result += ",\"saved\":";
-        result += (savedPass != "") ? "true" : "false";
+        result += wifiCredentials.contains(ssid.c_str()) ? "true" : "false";
         result += "}";
         count++;
     }
@@ -913,23 +1653,148 @@ const int TOUCH_THRESHOLD = 40;  // Values below this = touched
 
 // Soil moisture sensor on GPIO34 (ADC1)
 const int MOISTURE_PIN = 34;
-const int MOISTURE_DRY = 2800;   // ADC value when dry (in air)
-const int MOISTURE_WET = 1200;   // ADC value when wet (in water)
+const uint16_t MOISTURE_DRY_MV = 2380;  // Calibrated probe output when dry (in air)
+const uint16_t MOISTURE_WET_MV = 1100;  // ...and wet (in water)
 
 // Multi-tap timing (ms)
 const unsigned long TAP_WINDOW = 600;  // Time between taps (ms)
 const unsigned long DEBOUNCE_TIME = 50;
-
-WiFiClientSecure client;
+const unsigned long TOUCH_QUIET_MS = 200;  // The pad interrupts repeatedly while held
 
 String connectedSSID = "";
 
-bool tryConnect(const char* ssid, const char* password = NULL) {
+// Fast reconnect: the last network that worked (SSID, BSSID, channel,
+// IP settings) is kept in RTC memory, which survives resets and deep
+// sleep, and in NVS for power-on. connectWiFi() tries a directed
+// association to that access point on its channel before paying for a
+// full scan. -D WIFI_REUSE_IP=1 also skips DHCP by reusing the last
+// lease - only safe where the router reserves the address.
+#ifndef WIFI_FAST_CONNECT_MS
+#define WIFI_FAST_CONNECT_MS 3000
+#endif
+#ifndef WIFI_REUSE_IP
+#define WIFI_REUSE_IP 0
+#endif
+#define WIFI_CACHE_MAGIC 0x57464331  // "WFC1"
+
+struct WifiCache {
+    uint32_t magic;
+    char ssid[33];
+    char password[65];   // Empty = open network
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t checksum;   // FNV-1a of everything above
+};
+
+RTC_NOINIT_ATTR WifiCache rtcWifiCache;
+
+uint32_t wifiCacheChecksum(const WifiCache& cache) {
+    uint32_t hash = 2166136261u;
+    const uint8_t* bytes = (const uint8_t*)&cache;
+    for (size_t i = 0; i < offsetof(WifiCache, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool wifiCacheValid(const WifiCache& cache) {
+    return cache.magic == WIFI_CACHE_MAGIC && cache.channel >= 1 && cache.channel <= 14 &&
+           cache.checksum == wifiCacheChecksum(cache);
+}
+
+// RTC copy first (no flash read), NVS after a power cycle
+bool loadWifiCache(WifiCache& cache) {
+    if (wifiCacheValid(rtcWifiCache)) {
+        cache = rtcWifiCache;
+        return true;
+    }
+    Preferences cachePrefs;
+    cachePrefs.begin("wifi", true);
+    size_t length = cachePrefs.getBytes("last", &cache, sizeof(cache));
+    cachePrefs.end();
+    if (length != sizeof(cache) || !wifiCacheValid(cache)) return false;
+    rtcWifiCache = cache;
+    return true;
+}
+
+// Remember the network we're connected to now
+void saveWifiCache(const char* password) {
+    WifiCache cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.magic = WIFI_CACHE_MAGIC;
+    strncpy(cache.ssid, WiFi.SSID().c_str(), sizeof(cache.ssid) - 1);
+    strncpy(cache.password, password ? password : "", sizeof(cache.password) - 1);
+    uint8_t* bssid = WiFi.BSSID();
+    if (bssid) memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.channel = (uint8_t)WiFi.channel();
+    cache.ip = (uint32_t)WiFi.localIP();
+    cache.gateway = (uint32_t)WiFi.gatewayIP();
+    cache.subnet = (uint32_t)WiFi.subnetMask();
+    cache.dns = (uint32_t)WiFi.dnsIP();
+    cache.checksum = wifiCacheChecksum(cache);
+
+    // Flash only when something changed (roaming, new lease, new network)
+    bool changed = !wifiCacheValid(rtcWifiCache) || memcmp(&rtcWifiCache, &cache, sizeof(cache)) != 0;
+    rtcWifiCache = cache;
+    if (!changed) return;
+
+    Preferences cachePrefs;
+    cachePrefs.begin("wifi", false);
+    cachePrefs.putBytes("last", &cache, sizeof(cache));
+    cachePrefs.end();
+}
+
+// Drop the cached network if it's the one being forgotten
+void forgetWifiCache(const char* ssid) {
+    WifiCache cache;
+    if (!loadWifiCache(cache) || strcmp(cache.ssid, ssid) != 0) return;
+
+    rtcWifiCache.magic = 0;
+    Preferences cachePrefs;
+    cachePrefs.begin("wifi", false);
+    cachePrefs.remove("last");
+    cachePrefs.end();
+}
+
+// Directed association to the cached access point, no scan
+bool fastConnect(const WifiCache& cache) {
+    Serial.print("Fast connect: ");
+    Serial.print(cache.ssid);
+    Serial.print(" ch");
+    Serial.println(cache.channel);
+
+#if WIFI_REUSE_IP
+    if (cache.ip != 0) {
+        WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+    }
+#endif
+    WiFi.begin(cache.ssid, cache.password[0] ? cache.password : NULL, cache.channel, cache.bssid);
+
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < WIFI_FAST_CONNECT_MS) {
+        delay(50);
+    }
+    if (WiFi.status() == WL_CONNECTED) return true;
+
+    Serial.println("Fast connect failed - scanning");
+    WiFi.disconnect();
+#if WIFI_REUSE_IP
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // Back to DHCP
+#endif
+    return false;
+}
+
+// Directed to one access point when bssid is given
+bool tryConnect(const char* ssid, const char* password = NULL, int32_t channel = 0, const uint8_t* bssid = NULL) {
     Serial.print("Trying: ");
     Serial.println(ssid);
 
-    if (password) {
-        WiFi.begin(ssid, password);
+    if (password || bssid) {
+        WiFi.begin(ssid, password, channel, bssid);
     } else {
         WiFi.begin(ssid);
     }
@@ -948,116 +1813,289 @@ bool tryConnect(const char* ssid, const char* password = NULL) {
 void postConnectionStatus(const char* ssid, bool isOpen) {
     if (WiFi.status() != WL_CONNECTED) return;
 
-    HTTPClient http;
-    client.setInsecure();
-    http.begin(client, SF_ENDPOINT);
-    http.addHeader("Content-Type", "application/json");
+    char networks[48];
+    snprintf(networks, sizeof(networks), "%s%s", ssid, isOpen ? " (Open)" : " (Private)");
 
-    String payload = "{";
-    payload += "\"deviceId\":\"" + String(DEVICE_ID) + "\",";
-    payload += "\"function\":\"WiFi Connect\",";
-    payload += "\"networks\":\"" + String(ssid) + (isOpen ? " (Open)" : " (Private)") + "\",";
-    payload += "\"apiKey\":\"" + String(SF_API_KEY) + "\"";
-    payload += "}";
+    char payload[200];
+    JsonWriter json(payload, sizeof(payload));
+    json.beginObject();
+    json.field("deviceId", DEVICE_ID);
+    json.field("function", "WiFi Connect");
+    json.field("networks", networks);
+    json.field("apiKey", SF_API_KEY);
+    json.endObject();
 
     Serial.println("Posting connection status to Salesforce...");
-    int httpCode = http.POST(payload);
+    String response;
+    int httpCode = salesforce.request(SF_ENDPOINT, payload, json.length(), &response);
     if (httpCode > 0) {
         Serial.print("Posted: ");
-        Serial.println(http.getString());
+        Serial.println(response);
     }
-    http.end();
 }
 
-void connectWiFi() {
+// Record how long connectWiFi() took and how it got there
+void wifiConnected(unsigned long startMs, const char* path, const char* password) {
+    wifiConnectMs = millis() - startMs;
+    wifiConnectPath = path;
+    wifiConnectReported = false;
+    saveWifiCache(password);
+    Serial.printf("WiFi: connected in %lums (%s)\n", (unsigned long)wifiConnectMs, path);
+}
+
+// A visible access point we have a way into
+struct WifiCandidate {
+    char ssid[33];
+    const char* password;  // NULL = open
+    uint8_t bssid[6];
+    int32_t channel;
+};
+
+#define WIFI_SCAN_CANDIDATES 16  // Connectable access points considered per scan
+#define WIFI_CONNECT_ATTEMPTS 4  // Tried per scan, best score first
+
+// Caller bias for the scorer: networks the user saved over the built-in
+// default over whatever open network happens to be in range
+#define PREFERENCE_SAVED 100
+#define PREFERENCE_DEFAULT 50
+#define PREFERENCE_OPEN 0
+
+// Saved, default and open networks from the last scan
+uint8_t collectCandidates(int numNetworks, WifiCandidate* candidates, ScanEntry* entries) {
+    uint8_t count = 0;
+    for (int i = 0; i < numNetworks && count < WIFI_SCAN_CANDIDATES; i++) {
+        String ssid = WiFi.SSID(i);
+        if (ssid.length() == 0 || ssid.length() >= sizeof(candidates[0].ssid)) continue;
+
+        uint8_t preference;
+        const char* password = wifiCredentials.password(ssid.c_str());
+        if (password) {
+            preference = PREFERENCE_SAVED;
+            if (password[0] == '\0') password = NULL;
+        } else if (ssid == WIFI_SSID) {
+            preference = PREFERENCE_DEFAULT;
+            password = WIFI_PASSWORD;
+        } else if (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) {
+            preference = PREFERENCE_OPEN;
+        } else {
+            continue;
+        }
+
+        WifiCandidate& candidate = candidates[count];
+        strcpy(candidate.ssid, ssid.c_str());
+        candidate.password = password;
+        memcpy(candidate.bssid, WiFi.BSSID(i), sizeof(candidate.bssid));
+        candidate.channel = WiFi.channel(i);
+
+        entries[count].ssid = candidate.ssid;
+        entries[count].bssid = candidate.bssid;
+        entries[count].rssi = (int8_t)WiFi.RSSI(i);
+        entries[count].preference = preference;
+        count++;
+    }
+    return count;
+}
+
+void connectWiFi() {
+    unsigned long start = millis();
+    wifiConnectMs = 0;
+    wifiConnectPath = "";
+
     WiFi.mode(WIFI_STA);
     WiFi.disconnect();
     delay(100);
 
+    WifiCache cache;
+    if (loadWifiCache(cache)) {
+        bool connected = fastConnect(cache);
+        {
+            HealthLock lock;
+            wifiScorer.recordConnect(cache.ssid, cache.bssid, connected, millis() - start);
+        }
+        if (connected) {
+            connectedSSID = cache.ssid;
+            Serial.print("IP Address: ");
+            Serial.println(WiFi.localIP());
+            wifiConnected(start, "fast", cache.password);
+            flushWifiScores();
+            playSound(beepWifiConnect);
+            updateWifiStatus();
+            return;
+        }
+    }
+
     Serial.println("\n--- Scanning for networks ---");
     listSavedNetworks();
 
     int numNetworks = WiFi.scanNetworks();
-
-    // Priority 1: Try saved networks that are visible
-    Serial.println("Checking for saved networks...");
-    preferences.begin("wifi", true);
-    for (int i = 0; i < MAX_SAVED_NETWORKS; i++) {
-        String savedSSID = preferences.getString(("ssid" + String(i)).c_str(), "");
-        if (savedSSID == "") continue;
-
-        // Check if this saved network is visible
-        for (int j = 0; j < numNetworks; j++) {
-            if (WiFi.SSID(j) == savedSSID) {
-                String savedPass = preferences.getString(("pass" + String(i)).c_str(), "");
-                preferences.end();
-
-                Serial.print("Found saved network: ");
-                Serial.println(savedSSID);
-
-                if (tryConnect(savedSSID.c_str(), savedPass.length() > 0 ? savedPass.c_str() : NULL)) {
-                    connectedSSID = savedSSID;
-                    Serial.println("Connected to saved network!");
-                    Serial.print("IP Address: ");
-                    Serial.println(WiFi.localIP());
-                    WiFi.scanDelete();
-                    beepWifiConnect();
-                    updateWifiStatus();
-                    return;
-                }
-                preferences.begin("wifi", true);
-                break;
-            }
+    WifiCandidate candidates[WIFI_SCAN_CANDIDATES];
+    ScanEntry entries[WIFI_SCAN_CANDIDATES];
+    uint8_t order[WIFI_SCAN_CANDIDATES];
+    uint8_t count = collectCandidates(numNetworks, candidates, entries);
+    WiFi.scanDelete();
+    uint16_t scores[WIFI_SCAN_CANDIDATES];
+    {
+        HealthLock lock;
+        wifiScorer.rank(entries, count, order);
+        for (uint8_t i = 0; i < count; i++) scores[i] = wifiScorer.score(entries[i]);
+    }
+
+    // Best scoring access points first: signal now, and how connecting
+    // and posting through each has gone before
+    bool triedDefault = false;
+    for (uint8_t i = 0; i < count && i < WIFI_CONNECT_ATTEMPTS; i++) {
+        const WifiCandidate& candidate = candidates[order[i]];
+        Serial.printf("Candidate: %s (%d dBm, score %u)\n", candidate.ssid, entries[order[i]].rssi,
+                      (unsigned)scores[order[i]]);
+        if (strcmp(candidate.ssid, WIFI_SSID) == 0) triedDefault = true;
+
+        unsigned long attemptStart = millis();
+        bool connected = tryConnect(candidate.ssid, candidate.password, candidate.channel, candidate.bssid);
+        {
+            HealthLock lock;
+            wifiScorer.recordConnect(candidate.ssid, candidate.bssid, connected, millis() - attemptStart);
         }
-    }
-    preferences.end();
-
-    // Priority 2: Try open networks
-    Serial.println("Checking for open networks...");
-    for (int i = 0; i < numNetworks; i++) {
-        if (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) {
-            String ssid = WiFi.SSID(i);
-            Serial.print("Found open network: ");
-            Serial.print(ssid);
-            Serial.print(" (");
-            Serial.print(WiFi.RSSI(i));
-            Serial.println(" dBm)");
-
-            if (tryConnect(ssid.c_str(), NULL)) {
-                connectedSSID = ssid;
-                Serial.println("Connected to open network!");
-                Serial.print("IP Address: ");
-                Serial.println(WiFi.localIP());
-                WiFi.scanDelete();
-                beepWifiConnect();
-                updateWifiStatus();
-                return;
-            }
+        if (connected) {
+            connectedSSID = candidate.ssid;
+            Serial.println("Connected!");
+            Serial.print("IP Address: ");
+            Serial.println(WiFi.localIP());
+            wifiConnected(start, "scan", candidate.password);
+            flushWifiScores();
+            playSound(beepWifiConnect);
+            updateWifiStatus();
+            return;
         }
+        WiFi.disconnect();
     }
+    flushWifiScores();
 
-    WiFi.scanDelete();
-
-    // Priority 3: Fall back to hardcoded credentials
+    // Last resort: the hardcoded network, undirected in case it's hidden
+    if (triedDefault) {
+        Serial.println("WiFi Connection FAILED");
+        playSound(beepFail);
+        updateWifiStatus();
+        return;
+    }
     Serial.println("No saved/open networks available, using default WiFi...");
     if (tryConnect(WIFI_SSID, WIFI_PASSWORD)) {
         connectedSSID = WIFI_SSID;
         Serial.println("WiFi Connected!");
         Serial.print("IP Address: ");
         Serial.println(WiFi.localIP());
-        beepWifiConnect();
+        wifiConnected(start, "scan", WIFI_PASSWORD);
+        playSound(beepWifiConnect);
     } else {
         Serial.println("WiFi Connection FAILED");
-        beepFail();
+        playSound(beepFail);
     }
     updateWifiStatus();
 }
 
-// BLE characteristic for sending data to phone for Salesforce posting
+// WiFi supervision. The WiFi event task only records the latest link
+// event; the network task hands it to the supervisor and runs the
+// connect attempts it asks for, backing off while no network is in
+// range instead of scanning back to back.
+#ifndef WIFI_RETRY_BASE_MS
+#define WIFI_RETRY_BASE_MS 2000
+#endif
+#ifndef WIFI_RETRY_MAX_MS
+#define WIFI_RETRY_MAX_MS 300000
+#endif
+#ifndef WIFI_RECONNECT_BUDGET
+#define WIFI_RECONNECT_BUDGET 8      // Failed attempts in a row before resting
+#endif
+#ifndef WIFI_REST_MS
+#define WIFI_REST_MS 1800000
+#endif
+
+enum WifiLinkEvent : uint8_t {
+    WIFI_EVENT_NONE,
+    WIFI_EVENT_UP,
+    WIFI_EVENT_DOWN,
+};
+
+const WifiSupervisorConfig WIFI_SUPERVISOR_CONFIG = {
+    WIFI_RETRY_BASE_MS, WIFI_RETRY_MAX_MS, WIFI_RECONNECT_BUDGET, WIFI_REST_MS,
+};
+// Seeded in setup(): esp_random() only has entropy once the radio is on
+WifiSupervisor wifiSupervisor(WIFI_SUPERVISOR_CONFIG, 0);
+
+portMUX_TYPE wifiEventMux = portMUX_INITIALIZER_UNLOCKED;
+WifiLinkEvent wifiLinkEvent = WIFI_EVENT_NONE;  // Latest wins, guarded by wifiEventMux
+
+// Runs on the WiFi event task
+void onWifiEvent(WiFiEvent_t event) {
+    WifiLinkEvent link = WIFI_EVENT_NONE;
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) link = WIFI_EVENT_UP;
+    if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event == ARDUINO_EVENT_WIFI_STA_LOST_IP) {
+        link = WIFI_EVENT_DOWN;
+    }
+    if (link == WIFI_EVENT_NONE) return;
+
+    portENTER_CRITICAL(&wifiEventMux);
+    wifiLinkEvent = link;
+    portEXIT_CRITICAL(&wifiEventMux);
+}
+
+WifiLinkEvent takeWifiEvent() {
+    portENTER_CRITICAL(&wifiEventMux);
+    WifiLinkEvent event = wifiLinkEvent;
+    wifiLinkEvent = WIFI_EVENT_NONE;
+    portEXIT_CRITICAL(&wifiEventMux);
+    return event;
+}
+
+// BLE characteristic for sending data to phone for Salesforce posting.
+// The phone writes back "OK:<idempotencyKey>" once Salesforce stored the
+// reading, or "ERR:<idempotencyKey>" when its post failed.
 BLECharacteristic* pSalesforceChar = NULL;
 #define SALESFORCE_CHAR_UUID "e5c2f8a6-1b3d-4e5f-9a7c-8d6b5e4f3a21"
+#define BLE_ACK_TIMEOUT_MS 10000  // Phone's whole post, same budget as a direct HTTP timeout
+#define BLE_ACK_POLL_MS 250       // Re-check the connection this often while waiting
+
+portMUX_TYPE bleAckMux = portMUX_INITIALIZER_UNLOCKED;
+char bleAck[48] = "";                  // Latest write-back, guarded by bleAckMux
+SemaphoreHandle_t bleAckReady = NULL;  // Given on every write-back
+
+class SalesforceAckCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic *pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        portENTER_CRITICAL(&bleAckMux);
+        strncpy(bleAck, value.c_str(), sizeof(bleAck) - 1);
+        bleAck[sizeof(bleAck) - 1] = '\0';
+        portEXIT_CRITICAL(&bleAckMux);
+        xSemaphoreGive(bleAckReady);
+    }
+};
+
+// Notify the phone and wait for its answer about this reading. Only an
+// "OK" for the same idempotency key counts as delivered; an error, a
+// disconnect or no answer within BLE_ACK_TIMEOUT_MS is a failure.
+bool relayViaPhone(const char* payload, const char* key) {
+    xSemaphoreTake(bleAckReady, 0);  // Drop an answer nobody waited for
+    pSalesforceChar->setValue(payload);
+    pSalesforceChar->notify();
+
+    unsigned long start = millis();
+    while (deviceConnected && millis() - start < BLE_ACK_TIMEOUT_MS) {
+        if (xSemaphoreTake(bleAckReady, pdMS_TO_TICKS(BLE_ACK_POLL_MS)) != pdTRUE) continue;
+        char ack[sizeof(bleAck)];
+        portENTER_CRITICAL(&bleAckMux);
+        memcpy(ack, bleAck, sizeof(ack));
+        portEXIT_CRITICAL(&bleAckMux);
+
+        const char* colon = strchr(ack, ':');
+        if (colon == NULL || strcmp(colon + 1, key) != 0) continue;  // A late answer for an earlier reading
+        if (strncmp(ack, "OK:", 3) == 0) return true;
+        Serial.println("BLE: phone reported a failed post");
+        return false;
+    }
+    Serial.println(deviceConnected ? "BLE: no answer from phone" : "BLE: phone disconnected");
+    return false;
+}
 
-bool sendDirectToSalesforce(float temperature, float humidity, const char* function) {
+bool sendDirectToSalesforce(const char* payload, size_t payloadLen) {
     // Direct WiFi HTTP - only called when BLE is disabled
     if (WiFi.status() != WL_CONNECTED) {
         Serial.println("WiFi not connected");
@@ -1066,123 +2104,764 @@ bool sendDirectToSalesforce(float temperature, float humidity, const char* funct
 
     Serial.println("Sending direct to Salesforce via WiFi...");
 
-    // Update all modem diagnostics if available
-    if (modemInitialized) {
-        updateModemDiagnostics();
+    Serial.println(payload);
+    int httpCode = salesforce.request(SF_ENDPOINT, payload, payloadLen);
+    bool success = (httpCode == 200 || httpCode == 201);
+    {
+        HealthLock lock;
+        wifiScorer.recordPost(WiFi.SSID().c_str(), WiFi.BSSID(), success);
     }
 
-    client.setInsecure();
-    HTTPClient http;
-    http.setTimeout(10000);
-    http.begin(client, SF_ENDPOINT);
-    http.addHeader("Content-Type", "application/json");
+    if (success) {
+        Serial.println("WiFi POST success!");
+    } else {
+        Serial.printf("WiFi POST failed: %d\n", httpCode);
+    }
+    return success;
+}
 
-    String payload = "{";
-    payload += "\"temperature\":" + String(temperature, 1) + ",";
-    payload += "\"humidity\":" + String(humidity, 1) + ",";
-    payload += "\"deviceId\":\"" + String(DEVICE_ID) + "\",";
-    payload += "\"function\":\"" + String(function) + "\",";
-    payload += "\"connectionType\":\"WiFi\",";
-    payload += "\"localIP\":\"" + WiFi.localIP().toString() + "\",";
-    if (gpsValid) {
-        payload += "\"latitude\":" + String(gpsLatitude, 6) + ",";
-        payload += "\"longitude\":" + String(gpsLongitude, 6) + ",";
-        payload += "\"gpsAltitude\":" + String(gpsAltitude, 2) + ",";
-        payload += "\"gpsSpeed\":" + String(gpsSpeed, 2) + ",";
-        payload += "\"gpsSatellites\":" + String(gpsSatellites) + ",";
+// Store-and-forward backlog on the "readings" flash partition
+class PartitionFlash : public FlashDevice {
+public:
+    bool begin() {
+        _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                              (esp_partition_subtype_t)READINGS_PARTITION_SUBTYPE,
+                                              "readings");
+        return _partition != NULL;
     }
-    if (batteryVoltage > 0) {
-        payload += "\"batteryVoltage\":" + String(batteryVoltage) + ",";
+    uint32_t size() const { return _partition ? _partition->size : 0; }
+    bool read(uint32_t offset, void* data, size_t length) {
+        return esp_partition_read(_partition, offset, data, length) == ESP_OK;
     }
-    if (signalQuality != 99) {
-        payload += "\"signalQuality\":" + String(signalQuality) + ",";
+    bool write(uint32_t offset, const void* data, size_t length) {
+        return esp_partition_write(_partition, offset, data, length) == ESP_OK;
     }
-    if (networkOperator.length() > 0) {
-        payload += "\"networkOperator\":\"" + networkOperator + "\",";
+    bool eraseSector(uint32_t offset) {
+        return esp_partition_erase_range(_partition, offset, sectorSize()) == ESP_OK;
     }
-    payload += "\"apiKey\":\"" + String(SF_API_KEY) + "\"";
-    payload += "}";
 
-    Serial.println(payload);
-    int httpCode = http.POST(payload);
-    bool success = (httpCode == 200 || httpCode == 201);
+private:
+    const esp_partition_t* _partition = NULL;
+};
 
-    if (success) {
-        Serial.println("WiFi POST success!");
+// Record as stored in the log. Boot count and uptime let a reading queued
+// before the clock was set still report its age if sent in the same boot
+// (duty cycle wakes count as the same boot).
+struct QueuedReading {
+    uint32_t bootCount;
+    uint32_t uptimeMs;
+    SensorReading reading;
+};
+
+PartitionFlash readingFlash;
+ReadingLog readingLog(readingFlash);
+uint32_t bootCount = 0;
+
+bool clockValid() {
+    return time(NULL) > 1600000000;  // Set by SNTP
+}
+
+void initBacklog() {
+    if (!dutyCycleResumed) {
+        preferences.begin("device", false);
+        bootCount = preferences.getUInt("boots", 0) + 1;
+        preferences.putUInt("boots", bootCount);
+        preferences.end();
+    }
+
+    if (!readingFlash.begin() || !readingLog.mount()) {
+        Serial.println("Backlog: no readings partition - offline readings will be lost");
+        return;
+    }
+    Serial.print("Backlog: ");
+    Serial.print(readingLog.pending());
+    Serial.println(" queued readings");
+}
+
+void enqueueReading(const SensorReading& reading) {
+    if (!readingLog.mounted()) return;
+
+    QueuedReading queued;
+    queued.bootCount = bootCount;
+    queued.uptimeMs = uptimeMs();
+    queued.reading = reading;
+    if (clockValid()) {
+        queued.reading.capturedAt = (uint32_t)time(NULL);
+    }
+
+    if (readingLog.append(&queued, sizeof(queued))) {
+        Serial.print("Backlog: queued reading (");
+        Serial.print(readingLog.pending());
+        Serial.println(" pending)");
     } else {
-        Serial.print("WiFi POST failed: ");
-        Serial.println(httpCode);
+        Serial.println("Backlog: flash write failed");
     }
+}
 
-    http.end();
-    return success;
+// Rolling health per upload path, seeded with typical delivered/failed
+// times. BLE relay is timed from the notify to the phone's write-back,
+// so it covers the phone's own post.
+TransportHealth bleHealth(1500, BLE_ACK_TIMEOUT_MS);
+TransportHealth wifiHealth(1500, 10000);      // Failures wait out the HTTP timeout
+TransportHealth cellularHealth(6000, 30000);  // TLS over the modem, plus GPRS attach
+
+// Upload paths that take a JSON body. BLE relay is separate: the phone
+// adds its own connection type and API key.
+struct Transport {
+    const char* name;  // Sent as connectionType
+    bool (*post)(const char* payload, size_t length);
+    TransportHealth* health;
+};
+
+const Transport WIFI_TRANSPORT = {"WiFi", sendDirectToSalesforce, &wifiHealth};
+const Transport CELLULAR_TRANSPORT = {"Cellular", sendViaCellular, &cellularHealth};
+
+// One reading keeps the original single-object body; more are framed as
+// a batch that SensorDataAPI bulk-inserts
+bool uploadReadings(const Transport& transport, const SensorReading* readings, int count,
+                    char* payload, size_t size) {
+    SerializeOptions options = {DEVICE_ID, transport.name, SF_API_KEY};
+    size_t length = (count == 1)
+        ? serializeReading(readings[0], options, payload, size)
+        : serializeBatch(readings, count, options, payload, size);
+    if (length == 0) {
+        Serial.println("Payload too large");
+        return false;
+    }
+
+    bool allowed;
+    {
+        HealthLock lock;
+        allowed = transport.health->allow(millis());
+    }
+    if (!allowed) {
+        Serial.printf("%s: circuit open, skipped\n", transport.name);
+        return false;
+    }
+    unsigned long start = millis();
+    bool ok = transport.post(payload, length);
+    HealthLock lock;
+    transport.health->record(ok, millis() - start, millis());
+    return ok;
 }
 
-void sendSensorData(float temperature, float humidity, const char* function) {
-    // Priority 1: Phone (BLE relay)
-    if (bleEnabled && deviceConnected && pSalesforceChar) {
-        // Get all diagnostics for phone to include in POST
-        if (modemInitialized) {
-            updateModemDiagnostics();
-        }
+// Network task uploads share one buffer
+bool uploadReadings(const Transport& transport, const SensorReading* readings, int count) {
+    static char payload[UPLOAD_BATCH_LIMIT * READING_PAYLOAD_SIZE];
+    return uploadReadings(transport, readings, count, payload, sizeof(payload));
+}
 
-        String payload = "{";
-        payload += "\"temperature\":" + String(temperature, 1) + ",";
-        payload += "\"humidity\":" + String(humidity, 1) + ",";
-        payload += "\"deviceId\":\"" + String(DEVICE_ID) + "\",";
-        payload += "\"function\":\"" + String(function) + "\"";
-        if (WiFi.status() == WL_CONNECTED) {
-            payload += ",\"localIP\":\"" + WiFi.localIP().toString() + "\"";
+// Send queued readings oldest first over the transport that just worked.
+// Stops at the first failure so order is preserved for the next attempt.
+void replayBacklog(const Transport& transport) {
+    static SensorReading batch[BACKLOG_BATCH_SIZE];
+    int sent = 0;
+
+    for (int upload = 0; upload < BACKLOG_REPLAY_MAX && readingLog.pending() > 0; upload++) {
+        int count = 0;
+        QueuedReading queued;
+        int length = readingLog.peek(&queued, sizeof(queued));
+        while (length != 0 && count < BACKLOG_BATCH_SIZE) {
+            if (length != (int)sizeof(queued)) {
+                // Written by a firmware with a different record layout
+                if (count > 0) break;
+                Serial.println("Backlog: discarding incompatible record");
+                readingLog.pop();
+                length = readingLog.peek(&queued, sizeof(queued));
+                continue;
+            }
+            if (queued.reading.capturedAt == 0 && queued.bootCount == bootCount) {
+                queued.reading.ageSeconds = (uptimeMs() - queued.uptimeMs) / 1000;
+            }
+            batch[count++] = queued.reading;
+            length = readingLog.peekNext(&queued, sizeof(queued));
         }
-        if (gpsValid) {
-            payload += ",\"latitude\":" + String(gpsLatitude, 6);
-            payload += ",\"longitude\":" + String(gpsLongitude, 6);
-            payload += ",\"gpsAltitude\":" + String(gpsAltitude, 2);
-            payload += ",\"gpsSpeed\":" + String(gpsSpeed, 2);
-            payload += ",\"gpsSatellites\":" + String(gpsSatellites);
+        if (count == 0) break;
+
+        Serial.print("Backlog: replaying ");
+        Serial.print(count);
+        Serial.println(" readings");
+        if (!uploadReadings(transport, batch, count)) break;
+        for (int i = 0; i < count; i++) readingLog.pop();
+        sent += count;
+    }
+
+    if (sent > 0) {
+        Serial.print("Backlog: sent ");
+        Serial.print(sent);
+        Serial.print(", ");
+        Serial.print(readingLog.pending());
+        Serial.println(" remaining");
+    }
+}
+
+// Cellular link quality from the cached CSQ
+uint8_t cellularQuality() {
+    DiagnosticsSnapshot diag;
+    readDiagnostics(diag);
+    return csqQuality(diag.values.signalQuality);
+}
+
+// Transports in order of expected delivery time, skipping open breakers.
+// On success the backlog follows on the same transport; if all fail the
+// readings are queued in flash.
+bool uploadWithFallback(const SensorReading* readings, int count) {
+    const Transport* transports[] = {&WIFI_TRANSPORT, &CELLULAR_TRANSPORT};
+    const TransportHealth* health[] = {&wifiHealth, &cellularHealth};
+    uint8_t quality[] = {(uint8_t)(WiFi.status() == WL_CONNECTED ? 100 : 0), cellularQuality()};
+    uint8_t order[2];
+    uint32_t expectedMs[2];
+    TransportHealth::State states[2];
+    uint8_t ranked;
+    {
+        HealthLock lock;
+        ranked = rankTransports(health, quality, 2, millis(), order);
+        for (uint8_t i = 0; i < 2; i++) {
+            expectedMs[i] = health[i]->expectedCostMs(quality[i]);
+            states[i] = health[i]->state();
         }
-        if (batteryVoltage > 0) {
-            payload += ",\"batteryVoltage\":" + String(batteryVoltage);
+    }
+
+    for (uint8_t i = 0; i < ranked; i++) {
+        const Transport& transport = *transports[order[i]];
+        Serial.printf("Trying %s (expected %lums, %s)...\n", transport.name, (unsigned long)expectedMs[order[i]],
+                      breakerStateName(states[order[i]]));
+        if (uploadReadings(transport, readings, count)) {
+            replayBacklog(transport);
+            return true;
         }
-        if (signalQuality != 99) {
-            payload += ",\"signalQuality\":" + String(signalQuality);
+        Serial.printf("%s failed\n", transport.name);
+    }
+
+    Serial.println("All connection methods failed!");
+    for (int i = 0; i < count; i++) enqueueReading(readings[i]);
+    return false;
+}
+
+// ============================================================
+// Network task - all HTTP and AT traffic runs here, on core 0, so
+// sampling, taps and BLE on the loop task never wait for the network
+// ============================================================
+#define NET_TASK_CORE 0
+#define NET_TASK_STACK 16384     // TLS handshakes and httpUpdate need headroom
+#define NET_TASK_PRIORITY 1
+#define NET_QUEUE_LENGTH 8       // Readings/commands waiting for the network task
+#define NET_EVENT_QUEUE_LENGTH 8 // Sounds waiting for the loop task
+#define NET_IDLE_POLL_MS 1000    // WiFi supervision and batch flush interval
+
+enum NetJobType : uint8_t {
+    NET_JOB_READING,
+    NET_JOB_FIRMWARE_CHECK,
+    NET_JOB_WIFI_SCAN,
+    NET_JOB_WIFI_CONNECT,
+    NET_JOB_WIFI_FORGET,
+    NET_JOB_SLEEP,  // Duty cycle: deep sleep, never returns
+};
+
+struct NetJob {
+    NetJobType type;
+    unsigned long queuedAt;  // millis() when the loop task queued it
+    union {
+        struct {
+            float temperature;
+            float humidity;
+            char function[16];
+        } reading;
+        struct {
+            char ssid[33];
+            char password[65];
+        } wifi;
+    };
+};
+
+// Network task telemetry (printed with the scheduler stats)
+struct NetTelemetry {
+    uint32_t queued;         // Jobs accepted by the queue
+    uint32_t dropped;        // Jobs rejected because the queue was full
+    uint32_t sent;           // Readings delivered
+    uint32_t failed;         // Readings that went to the flash backlog
+    uint32_t maxDepth;       // Deepest the job queue has been
+    uint32_t lastLatencyMs;  // Queued-to-sent time of the last delivered reading
+    uint32_t maxLatencyMs;
+    uint64_t totalLatencyMs;
+    uint32_t hedged;         // Readings also sent on a second transport
+    uint32_t hedgeWins;      // ...where only the second transport delivered
+};
+
+QueueHandle_t netQueue = NULL;
+NetTelemetry netTelemetry = {};
+volatile bool netJobRunning = false;  // Network task is inside runNetJob()
+volatile bool sleepQueued = false;    // Duty cycle: NET_JOB_SLEEP on its way
+
+void recordDelivery(unsigned long queuedAt, bool ok) {
+    if (!ok) {
+        netTelemetry.failed++;
+        return;
+    }
+    uint32_t latency = millis() - queuedAt;
+    netTelemetry.sent++;
+    netTelemetry.lastLatencyMs = latency;
+    netTelemetry.totalLatencyMs += latency;
+    if (latency > netTelemetry.maxLatencyMs) netTelemetry.maxLatencyMs = latency;
+}
+
+// Live readings waiting for a batch upload (network task only)
+SensorReading liveBatch[BATCH_MAX_READINGS];
+unsigned long liveBatchQueuedAt[BATCH_MAX_READINGS];
+int liveBatchCount = 0;
+unsigned long liveBatchStarted = 0;
+
+void flushBatch() {
+    if (liveBatchCount == 0) return;
+
+    Serial.print("Batch: uploading ");
+    Serial.print(liveBatchCount);
+    Serial.println(" readings");
+    bool ok = uploadWithFallback(liveBatch, liveBatchCount);
+    for (int i = 0; i < liveBatchCount; i++) {
+        recordDelivery(liveBatchQueuedAt[i], ok);
+    }
+    playSound(ok ? beepSuccess : beepFail);
+    liveBatchCount = 0;
+}
+
+// Does the relay beat direct WiFi and cellular for this reading?
+bool bleRelayPreferred() {
+    const TransportHealth* health[] = {&bleHealth, &wifiHealth, &cellularHealth};
+    uint8_t quality[] = {100, (uint8_t)(WiFi.status() == WL_CONNECTED ? 100 : 0), cellularQuality()};
+    uint8_t order[3];
+    HealthLock lock;
+    return rankTransports(health, quality, 3, millis(), order) > 0 && order[0] == 0;
+}
+
+// Hedged uploads: a tap or touch reading that hasn't been delivered
+// within its transport's p95 latency is also sent on the next best
+// transport, from the network task while a worker keeps waiting on the
+// first. The idempotency key lets the server drop whichever copy lands
+// second. -D HEDGE_INTERACTIVE=0 turns it off.
+#ifndef HEDGE_INTERACTIVE
+#define HEDGE_INTERACTIVE 1
+#endif
+
+// The upload the hedge worker is running. The network task fills it in
+// and sets hedgeBusy; the worker owns it until it clears hedgeBusy, which
+// may be after uploadHedged() has returned.
+struct HedgeJob {
+    const Transport* transport;
+    SensorReading reading;
+    bool ok;
+};
+
+HedgeJob hedgeJob;
+volatile bool hedgeBusy = false;
+SemaphoreHandle_t hedgeDone = NULL;
+
+void hedgeTask(void* param) {
+    static char payload[READING_PAYLOAD_SIZE];
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        hedgeJob.ok = uploadReadings(*hedgeJob.transport, &hedgeJob.reading, 1, payload, sizeof(payload));
+        xSemaphoreGive(hedgeDone);
+        hedgeBusy = false;
+    }
+}
+
+bool isInteractive(const char* function) {
+    return strcmp(function, "Single") == 0 || strcmp(function, "Double") == 0 || strcmp(function, "Touch") == 0;
+}
+
+// Best transport on the worker; the runner-up joins in on this task if
+// the first is still going at its p95. Returns as soon as one copy is
+// delivered. A slow primary finishes on the worker; the modem and WiFi
+// session locks keep the next upload off its connection until then.
+bool uploadHedged(const SensorReading& reading) {
+    const Transport* transports[] = {&WIFI_TRANSPORT, &CELLULAR_TRANSPORT};
+    const TransportHealth* health[] = {&wifiHealth, &cellularHealth};
+    uint8_t quality[] = {(uint8_t)(WiFi.status() == WL_CONNECTED ? 100 : 0), cellularQuality()};
+    uint8_t order[2];
+    uint8_t ranked = 0;
+    uint32_t hedgeAfterMs = 0;
+    if (hedgeTaskHandle != NULL && !hedgeBusy) {
+        HealthLock lock;
+        ranked = rankTransports(health, quality, 2, millis(), order);
+        if (ranked == 2) hedgeAfterMs = health[order[0]]->p95LatencyMs();
+    }
+    if (ranked < 2) return uploadWithFallback(&reading, 1);
+
+    const Transport& primary = *transports[order[0]];
+    const Transport& secondary = *transports[order[1]];
+
+    xSemaphoreTake(hedgeDone, 0);  // Left over from a job nobody waited for
+    hedgeJob.transport = &primary;
+    hedgeJob.reading = reading;
+    hedgeJob.ok = false;
+    hedgeBusy = true;
+    Serial.printf("Trying %s (hedge after %lums)...\n", primary.name, (unsigned long)hedgeAfterMs);
+    xTaskNotifyGive(hedgeTaskHandle);
+
+    const Transport* delivered = NULL;
+    if (xSemaphoreTake(hedgeDone, pdMS_TO_TICKS(hedgeAfterMs)) == pdTRUE) {
+        if (hedgeJob.ok) {
+            delivered = &primary;
+        } else {
+            Serial.printf("%s failed, trying %s...\n", primary.name, secondary.name);
+            if (uploadReadings(secondary, &reading, 1)) delivered = &secondary;
         }
-        if (networkOperator.length() > 0) {
-            payload += ",\"networkOperator\":\"" + networkOperator + "\"";
+    } else {
+        Serial.printf("%s slow, hedging on %s\n", primary.name, secondary.name);
+        netTelemetry.hedged++;
+        if (uploadReadings(secondary, &reading, 1)) {
+            // Don't wait for the primary; the key dedupes a second copy
+            delivered = &secondary;
+            netTelemetry.hedgeWins++;
+        } else if (xSemaphoreTake(hedgeDone, portMAX_DELAY) == pdTRUE && hedgeJob.ok) {
+            delivered = &primary;
         }
-        payload += "}";
+    }
 
-        Serial.println("Priority 1: Sending via Phone (BLE)");
-        Serial.println(payload);
+    if (delivered == NULL) {
+        Serial.println("All connection methods failed!");
+        enqueueReading(reading);
+        return false;
+    }
+    replayBacklog(*delivered);
+    return true;
+}
 
-        pSalesforceChar->setValue(payload.c_str());
-        pSalesforceChar->notify();
+void sendSensorData(float temperature, float humidity, const char* function, unsigned long queuedAt) {
+    // Diagnostics come from the cache; the modem is not queried here
+    SensorReading reading;
+    fillReading(reading, temperature, humidity, function);
+
+    // Phone (BLE relay) when it has the best expected delivery time
+    if (bleEnabled && deviceConnected && pSalesforceChar && bleRelayPreferred()) {
+        // Phone adds its own connection type and API key
+        SerializeOptions options = {DEVICE_ID, NULL, NULL};
+        char payload[READING_PAYLOAD_SIZE];
+        if (serializeReading(reading, options, payload, sizeof(payload)) == 0) {
+            // Would be too large for every transport as well; drop it
+            Serial.println("Payload too large");
+            recordDelivery(queuedAt, false);
+            playSound(beepFail);
+            return;
+        }
 
-        notifyPhone("Sent via Phone");
-        beepSuccess();
+        unsigned long start = millis();
+        bool allowed;
+        {
+            HealthLock lock;
+            allowed = bleHealth.allow(start);
+        }
+        if (allowed) {
+            Serial.println("Sending via Phone (BLE)");
+            Serial.println(payload);
+            bool ok = relayViaPhone(payload, reading.idempotencyKey);
+            {
+                HealthLock lock;
+                bleHealth.record(ok, millis() - start, millis());
+            }
+            if (ok) {
+                notifyPhone("Sent via Phone");
+                recordDelivery(queuedAt, true);
+                playSound(beepSuccess);
+                return;
+            }
+            // The phone may still have posted it; the idempotency key
+            // makes a second copy harmless
+            Serial.println("Phone relay failed, sending directly");
+        }
+    }
+
+    if (HEDGE_INTERACTIVE && isInteractive(function)) {
+        bool ok = uploadHedged(reading);
+        recordDelivery(queuedAt, ok);
+        playSound(ok ? beepSuccess : beepFail);
         return;
     }
 
-    // Priority 2: WiFi (direct HTTP)
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("Priority 2: Trying WiFi...");
-        if (sendDirectToSalesforce(temperature, humidity, function)) {
-            beepSuccess();
-            return;
+    if (BATCH_MAX_READINGS > 1) {
+        if (liveBatchCount == 0) liveBatchStarted = millis();
+        liveBatchQueuedAt[liveBatchCount] = queuedAt;
+        liveBatch[liveBatchCount++] = reading;
+        Serial.print("Batch: ");
+        Serial.print(liveBatchCount);
+        Serial.print("/");
+        Serial.println(BATCH_MAX_READINGS);
+        if (liveBatchCount >= BATCH_MAX_READINGS) {
+            flushBatch();
+        } else {
+            notifyPhone("Reading batched");
+            playSound(beepShortTap);
         }
-        Serial.println("WiFi failed, trying cellular...");
+        return;
+    }
+
+    bool ok = uploadWithFallback(&reading, 1);
+    recordDelivery(queuedAt, ok);
+    playSound(ok ? beepSuccess : beepFail);
+}
+
+void connectNewNetwork(const char* ssid, const char* password) {
+    saveWifiCredential(ssid, password);
+    notifyPhone((String("Saved: ") + ssid).c_str());
+
+    // Try to connect to the new network
+    Serial.println("Attempting to connect to new network...");
+    notifyPhone("Connecting...");
+    salesforce.close();
+    WiFi.disconnect();
+    delay(100);
+
+    if (tryConnect(ssid, password[0] ? password : NULL)) {
+        connectedSSID = ssid;
+        saveWifiCache(password);
+        Serial.println("Connected to new network!");
+        notifyPhone((String("Connected: ") + ssid).c_str());
+        postConnectionStatus(ssid, password[0] == '\0');
+        updateWifiStatus();
     } else {
-        Serial.println("WiFi not connected, trying cellular...");
+        Serial.println("Failed to connect to new network");
+        notifyPhone("Connection failed");
+        // Back to the saved networks on the next supervision pass
+        wifiSupervisor.reset(millis());
+    }
+}
+
+#if DUTY_CYCLE
+WakeReason readWakeReason() {
+    switch (esp_sleep_get_wakeup_cause()) {
+        case ESP_SLEEP_WAKEUP_TIMER: return WAKE_TIMER;
+        case ESP_SLEEP_WAKEUP_EXT0: return WAKE_BUTTON;
+        case ESP_SLEEP_WAKEUP_TOUCHPAD: return WAKE_TOUCH;
+        default: return WAKE_POWER_ON;
     }
+}
 
-    // Priority 3: Cellular (SIM7000A)
-    Serial.println("Priority 3: Trying Cellular...");
-    if (sendViaCellular(temperature, humidity, function)) {
-        beepSuccess();
+// Pick up where the last cycle left off. Runs before initBacklog(), which
+// keeps the boot count of a resumed wake.
+void beginDutyCycle() {
+    WakeReason reason = readWakeReason();
+    uint32_t nowS = (uint32_t)time(NULL);
+    if (reason != WAKE_POWER_ON && dutyCycleValid(rtcDutyCycle)) {
+        dutyCycleResumed = true;
+        rtcDutyCycle.cycles++;
+        uptimeBaseMs = dutyCycleUptimeMs(rtcDutyCycle, nowS);
+        bootCount = rtcDutyCycle.bootCount;
+        readingSequence = rtcDutyCycle.readingSequence;
+        TransportHealth* health[DUTY_CYCLE_HEALTH_SLOTS] = {&bleHealth, &wifiHealth, &cellularHealth};
+        for (int i = 0; i < DUTY_CYCLE_HEALTH_SLOTS; i++) health[i]->restore(rtcDutyCycle.health[i], millis());
     } else {
-        Serial.println("All connection methods failed!");
+        reason = WAKE_POWER_ON;  // Also a wake whose state didn't survive (new firmware)
+        memset(&rtcDutyCycle, 0, sizeof(rtcDutyCycle));
+    }
+
+    bool due = wakeScheduler.wake(reason, nowS, millis(), rtcDutyCycle.nextReportAt);
+    wakeReading = wakeReadingFunction(reason, due);
+    Serial.printf("Duty cycle: %s wake, cycle %lu, last awake %lums, reading %s\n", wakeReasonName(reason),
+                  (unsigned long)rtcDutyCycle.cycles, (unsigned long)rtcDutyCycle.lastAwakeMs,
+                  wakeReading ? wakeReading : "none");
+}
+
+// Network task, with nothing else in flight: save what the next wake
+// needs, power the radios down and sleep until the next periodic reading
+// or a tap or touch
+void enterDeepSleep() {
+    if (uxQueueMessagesWaiting(netQueue) > 0) {
+        sleepQueued = false;  // Something came in behind it; the loop asks again
+        return;
+    }
+    uint32_t nowS = (uint32_t)time(NULL);
+    uint32_t sleepS = wakeScheduler.sleepSeconds(nowS, rtcDutyCycle.nextReportAt);
+
+    flushWifiScores();
+    saveLastFix();
+    GnssFix fix;
+    if (gnssFix.read(fix) && fix.valid) storeFix(fix, rtcDutyCycle.lastFix);
+    rtcDutyCycle.bootCount = bootCount;
+    rtcDutyCycle.readingSequence = readingSequence;
+    const TransportHealth* health[DUTY_CYCLE_HEALTH_SLOTS] = {&bleHealth, &wifiHealth, &cellularHealth};
+    {
+        HealthLock lock;
+        for (int i = 0; i < DUTY_CYCLE_HEALTH_SLOTS; i++) health[i]->save(rtcDutyCycle.health[i]);
+    }
+    rtcDutyCycle.lastAwakeMs = millis();
+    rtcDutyCycle.uptimeMs = uptimeMs();
+    rtcDutyCycle.sleptAt = nowS;
+    dutyCycleSeal(rtcDutyCycle);
+
+    Serial.printf("Duty cycle: awake %lums, sleeping %lus\n", (unsigned long)rtcDutyCycle.lastAwakeMs,
+                  (unsigned long)sleepS);
+
+    // Off, not asleep: the modem draws more than everything else put
+    // together. The next wake powers it up again with a warm GNSS start
+    // from the fix above.
+    {
+        ModemLock lock;
+        if (modemInitialized) modem.poweroff();
+        modemInitialized = false;
+    }
+    WiFi.disconnect(true);
+
+    esp_sleep_enable_timer_wakeup((uint64_t)sleepS * 1000000ULL);
+    rtc_gpio_pullup_en((gpio_num_t)BUTTON_PIN);  // The digital pull-up is off in deep sleep
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)BUTTON_PIN, 0);
+    esp_sleep_enable_touchpad_wakeup();  // Threshold set by setupInput()
+    Serial.flush();
+    esp_deep_sleep_start();
+}
+#endif
+
+void runNetJob(const NetJob& job) {
+    switch (job.type) {
+        case NET_JOB_READING:
+            sendSensorData(job.reading.temperature, job.reading.humidity, job.reading.function, job.queuedAt);
+            break;
+        case NET_JOB_FIRMWARE_CHECK:
+            checkAndUpdateFirmware();
+            break;
+        case NET_JOB_WIFI_SCAN:
+            performWifiScanForPhone();
+            break;
+        case NET_JOB_WIFI_CONNECT:
+            connectNewNetwork(job.wifi.ssid, job.wifi.password);
+            break;
+        case NET_JOB_WIFI_FORGET:
+            forgetWifiNetwork(job.wifi.ssid);
+            forgetWifiCache(job.wifi.ssid);
+            notifyPhone((String("Forgot: ") + job.wifi.ssid).c_str());
+            break;
+        case NET_JOB_SLEEP:
+#if DUTY_CYCLE
+            enterDeepSleep();
+#endif
+            break;
+    }
+}
+
+// Listener: the link just came up
+void onWifiUp(void* context) {
+    Serial.print("WiFi up: ");
+    Serial.println(WiFi.localIP());
+    updateWifiStatus();
+    replayBacklog(WIFI_TRANSPORT);
+}
+
+void superviseWifi() {
+    uint32_t now = millis();
+    bool connected = WiFi.status() == WL_CONNECTED;
+
+    // The boot task's attempt, the only one that ends outside this function
+    if (wifiSupervisor.state() == WIFI_LINK_CONNECTING) {
+        takeWifiEvent();
+        wifiSupervisor.attemptFinished(connected, now);
+        return;
+    }
+
+    WifiLinkEvent event = takeWifiEvent();
+
+    // Events first; the status poll catches anything the event task missed
+    if (event == WIFI_EVENT_DOWN || (wifiSupervisor.state() == WIFI_LINK_UP && !connected)) {
+        if (wifiSupervisor.state() == WIFI_LINK_UP) {
+            Serial.println("WiFi lost");
+            notifyPhone("WiFi reconnecting...");
+            salesforce.close();
+        }
+        wifiSupervisor.linkDown(now);
+    }
+    if (connected && (event == WIFI_EVENT_UP || wifiSupervisor.state() != WIFI_LINK_UP)) {
+        wifiSupervisor.linkUp(now);
+    }
+
+    if (!wifiSupervisor.shouldConnect(now)) return;
+
+    connectWiFi();
+    takeWifiEvent();  // The attempt's own associations and drops
+    wifiSupervisor.attemptFinished(WiFi.status() == WL_CONNECTED, millis());
+    if (wifiSupervisor.state() != WIFI_LINK_UP) {
+        Serial.printf("WiFi: attempt failed (%u in a row), %s, next in %lus\n",
+                      (unsigned)wifiSupervisor.failures(), wifiLinkStateName(wifiSupervisor.state()),
+                      (unsigned long)(wifiSupervisor.retryInMs(millis()) / 1000));
+    }
+}
+
+void superviseNetwork() {
+    // Dispatch URCs that arrived while the modem was idle
+    if (modemInitialized) {
+        ModemLock lock(0);
+        if (lock.held()) atEngine.poll(millis());
+    }
+
+    // Top up stale diagnostics between jobs, never behind an upload
+    refreshDiagnostics(0);
+    saveLastFix();
+    static unsigned long lastScoreSave = 0;
+    if (millis() - lastScoreSave >= WIFI_SCORE_SAVE_INTERVAL_MS) {
+        HealthLock lock;
+        if (wifiScorer.dirty()) {
+            lastScoreSave = millis();
+            wifiScorer.flush();
+        }
+    }
+
+    superviseWifi();
+
+    // Upload a partial batch once its oldest reading has waited long enough
+    if (liveBatchCount > 0 && millis() - liveBatchStarted >= BATCH_FLUSH_MS) {
+        flushBatch();
+    }
+}
+
+void netTask(void* param) {
+    // Jobs queue up until the boot task's WiFi attempt is done; only one
+    // task drives the radio at a time
+    xEventGroupWaitBits(bootEvents, 1 << BOOT_WIFI, pdFALSE, pdTRUE, portMAX_DELAY);
+    NetJob job;
+    for (;;) {
+        if (xQueueReceive(netQueue, &job, pdMS_TO_TICKS(NET_IDLE_POLL_MS)) == pdTRUE) {
+            netJobRunning = true;
+            runNetJob(job);
+            netJobRunning = false;
+        }
+        superviseNetwork();
+    }
+}
+
+void startNetworkTask() {
+    wifiSupervisor.addListener(onWifiUp, NULL);
+    netQueue = xQueueCreate(NET_QUEUE_LENGTH, sizeof(NetJob));
+    netEventQueue = xQueueCreate(NET_EVENT_QUEUE_LENGTH, sizeof(NetEvent));
+    xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, NULL, NET_TASK_PRIORITY,
+                            &netTaskHandle, NET_TASK_CORE);
+#if HEDGE_INTERACTIVE
+    hedgeDone = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(hedgeTask, "hedge", NET_TASK_STACK, NULL, NET_TASK_PRIORITY,
+                            &hedgeTaskHandle, NET_TASK_CORE);
+#endif
+}
+
+// Called on the loop task. Never blocks: a full queue drops the job.
+bool queueNetJob(NetJob& job) {
+    job.queuedAt = millis();
+    if (netQueue == NULL || xQueueSend(netQueue, &job, 0) != pdTRUE) {
+        netTelemetry.dropped++;
+        Serial.println("Network queue full - dropping request");
+        notifyPhone("Busy - try again");
         beepFail();
+        return false;
     }
+    netTelemetry.queued++;
+    uint32_t depth = uxQueueMessagesWaiting(netQueue);
+    if (depth > netTelemetry.maxDepth) netTelemetry.maxDepth = depth;
+    return true;
+}
+
+bool queueNetCommand(NetJobType type, const char* ssid = "", const char* password = "") {
+    NetJob job;
+    memset(&job, 0, sizeof(job));
+    job.type = type;
+    strncpy(job.wifi.ssid, ssid, sizeof(job.wifi.ssid) - 1);
+    strncpy(job.wifi.password, password, sizeof(job.wifi.password) - 1);
+    return queueNetJob(job);
 }
 
 void setupBLE() {
@@ -1262,8 +2941,9 @@ void setupBLE() {
     // Salesforce POST characteristic - sends data to phone for posting
     pSalesforceChar = pService->createCharacteristic(
         SALESFORCE_CHAR_UUID,
-        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_NOTIFY
     );
+    pSalesforceChar->setCallbacks(new SalesforceAckCallbacks());
     pSalesforceChar->addDescriptor(new BLE2902());
     pSalesforceChar->setValue("{}");
 
@@ -1279,9 +2959,161 @@ void setupBLE() {
     Serial.println("BLE ready - look for 'ESP32-Sensor'");
 }
 
+#define WIFI_BOOT_STACK 8192
+#define MODEM_BOOT_STACK 8192
+#define SENSOR_WARMUP_STACK 2048
+#define SENSOR_WARMUP_MAX_MS 1000  // Longest wait for the moisture filter to fill
+
+// The first WiFi attempt, claimed from the supervisor by setup(). The
+// network task waits for BOOT_WIFI before it touches WiFi, then takes
+// the attempt's outcome over.
+void wifiBootTask(void* param) {
+    connectWiFi();
+    bootPhaseDone(BOOT_WIFI);
+    vTaskDelete(NULL);
+}
+
+// Modem power-up, GNSS start and a first diagnostics pass, concurrently
+// with WiFi. The modem lock keeps early uploads from racing the init.
+void modemBootTask(void* param) {
+    {
+        ModemLock lock;
+        if (initModem()) {
+            Serial.println("Modem ready - GPS enabled");
+            refreshDiagnostics();
+        } else {
+            Serial.println("Modem init failed - check wiring and press PWR button");
+        }
+    }
+    bootPhaseDone(BOOT_MODEM);
+    vTaskDelete(NULL);
+}
+
+// Soil moisture is sampled continuously. The ADC's DMA mode (I2S0 on
+// the ESP32) converts GPIO34 in the background; the moisture task averages
+// each DMA frame into one sample, converts it to millivolts with the
+// eFuse calibration and runs it through a median + EMA filter. Readers
+// take the latest value and never wait on the ADC. Nothing else may use
+// ADC1 while this runs.
+//
+// The DMA driver holds the APB clock at its maximum while converting,
+// which rules out light sleep. At the low power level the task converts
+// one frame per MOISTURE_IDLE_INTERVAL_MS and stops the DMA in between,
+// so the filter follows a step in ~40 s instead.
+#define MOISTURE_CHANNEL ADC1_CHANNEL_6  // GPIO34 = MOISTURE_PIN
+#define MOISTURE_SAMPLE_HZ 20000         // Lowest rate the ESP32's DMA mode runs at
+#define MOISTURE_FRAME_BYTES 1024        // 512 conversions (~26 ms) per filter sample
+#define MOISTURE_MEDIAN_WINDOW 5
+#define MOISTURE_EMA_SHIFT 3             // alpha = 1/8: follows a step in ~0.5 s
+#define MOISTURE_POLL_MS 25              // Without DMA: analogReadMilliVolts() at the same pace
+#define MOISTURE_IDLE_INTERVAL_MS 2000   // Between samples while light sleep is enabled
+#define MOISTURE_TASK_STACK 3072
+#define ADC_DEFAULT_VREF_MV 1100         // Only used when the eFuse has no calibration
+
+MedianEmaFilter moistureFilter(MOISTURE_MEDIAN_WINDOW, MOISTURE_EMA_SHIFT);  // Moisture task only
+esp_adc_cal_characteristics_t adcCalibration;
+#define MOISTURE_NONE -1
+volatile int32_t moistureMv = MOISTURE_NONE;  // Latest filtered value
+volatile bool moistureSettled = false;  // Filter has a full median window
+
+bool startMoistureDma() {
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = MOISTURE_FRAME_BYTES * 2;
+    init.conv_num_each_intr = MOISTURE_FRAME_BYTES;
+    init.adc1_chan_mask = BIT(MOISTURE_CHANNEL);
+    if (adc_digi_initialize(&init) != ESP_OK) return false;
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = MOISTURE_CHANNEL;
+    pattern.unit = 0;  // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = true;  // Required on the ESP32
+    config.conv_limit_num = 250;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = MOISTURE_SAMPLE_HZ;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+    if (adc_digi_controller_configure(&config) != ESP_OK || adc_digi_start() != ESP_OK) {
+        adc_digi_deinitialize();
+        return false;
+    }
+    return true;
+}
+
+void publishMoisture(uint32_t millivolts) {
+    moistureFilter.add((uint16_t)millivolts);
+    moistureMv = moistureFilter.value();
+    if (moistureFilter.settled()) moistureSettled = true;
+}
+
+void moistureTask(void* param) {
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, ADC_DEFAULT_VREF_MV, &adcCalibration);
+    bool dma = startMoistureDma();
+    if (!dma) Serial.println("Moisture: DMA sampling unavailable - polling");
+
+    static uint8_t frame[MOISTURE_FRAME_BYTES];
+    bool running = dma;
+    for (;;) {
+        if (!dma) {
+            publishMoisture(analogReadMilliVolts(MOISTURE_PIN));
+            delay(lightSleepEnabled ? MOISTURE_IDLE_INTERVAL_MS : MOISTURE_POLL_MS);
+            continue;
+        }
+
+        // Paced: stopped between frames so the APB lock is released
+        if (lightSleepEnabled) {
+            if (running) adc_digi_stop();
+            running = false;
+            delay(MOISTURE_IDLE_INTERVAL_MS);
+        }
+        if (!running) {
+            if (adc_digi_start() != ESP_OK) continue;
+            running = true;
+        }
+
+        // INVALID_STATE: the task fell behind and the driver dropped
+        // frames; what it returns is still good
+        uint32_t length = 0;
+        esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &length, 1000);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) continue;
+
+        uint32_t sum = 0;
+        uint32_t count = 0;
+        for (uint32_t i = 0; i + sizeof(adc_digi_output_data_t) <= length; i += sizeof(adc_digi_output_data_t)) {
+            const adc_digi_output_data_t* sample = (const adc_digi_output_data_t*)&frame[i];
+            if (sample->type1.channel != MOISTURE_CHANNEL) continue;
+            sum += sample->type1.data;
+            count++;
+        }
+        if (count > 0) publishMoisture(esp_adc_cal_raw_to_voltage(sum / count, &adcCalibration));
+    }
+}
+
+// Let the moisture filter fill before the startup reading
+void sensorWarmupTask(void* param) {
+    uint32_t start = millis();
+    while (!moistureSettled && millis() - start < SENSOR_WARMUP_MAX_MS) delay(10);
+    temperatureRead();
+    bootPhaseDone(BOOT_SENSORS);
+    vTaskDelete(NULL);
+}
+
 void setup() {
     Serial.begin(115200);
-    delay(1000);
+
+    modemMutex = xSemaphoreCreateRecursiveMutex();
+    powerMutex = xSemaphoreCreateMutex();
+    healthMutex = xSemaphoreCreateMutex();
+    salesforceMutex = xSemaphoreCreateMutex();
+    bleAckReady = xSemaphoreCreateBinary();
+    bootEvents = xEventGroupCreate();
+#if DUTY_CYCLE
+    beginDutyCycle();
+#endif
 
     Serial.println();
     Serial.println("================================");
@@ -1298,22 +3130,40 @@ void setup() {
     Serial.println("================================");
 
     pinMode(BUTTON_PIN, INPUT_PULLUP);
+    setupInput();
 
-    // Setup buzzer PWM
-    ledcSetup(BUZZER_CHANNEL, 2000, 8);
-    ledcAttachPin(BUZZER_PIN, BUZZER_CHANNEL);
+    // Setup buzzer PWM and melody timer
+    setupBuzzer();
 
-    // Startup chime
-    beepStartup();
+    // Startup chime (not on every duty cycle wake)
+    if (!dutyCycleResumed) beepStartup();
 
     // Temperature sensor - using ESP32 internal temp
     // (SIM7000A shield does not have MCP9808 populated)
     Serial.println("Using ESP32 internal temperature sensor");
 
-    // Connect WiFi first
-    connectWiFi();
+    // Offline readings from previous boots
+    initBacklog();
+    initCredentials();
+    wifiScorer.begin();
+
+    // WiFi, modem and sensors come up in the background
+    WiFi.onEvent(onWifiEvent);
+    WiFi.mode(WIFI_STA);  // Station interface up for OTA's mDNS below
+    wifiSupervisor.seed(esp_random());
+    wifiSupervisor.shouldConnect(millis());
+    xTaskCreatePinnedToCore(wifiBootTask, "wifiBoot", WIFI_BOOT_STACK, NULL, 1, NULL, NET_TASK_CORE);
+    Serial.println("\nInitializing cellular modem...");
+    setupDiagnostics();
+    setupModemUrcs();
+    xTaskCreatePinnedToCore(modemBootTask, "modemBoot", MODEM_BOOT_STACK, NULL, 1, NULL, NET_TASK_CORE);
+    xTaskCreate(moistureTask, "moisture", MOISTURE_TASK_STACK, NULL, 1, NULL);
+    xTaskCreate(sensorWarmupTask, "sensorWarmup", SENSOR_WARMUP_STACK, NULL, 1, NULL);
+
+    // UTC clock for timestamping queued readings (syncs in background)
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
 
-    // Disable WiFi power saving for reliable OTA
+    // Full power through boot; the governor steps down once it's idle
     WiFi.setSleep(false);
 
     // Setup OTA updates
@@ -1321,14 +3171,17 @@ void setup() {
     ArduinoOTA.setPort(3232);
     ArduinoOTA.onStart([]() {
         Serial.println("OTA Update starting...");
+        governPower(POWER_DEMAND_OTA, 1);
     });
     ArduinoOTA.onEnd([]() {
         Serial.println("\nOTA Update complete!");
+        governPower(POWER_DEMAND_OTA, -1);
     });
     ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
         Serial.printf("OTA Progress: %u%%\r", (progress / (total / 100)));
     });
     ArduinoOTA.onError([](ota_error_t error) {
+        governPower(POWER_DEMAND_OTA, -1);
         Serial.printf("OTA Error[%u]: ", error);
         if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
         else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
@@ -1339,44 +3192,38 @@ void setup() {
     ArduinoOTA.begin();
     Serial.println("OTA updates enabled");
 
-    // Initialize cellular modem (for GPS and cellular fallback)
-    Serial.println("\nInitializing cellular modem...");
-    if (initModem()) {
-        Serial.println("Modem ready - GPS enabled");
-        // Try to get initial GPS fix
-        updateGPS();
-    } else {
-        Serial.println("Modem init failed - check wiring and press PWR button");
-    }
-
     // BLE stays OFF by default for reliable direct HTTP
     // User can 4-tap to enable BLE for phone configuration
     Serial.println("BLE disabled - 4-tap to enable");
 
-    // Send startup reading with all available data
-    Serial.println("\n--- Sending startup status to Salesforce ---");
-    if (modemInitialized) {
-        updateModemDiagnostics();
-    }
-    sendReading("Startup");
+    // Network I/O from here on runs on core 0
+    startNetworkTask();
+
+    // Startup reading goes out from the scheduler once the boot phases
+    // are done and GPS has had its chance
+    setupScheduler();
 }
 
+// Filtered probe voltage in millivolts, MOISTURE_NONE before the first
+// sample
 int readSoilMoisture() {
-    // Read multiple samples and average for stability
-    long total = 0;
-    for (int i = 0; i < 10; i++) {
-        total += analogRead(MOISTURE_PIN);
-        delay(10);
-    }
-    return total / 10;
+    return (int)moistureMv;
 }
 
-float getMoisturePercent(int rawValue) {
-    // Convert raw ADC to percentage (0% = dry, 100% = wet)
-    float percent = (float)(MOISTURE_DRY - rawValue) / (MOISTURE_DRY - MOISTURE_WET) * 100.0;
-    if (percent < 0) percent = 0;
-    if (percent > 100) percent = 100;
-    return percent;
+// NaN without a sample; the payload then carries null, not 100% wet
+float getMoisturePercent(int millivolts) {
+    if (millivolts == MOISTURE_NONE) return NAN;
+    // 0% = dry, 100% = wet
+    return moisturePermille((uint16_t)millivolts, MOISTURE_DRY_MV, MOISTURE_WET_MV) / 10.0f;
+}
+
+// "72.5F | 41%" for the sensor characteristic
+void formatSensorMessage(char* out, size_t size, float temp, float moisture) {
+    if (isnan(moisture)) {
+        snprintf(out, size, "%.1fF | --%%", temp);
+    } else {
+        snprintf(out, size, "%.1fF | %.0f%%", temp, moisture);
+    }
 }
 
 void sendReading(const char* function) {
@@ -1385,8 +3232,8 @@ void sendReading(const char* function) {
     float temp = (tempC * 9.0 / 5.0) + 32.0;
 
     // Read soil moisture sensor
-    int moistureRaw = readSoilMoisture();
-    float humidity = getMoisturePercent(moistureRaw);  // Using humidity field for moisture %
+    int moistureMillivolts = readSoilMoisture();
+    float humidity = getMoisturePercent(moistureMillivolts);  // Using humidity field for moisture %
 
     Serial.println("\n--- Sending Sensor Data ---");
     Serial.print("Function: ");
@@ -1396,13 +3243,13 @@ void sendReading(const char* function) {
     Serial.println(" F");
     Serial.print("Soil Moisture: ");
     Serial.print(humidity);
-    Serial.print("% (raw: ");
-    Serial.print(moistureRaw);
-    Serial.println(")");
+    Serial.print("% (");
+    Serial.print(moistureMillivolts);
+    Serial.println(" mV)");
 
     // Update sensor characteristic
     char sensorMsg[50];
-    snprintf(sensorMsg, sizeof(sensorMsg), "%.1fF | %.0f%%", temp, humidity);
+    formatSensorMessage(sensorMsg, sizeof(sensorMsg), temp, humidity);
     if (pSensorChar) {
         pSensorChar->setValue(sensorMsg);
         if (deviceConnected) {
@@ -1412,34 +3259,34 @@ void sendReading(const char* function) {
 
     // Notify phone what we're sending
     char statusMsg[100];
-    snprintf(statusMsg, sizeof(statusMsg), "Reading: %.1fF, %.0f%%", temp, humidity);
+    if (isnan(humidity)) {
+        snprintf(statusMsg, sizeof(statusMsg), "Reading: %.1fF, --%%", temp);
+    } else {
+        snprintf(statusMsg, sizeof(statusMsg), "Reading: %.1fF, %.0f%%", temp, humidity);
+    }
     notifyPhone(statusMsg);
 
-    // Send via best available method: Phone → WiFi → Cellular
-    sendSensorData(temp, humidity, function);
-}
-
-void scanAndSendNetworks() {
-    Serial.println("\n--- Triple Tap: WiFi Scan ---");
-
-    // Just send a scan reading to Salesforce via phone
-    float tempC = temperatureRead();
-    float temp = (tempC * 9.0 / 5.0) + 32.0;
-    int moistureRaw = analogRead(34);
-    float moisture = 0;  // Simple read for scan
-
-    notifyPhone("Triple tap - scanning");
-    sendSensorData(temp, moisture, "Scan");
+    // Network task sends via best available method: Phone → WiFi → Cellular
+    NetJob job;
+    memset(&job, 0, sizeof(job));
+    job.type = NET_JOB_READING;
+    job.reading.temperature = temp;
+    job.reading.humidity = humidity;
+    strncpy(job.reading.function, function, sizeof(job.reading.function) - 1);
+    queueNetJob(job);
 }
 
 void updateGpsStatus() {
     if (!pGpsChar) return;
 
+    GnssFix fix;
+    bool valid = gnssFix.read(fix) && fix.valid;
+
     char gpsMsg[50];
     if (!modemInitialized) {
         snprintf(gpsMsg, sizeof(gpsMsg), "No modem");
-    } else if (gpsValid) {
-        snprintf(gpsMsg, sizeof(gpsMsg), "%.4f, %.4f", gpsLatitude, gpsLongitude);
+    } else if (valid) {
+        snprintf(gpsMsg, sizeof(gpsMsg), "%.4f, %.4f", fix.latitude, fix.longitude);
     } else {
         snprintf(gpsMsg, sizeof(gpsMsg), "Searching...");
     }
@@ -1453,13 +3300,16 @@ void updateGpsStatus() {
 void updateCellStatus() {
     if (!pCellChar) return;
 
+    // Cached state only - no modem round trips from the loop
+    DiagnosticsSnapshot diag;
+    readDiagnostics(diag);
+
     char cellMsg[50];
     if (!modemInitialized) {
         snprintf(cellMsg, sizeof(cellMsg), "No modem");
-    } else if (modem.isGprsConnected()) {
-        int csq = modem.getSignalQuality();
-        snprintf(cellMsg, sizeof(cellMsg), "Connected (CSQ:%d)", csq);
-    } else if (modem.isNetworkConnected()) {
+    } else if (cellularDataConnected) {
+        snprintf(cellMsg, sizeof(cellMsg), "Connected (CSQ:%d)", (int)diag.values.signalQuality);
+    } else if (diag.values.registered) {
         snprintf(cellMsg, sizeof(cellMsg), "Registered");
     } else {
         snprintf(cellMsg, sizeof(cellMsg), "Searching...");
@@ -1475,11 +3325,10 @@ void updateSensorReading() {
     // Read sensors and update BLE characteristic (doesn't post to Salesforce)
     float tempC = temperatureRead();
     float temp = (tempC * 9.0 / 5.0) + 32.0;
-    int moistureRaw = readSoilMoisture();
-    float moisture = getMoisturePercent(moistureRaw);
+    float moisture = getMoisturePercent(readSoilMoisture());
 
     char sensorMsg[50];
-    snprintf(sensorMsg, sizeof(sensorMsg), "%.1fF | %.0f%%", temp, moisture);
+    formatSensorMessage(sensorMsg, sizeof(sensorMsg), temp, moisture);
     if (pSensorChar) {
         pSensorChar->setValue(sensorMsg);
         if (deviceConnected) {
@@ -1492,26 +3341,79 @@ void updateSensorReading() {
     updateCellStatus();
 }
 
-void loop() {
-    // Handle OTA updates
+// ============================================================
+// Cooperative scheduler - loop() duties as short run-to-yield tasks
+// ============================================================
+uint32_t schedulerMillis() { return millis(); }
+uint32_t schedulerMicros() { return micros(); }
+
+CoopScheduler scheduler(schedulerMillis, schedulerMicros);
+int bleShutdownTaskId = -1;
+int startupReadingTaskId = -1;
+
+#define SCHEDULER_STATS_MS 300000  // Print per-task timing every 5 minutes
+
+void netEventTask() {
+    // Sounds posted by the network task
+    NetEvent event;
+    if (netEventQueue != NULL && xQueueReceive(netEventQueue, &event, 0) == pdTRUE) {
+        event.sound();
+    }
+}
+
+void otaTask() {
     ArduinoOTA.handle();
+}
 
-    static unsigned long lastTapTime = 0;
-    static int tapCount = 0;
-    static bool lastButtonState = HIGH;
-    static bool buttonPressed = false;
-    static bool lastButtonReading = HIGH;
-    static unsigned long lastSensorUpdate = 0;
+bool startupReadingPending = true;
 
+// Send the startup reading once there's a fix, or when the wait after a
+// hot/warm GNSS start runs out (straight away after a cold one)
+void startupReadingTask() {
+    if (wakeReading == NULL) {
+        startupReadingPending = false;
+        scheduler.setEnabled(startupReadingTaskId, false);
+        return;
+    }
+    static bool bootDone = false;
+    if (!bootDone) {
+        EventBits_t done = xEventGroupGetBits(bootEvents) & BOOT_ALL_DONE;
+        if (done != BOOT_ALL_DONE && millis() < BOOT_READY_TIMEOUT_MS) return;
+        bootDone = true;
+        Serial.printf("Boot: wifi=%lums modem=%lums sensors=%lums\n", (unsigned long)bootPhaseMs[BOOT_WIFI],
+                      (unsigned long)bootPhaseMs[BOOT_MODEM], (unsigned long)bootPhaseMs[BOOT_SENSORS]);
+        // GNSS started with the modem; a hot or warm start gets a little
+        // longer to produce a fix
+        if (modemInitialized && gnssStart != GNSS_START_COLD) {
+            startupReadingDeadline = millis() + GNSS_STARTUP_WAIT_MS;
+        }
+    }
+
+    GnssFix fix;
+    bool haveFix = gnssFix.read(fix) && fix.valid;
+    if (!haveFix && (int32_t)(millis() - startupReadingDeadline) < 0) return;
+
+    Serial.println("\n--- Sending startup status to Salesforce ---");
+    sendReading(wakeReading);
+    startupReadingPending = false;
+    scheduler.setEnabled(startupReadingTaskId, false);
+}
+
+void bleShutdownTask() {
+    // Phone may have reconnected during the grace period
+    if (!bleEnabled || deviceConnected) return;
+    Serial.println("Phone disconnected - fully disabling BLE");
+    BLEDevice::deinit(false);  // Deinit but keep memory
+    btStop();  // Stop Bluetooth controller completely
+    bleEnabled = false;
+    beepBleOff();
+}
+
+void bleTask() {
     // Handle BLE disconnection - fully disable BLE to allow direct HTTP
     if (bleEnabled && !deviceConnected && oldDeviceConnected) {
-        delay(500);
-        Serial.println("Phone disconnected - fully disabling BLE");
-        BLEDevice::deinit(false);  // Deinit but keep memory
-        btStop();  // Stop Bluetooth controller completely
-        bleEnabled = false;
-        beepBleOff();
         oldDeviceConnected = deviceConnected;
+        scheduler.trigger(bleShutdownTaskId, 500);
     }
     if (deviceConnected && !oldDeviceConnected) {
         oldDeviceConnected = deviceConnected;
@@ -1519,121 +3421,89 @@ void loop() {
         updateWifiStatus();
     }
 
-    // Update sensor reading every 2 seconds when phone is connected
-    if (bleEnabled && deviceConnected && !pauseSensorUpdates && (millis() - lastSensorUpdate >= 2000)) {
-        lastSensorUpdate = millis();
-        updateSensorReading();
-    }
-
-    // Handle WiFi scan request from phone
+    // WiFi requests from the phone are carried out by the network task
     if (wifiScanRequested) {
         wifiScanRequested = false;
-        performWifiScanForPhone();
+        queueNetCommand(NET_JOB_WIFI_SCAN);
     }
 
-    // Handle forget network request from phone
     if (forgetNetworkRequested) {
         forgetNetworkRequested = false;
-        forgetWifiNetwork(forgetSSID);
-        notifyPhone(("Forgot: " + forgetSSID).c_str());
+        queueNetCommand(NET_JOB_WIFI_FORGET, forgetSSID.c_str());
         forgetSSID = "";
     }
 
-    // Handle new WiFi credentials from phone
     if (newCredentialsReceived) {
         newCredentialsReceived = false;
-        saveWifiCredential(newSSID, newPassword);
-        notifyPhone(("Saved: " + newSSID).c_str());
-
-        // Try to connect to the new network
-        Serial.println("Attempting to connect to new network...");
-        notifyPhone("Connecting...");
-        WiFi.disconnect();
-        delay(100);
-
-        if (tryConnect(newSSID.c_str(), newPassword.length() > 0 ? newPassword.c_str() : NULL)) {
-            connectedSSID = newSSID;
-            Serial.println("Connected to new network!");
-            notifyPhone(("Connected: " + newSSID).c_str());
-            postConnectionStatus(newSSID.c_str(), newPassword.length() == 0);
-            updateWifiStatus();
-        } else {
-            Serial.println("Failed to connect to new network");
-            notifyPhone("Connection failed");
-            // Reconnect to previous network
-            connectWiFi();
-        }
+        queueNetCommand(NET_JOB_WIFI_CONNECT, newSSID.c_str(), newPassword.c_str());
         newSSID = "";
         newPassword = "";
     }
+}
 
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi lost - reconnecting...");
-        notifyPhone("WiFi reconnecting...");
-        connectWiFi();
+void sensorTask() {
+    // Live sensor values for the phone (doesn't post to Salesforce)
+    if (bleEnabled && deviceConnected && !pauseSensorUpdates) {
+        updateSensorReading();
     }
+}
 
-    bool reading = digitalRead(BUTTON_PIN);
+// Button and touch pad report through interrupts: each edge goes into a
+// lock-free queue with its time, so a press is timed right even when the
+// loop is late, and the recognizer works the taps out when it catches up
+#define INPUT_QUEUE_SIZE 32  // Edges; bounce on a press can be a dozen
 
-    // Notify phone of button state changes
-    if (reading != lastButtonReading) {
-        notifyButtonState(reading == LOW);
-        lastButtonReading = reading;
-    }
+const GestureConfig GESTURE_CONFIG = {DEBOUNCE_TIME, TAP_WINDOW, TOUCH_QUIET_MS};
 
-    // Detect button press (HIGH to LOW transition)
-    if (reading == LOW && lastButtonState == HIGH) {
-        buttonPressed = true;
-    }
-    lastButtonState = reading;
+EdgeQueue<INPUT_QUEUE_SIZE> buttonEdges;  // Button ISR -> loop task
+EdgeQueue<INPUT_QUEUE_SIZE> touchEdges;   // Touch ISR -> loop task
+GestureRecognizer gestures(GESTURE_CONFIG);
 
-    // Process button press with simple debounce
-    if (buttonPressed) {
-        buttonPressed = false;
-        delay(50);  // Simple debounce
+void IRAM_ATTR onButtonEdge() {
+    buttonEdges.push(millis(), digitalRead(BUTTON_PIN) == LOW);
+}
 
-        unsigned long now = millis();
+void IRAM_ATTR onTouchEdge() {
+    touchEdges.push(millis(), true);
+}
 
-        if (now - lastTapTime > TAP_WINDOW) {
-            // New tap sequence
-            tapCount = 1;
-            Serial.println("Tap 1");
-            notifyPhone("Tap 1...");
-            beep(20);
-        } else {
-            tapCount++;
-            Serial.print("Tap ");
-            Serial.println(tapCount);
-            char tapMsg[20];
-            snprintf(tapMsg, sizeof(tapMsg), "Tap %d...", tapCount);
-            notifyPhone(tapMsg);
-            beep(20);
-        }
-        lastTapTime = now;
+void setupInput() {
+    attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), onButtonEdge, CHANGE);
+    touchAttachInterrupt(TOUCH_PIN, onTouchEdge, TOUCH_THRESHOLD);
+}
 
-        // 5-tap triggers firmware update check immediately
-        if (tapCount >= 5) {
-            Serial.println("\n*** 5-TAP: CHECKING FOR FIRMWARE UPDATE ***");
-            notifyPhone("Checking for update...");
-            checkAndUpdateFirmware();
-            tapCount = 0;
-            lastTapTime = 0;
-        }
-        // 4-tap waits for timeout (so user can continue to 5)
-    }
+// Button, touch and phone keep a duty-cycled device awake a while
+void noteActivity() {
+#if DUTY_CYCLE
+    wakeScheduler.activity(millis());
+#endif
+}
+
+void onTap(uint8_t taps) {
+    noteActivity();
+    Serial.print("Tap ");
+    Serial.println(taps);
+    char tapMsg[20];
+    snprintf(tapMsg, sizeof(tapMsg), "Tap %u...", (unsigned)taps);
+    notifyPhone(tapMsg);
+    beepTapAck();
+}
 
-    // Check for timeout to trigger actions
-    if (tapCount > 0 && (millis() - lastTapTime) >= TAP_WINDOW) {
-        if (tapCount == 1) {
+void onGesture(Gesture gesture) {
+    switch (gesture) {
+        case GESTURE_SINGLE:
             Serial.println("\n*** SINGLE TAP! ***");
             sendReading("Single");
-        } else if (tapCount == 2) {
+            break;
+        case GESTURE_DOUBLE:
             Serial.println("\n*** DOUBLE TAP! ***");
             sendReading("Double");
-        } else if (tapCount == 3) {
+            break;
+        case GESTURE_SCAN:
             Serial.println("\n*** TRIPLE TAP! ***");
             sendReading("Scan");
-        } else if (tapCount == 4) {
+            break;
+        case GESTURE_BLE_TOGGLE:
             if (!bleEnabled) {
                 Serial.println("\n*** 4-TAP: ENABLING BLE ***");
                 btStart();  // Start Bluetooth controller
@@ -1647,31 +3517,154 @@ void loop() {
                 bleEnabled = false;
                 beepBleOff();
             }
-        }
-        tapCount = 0;
-    }
-
-    // Touch sensor detection
-    static bool wasTouched = false;
-    static unsigned long lastTouchTime = 0;
-    int touchValue = touchRead(TOUCH_PIN);
-
-    if (touchValue < TOUCH_THRESHOLD && !wasTouched) {
-        // Debounce - must be 200ms since last touch
-        if (millis() - lastTouchTime > 200) {
-            wasTouched = true;
-            lastTouchTime = millis();
+            break;
+        case GESTURE_OTA:
+            Serial.println("\n*** 5-TAP: CHECKING FOR FIRMWARE UPDATE ***");
+            notifyPhone("Checking for update...");
+            queueNetCommand(NET_JOB_FIRMWARE_CHECK);
+            break;
+        case GESTURE_TOUCH:
+            noteActivity();
             Serial.print("\n*** TOUCH DETECTED! (value: ");
-            Serial.print(touchValue);
+            Serial.print(touchRead(TOUCH_PIN));
             Serial.println(") ***");
             notifyPhone("Touch!");
             notifyButtonState(true);
             sendReading("Touch");
             notifyButtonState(false);
+            break;
+    }
+}
+
+// Feed queued edges to the recognizer oldest first, across both queues,
+// then act on what it made of them
+void inputTask() {
+    InputEdge button = {}, touch = {};
+    bool haveButton = buttonEdges.peek(button);
+    bool haveTouch = touchEdges.peek(touch);
+    while (haveButton || haveTouch) {
+        if (haveButton && (!haveTouch || (int32_t)(button.atMs - touch.atMs) <= 0)) {
+            gestures.buttonEdge(button.atMs, button.active);
+            buttonEdges.pop();
+            haveButton = buttonEdges.peek(button);
+        } else {
+            gestures.touchPulse(touch.atMs);
+            touchEdges.pop();
+            haveTouch = touchEdges.peek(touch);
+        }
+    }
+    gestures.advance(millis());
+
+    InputEvent event;
+    while (gestures.next(event)) {
+        switch (event.type) {
+            case INPUT_PRESS: notifyButtonState(true); break;
+            case INPUT_RELEASE: notifyButtonState(false); break;
+            case INPUT_TAP: onTap(event.taps); break;
+            case INPUT_GESTURE: onGesture(event.gesture); break;
         }
-    } else if (touchValue >= TOUCH_THRESHOLD) {
-        wasTouched = false;
     }
+}
 
-    delay(10);
+#if DUTY_CYCLE
+// Hand over to the network task for deep sleep once this wake's reading
+// is out and nobody is using the device
+void dutyCycleTask() {
+    if (sleepQueued) return;
+    if (deviceConnected) noteActivity();
+    bool busy = startupReadingPending || gestures.pendingTaps() > 0 || bleEnabled || netJobRunning ||
+                (netQueue != NULL && uxQueueMessagesWaiting(netQueue) > 0);
+    if (!wakeScheduler.shouldSleep(millis(), busy)) return;
+    sleepQueued = queueNetCommand(NET_JOB_SLEEP);
+}
+#endif
+
+// Demands nobody holds explicitly: pending network work and BLE
+void powerTask() {
+    bool work = netJobRunning || (netQueue != NULL && uxQueueMessagesWaiting(netQueue) > 0);
+    setPowerDemand(POWER_DEMAND_WORK, work);
+    setPowerDemand(POWER_DEMAND_BLE, bleEnabled);
+}
+
+void schedulerStatsTask() {
+    Serial.println("\n--- Network task ---");
+    uint32_t avgLatency = netTelemetry.sent ? (uint32_t)(netTelemetry.totalLatencyMs / netTelemetry.sent) : 0;
+    Serial.printf("queue=%lu/%d maxDepth=%lu queued=%lu dropped=%lu sent=%lu failed=%lu\n",
+                  (unsigned long)(netQueue ? uxQueueMessagesWaiting(netQueue) : 0), NET_QUEUE_LENGTH,
+                  (unsigned long)netTelemetry.maxDepth, (unsigned long)netTelemetry.queued,
+                  (unsigned long)netTelemetry.dropped, (unsigned long)netTelemetry.sent,
+                  (unsigned long)netTelemetry.failed);
+    Serial.printf("latency last=%lums avg=%lums max=%lums backlog=%lu\n",
+                  (unsigned long)netTelemetry.lastLatencyMs, (unsigned long)avgLatency,
+                  (unsigned long)netTelemetry.maxLatencyMs, (unsigned long)readingLog.pending());
+    Serial.printf("hedged=%lu hedgeWins=%lu\n", (unsigned long)netTelemetry.hedged,
+                  (unsigned long)netTelemetry.hedgeWins);
+    Serial.printf("wifi lastConnect=%lums (%s) link=%s attempts=%lu failures=%u retryIn=%lus\n",
+                  (unsigned long)wifiConnectMs, wifiConnectPath, wifiLinkStateName(wifiSupervisor.state()),
+                  (unsigned long)wifiSupervisor.attempts(), (unsigned)wifiSupervisor.failures(),
+                  (unsigned long)(wifiSupervisor.retryInMs(millis()) / 1000));
+    const char* transportNames[] = {"ble", "wifi", "cellular"};
+    const TransportHealth* transportHealth[] = {&bleHealth, &wifiHealth, &cellularHealth};
+    for (int i = 0; i < 3; i++) {
+        TransportHealth health(0, 0);
+        {
+            HealthLock lock;  // Copy, then print outside the lock
+            health = *transportHealth[i];
+        }
+        Serial.printf("%s %s latency=%lums p95=%lums success=%u%% attempts=%lu failures=%lu\n", transportNames[i],
+                      breakerStateName(health.state()), (unsigned long)health.latencyMs(),
+                      (unsigned long)health.p95LatencyMs(),
+                      (unsigned)(health.successPermille() / 10), (unsigned long)health.attempts(),
+                      (unsigned long)health.failures());
+    }
+#if POWER_GOVERNOR
+    xSemaphoreTake(powerMutex, portMAX_DELAY);
+    uint32_t now = millis();
+    Serial.printf("power %s %luMHz low=%llus medium=%llus high=%llus transitions=%lu%s\n",
+                  powerLevelName(powerGovernor.level()), (unsigned long)getCpuFrequencyMhz(),
+                  (unsigned long long)(powerGovernor.timeInMs(POWER_LOW, now) / 1000),
+                  (unsigned long long)(powerGovernor.timeInMs(POWER_MEDIUM, now) / 1000),
+                  (unsigned long long)(powerGovernor.timeInMs(POWER_HIGH, now) / 1000),
+                  (unsigned long)powerGovernor.transitions(), powerManagement ? "" : " (no light sleep)");
+    xSemaphoreGive(powerMutex);
+#endif
+    // Counters only; the track itself belongs to the network task
+    Serial.printf("gnss sentences=%lu badChecksum=%lu track=%u\n",
+                  (unsigned long)nmeaParser.sentences(), (unsigned long)nmeaParser.checksumErrors(),
+                  (unsigned)gnssTrack.count());
+
+    Serial.println("\n--- Scheduler ---");
+    for (int id = 0; id < scheduler.taskCount(); id++) {
+        const CoopScheduler::TaskStats* stats = scheduler.stats(id);
+        uint32_t avgUs = stats->runs ? (uint32_t)(stats->totalRunUs / stats->runs) : 0;
+        Serial.printf("%-10s runs=%lu avg=%luus max=%luus missed=%lu\n",
+                      scheduler.name(id), (unsigned long)stats->runs, (unsigned long)avgUs,
+                      (unsigned long)stats->maxRunUs, (unsigned long)stats->missedDeadlines);
+    }
+}
+
+void setupScheduler() {
+    //                  name        task                period  deadline (ms)
+    scheduler.add("input", inputTask, 10, 50);
+    scheduler.add("ota", otaTask, 10, 50);
+    scheduler.add("ble", bleTask, 50, 200);
+    scheduler.add("sensors", sensorTask, 2000, 500);
+    scheduler.add("netEvents", netEventTask, 20, 100);
+#if POWER_GOVERNOR
+    scheduler.add("power", powerTask, POWER_POLL_MS, 50);
+#endif
+    bleShutdownTaskId = scheduler.add("bleOff", bleShutdownTask, 0, 500);
+    startupReadingTaskId = scheduler.add("startup", startupReadingTask, 250, 500);
+#if DUTY_CYCLE
+    scheduler.add("dutyCycle", dutyCycleTask, 500, 100);
+#endif
+    scheduler.add("stats", schedulerStatsTask, SCHEDULER_STATS_MS);
+}
+
+void loop() {
+    uint32_t idle = scheduler.runOnce();
+    if (idle > 0) {
+        // Sleep until the next task is due, capped so input stays responsive
+        delay(idle < 10 ? idle : 10);
+    }
 }
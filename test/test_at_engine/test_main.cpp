@@ -0,0 +1,419 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "AtEngine.h"
+
+// Canned modem output: each chunk becomes readable at its time, the way
+// bytes trickle in from the UART
+struct Chunk {
+    uint32_t atMs;
+    const char* bytes;
+};
+
+class ScriptedPort : public AtPort {
+public:
+    ScriptedPort() : now(0), _chunks(NULL), _count(0), _next(0), _offset(0), _sentLength(0) { sent[0] = '\0'; }
+
+    void script(const Chunk* chunks, size_t count) {
+        _chunks = chunks;
+        _count = count;
+        _next = 0;
+        _offset = 0;
+    }
+
+    int available() {
+        if (_next >= _count || _chunks[_next].atMs > now) return 0;
+        return (int)(strlen(_chunks[_next].bytes) - _offset);
+    }
+
+    int read() {
+        if (available() <= 0) return -1;
+        int c = (unsigned char)_chunks[_next].bytes[_offset++];
+        if (_chunks[_next].bytes[_offset] == '\0') {
+            _next++;
+            _offset = 0;
+        }
+        return c;
+    }
+
+    size_t write(const uint8_t* data, size_t length) {
+        if (_sentLength + length >= sizeof(sent)) length = sizeof(sent) - 1 - _sentLength;
+        memcpy(sent + _sentLength, data, length);
+        _sentLength += length;
+        sent[_sentLength] = '\0';
+        return length;
+    }
+
+    uint32_t now;
+    char sent[512];
+
+private:
+    const Chunk* _chunks;
+    size_t _count;
+    size_t _next;
+    size_t _offset;
+    size_t _sentLength;
+};
+
+#define SCRIPT(port, chunks) (port).script(chunks, sizeof(chunks) / sizeof(chunks[0]))
+
+// Poll every millisecond up to endMs
+static void runUntil(ScriptedPort& port, AtEngine& engine, uint32_t endMs) {
+    for (; port.now <= endMs; port.now++) engine.poll(port.now);
+}
+
+struct Captured {
+    int count;
+    char lines[4][AT_LINE_MAX];
+};
+
+static void captureLine(const char* line, void* context) {
+    Captured* captured = (Captured*)context;
+    if (captured->count < 4) strcpy(captured->lines[captured->count], line);
+    captured->count++;
+}
+
+static int callbacks;
+static AtResult lastCallback;
+
+static void onDone(const AtResult& result, void* context) {
+    callbacks++;
+    lastCallback = result;
+}
+
+void setUp(void) {
+    callbacks = 0;
+    memset(&lastCallback, 0, sizeof(lastCallback));
+}
+
+void tearDown(void) {}
+
+void test_captures_prefixed_line(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{20, "AT+CBC\r\r\n+CBC: 0,85,4012\r\n"}, {25, "\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    AtResult result;
+    AtRequest request("+CBC", "+CBC:", 1000);
+    request.result = &result;
+    request.callback = onDone;
+    TEST_ASSERT_TRUE(engine.submit(request));
+    TEST_ASSERT_EQUAL(AT_PENDING, result.status);
+    TEST_ASSERT_FALSE(engine.idle());
+
+    runUntil(port, engine, 100);
+    TEST_ASSERT_EQUAL_STRING("AT+CBC\r", port.sent);
+    TEST_ASSERT_TRUE(result.ok());
+    TEST_ASSERT_EQUAL_STRING("0,85,4012", result.line);  // Echo skipped, prefix stripped
+    TEST_ASSERT_EQUAL_UINT32(25, result.elapsedMs);
+    TEST_ASSERT_EQUAL(1, callbacks);
+    TEST_ASSERT_EQUAL_STRING("0,85,4012", lastCallback.line);
+    TEST_ASSERT_TRUE(engine.idle());
+    TEST_ASSERT_EQUAL_UINT32(0, engine.unsolicited());
+}
+
+// Commands go out one at a time, each after the previous one finished
+void test_queue_runs_in_order(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{10, "+CSQ: 18,99\r\nOK\r\n"}, {30, "+COPS: 0,0,\"T-Mobile\",7\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    AtResult csq, cops;
+    AtRequest first("+CSQ", "+CSQ:");
+    first.result = &csq;
+    AtRequest second("+COPS?", "+COPS:");
+    second.result = &cops;
+    engine.submit(first);
+    engine.submit(second);
+    TEST_ASSERT_EQUAL(2, engine.queued());
+
+    engine.poll(0);
+    TEST_ASSERT_EQUAL_STRING("AT+CSQ\r", port.sent);
+    runUntil(port, engine, 50);
+    TEST_ASSERT_EQUAL_STRING("AT+CSQ\rAT+COPS?\r", port.sent);
+    TEST_ASSERT_EQUAL_STRING("18,99", csq.line);
+    TEST_ASSERT_EQUAL_STRING("0,0,\"T-Mobile\",7", cops.line);
+    TEST_ASSERT_EQUAL_UINT32(30 - 10, cops.elapsedMs);
+}
+
+// A +CGNSINF URC landing in the middle of a +CBC response goes to its
+// handler and does not complete or corrupt the command
+void test_urc_interleaved_with_response(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{5, "\r\n+CBC: 0,85,"},
+                            {6, "4012\r\n+CGNSINF: 1,1,20261017101501.000,37.774929,-122.419418\r\n"},
+                            {9, "+CGNSINF: 1,0\r\n\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+    Captured gnss = {};
+    engine.onUrc("+CGNSINF:", captureLine, &gnss);
+
+    AtResult result;
+    AtRequest request("+CBC", "+CBC:");
+    request.result = &result;
+    engine.submit(request);
+    runUntil(port, engine, 20);
+
+    TEST_ASSERT_TRUE(result.ok());
+    TEST_ASSERT_EQUAL_STRING("0,85,4012", result.line);
+    TEST_ASSERT_EQUAL(2, gnss.count);
+    TEST_ASSERT_EQUAL_STRING("+CGNSINF: 1,1,20261017101501.000,37.774929,-122.419418", gnss.lines[0]);
+    TEST_ASSERT_EQUAL_STRING("+CGNSINF: 1,0", gnss.lines[1]);
+}
+
+// The DOWNLOAD prompt split across two reads still sends the payload,
+// once, and the command then finishes on OK
+void test_split_prompt_sends_payload_once(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{10, "\r\nDOWN"}, {40, "LOAD\r\n"}, {45, "DOWNLOAD\r\n"}, {300, "\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    const char* body = "{\"temperature\":72.5}";
+    AtResult result;
+    AtRequest request("+HTTPDATA=20,10000", NULL, 12000);
+    request.prompt = "DOWNLOAD";
+    request.payload = (const uint8_t*)body;
+    request.payloadLength = strlen(body);
+    request.result = &result;
+    engine.submit(request);
+
+    runUntil(port, engine, 39);
+    TEST_ASSERT_EQUAL_STRING("AT+HTTPDATA=20,10000\r", port.sent);
+    runUntil(port, engine, 400);
+    TEST_ASSERT_EQUAL_STRING("AT+HTTPDATA=20,10000\r{\"temperature\":72.5}", port.sent);
+    TEST_ASSERT_TRUE(result.ok());
+}
+
+// CASEND's "> " prompt has no line ending at all
+void test_prompt_without_line_ending(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{10, "\r\n> "}, {50, "\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    AtResult result;
+    AtRequest request("+CASEND=0,5", NULL, 5000);
+    request.prompt = ">";
+    request.payload = (const uint8_t*)"hello";
+    request.payloadLength = 5;
+    request.result = &result;
+    engine.submit(request);
+    runUntil(port, engine, 11);
+    TEST_ASSERT_EQUAL_STRING("AT+CASEND=0,5\rhello", port.sent);
+    runUntil(port, engine, 60);
+    TEST_ASSERT_TRUE(result.ok());
+}
+
+// +HTTPACTION answers OK at once and the status line seconds later; the
+// command only completes on that line
+void test_late_httpaction(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{15, "\r\nOK\r\n"}, {2900, "\r\n+HTTPACTION: 1,201,16\r\n"}, {2910, "+CSQ: 20,99\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    AtResult action, csq;
+    AtRequest request("+HTTPACTION=1", "+HTTPACTION:", 30000);
+    request.untilPrefix = true;
+    request.result = &action;
+    AtRequest next("+CSQ", "+CSQ:");
+    next.result = &csq;
+    engine.submit(request);
+    engine.submit(next);
+
+    runUntil(port, engine, 2000);
+    TEST_ASSERT_FALSE(action.done());  // OK alone is not enough
+    TEST_ASSERT_EQUAL_STRING("AT+HTTPACTION=1\r", port.sent);
+
+    runUntil(port, engine, 3000);
+    TEST_ASSERT_TRUE(action.ok());
+    TEST_ASSERT_EQUAL_STRING("1,201,16", action.line);
+    TEST_ASSERT_EQUAL_UINT32(2900, action.elapsedMs);
+    TEST_ASSERT_TRUE(csq.ok());
+}
+
+// A +HTTPACTION arriving after its command timed out goes to the URC
+// handler instead of completing whatever runs next
+void test_httpaction_after_timeout_is_urc(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{10, "OK\r\n"}, {1500, "+HTTPACTION: 1,200,2\r\n"}, {1600, "+CBC: 0,80,3950\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+    Captured late = {};
+    engine.onUrc("+HTTPACTION:", captureLine, &late);
+
+    AtResult action, cbc;
+    AtRequest request("+HTTPACTION=1", "+HTTPACTION:", 1000);
+    request.untilPrefix = true;
+    request.result = &action;
+    request.callback = onDone;
+    engine.submit(request);
+    AtRequest next("+CBC", "+CBC:");
+    next.result = &cbc;
+
+    runUntil(port, engine, 1200);
+    TEST_ASSERT_EQUAL(AT_TIMEOUT, action.status);
+    TEST_ASSERT_EQUAL_UINT32(1000, action.elapsedMs);
+    TEST_ASSERT_EQUAL(1, callbacks);
+    TEST_ASSERT_EQUAL_UINT32(1, engine.timeouts());
+
+    engine.submit(next);
+    runUntil(port, engine, 1700);
+    TEST_ASSERT_EQUAL(1, late.count);
+    TEST_ASSERT_EQUAL_STRING("+HTTPACTION: 1,200,2", late.lines[0]);
+    TEST_ASSERT_TRUE(cbc.ok());
+    TEST_ASSERT_EQUAL_STRING("0,80,3950", cbc.line);
+}
+
+// A timeout frees the engine for the next queued command at once
+void test_timeout_starts_next(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{150, "+CSQ: 9,99\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    AtResult silent, csq;
+    AtRequest first("+CGNSPWR=1", NULL, 100);
+    first.result = &silent;
+    AtRequest second("+CSQ", "+CSQ:");
+    second.result = &csq;
+    engine.submit(first);
+    engine.submit(second);
+
+    runUntil(port, engine, 99);
+    TEST_ASSERT_FALSE(silent.done());
+    runUntil(port, engine, 100);
+    TEST_ASSERT_EQUAL(AT_TIMEOUT, silent.status);
+    TEST_ASSERT_EQUAL_STRING("AT+CGNSPWR=1\rAT+CSQ\r", port.sent);
+    runUntil(port, engine, 200);
+    TEST_ASSERT_TRUE(csq.ok());
+}
+
+void test_error_results(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{5, "ERROR\r\n"}, {10, "+CME ERROR: SIM not inserted\r\n"}, {15, "+CMS ERROR: 500\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    AtResult results[3];
+    const char* commands[3] = {"+BOGUS", "+CPIN?", "+CMGS"};
+    for (int i = 0; i < 3; i++) {
+        AtRequest request(commands[i], "+X:");
+        request.result = &results[i];
+        engine.submit(request);
+    }
+    runUntil(port, engine, 20);
+    for (int i = 0; i < 3; i++) TEST_ASSERT_EQUAL(AT_ERROR, results[i].status);
+    TEST_ASSERT_EQUAL_STRING("ERROR", results[0].line);
+    TEST_ASSERT_EQUAL_STRING("+CME ERROR: SIM not inserted", results[1].line);
+}
+
+// No prefix: the first bare information line is the result (ATI)
+void test_bare_information_line(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{5, "SIM7000G R1529\r\nextra\r\n\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    AtResult result;
+    AtRequest request("I");
+    request.result = &result;
+    engine.submit(request);
+    runUntil(port, engine, 10);
+    TEST_ASSERT_TRUE(result.ok());
+    TEST_ASSERT_EQUAL_STRING("SIM7000G R1529", result.line);
+    TEST_ASSERT_EQUAL_UINT32(1, engine.unsolicited());
+}
+
+static bool claimStatus(const char* line, void* context) {
+    if (line[0] != '+') return false;
+    captureLine(line, context);
+    return true;
+}
+
+// A combined command line answers with one line per command and a
+// single OK; the onLine handler sees each of them
+void test_combined_command_lines(void) {
+    ScriptedPort port;
+    const Chunk script[] = {{30,
+                             "+CBC: 0,85,4012\r\n+CSQ: 18,99\r\n+COPS: 0,0,\"T-Mobile\",7\r\n"
+                             "+CREG: 0,5\r\n\r\nOK\r\n"}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+
+    Captured lines = {};
+    AtResult result;
+    AtRequest request("+CBC;+CSQ;+COPS?;+CREG?");
+    request.onLine = claimStatus;
+    request.context = &lines;
+    request.result = &result;
+    engine.submit(request);
+    runUntil(port, engine, 40);
+
+    TEST_ASSERT_TRUE(result.ok());
+    TEST_ASSERT_EQUAL_STRING("AT+CBC;+CSQ;+COPS?;+CREG?\r", port.sent);
+    TEST_ASSERT_EQUAL(4, lines.count);
+    TEST_ASSERT_EQUAL_STRING("+CSQ: 18,99", lines.lines[1]);
+    TEST_ASSERT_EQUAL_STRING("+CREG: 0,5", lines.lines[3]);
+}
+
+// Idle output nobody handles is counted, and overlong lines are cut
+// to the buffer rather than split into two
+void test_unsolicited_and_overlong_lines(void) {
+    char longLine[AT_LINE_MAX * 2 + 3];
+    memset(longLine, 'x', AT_LINE_MAX * 2);
+    strcpy(longLine + AT_LINE_MAX * 2, "\r\n");
+
+    ScriptedPort port;
+    const Chunk script[] = {{1, "RDY\r\n+CFUN: 1\r\n"}, {2, longLine}};
+    SCRIPT(port, script);
+    AtEngine engine(port);
+    Captured urc = {};
+    engine.onUrc("xxx", captureLine, &urc);
+    runUntil(port, engine, 5);
+
+    TEST_ASSERT_EQUAL_UINT32(2, engine.unsolicited());
+    TEST_ASSERT_EQUAL(1, urc.count);
+    TEST_ASSERT_EQUAL(AT_LINE_MAX - 1, strlen(urc.lines[0]));
+}
+
+void test_submit_limits(void) {
+    ScriptedPort port;
+    AtEngine engine(port);
+    char command[AT_COMMAND_MAX + 1];
+    memset(command, 'C', AT_COMMAND_MAX);
+    command[AT_COMMAND_MAX] = '\0';
+    TEST_ASSERT_FALSE(engine.submit(AtRequest(command)));
+    TEST_ASSERT_FALSE(engine.submit(AtRequest(NULL)));
+
+    for (int i = 0; i < AtEngine::QUEUE_SIZE; i++) TEST_ASSERT_TRUE(engine.submit(AtRequest("+CSQ")));
+    TEST_ASSERT_FALSE(engine.submit(AtRequest("+CSQ")));
+    engine.poll(0);  // One moves to active, freeing a slot
+    TEST_ASSERT_TRUE(engine.submit(AtRequest("+CSQ")));
+    TEST_ASSERT_EQUAL(AtEngine::QUEUE_SIZE + 1, engine.queued());
+
+    for (int i = 0; i < AtEngine::MAX_URC_HANDLERS; i++) TEST_ASSERT_TRUE(engine.onUrc("+X", captureLine));
+    TEST_ASSERT_FALSE(engine.onUrc("+X", captureLine));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_captures_prefixed_line);
+    RUN_TEST(test_queue_runs_in_order);
+    RUN_TEST(test_urc_interleaved_with_response);
+    RUN_TEST(test_split_prompt_sends_payload_once);
+    RUN_TEST(test_prompt_without_line_ending);
+    RUN_TEST(test_late_httpaction);
+    RUN_TEST(test_httpaction_after_timeout_is_urc);
+    RUN_TEST(test_timeout_starts_next);
+    RUN_TEST(test_error_results);
+    RUN_TEST(test_bare_information_line);
+    RUN_TEST(test_combined_command_lines);
+    RUN_TEST(test_unsolicited_and_overlong_lines);
+    RUN_TEST(test_submit_limits);
+    return UNITY_END();
+}
@@ -0,0 +1,316 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "AtParse.h"
+
+// SIM7000G responses, prefix removed the way AtEngine hands them over
+static const char* const CGNSINF_FIX =
+    "1,1,20261017101501.000,37.774929,-122.419416,16.200,1.85,271.4,1,,1.1,1.4,0.9,,12,8,3,,35,,";
+static const char* const CGNSINF_NO_FIX = "1,0,,,,,,,0,,,,,,,,,,,,";
+static const char* const CGNSINF_OFF = "0,,,,,,,,,,,,,,,,,,,,";
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fields_walk(void) {
+    AtFields f("0, 0 ,\"AT&T, Inc\",,7\r\n");
+    TEST_ASSERT_EQUAL(-1, f.index());
+    TEST_ASSERT_TRUE(f.next());
+    TEST_ASSERT_TRUE(f.equals("0"));
+    TEST_ASSERT_TRUE(f.next());
+    TEST_ASSERT_TRUE(f.equals("0"));  // Spaces around the value dropped
+    TEST_ASSERT_TRUE(f.next());
+    TEST_ASSERT_TRUE(f.quoted());
+    TEST_ASSERT_TRUE(f.equals("AT&T, Inc"));  // Comma inside quotes
+    TEST_ASSERT_TRUE(f.next());
+    TEST_ASSERT_TRUE(f.empty());
+    TEST_ASSERT_TRUE(f.next());
+    TEST_ASSERT_TRUE(f.equals("7"));  // Line ending trimmed
+    TEST_ASSERT_EQUAL(4, f.index());
+    TEST_ASSERT_FALSE(f.next());
+
+    AtFields none(NULL);
+    TEST_ASSERT_TRUE(none.next());
+    TEST_ASSERT_TRUE(none.empty());
+    TEST_ASSERT_FALSE(none.next());
+}
+
+// Fields point into the line: nothing is copied
+void test_fields_are_in_place(void) {
+    const char* line = "12,\"abc\"";
+    AtFields f(line);
+    TEST_ASSERT_TRUE(f.seek(1));
+    TEST_ASSERT_EQUAL_PTR(line + 4, f.data());
+    TEST_ASSERT_EQUAL(3, f.length());
+    TEST_ASSERT_FALSE(f.seek(0));  // Only forward
+    TEST_ASSERT_FALSE(f.seek(5));
+
+    char small[3];
+    AtFields g(line);
+    g.seek(1);
+    TEST_ASSERT_EQUAL(2, g.copy(small, sizeof(small)));
+    TEST_ASSERT_EQUAL_STRING("ab", small);
+    TEST_ASSERT_EQUAL(0, g.copy(small, 0));
+}
+
+void test_typed_reads(void) {
+    struct Case {
+        const char* text;
+        bool ok;
+        double value;
+    };
+    const Case cases[] = {
+        {"-122.419416", true, -122.419416}, {"+5", true, 5},      {"0.000000000000000000001", true, 0},
+        {"16.", true, 16},                  {"-", false, 0},      {"1.2.3", false, 0},
+        {"1e5", false, 0},                  {"", false, 0},       {"12345678901234567890", false, 0},
+        {"4012 ", true, 4012},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        AtFields f(cases[i].text);
+        f.next();
+        double value = -1;
+        TEST_ASSERT_EQUAL_MESSAGE(cases[i].ok, f.toDouble(value), cases[i].text);
+        if (cases[i].ok) TEST_ASSERT_DOUBLE_WITHIN(1e-9, cases[i].value, value);
+        else TEST_ASSERT_EQUAL_DOUBLE(-1, value);  // Untouched on failure
+    }
+
+    int32_t i32 = 7;
+    AtFields f("2147483647,2147483648,-2147483648,3.5");
+    TEST_ASSERT_TRUE(f.next() && f.toInt(i32));
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, i32);
+    TEST_ASSERT_TRUE(f.next());
+    TEST_ASSERT_FALSE(f.toInt(i32));
+    TEST_ASSERT_TRUE(f.next() && f.toInt(i32));
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, i32);
+    TEST_ASSERT_TRUE(f.next());
+    TEST_ASSERT_FALSE(f.toInt(i32));  // Not an integer
+}
+
+void test_cgnsinf_fix(void) {
+    GnssInfo info;
+    TEST_ASSERT_TRUE(parseCgnsinf(CGNSINF_FIX, info));
+    TEST_ASSERT_TRUE(info.running);
+    TEST_ASSERT_TRUE(info.fix);
+    TEST_ASSERT_EQUAL_STRING("20261017101501.000", info.utc);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-7, 37.774929, info.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-7, -122.419416, info.longitude);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 16.2f, info.altitude);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 1.85f, info.speedKmh);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 271.4f, info.course);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 1.1f, info.hdop);
+    TEST_ASSERT_EQUAL_INT32(12, info.satellitesInView);  // Field 14
+    TEST_ASSERT_EQUAL_INT32(8, info.satellitesUsed);     // Field 15
+    TEST_ASSERT_EQUAL_INT32(3, info.glonassUsed);        // Field 16
+}
+
+void test_cgnsinf_no_fix_and_off(void) {
+    GnssInfo info;
+    TEST_ASSERT_TRUE(parseCgnsinf(CGNSINF_NO_FIX, info));
+    TEST_ASSERT_TRUE(info.running);
+    TEST_ASSERT_FALSE(info.fix);
+    TEST_ASSERT_EQUAL_STRING("", info.utc);
+
+    TEST_ASSERT_TRUE(parseCgnsinf(CGNSINF_OFF, info));
+    TEST_ASSERT_FALSE(info.running);
+    TEST_ASSERT_FALSE(info.fix);
+
+    // Older firmware stops after the run status when GNSS is off
+    TEST_ASSERT_TRUE(parseCgnsinf("0", info));
+    TEST_ASSERT_FALSE(info.running);
+}
+
+// Cut off or garbled lines never produce a fix with a made-up position
+void test_cgnsinf_malformed(void) {
+    GnssInfo info;
+    TEST_ASSERT_TRUE(parseCgnsinf("1,1,20261017101501.000,37.77", info));
+    TEST_ASSERT_FALSE(info.fix);
+    TEST_ASSERT_TRUE(parseCgnsinf("1,1,20261017101501.000,,,16.2", info));
+    TEST_ASSERT_FALSE(info.fix);
+    TEST_ASSERT_TRUE(parseCgnsinf("1,1,20261017101501.000,37.7749x,-122.4194", info));
+    TEST_ASSERT_FALSE(info.fix);
+
+    // A fix with the tail cut off keeps the position, not the counts
+    TEST_ASSERT_TRUE(parseCgnsinf("1,1,20261017101501.000,37.774929,-122.419416,16.2", info));
+    TEST_ASSERT_TRUE(info.fix);
+    TEST_ASSERT_EQUAL_INT32(0, info.satellitesUsed);
+
+    TEST_ASSERT_FALSE(parseCgnsinf("x,1,junk", info));
+    TEST_ASSERT_FALSE(parseCgnsinf("", info));
+}
+
+void test_cbc(void) {
+    BatteryInfo info = {};
+    TEST_ASSERT_TRUE(parseCbc("0,85,4012", info));
+    TEST_ASSERT_EQUAL_INT32(0, info.chargeState);
+    TEST_ASSERT_EQUAL_INT32(85, info.percent);
+    TEST_ASSERT_EQUAL_INT32(4012, info.millivolts);
+    TEST_ASSERT_TRUE(parseCbc("1,100,4190", info));
+    TEST_ASSERT_EQUAL_INT32(4190, info.millivolts);
+
+    TEST_ASSERT_FALSE(parseCbc("0,85", info));
+    TEST_ASSERT_FALSE(parseCbc(",,", info));
+    TEST_ASSERT_FALSE(parseCbc("", info));
+}
+
+void test_cops(void) {
+    OperatorInfo info;
+    TEST_ASSERT_TRUE(parseCops("0,0,\"T-Mobile\",7", info));
+    TEST_ASSERT_EQUAL_STRING("T-Mobile", info.name);
+    TEST_ASSERT_EQUAL_INT32(7, info.accessTech);
+
+    TEST_ASSERT_TRUE(parseCops("1,0,\"AT&T, Inc\",9", info));
+    TEST_ASSERT_EQUAL_STRING("AT&T, Inc", info.name);
+
+    TEST_ASSERT_TRUE(parseCops("0,2,\"310260\"", info));
+    TEST_ASSERT_EQUAL_INT32(2, info.format);
+    TEST_ASSERT_EQUAL_INT32(-1, info.accessTech);
+
+    // Not registered: mode only, and a stale name is cleared
+    TEST_ASSERT_TRUE(parseCops("0", info));
+    TEST_ASSERT_EQUAL_STRING("", info.name);
+    TEST_ASSERT_EQUAL_INT32(-1, info.format);
+
+    TEST_ASSERT_TRUE(parseCops("0,0,\"A very long operator name for the buffer\",7", info));
+    TEST_ASSERT_EQUAL(sizeof(info.name) - 1, strlen(info.name));
+
+    TEST_ASSERT_TRUE(parseCops("0,0,\"Unterminated", info));  // Truncated line
+    TEST_ASSERT_EQUAL_STRING("Unterminated", info.name);
+    TEST_ASSERT_FALSE(parseCops("0,0,Bare", info));
+    TEST_ASSERT_FALSE(parseCops("0,x,\"T-Mobile\"", info));
+}
+
+void test_csq(void) {
+    SignalInfo info = {};
+    TEST_ASSERT_TRUE(parseCsq("21,99", info));
+    TEST_ASSERT_EQUAL_INT32(21, info.rssi);
+    TEST_ASSERT_EQUAL_INT32(99, info.ber);
+    TEST_ASSERT_TRUE(parseCsq("99,99", info));
+    TEST_ASSERT_EQUAL_INT32(99, info.rssi);
+    TEST_ASSERT_FALSE(parseCsq("abc", info));
+    TEST_ASSERT_FALSE(parseCsq("21", info));
+}
+
+void test_httpaction(void) {
+    HttpActionInfo info = {};
+    TEST_ASSERT_TRUE(parseHttpAction("1,201,16", info));
+    TEST_ASSERT_EQUAL_INT32(1, info.method);
+    TEST_ASSERT_EQUAL_INT32(201, info.status);
+    TEST_ASSERT_EQUAL_INT32(16, info.length);
+    TEST_ASSERT_TRUE(parseHttpAction("1,603,0", info));  // DNS error from the modem
+    TEST_ASSERT_EQUAL_INT32(603, info.status);
+    TEST_ASSERT_FALSE(parseHttpAction("1,200", info));
+    TEST_ASSERT_FALSE(parseHttpAction("1,2OO,16", info));
+}
+
+void test_creg(void) {
+    RegistrationInfo info = {};
+    TEST_ASSERT_TRUE(parseCreg("0,1", info));
+    TEST_ASSERT_TRUE(info.registered());
+    TEST_ASSERT_TRUE(parseCreg("2,5,\"1A2B\",\"01C3D4E5\"", info));  // With location
+    TEST_ASSERT_EQUAL_INT32(2, info.mode);
+    TEST_ASSERT_TRUE(info.registered());
+    TEST_ASSERT_TRUE(parseCreg("0,2", info));
+    TEST_ASSERT_FALSE(info.registered());
+    TEST_ASSERT_FALSE(parseCreg("0", info));
+}
+
+// The combined status answer, one line at a time as AtEngine delivers it
+void test_modem_status_lines(void) {
+    const char* const answer[] = {"+CBC: 0,85,4012", "+CSQ: 18,99", "+COPS: 0,0,\"Hologram\",7", "+CREG: 0,5"};
+    ModemStatus status;
+    memset(&status, 0, sizeof(status));
+    for (size_t i = 0; i < 4; i++) TEST_ASSERT_TRUE(parseModemStatusLine(answer[i], status));
+    TEST_ASSERT_EQUAL_UINT8(STATUS_ALL, status.fields);
+    TEST_ASSERT_EQUAL_INT32(4012, status.battery.millivolts);
+    TEST_ASSERT_EQUAL_INT32(18, status.signal.rssi);
+    TEST_ASSERT_EQUAL_STRING("Hologram", status.network.name);
+    TEST_ASSERT_TRUE(status.registration.registered());
+}
+
+// A query that fails ends the answer early; only what arrived is marked
+void test_modem_status_partial(void) {
+    ModemStatus status;
+    memset(&status, 0, sizeof(status));
+    TEST_ASSERT_TRUE(parseModemStatusLine("+CBC: 0,85,4012", status));
+    TEST_ASSERT_TRUE(parseModemStatusLine("+CSQ: 18", status));  // Truncated: claimed, not marked
+    TEST_ASSERT_EQUAL_UINT8(STATUS_BATTERY, status.fields);
+
+    // Lines that belong to something else are left for the engine
+    TEST_ASSERT_FALSE(parseModemStatusLine("+CGNSINF: 1,0", status));
+    TEST_ASSERT_FALSE(parseModemStatusLine("+CMTI: \"SM\",3", status));
+    TEST_ASSERT_FALSE(parseModemStatusLine("OK", status));
+    TEST_ASSERT_FALSE(parseModemStatusLine("", status));
+    TEST_ASSERT_EQUAL_UINT8(STATUS_BATTERY, status.fields);
+
+    // Not registered: operator is reported with an empty name
+    TEST_ASSERT_TRUE(parseModemStatusLine("+COPS:0", status));
+    TEST_ASSERT_TRUE(parseModemStatusLine("+CREG: 0,2", status));
+    TEST_ASSERT_EQUAL_UINT8(STATUS_BATTERY | STATUS_OPERATOR | STATUS_REGISTRATION, status.fields);
+    TEST_ASSERT_EQUAL_STRING("", status.network.name);
+    TEST_ASSERT_FALSE(status.registration.registered());
+}
+
+// The old updateGPS(): split into 20 Strings, then convert
+static double splitAndConvert(const char* line) {
+    std::string data = line;
+    std::string fields[20];
+    int count = 0;
+    size_t last = 0;
+    for (size_t i = 0; i < data.size() && count < 20; i++) {
+        if (data[i] == ',') {
+            fields[count++] = data.substr(last, i - last);
+            last = i + 1;
+        }
+    }
+    if (last < data.size() && count < 20) fields[count++] = data.substr(last);
+    if (count < 16 || fields[1] != "1") return 0;
+    return atof(fields[3].c_str()) + atof(fields[4].c_str()) + atof(fields[5].c_str()) +
+           atof(fields[6].c_str()) + atoi(fields[15].c_str());
+}
+
+// Micro-benchmark against the split-into-Strings parse it replaced
+void test_benchmark_against_split(void) {
+    const int iterations = 100000;
+    volatile double sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        GnssInfo info;
+        parseCgnsinf(CGNSINF_FIX, info);
+        sink = sink + info.latitude + info.longitude + info.altitude + info.speedKmh + info.satellitesUsed;
+    }
+    std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) sink = sink + splitAndConvert(CGNSINF_FIX);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    double inPlace = std::chrono::duration<double, std::nano>(middle - start).count() / iterations;
+    double split = std::chrono::duration<double, std::nano>(end - middle).count() / iterations;
+    char message[96];
+    snprintf(message, sizeof(message), "+CGNSINF in place %.0f ns, split into strings %.0f ns", inPlace, split);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(inPlace < split);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fields_walk);
+    RUN_TEST(test_fields_are_in_place);
+    RUN_TEST(test_typed_reads);
+    RUN_TEST(test_cgnsinf_fix);
+    RUN_TEST(test_cgnsinf_no_fix_and_off);
+    RUN_TEST(test_cgnsinf_malformed);
+    RUN_TEST(test_cbc);
+    RUN_TEST(test_cops);
+    RUN_TEST(test_csq);
+    RUN_TEST(test_httpaction);
+    RUN_TEST(test_creg);
+    RUN_TEST(test_modem_status_lines);
+    RUN_TEST(test_modem_status_partial);
+    RUN_TEST(test_benchmark_against_split);
+    return UNITY_END();
+}
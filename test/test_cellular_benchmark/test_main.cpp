@@ -0,0 +1,523 @@
+#include <unity.h>
+
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AtEngine.h"
+#include "AtParse.h"
+#include "HttpResponseParser.h"
+
+// Compares the two ways src/main.cpp has posted a reading over the
+// SIM7000: the module's HTTP application (HTTPINIT, HTTPPARA x3,
+// HTTPDATA, HTTPACTION, HTTPTERM per post) and a TLS socket on the modem
+// kept open across posts (CAOPEN once, then CASEND / CARECV). Also
+// compares the status poll as four exchanges against one combined line.
+//
+// The modem is emulated on simulated time: the UART moves bytes at the
+// configured baud rate in both directions, the modem takes a turnaround
+// to answer a local command, and anything that reaches the server costs
+// network round trips. Commands go through the real AtEngine and the
+// response through the real HttpResponseParser; CARECV's raw bytes are
+// read directly, as TinyGSM does. The timings are assumptions for an
+// LTE-M link, so the numbers are for comparing the paths, not absolute.
+struct LinkModel {
+    uint32_t baud;
+    uint32_t turnaroundMs;  // Modem answering a local command
+    uint32_t rttMs;         // Network round trip
+    uint32_t tlsMs;         // Handshake crypto on the modem, on top of 2 RTTs
+    uint32_t serverMs;      // Apex handling the post
+};
+
+static const LinkModel LTE_M = {57600, 20, 450, 1200, 150};
+
+static const char* const SITE = "example.my.salesforce-sites.com";
+static const char* const RESPONSE =
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Sat, 17 Oct 2026 10:15:01 GMT\r\n"
+    "Content-Type: application/json;charset=UTF-8\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "Strict-Transport-Security: max-age=63072000; includeSubDomains\r\n"
+    "X-Content-Type-Options: nosniff\r\n"
+    "Cache-Control: no-cache,must-revalidate,max-age=0,no-store,private\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "10\r\n"
+    "{\"success\":true}\r\n"
+    "0\r\n"
+    "\r\n";
+
+// Status answers recorded from a SIM7000G on Hologram
+static const char* const STATUS_ANSWERS[][2] = {
+    {"+CBC", "+CBC: 0,85,4012"},
+    {"+CSQ", "+CSQ: 18,99"},
+    {"+COPS?", "+COPS: 0,0,\"Hologram\",7"},
+    {"+CREG?", "+CREG: 0,5"},
+};
+
+class ModemEmulator : public AtPort {
+public:
+    explicit ModemEmulator(const LinkModel& link)
+        : _link(link), _nowUs(0), _rxFreeUs(0), _txFreeUs(0), _lineLength(0), _dataExpected(0),
+          _dataMode(DATA_NONE), _socketOpen(false), _commands(0), _uartBytes(0) {}
+
+    // Simulated clock
+    uint64_t nowUs() const { return _nowUs; }
+    uint32_t nowMs() const { return (uint32_t)(_nowUs / 1000); }
+    void advanceUs(uint64_t us) { _nowUs += us; }
+
+    uint32_t commands() const { return _commands; }
+    uint32_t uartBytes() const { return _uartBytes; }
+    void dropSocket() { _socketOpen = false; }
+
+    int available() {
+        int n = 0;
+        for (size_t i = 0; i < _output.size() && _output[i].atUs <= _nowUs; i++) n++;
+        return n;
+    }
+
+    int read() {
+        if (_output.empty() || _output.front().atUs > _nowUs) return -1;
+        char c = _output.front().c;
+        _output.pop_front();
+        return (uint8_t)c;
+    }
+
+    size_t write(const uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; i++) receive((char)data[i]);
+        return length;
+    }
+
+    // AT+CARECV=0,<max>: the host blocks while the command goes out and
+    // "+CARECV: n,<n bytes>\r\nOK\r\n" comes back
+    size_t receiveSocket(uint8_t* out, size_t max) {
+        char command[32];
+        int commandLength = snprintf(command, sizeof(command), "AT+CARECV=0,%u\r", (unsigned)max);
+        _commands++;
+        uint64_t doneUs = uartUs(commandLength) + _link.turnaroundMs * 1000ULL;
+        size_t n = _socketData.size() < max ? _socketData.size() : max;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = (uint8_t)_socketData.front();
+            _socketData.pop_front();
+        }
+        char header[24];
+        int headerLength = snprintf(header, sizeof(header), "+CARECV: %u,", (unsigned)n);
+        doneUs += uartUs(headerLength + n + 6);
+        _uartBytes += commandLength + headerLength + n + 6;
+        _nowUs += doneUs;
+        return n;
+    }
+
+    size_t socketPending() const { return _socketData.size(); }
+
+private:
+    enum DataMode : uint8_t { DATA_NONE, DATA_HTTP, DATA_SOCKET };
+
+    struct Byte {
+        uint64_t atUs;
+        char c;
+    };
+
+    uint64_t uartUs(size_t bytes) const { return (uint64_t)bytes * 10 * 1000000ULL / _link.baud; }
+    uint64_t rttUs(uint32_t count) const { return (uint64_t)count * _link.rttMs * 1000ULL; }
+
+    // DNS + TCP + TLS handshake from the modem
+    uint64_t connectUs() const { return rttUs(4) + _link.tlsMs * 1000ULL; }
+
+    // Request up, response back after the server has handled it
+    uint64_t exchangeUs() const { return rttUs(1) + _link.serverMs * 1000ULL; }
+
+    void emit(uint64_t atUs, const char* text) {
+        uint64_t start = atUs > _txFreeUs ? atUs : _txFreeUs;
+        size_t length = strlen(text);
+        for (size_t i = 0; i < length; i++) {
+            Byte b = {start + uartUs(i + 1), text[i]};
+            _output.push_back(b);
+        }
+        _txFreeUs = start + uartUs(length);
+        _uartBytes += length;
+    }
+
+    void receive(char c) {
+        // Bytes arrive at the modem one UART byte time apart
+        uint64_t start = _nowUs > _rxFreeUs ? _nowUs : _rxFreeUs;
+        _rxFreeUs = start + uartUs(1);
+        _uartBytes++;
+
+        if (_dataMode != DATA_NONE) {
+            if (--_dataExpected == 0) dataComplete();
+            return;
+        }
+        if (c == '\r') {
+            _line[_lineLength] = '\0';
+            _lineLength = 0;
+            command(_line);
+            return;
+        }
+        if (_lineLength < sizeof(_line) - 1) _line[_lineLength++] = c;
+    }
+
+    void command(const char* line) {
+        _commands++;
+        uint64_t t = _rxFreeUs + _link.turnaroundMs * 1000ULL;
+        const char* at = line + 2;
+
+        if (strncmp(at, "+HTTPDATA=", 10) == 0) {
+            _dataExpected = (size_t)atoi(at + 10);
+            _dataMode = DATA_HTTP;
+            emit(t, "\r\nDOWNLOAD\r\n");
+        } else if (strcmp(at, "+HTTPACTION=1") == 0) {
+            emit(t, "\r\nOK\r\n");
+            // The HTTP application opens a new connection for every action
+            emit(t + connectUs() + exchangeUs(), "\r\n+HTTPACTION: 1,200,16\r\n");
+        } else if (strncmp(at, "+CAOPEN=", 8) == 0) {
+            _socketOpen = true;
+            emit(t + connectUs(), "\r\n+CAOPEN: 0,0\r\n\r\nOK\r\n");
+        } else if (strcmp(at, "+CASTATE?") == 0) {
+            emit(t, _socketOpen ? "\r\n+CASTATE: 0,1\r\n\r\nOK\r\n" : "\r\nOK\r\n");
+        } else if (strncmp(at, "+CASEND=0,", 10) == 0) {
+            _dataExpected = (size_t)atoi(at + 10);
+            _dataMode = DATA_SOCKET;
+            emit(t, "\r\n> ");
+        } else if (statusAnswer(at, strcspn(at, ";")) != NULL) {
+            emitStatus(t, at);
+        } else {
+            // HTTPINIT, HTTPPARA, HTTPTERM, CSSLCFG, CASSLCFG, CACLOSE
+            emit(t, "\r\nOK\r\n");
+        }
+    }
+
+    static const char* statusAnswer(const char* query, size_t length) {
+        for (size_t i = 0; i < sizeof(STATUS_ANSWERS) / sizeof(STATUS_ANSWERS[0]); i++) {
+            if (strlen(STATUS_ANSWERS[i][0]) == length && strncmp(query, STATUS_ANSWERS[i][0], length) == 0) {
+                return STATUS_ANSWERS[i][1];
+            }
+        }
+        return NULL;
+    }
+
+    // One answer line per ';'-separated query, then a single OK
+    void emitStatus(uint64_t t, const char* queries) {
+        char answer[256] = "";
+        const char* query = queries;
+        for (;;) {
+            const char* end = strchr(query, ';');
+            size_t length = end ? (size_t)(end - query) : strlen(query);
+            const char* line = statusAnswer(query, length);
+            if (line == NULL) {
+                strcat(answer, "\r\nERROR\r\n");
+                emit(t, answer);
+                return;
+            }
+            strcat(answer, "\r\n");
+            strcat(answer, line);
+            strcat(answer, "\r\n");
+            if (end == NULL) break;
+            query = end + 1;
+        }
+        strcat(answer, "\r\nOK\r\n");
+        emit(t, answer);
+    }
+
+    void dataComplete() {
+        uint64_t t = _rxFreeUs + _link.turnaroundMs * 1000ULL;
+        DataMode mode = _dataMode;
+        _dataMode = DATA_NONE;
+        emit(t, "\r\nOK\r\n");
+        if (mode == DATA_SOCKET && _socketOpen) {
+            for (const char* p = RESPONSE; *p; p++) _socketData.push_back(*p);
+            emit(t + exchangeUs(), "\r\n+CADATAIND: 0\r\n");
+        }
+    }
+
+    LinkModel _link;
+    uint64_t _nowUs;
+    uint64_t _rxFreeUs;  // Host -> modem UART busy until
+    uint64_t _txFreeUs;  // Modem -> host UART busy until
+    std::deque<Byte> _output;
+    std::deque<char> _socketData;
+    char _line[AT_COMMAND_MAX + 4];
+    size_t _lineLength;
+    size_t _dataExpected;
+    DataMode _dataMode;
+    bool _socketOpen;
+    uint32_t _commands;
+    uint32_t _uartBytes;
+};
+
+// One command to completion on simulated time, like modemWait()
+static bool run(ModemEmulator& modem, AtEngine& engine, AtRequest request) {
+    AtResult result;
+    request.result = &result;
+    if (!engine.submit(request)) return false;
+    while (!result.done()) {
+        engine.poll(modem.nowMs());
+        modem.advanceUs(100);
+    }
+    return result.ok();
+}
+
+static void waitUntil(ModemEmulator& modem, AtEngine& engine, volatile bool& flag) {
+    while (!flag) {
+        engine.poll(modem.nowMs());
+        modem.advanceUs(100);
+    }
+}
+
+// The per-post sequence sendViaCellular() ran before the socket transport
+static bool postHttpApplication(ModemEmulator& modem, AtEngine& engine, const char* body) {
+    char command[AT_COMMAND_MAX];
+    bool ok = run(modem, engine, AtRequest("+HTTPINIT"));
+    ok = ok && run(modem, engine, AtRequest("+HTTPPARA=\"CID\",1"));
+    snprintf(command, sizeof(command), "+HTTPPARA=\"URL\",\"https://%s/services/apexrest/sensor\"", SITE);
+    ok = ok && run(modem, engine, AtRequest(command));
+    ok = ok && run(modem, engine, AtRequest("+HTTPPARA=\"CONTENT\",\"application/json\""));
+
+    snprintf(command, sizeof(command), "+HTTPDATA=%u,10000", (unsigned)strlen(body));
+    AtRequest data(command, NULL, 12000);
+    data.prompt = "DOWNLOAD";
+    data.payload = (const uint8_t*)body;
+    data.payloadLength = strlen(body);
+    ok = ok && run(modem, engine, data);
+
+    AtRequest action("+HTTPACTION=1", "+HTTPACTION:", 30000);
+    action.untilPrefix = true;
+    ok = ok && run(modem, engine, action);
+    run(modem, engine, AtRequest("+HTTPTERM"));
+    return ok;
+}
+
+static volatile bool dataIndicated = false;
+
+static void onDataIndication(const char* line, void* context) {
+    dataIndicated = true;
+}
+
+// What CellularConnection::post() costs through TinyGsmClientSecure:
+// connected() is a +CASTATE? query, a new socket is configured and
+// opened, then one CASEND with header and body and CARECV reads until
+// the response parser is done
+static bool postKeptSocket(ModemEmulator& modem, AtEngine& engine, const char* body, bool& reused) {
+    AtResult state;
+    AtRequest query("+CASTATE?", "+CASTATE:");
+    query.result = &state;
+    engine.submit(query);
+    while (!state.done()) {
+        engine.poll(modem.nowMs());
+        modem.advanceUs(100);
+    }
+    reused = state.ok() && state.line[0] != '\0';
+
+    char command[AT_COMMAND_MAX];
+    if (!reused) {
+        run(modem, engine, AtRequest("+CSSLCFG=\"sslversion\",0,3"));
+        run(modem, engine, AtRequest("+CASSLCFG=0,\"SSL\",1"));
+        run(modem, engine, AtRequest("+CASSLCFG=0,\"crindex\",0"));
+        snprintf(command, sizeof(command), "+CAOPEN=0,0,\"%s\",443", SITE);
+        if (!run(modem, engine, AtRequest(command, "+CAOPEN:", 30000))) return false;
+    }
+
+    char request[1024];
+    int length = snprintf(request, sizeof(request),
+                          "POST /services/apexrest/sensor HTTP/1.1\r\n"
+                          "Host: %s\r\n"
+                          "Content-Type: application/json\r\n"
+                          "Content-Length: %u\r\n"
+                          "Connection: keep-alive\r\n"
+                          "\r\n%s",
+                          SITE, (unsigned)strlen(body), body);
+    snprintf(command, sizeof(command), "+CASEND=0,%d", length);
+    AtRequest send(command, NULL, 10000);
+    send.prompt = ">";
+    send.payload = (const uint8_t*)request;
+    send.payloadLength = (size_t)length;
+    dataIndicated = false;
+    if (!run(modem, engine, send)) return false;
+
+    waitUntil(modem, engine, dataIndicated);
+    HttpResponseParser response;
+    uint8_t buffer[128];
+    while (!response.done() && !response.failed()) {
+        size_t n = modem.receiveSocket(buffer, sizeof(buffer));
+        if (n == 0) return false;
+        response.feed(buffer, n);
+    }
+    return response.done() && response.status() == 200;
+}
+
+static const char* const BODY =
+    "{\"temperature\":72.5,\"humidity\":41.0,\"deviceId\":\"ESP32-001\",\"function\":\"Periodic\","
+    "\"idempotencyKey\":\"ESP32-001-12-345\",\"connectionType\":\"Cellular\",\"latitude\":37.774928,"
+    "\"longitude\":-122.419418,\"gpsAltitude\":16.20,\"gpsSpeed\":0.22,\"gpsSatellites\":7,\"gpsAge\":1,"
+    "\"batteryVoltage\":4012,\"batteryAge\":30,\"signalQuality\":18,\"signalAge\":30,"
+    "\"networkOperator\":\"Hologram\",\"operatorAge\":60,\"apiKey\":\"LawnMonitor2024SecretKey\"}";
+
+static const int POSTS = 10;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_benchmark_http_application_vs_kept_socket(void) {
+    uint64_t httpUs[POSTS];
+    uint32_t httpCommands;
+    {
+        ModemEmulator modem(LTE_M);
+        AtEngine engine(modem);
+        for (int i = 0; i < POSTS; i++) {
+            uint64_t start = modem.nowUs();
+            TEST_ASSERT_TRUE(postHttpApplication(modem, engine, BODY));
+            httpUs[i] = modem.nowUs() - start;
+            modem.advanceUs(60 * 1000000ULL);  // A reading a minute
+        }
+        httpCommands = modem.commands();
+    }
+
+    uint64_t socketUs[POSTS];
+    uint32_t socketCommands;
+    {
+        ModemEmulator modem(LTE_M);
+        AtEngine engine(modem);
+        engine.onUrc("+CADATAIND:", onDataIndication);
+        for (int i = 0; i < POSTS; i++) {
+            bool reused;
+            uint64_t start = modem.nowUs();
+            TEST_ASSERT_TRUE(postKeptSocket(modem, engine, BODY, reused));
+            socketUs[i] = modem.nowUs() - start;
+            TEST_ASSERT_EQUAL(i > 0, reused);
+            TEST_ASSERT_EQUAL(0, modem.socketPending());
+            modem.advanceUs(30 * 1000000ULL);  // Inside CELL_IDLE_CLOSE_MS
+        }
+        socketCommands = modem.commands();
+        TEST_ASSERT_EQUAL(0, engine.timeouts());
+    }
+
+    uint64_t httpSteady = 0, socketSteady = 0;
+    for (int i = 1; i < POSTS; i++) {
+        httpSteady += httpUs[i];
+        socketSteady += socketUs[i];
+    }
+    httpSteady /= POSTS - 1;
+    socketSteady /= POSTS - 1;
+
+    char message[160];
+    snprintf(message, sizeof(message), "AT-HTTP: first %lu ms, then %lu ms per post, %lu AT commands for %d posts",
+             (unsigned long)(httpUs[0] / 1000), (unsigned long)(httpSteady / 1000), (unsigned long)httpCommands, POSTS);
+    TEST_MESSAGE(message);
+    snprintf(message, sizeof(message), "Socket:  first %lu ms, then %lu ms per post, %lu AT commands for %d posts",
+             (unsigned long)(socketUs[0] / 1000), (unsigned long)(socketSteady / 1000), (unsigned long)socketCommands,
+             POSTS);
+    TEST_MESSAGE(message);
+
+    // The first post pays the handshake either way; after that the kept
+    // socket skips DNS, TCP and TLS
+    TEST_ASSERT_UINT32_WITHIN(500000, httpUs[0], socketUs[0]);
+    TEST_ASSERT_LESS_THAN(httpSteady / 2, socketSteady);
+    TEST_ASSERT_LESS_THAN(httpCommands, socketCommands);
+}
+
+// A socket the network dropped while idle is reopened on the next post
+void test_dropped_socket_reopens(void) {
+    ModemEmulator modem(LTE_M);
+    AtEngine engine(modem);
+    engine.onUrc("+CADATAIND:", onDataIndication);
+    bool reused;
+    TEST_ASSERT_TRUE(postKeptSocket(modem, engine, BODY, reused));
+    modem.dropSocket();
+    TEST_ASSERT_TRUE(postKeptSocket(modem, engine, BODY, reused));
+    TEST_ASSERT_FALSE(reused);
+    TEST_ASSERT_TRUE(postKeptSocket(modem, engine, BODY, reused));
+    TEST_ASSERT_TRUE(reused);
+}
+
+// The four status queries as separate exchanges, the way
+// updateBatteryVoltage(), updateSignalQuality(), updateNetworkOperator()
+// and isNetworkConnected() each did one
+static bool pollStatusSeparately(ModemEmulator& modem, AtEngine& engine, ModemStatus& status) {
+    for (size_t i = 0; i < sizeof(STATUS_ANSWERS) / sizeof(STATUS_ANSWERS[0]); i++) {
+        AtResult result;
+        AtRequest request(STATUS_ANSWERS[i][0]);
+        request.result = &result;
+        if (!engine.submit(request)) return false;
+        while (!result.done()) {
+            engine.poll(modem.nowMs());
+            modem.advanceUs(100);
+        }
+        // The bare information line is the whole answer, prefix included
+        if (!result.ok() || !parseModemStatusLine(result.line, status)) return false;
+    }
+    return true;
+}
+
+static bool onStatusLine(const char* line, void* context) {
+    return parseModemStatusLine(line, *(ModemStatus*)context);
+}
+
+// What refreshDiagnostics() sends now: one line, demultiplexed as it
+// arrives
+static bool pollStatusCombined(ModemEmulator& modem, AtEngine& engine, ModemStatus& status) {
+    AtRequest request(MODEM_STATUS_COMMAND);
+    request.onLine = onStatusLine;
+    request.context = &status;
+    return run(modem, engine, request);
+}
+
+void test_benchmark_combined_status_poll(void) {
+    const int polls = 20;
+    uint64_t separateUs, combinedUs;
+    uint32_t separateBytes, combinedBytes;
+    ModemStatus separate, combined;
+
+    {
+        ModemEmulator modem(LTE_M);
+        AtEngine engine(modem);
+        uint64_t start = modem.nowUs();
+        for (int i = 0; i < polls; i++) {
+            memset(&separate, 0, sizeof(separate));
+            TEST_ASSERT_TRUE(pollStatusSeparately(modem, engine, separate));
+        }
+        separateUs = (modem.nowUs() - start) / polls;
+        separateBytes = modem.uartBytes() / polls;
+        TEST_ASSERT_EQUAL_UINT32(4 * polls, modem.commands());
+    }
+    {
+        ModemEmulator modem(LTE_M);
+        AtEngine engine(modem);
+        uint64_t start = modem.nowUs();
+        for (int i = 0; i < polls; i++) {
+            memset(&combined, 0, sizeof(combined));
+            TEST_ASSERT_TRUE(pollStatusCombined(modem, engine, combined));
+        }
+        combinedUs = (modem.nowUs() - start) / polls;
+        combinedBytes = modem.uartBytes() / polls;
+        TEST_ASSERT_EQUAL_UINT32(polls, modem.commands());
+        TEST_ASSERT_EQUAL_UINT32(0, engine.unsolicited());
+    }
+
+    // Same answers either way
+    TEST_ASSERT_EQUAL_UINT8(STATUS_ALL, separate.fields);
+    TEST_ASSERT_EQUAL_UINT8(STATUS_ALL, combined.fields);
+    TEST_ASSERT_EQUAL_INT32(4012, combined.battery.millivolts);
+    TEST_ASSERT_EQUAL_INT32(18, combined.signal.rssi);
+    TEST_ASSERT_EQUAL_STRING("Hologram", combined.network.name);
+    TEST_ASSERT_TRUE(combined.registration.registered());
+    TEST_ASSERT_EQUAL_MEMORY(&separate, &combined, sizeof(combined));
+
+    char message[128];
+    snprintf(message, sizeof(message), "Status poll: 4 exchanges %lu us / %lu UART bytes, combined %lu us / %lu bytes",
+             (unsigned long)separateUs, (unsigned long)separateBytes, (unsigned long)combinedUs,
+             (unsigned long)combinedBytes);
+    TEST_MESSAGE(message);
+
+    // Three command turnarounds fewer
+    TEST_ASSERT_LESS_THAN(separateUs - 3 * LTE_M.turnaroundMs * 1000ULL + 1000, combinedUs);
+    TEST_ASSERT_LESS_THAN(separateBytes, combinedBytes);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_http_application_vs_kept_socket);
+    RUN_TEST(test_dropped_socket_reopens);
+    RUN_TEST(test_benchmark_combined_status_poll);
+    return UNITY_END();
+}
@@ -0,0 +1,254 @@
+#include <unity.h>
+
+#include "CoopScheduler.h"
+
+// Virtual clocks: tasks advance them to simulate their own run time
+static uint32_t nowMs;
+static uint32_t nowUs;
+static uint32_t millisClock() { return nowMs; }
+static uint32_t microsClock() { return nowUs; }
+
+static CoopScheduler* scheduler;
+static int order[32];
+static int orderCount;
+static int runsA, runsB, runsC;
+static int selfId;
+
+static void record(int task) {
+    if (orderCount < 32) order[orderCount++] = task;
+}
+
+static void taskA() {
+    runsA++;
+    nowUs += 300;
+    record(0);
+}
+
+static void taskB() {
+    runsB++;
+    record(1);
+}
+
+static void taskC() {
+    runsC++;
+    record(2);
+}
+
+// Overruns by 30 ms, the way a blocking upload would
+static void slowTask() {
+    runsB++;
+    nowMs += 30;
+    nowUs += 30000;
+}
+
+static void retriggeringTask() {
+    runsC++;
+    if (runsC < 3) scheduler->trigger(selfId, 5);
+}
+
+// Run until the virtual clock reaches endMs, sleeping through idle time
+static void runUntil(CoopScheduler& s, uint32_t endMs) {
+    while ((int32_t)(nowMs - endMs) < 0) {
+        uint32_t idle = s.runOnce();
+        if (idle > 0) nowMs += idle < endMs - nowMs ? idle : endMs - nowMs;
+    }
+}
+
+void setUp(void) {
+    nowMs = 1000;
+    nowUs = 0;
+    orderCount = 0;
+    runsA = runsB = runsC = 0;
+}
+
+void tearDown(void) {}
+
+void test_periodic_tasks_run_on_period(void) {
+    CoopScheduler s(millisClock, microsClock);
+    int a = s.add("a", taskA, 10);
+    int b = s.add("b", taskB, 25);
+    TEST_ASSERT_EQUAL(0, a);
+    TEST_ASSERT_EQUAL(1, b);
+    TEST_ASSERT_EQUAL(2, s.taskCount());
+    TEST_ASSERT_EQUAL_STRING("b", s.name(b));
+
+    runUntil(s, 1100);
+    TEST_ASSERT_EQUAL(10, runsA);  // 1000, 1010, ... 1090
+    TEST_ASSERT_EQUAL(4, runsB);   // 1000, 1025, 1050, 1075
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(a)->missedDeadlines);
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(b)->missedDeadlines);
+}
+
+void test_idle_time_until_next_due(void) {
+    CoopScheduler s(millisClock, microsClock);
+    s.add("a", taskA, 10);
+    s.add("b", taskB, 4);
+    TEST_ASSERT_EQUAL_UINT32(0, s.runOnce());  // b still due
+    TEST_ASSERT_EQUAL_UINT32(4, s.runOnce());
+    nowMs += 3;
+    TEST_ASSERT_EQUAL_UINT32(1, s.runOnce());
+}
+
+void test_nothing_scheduled_idles_forever(void) {
+    CoopScheduler s(millisClock, microsClock);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, s.runOnce());
+    s.add("c", taskC, 0);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, s.runOnce());
+    TEST_ASSERT_EQUAL(0, runsC);
+}
+
+// Among due tasks the one whose deadline is nearest runs first,
+// regardless of the order they were added in
+void test_earliest_deadline_first(void) {
+    CoopScheduler s(millisClock, microsClock);
+    s.add("a", taskA, 100, 50);
+    s.add("b", taskB, 100, 5);
+    s.add("c", taskC, 100, 20);
+    s.runOnce();
+    s.runOnce();
+    s.runOnce();
+    TEST_ASSERT_EQUAL(3, orderCount);
+    TEST_ASSERT_EQUAL(1, order[0]);
+    TEST_ASSERT_EQUAL(2, order[1]);
+    TEST_ASSERT_EQUAL(0, order[2]);
+}
+
+void test_triggered_task(void) {
+    CoopScheduler s(millisClock, microsClock);
+    int c = s.add("c", taskC, 0);
+    runUntil(s, 1050);
+    TEST_ASSERT_EQUAL(0, runsC);
+
+    s.trigger(c, 7);
+    TEST_ASSERT_EQUAL_UINT32(7, s.runOnce());
+    runUntil(s, 1056);
+    TEST_ASSERT_EQUAL(0, runsC);
+    runUntil(s, 1100);
+    TEST_ASSERT_EQUAL(1, runsC);  // Once per trigger
+
+    // A later trigger never pushes back an earlier one
+    s.trigger(c, 5);
+    s.trigger(c, 50);
+    runUntil(s, 1106);
+    TEST_ASSERT_EQUAL(2, runsC);
+}
+
+void test_task_can_retrigger_itself(void) {
+    CoopScheduler s(millisClock, microsClock);
+    scheduler = &s;
+    selfId = s.add("self", retriggeringTask, 0);
+    s.trigger(selfId);
+    runUntil(s, 1100);
+    TEST_ASSERT_EQUAL(3, runsC);
+}
+
+// A slow task makes the others start late: the lateness is counted,
+// and a task that fell whole periods behind skips them rather than
+// running back to back to catch up
+void test_missed_deadlines_and_catch_up(void) {
+    CoopScheduler s(millisClock, microsClock);
+    int a = s.add("a", taskA, 10, 5);
+    int slow = s.add("slow", slowTask, 100);
+    runUntil(s, 1200);
+
+    const CoopScheduler::TaskStats* stats = s.stats(a);
+    TEST_ASSERT_EQUAL_UINT32(2, s.stats(slow)->runs);
+    TEST_ASSERT_GREATER_THAN(0, stats->missedDeadlines);
+    // 20 slots in 200 ms, less the two blocked for 30 ms each
+    TEST_ASSERT_LESS_OR_EQUAL(20, runsA);
+    TEST_ASSERT_GREATER_OR_EQUAL(14, runsA);
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(slow)->missedDeadlines);
+}
+
+void test_run_time_stats(void) {
+    CoopScheduler s(millisClock, microsClock);
+    int a = s.add("a", taskA, 10);
+    int slow = s.add("slow", slowTask, 100);
+    runUntil(s, 1100);
+
+    const CoopScheduler::TaskStats* stats = s.stats(a);
+    TEST_ASSERT_EQUAL_UINT32(300, stats->lastRunUs);
+    TEST_ASSERT_EQUAL_UINT32(300, stats->maxRunUs);
+    TEST_ASSERT_EQUAL_UINT64(300ull * stats->runs, stats->totalRunUs);
+    TEST_ASSERT_EQUAL_UINT32(30000, s.stats(slow)->maxRunUs);
+
+    // Without a microsecond clock only runs are counted
+    CoopScheduler plain(millisClock);
+    int p = plain.add("a", taskA, 10);
+    plain.runOnce();
+    TEST_ASSERT_EQUAL_UINT32(1, plain.stats(p)->runs);
+    TEST_ASSERT_EQUAL_UINT32(0, plain.stats(p)->maxRunUs);
+}
+
+// Re-enabling resumes one period later instead of bursting through the
+// slots missed while disabled
+void test_disable_and_resume(void) {
+    CoopScheduler s(millisClock, microsClock);
+    int a = s.add("a", taskA, 10);
+    s.runOnce();
+    TEST_ASSERT_EQUAL(1, runsA);
+    s.setEnabled(a, false);
+    runUntil(s, 1500);
+    TEST_ASSERT_EQUAL(1, runsA);
+
+    s.setEnabled(a, true);
+    TEST_ASSERT_EQUAL_UINT32(10, s.runOnce());
+    runUntil(s, 1511);
+    TEST_ASSERT_EQUAL(2, runsA);
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(a)->missedDeadlines);
+}
+
+void test_set_period(void) {
+    CoopScheduler s(millisClock, microsClock);
+    int a = s.add("a", taskA, 1000);
+    s.runOnce();
+
+    // Shortening takes effect now rather than after the old period
+    s.setPeriod(a, 10);
+    runUntil(s, 1101);
+    TEST_ASSERT_EQUAL(11, runsA);
+
+    // Period 0 turns it into a triggered task
+    s.setPeriod(a, 0);
+    runUntil(s, 1200);
+    TEST_ASSERT_GREATER_OR_EQUAL(11, runsA);
+    TEST_ASSERT_LESS_OR_EQUAL(12, runsA);
+}
+
+void test_millis_wraparound(void) {
+    nowMs = UINT32_MAX - 25;
+    CoopScheduler s(millisClock, microsClock);
+    int a = s.add("a", taskA, 10);
+    runUntil(s, 25);
+    TEST_ASSERT_EQUAL(6, runsA);
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(a)->missedDeadlines);
+}
+
+void test_table_limits(void) {
+    CoopScheduler s(millisClock, microsClock);
+    TEST_ASSERT_EQUAL(-1, s.add("null", NULL, 10));
+    for (int i = 0; i < CoopScheduler::MAX_TASKS; i++) TEST_ASSERT_EQUAL(i, s.add("t", taskB, 10));
+    TEST_ASSERT_EQUAL(-1, s.add("full", taskB, 10));
+    TEST_ASSERT_NULL(s.stats(CoopScheduler::MAX_TASKS));
+    TEST_ASSERT_NULL(s.name(-1));
+    s.trigger(-1);
+    s.setEnabled(99, false);
+    s.setPeriod(99, 5);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_periodic_tasks_run_on_period);
+    RUN_TEST(test_idle_time_until_next_due);
+    RUN_TEST(test_nothing_scheduled_idles_forever);
+    RUN_TEST(test_earliest_deadline_first);
+    RUN_TEST(test_triggered_task);
+    RUN_TEST(test_task_can_retrigger_itself);
+    RUN_TEST(test_missed_deadlines_and_catch_up);
+    RUN_TEST(test_run_time_stats);
+    RUN_TEST(test_disable_and_resume);
+    RUN_TEST(test_set_period);
+    RUN_TEST(test_millis_wraparound);
+    RUN_TEST(test_table_limits);
+    return UNITY_END();
+}
@@ -0,0 +1,53 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "Crc32.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Standard check value for CRC-32/ISO-HDLC
+void test_check_value(void) {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32("123456789", 9));
+}
+
+void test_known_values(void) {
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, crc32("", 0));
+    TEST_ASSERT_EQUAL_HEX32(0xE8B7BE43, crc32("a", 1));
+    const char* fox = "The quick brown fox jumps over the lazy dog";
+    TEST_ASSERT_EQUAL_HEX32(0x414FA339, crc32(fox, strlen(fox)));
+}
+
+// Pieces chained through the previous result match one pass, at every
+// split point
+void test_incremental(void) {
+    const char* text = "The quick brown fox jumps over the lazy dog";
+    size_t length = strlen(text);
+    uint32_t whole = crc32(text, length);
+    for (size_t split = 0; split <= length; split++) {
+        uint32_t crc = crc32(text, split);
+        TEST_ASSERT_EQUAL_HEX32(whole, crc32(text + split, length - split, crc));
+    }
+}
+
+// Any single bit flip in a record changes the checksum
+void test_detects_bit_flips(void) {
+    uint8_t record[64];
+    for (size_t i = 0; i < sizeof(record); i++) record[i] = (uint8_t)(i * 37);
+    uint32_t original = crc32(record, sizeof(record));
+    for (size_t bit = 0; bit < sizeof(record) * 8; bit++) {
+        record[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+        TEST_ASSERT_NOT_EQUAL(original, crc32(record, sizeof(record)));
+        record[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_check_value);
+    RUN_TEST(test_known_values);
+    RUN_TEST(test_incremental);
+    RUN_TEST(test_detects_bit_flips);
+    return UNITY_END();
+}
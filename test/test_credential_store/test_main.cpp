@@ -0,0 +1,377 @@
+#include <unity.h>
+
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "CredentialStore.h"
+
+// One NVS blob key. Counts loads and saves, can fail the next save, and
+// keeps what was stored so a second store can "reboot" from it.
+class FakeBlob : public BlobStorage {
+public:
+    FakeBlob() : length(0), loads(0), saves(0), failSaves(false) {}
+
+    size_t load(void* data, size_t size) {
+        loads++;
+        if (length == 0 || length > size) return 0;
+        memcpy(data, bytes, length);
+        return length;
+    }
+
+    bool save(const void* data, size_t n) {
+        saves++;
+        if (failSaves || n > sizeof(bytes)) return false;
+        memcpy(bytes, data, n);
+        length = n;
+        return true;
+    }
+
+    uint8_t bytes[2048];
+    size_t length;
+    int loads;
+    int saves;
+    bool failSaves;
+};
+
+static void fillSsid(char* out, int i) {
+    snprintf(out, CredentialStore::SSID_MAX + 1, "Network-%02d", i);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_store(void) {
+    FakeBlob blob;
+    CredentialStore store(blob);
+    TEST_ASSERT_FALSE(store.begin());
+    TEST_ASSERT_EQUAL(0, store.count());
+    TEST_ASSERT_NULL(store.password("Home"));
+    TEST_ASSERT_FALSE(store.contains(""));
+    TEST_ASSERT_FALSE(store.forget("Home"));
+    TEST_ASSERT_EQUAL(0, blob.saves);
+}
+
+void test_save_lookup_and_reload(void) {
+    FakeBlob blob;
+    {
+        CredentialStore store(blob);
+        store.begin();
+        TEST_ASSERT_TRUE(store.save("Home", "hunter22"));
+        TEST_ASSERT_TRUE(store.save("Cafe, Main St", ""));  // Open network
+        TEST_ASSERT_TRUE(store.save("Garage", NULL));
+        TEST_ASSERT_EQUAL_STRING("hunter22", store.password("Home"));
+        TEST_ASSERT_EQUAL_STRING("", store.password("Cafe, Main St"));
+        TEST_ASSERT_NULL(store.password("home"));  // SSIDs are case sensitive
+        TEST_ASSERT_EQUAL(3, blob.saves);          // One write per change
+        TEST_ASSERT_EQUAL(blob.length, store.recordSize());
+    }
+
+    CredentialStore reloaded(blob);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL(3, reloaded.count());
+    TEST_ASSERT_EQUAL_STRING("Home", reloaded.ssid(0));
+    TEST_ASSERT_EQUAL_STRING("Cafe, Main St", reloaded.ssid(1));
+    TEST_ASSERT_EQUAL_STRING("hunter22", reloaded.passwordAt(0));
+    TEST_ASSERT_EQUAL_STRING("", reloaded.password("Garage"));
+
+    // Lookups are served from RAM
+    int loads = blob.loads;
+    for (int i = 0; i < 100; i++) reloaded.password("Home");
+    TEST_ASSERT_EQUAL(loads, blob.loads);
+}
+
+// Updating keeps the network's place; an unchanged password is not written
+void test_update_password(void) {
+    FakeBlob blob;
+    CredentialStore store(blob);
+    store.begin();
+    store.save("Home", "old");
+    store.save("Work", "w");
+    TEST_ASSERT_TRUE(store.save("Home", "new"));
+    TEST_ASSERT_EQUAL_STRING("Home", store.ssid(0));
+    TEST_ASSERT_EQUAL_STRING("new", store.password("Home"));
+    TEST_ASSERT_EQUAL(2, store.count());
+    TEST_ASSERT_EQUAL(3, blob.saves);
+
+    TEST_ASSERT_TRUE(store.save("Home", "new"));
+    TEST_ASSERT_EQUAL(3, blob.saves);
+    TEST_ASSERT_EQUAL_UINT32(3, store.writes());
+}
+
+void test_forget_and_clear(void) {
+    FakeBlob blob;
+    CredentialStore store(blob);
+    store.begin();
+    store.save("A", "1");
+    store.save("B", "2");
+    store.save("C", "3");
+    TEST_ASSERT_TRUE(store.forget("B"));
+    TEST_ASSERT_EQUAL(2, store.count());
+    TEST_ASSERT_EQUAL_STRING("C", store.ssid(1));
+    TEST_ASSERT_FALSE(store.contains("B"));
+    TEST_ASSERT_EQUAL_STRING("3", store.password("C"));  // Index rebuilt
+    TEST_ASSERT_EQUAL(4, blob.saves);
+
+    TEST_ASSERT_TRUE(store.clear());
+    TEST_ASSERT_EQUAL(0, store.count());
+    CredentialStore reloaded(blob);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL(0, reloaded.count());
+}
+
+// A full store evicts the oldest network
+void test_capacity_evicts_oldest(void) {
+    FakeBlob blob;
+    CredentialStore store(blob);
+    store.begin();
+    char ssid[CredentialStore::SSID_MAX + 1];
+    for (int i = 0; i < CredentialStore::CAPACITY + 2; i++) {
+        fillSsid(ssid, i);
+        TEST_ASSERT_TRUE(store.save(ssid, "password"));
+    }
+    TEST_ASSERT_EQUAL(CredentialStore::CAPACITY, store.count());
+    TEST_ASSERT_FALSE(store.contains("Network-00"));
+    TEST_ASSERT_FALSE(store.contains("Network-01"));
+    TEST_ASSERT_EQUAL_STRING("Network-02", store.ssid(0));
+    for (int i = 2; i < CredentialStore::CAPACITY + 2; i++) {
+        fillSsid(ssid, i);
+        TEST_ASSERT_TRUE(store.contains(ssid));
+    }
+}
+
+void test_field_limits(void) {
+    FakeBlob blob;
+    CredentialStore store(blob);
+    store.begin();
+    char ssid[CredentialStore::SSID_MAX + 2];
+    char password[CredentialStore::PASSWORD_MAX + 2];
+    memset(ssid, 's', sizeof(ssid) - 1);
+    ssid[sizeof(ssid) - 1] = '\0';
+    memset(password, 'p', sizeof(password) - 1);
+    password[sizeof(password) - 1] = '\0';
+
+    TEST_ASSERT_FALSE(store.save(ssid, "x"));      // 33 chars
+    TEST_ASSERT_FALSE(store.save("Home", password));  // 65 chars
+    TEST_ASSERT_FALSE(store.save("", "x"));
+    TEST_ASSERT_FALSE(store.save(NULL, "x"));
+
+    ssid[CredentialStore::SSID_MAX] = '\0';
+    password[CredentialStore::PASSWORD_MAX] = '\0';
+    TEST_ASSERT_TRUE(store.save(ssid, password));
+    CredentialStore reloaded(blob);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL_STRING(password, reloaded.password(ssid));
+    TEST_ASSERT_EQUAL(1, blob.saves);
+}
+
+// The largest possible record fits and reloads
+void test_full_store_round_trip(void) {
+    FakeBlob blob;
+    CredentialStore store(blob);
+    store.begin();
+    char ssid[CredentialStore::SSID_MAX + 1];
+    char password[CredentialStore::PASSWORD_MAX + 1];
+    for (int i = 0; i < CredentialStore::CAPACITY; i++) {
+        memset(ssid, 'a' + i, CredentialStore::SSID_MAX);
+        ssid[CredentialStore::SSID_MAX] = '\0';
+        memset(password, 'A' + i, CredentialStore::PASSWORD_MAX);
+        password[CredentialStore::PASSWORD_MAX] = '\0';
+        TEST_ASSERT_TRUE(store.save(ssid, password));
+    }
+    CredentialStore reloaded(blob);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL(CredentialStore::CAPACITY, reloaded.count());
+    TEST_ASSERT_EQUAL(password[0], reloaded.password(ssid)[0]);
+}
+
+// A damaged record is ignored rather than half-loaded
+void test_corrupt_record_starts_empty(void) {
+    FakeBlob blob;
+    {
+        CredentialStore store(blob);
+        store.begin();
+        store.save("Home", "hunter22");
+        store.save("Work", "secret");
+    }
+    FakeBlob good = blob;
+
+    for (size_t i = 0; i < good.length; i++) {
+        blob = good;
+        blob.bytes[i] ^= 0x40;
+        CredentialStore store(blob);
+        TEST_ASSERT_FALSE(store.begin());
+        TEST_ASSERT_EQUAL(0, store.count());
+        TEST_ASSERT_NULL(store.password("Home"));
+    }
+
+    // Truncated, or with trailing bytes
+    blob = good;
+    blob.length--;
+    CredentialStore truncated(blob);
+    TEST_ASSERT_FALSE(truncated.begin());
+    blob = good;
+    blob.length++;
+    CredentialStore padded(blob);
+    TEST_ASSERT_FALSE(padded.begin());
+}
+
+void test_storage_failure_reported(void) {
+    FakeBlob blob;
+    CredentialStore store(blob);
+    store.begin();
+    blob.failSaves = true;
+    TEST_ASSERT_FALSE(store.save("Home", "x"));
+    TEST_ASSERT_FALSE(store.forget("Home"));
+}
+
+// Many SSIDs sharing index slots still resolve; absent ones are misses
+void test_index_collisions(void) {
+    FakeBlob blob;
+    CredentialStore store(blob);
+    store.begin();
+    char ssid[CredentialStore::SSID_MAX + 1];
+    for (int i = 0; i < CredentialStore::CAPACITY; i++) {
+        snprintf(ssid, sizeof(ssid), "%c", 'A' + i);
+        char password[4];
+        snprintf(password, sizeof(password), "%d", i);
+        store.save(ssid, password);
+    }
+    for (int i = 0; i < CredentialStore::CAPACITY; i++) {
+        snprintf(ssid, sizeof(ssid), "%c", 'A' + i);
+        char password[4];
+        snprintf(password, sizeof(password), "%d", i);
+        TEST_ASSERT_EQUAL_STRING(password, store.password(ssid));
+    }
+    for (int i = 0; i < 200; i++) {
+        snprintf(ssid, sizeof(ssid), "absent-%d", i);
+        TEST_ASSERT_NULL(store.password(ssid));
+    }
+}
+
+// The key-per-slot scheme the store replaced: "ssid<i>"/"pass<i>"
+// strings in a "wifi" namespace, MAX_SAVED_NETWORKS 5, shifting every
+// slot on eviction and forget
+class LegacyNvs {
+public:
+    static const int SLOTS = 5;
+
+    LegacyNvs() : reads(0), writes(0) {}
+
+    std::string get(const std::string& key) {
+        reads++;
+        return _keys.count(key) ? _keys[key] : "";
+    }
+
+    void put(const std::string& key, const std::string& value) {
+        writes++;
+        _keys[key] = value;
+    }
+
+    static std::string ssidKey(int i) { return "ssid" + std::to_string(i); }
+    static std::string passKey(int i) { return "pass" + std::to_string(i); }
+
+    void save(const std::string& ssid, const std::string& password) {
+        for (int i = 0; i < SLOTS; i++) {
+            std::string existing = get(ssidKey(i));
+            if (existing == "" || existing == ssid) {
+                put(ssidKey(i), ssid);
+                put(passKey(i), password);
+                return;
+            }
+        }
+        for (int i = 0; i < SLOTS - 1; i++) {
+            put(ssidKey(i), get(ssidKey(i + 1)));
+            put(passKey(i), get(passKey(i + 1)));
+        }
+        put(ssidKey(SLOTS - 1), ssid);
+        put(passKey(SLOTS - 1), password);
+    }
+
+    std::string password(const std::string& ssid) {
+        for (int i = 0; i < SLOTS; i++) {
+            if (get(ssidKey(i)) == ssid) return get(passKey(i));
+        }
+        return "";
+    }
+
+    void forget(const std::string& ssid) {
+        int found = -1;
+        for (int i = 0; i < SLOTS && found < 0; i++) {
+            if (get(ssidKey(i)) == ssid) found = i;
+        }
+        if (found < 0) return;
+        for (int i = found; i < SLOTS - 1; i++) {
+            put(ssidKey(i), get(ssidKey(i + 1)));
+            put(passKey(i), get(passKey(i + 1)));
+        }
+        put(ssidKey(SLOTS - 1), "");
+        put(passKey(SLOTS - 1), "");
+    }
+
+    int reads;
+    int writes;
+
+private:
+    std::map<std::string, std::string> _keys;
+};
+
+// NVS traffic for the same day of use: provisioning five networks,
+// phone-initiated scans that look up every visible SSID, a new network
+// joining a full list, a password change and a forget
+void test_benchmark_nvs_writes(void) {
+    const char* const saved[] = {"Home", "Work", "Garage", "Cafe", "Library"};
+    const char* const scanned[] = {"Home", "Neighbour", "xfinitywifi", "Garage", "DIRECT-printer", "Guest", "Cafe",
+                                   "Library"};
+
+    LegacyNvs legacy;
+    FakeBlob blob;
+    CredentialStore store(blob);
+    store.begin();
+
+    for (int i = 0; i < 5; i++) {
+        legacy.save(saved[i], "password");
+        store.save(saved[i], "password");
+    }
+    for (int scan = 0; scan < 20; scan++) {
+        for (int i = 0; i < 8; i++) {
+            legacy.password(scanned[i]);
+            store.password(scanned[i]);
+        }
+    }
+    legacy.save("Hotspot", "tether");
+    store.save("Hotspot", "tether");
+    legacy.save("Home", "changed");
+    store.save("Home", "changed");
+    legacy.forget("Garage");
+    store.forget("Garage");
+
+    TEST_ASSERT_EQUAL_STRING("changed", store.password("Home"));
+    std::string legacyCafe = legacy.password("Cafe");
+    TEST_ASSERT_EQUAL_STRING(legacyCafe.c_str(), store.password("Cafe"));
+
+    char message[128];
+    snprintf(message, sizeof(message), "NVS writes: key-per-slot %d, record %d; NVS reads: key-per-slot %d, record %d",
+             legacy.writes, blob.saves, legacy.reads, blob.loads);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL(8, blob.saves);  // One per change
+    TEST_ASSERT_EQUAL(1, blob.loads);
+    TEST_ASSERT_LESS_THAN(legacy.writes / 3, blob.saves);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_store);
+    RUN_TEST(test_save_lookup_and_reload);
+    RUN_TEST(test_update_password);
+    RUN_TEST(test_forget_and_clear);
+    RUN_TEST(test_capacity_evicts_oldest);
+    RUN_TEST(test_field_limits);
+    RUN_TEST(test_full_store_round_trip);
+    RUN_TEST(test_corrupt_record_starts_empty);
+    RUN_TEST(test_storage_failure_reported);
+    RUN_TEST(test_index_collisions);
+    RUN_TEST(test_benchmark_nvs_writes);
+    return UNITY_END();
+}
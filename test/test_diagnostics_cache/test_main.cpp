@@ -0,0 +1,113 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "DiagnosticsCache.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_starts_unknown_and_due(void) {
+    DiagnosticsCache cache;
+    DiagnosticsSnapshot snapshot;
+    cache.snapshot(5000, snapshot);
+    TEST_ASSERT_EQUAL_INT32(0, snapshot.values.batteryVoltage);
+    TEST_ASSERT_EQUAL_INT32(99, snapshot.values.signalQuality);
+    TEST_ASSERT_EQUAL_STRING("", snapshot.values.networkOperator);
+    TEST_ASSERT_FALSE(snapshot.values.registered);
+    for (int i = 0; i < DIAG_METRIC_COUNT; i++) {
+        TEST_ASSERT_EQUAL_UINT32(DiagnosticsCache::NEVER, snapshot.ageMs[i]);
+        TEST_ASSERT_TRUE(cache.due((DiagnosticMetric)i, 0));
+        TEST_ASSERT_EQUAL_UINT32(60000, cache.ttl((DiagnosticMetric)i));
+    }
+}
+
+// Each metric has its own staleness budget
+void test_per_metric_ttl(void) {
+    DiagnosticsCache cache;
+    cache.setTtl(DIAG_BATTERY, 300000);
+    cache.setTtl(DIAG_SIGNAL, 30000);
+
+    cache.attempted(DIAG_BATTERY, 1000);
+    cache.setBattery(4012, 1000);
+    cache.attempted(DIAG_SIGNAL, 1000);
+    cache.setSignal(18, 1000);
+
+    TEST_ASSERT_FALSE(cache.due(DIAG_SIGNAL, 30999));
+    TEST_ASSERT_TRUE(cache.due(DIAG_SIGNAL, 31000));
+    TEST_ASSERT_FALSE(cache.due(DIAG_BATTERY, 31000));
+    TEST_ASSERT_TRUE(cache.due(DIAG_BATTERY, 301000));
+    TEST_ASSERT_TRUE(cache.due(DIAG_OPERATOR, 1000));  // Never attempted
+}
+
+// A failed refresh keeps the old value, which keeps getting older, and
+// waits a full TTL before the next attempt
+void test_failed_refresh_keeps_value(void) {
+    DiagnosticsCache cache;
+    cache.setTtl(DIAG_SIGNAL, 30000);
+    cache.attempted(DIAG_SIGNAL, 0);
+    cache.setSignal(20, 0);
+
+    cache.attempted(DIAG_SIGNAL, 30000);  // No answer this time
+    TEST_ASSERT_FALSE(cache.due(DIAG_SIGNAL, 45000));
+    TEST_ASSERT_TRUE(cache.due(DIAG_SIGNAL, 60000));
+
+    DiagnosticsSnapshot snapshot;
+    cache.snapshot(45000, snapshot);
+    TEST_ASSERT_EQUAL_INT32(20, snapshot.values.signalQuality);
+    TEST_ASSERT_EQUAL_UINT32(45000, snapshot.ageMs[DIAG_SIGNAL]);
+}
+
+void test_snapshot_ages(void) {
+    DiagnosticsCache cache;
+    cache.setBattery(3950, 1000);
+    cache.setOperator("T-Mobile", 4000);
+    cache.setRegistered(true, 9000);
+
+    DiagnosticsSnapshot snapshot;
+    cache.snapshot(10000, snapshot);
+    TEST_ASSERT_EQUAL_INT32(3950, snapshot.values.batteryVoltage);
+    TEST_ASSERT_EQUAL_STRING("T-Mobile", snapshot.values.networkOperator);
+    TEST_ASSERT_TRUE(snapshot.values.registered);
+    TEST_ASSERT_EQUAL_UINT32(9000, snapshot.ageMs[DIAG_BATTERY]);
+    TEST_ASSERT_EQUAL_UINT32(DiagnosticsCache::NEVER, snapshot.ageMs[DIAG_SIGNAL]);
+    TEST_ASSERT_EQUAL_UINT32(6000, snapshot.ageMs[DIAG_OPERATOR]);
+    TEST_ASSERT_EQUAL_UINT32(1000, snapshot.ageMs[DIAG_REGISTRATION]);
+    TEST_ASSERT_EQUAL_UINT32(1000, cache.ageMs(DIAG_REGISTRATION, 10000));
+}
+
+void test_operator_name(void) {
+    DiagnosticsCache cache;
+    cache.setOperator("A very long operator name that does not fit", 0);
+    DiagnosticsSnapshot snapshot;
+    cache.snapshot(0, snapshot);
+    TEST_ASSERT_EQUAL(sizeof(snapshot.values.networkOperator) - 1, strlen(snapshot.values.networkOperator));
+
+    // Not registered clears the name but still counts as a fresh read
+    cache.setOperator(NULL, 500);
+    cache.snapshot(600, snapshot);
+    TEST_ASSERT_EQUAL_STRING("", snapshot.values.networkOperator);
+    TEST_ASSERT_EQUAL_UINT32(100, snapshot.ageMs[DIAG_OPERATOR]);
+}
+
+void test_millis_wraparound(void) {
+    DiagnosticsCache cache;
+    cache.setTtl(DIAG_BATTERY, 1000);
+    uint32_t before = 0xFFFFFF00;
+    cache.attempted(DIAG_BATTERY, before);
+    cache.setBattery(4100, before);
+    TEST_ASSERT_FALSE(cache.due(DIAG_BATTERY, before + 999));
+    TEST_ASSERT_TRUE(cache.due(DIAG_BATTERY, before + 1000));
+    TEST_ASSERT_EQUAL_UINT32(500, cache.ageMs(DIAG_BATTERY, before + 500));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_unknown_and_due);
+    RUN_TEST(test_per_metric_ttl);
+    RUN_TEST(test_failed_refresh_keeps_value);
+    RUN_TEST(test_snapshot_ages);
+    RUN_TEST(test_operator_name);
+    RUN_TEST(test_millis_wraparound);
+    return UNITY_END();
+}
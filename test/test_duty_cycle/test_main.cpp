@@ -0,0 +1,246 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "DutyCycle.h"
+
+// src/main.cpp's defaults
+static const DutyCycleConfig CONFIG = {900, 10, 60000, 120000};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_power_on_reads_and_schedules(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 0;
+    TEST_ASSERT_TRUE(scheduler.wake(WAKE_POWER_ON, 100, 0, next));
+    TEST_ASSERT_EQUAL_UINT32(1000, next);
+    TEST_ASSERT_EQUAL(WAKE_POWER_ON, scheduler.reason());
+    TEST_ASSERT_EQUAL_STRING("Startup", wakeReadingFunction(WAKE_POWER_ON, true));
+
+    // Even with a schedule carried over, power-on starts a new one
+    next = 5000;
+    TEST_ASSERT_TRUE(scheduler.wake(WAKE_POWER_ON, 100, 0, next));
+    TEST_ASSERT_EQUAL_UINT32(1000, next);
+}
+
+void test_timer_wake(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 1000;
+    TEST_ASSERT_TRUE(scheduler.wake(WAKE_TIMER, 1000, 0, next));
+    TEST_ASSERT_EQUAL_UINT32(1900, next);
+    TEST_ASSERT_EQUAL_STRING("Periodic", wakeReadingFunction(WAKE_TIMER, true));
+
+    // Nothing interactive: sleeps as soon as the work is done
+    TEST_ASSERT_TRUE(scheduler.shouldSleep(1, false));
+    TEST_ASSERT_FALSE(scheduler.shouldSleep(1, true));
+
+    // Woken early (timer armed to the minimum): nothing due
+    TEST_ASSERT_FALSE(scheduler.wake(WAKE_TIMER, 1890, 0, next));
+    TEST_ASSERT_EQUAL_UINT32(1900, next);
+    TEST_ASSERT_NULL(wakeReadingFunction(WAKE_TIMER, false));
+}
+
+// A missing schedule (first wake after new firmware) reads now
+void test_timer_wake_without_schedule(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 0;
+    TEST_ASSERT_TRUE(scheduler.wake(WAKE_TIMER, 4000, 0, next));
+    TEST_ASSERT_EQUAL_UINT32(4900, next);
+}
+
+void test_button_and_touch_wakes(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 1900;
+    TEST_ASSERT_FALSE(scheduler.wake(WAKE_BUTTON, 1200, 500, next));
+    TEST_ASSERT_EQUAL_UINT32(1900, next);
+    TEST_ASSERT_EQUAL_STRING("Single", wakeReadingFunction(WAKE_BUTTON, false));
+    TEST_ASSERT_EQUAL_STRING("Touch", wakeReadingFunction(WAKE_TOUCH, false));
+
+    // Stays up for the interactive window, counted from the wake
+    TEST_ASSERT_FALSE(scheduler.shouldSleep(500 + CONFIG.interactiveWindowMs - 1, false));
+    TEST_ASSERT_TRUE(scheduler.shouldSleep(500 + CONFIG.interactiveWindowMs, false));
+
+    // A periodic reading that came due meanwhile is sent too
+    TEST_ASSERT_TRUE(scheduler.wake(WAKE_TOUCH, 1950, 0, next));
+    TEST_ASSERT_EQUAL_UINT32(2800, next);
+}
+
+void test_activity_extends_window(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 1900;
+    scheduler.wake(WAKE_TIMER, 1000, 0, next);
+    scheduler.activity(30000);  // Tap during a timer cycle
+    TEST_ASSERT_FALSE(scheduler.shouldSleep(60000, false));
+    TEST_ASSERT_TRUE(scheduler.shouldSleep(30000 + CONFIG.interactiveWindowMs, false));
+}
+
+// Busy keeps it up, but never past maxAwakeMs since the last activity
+void test_max_awake(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 0;
+    scheduler.wake(WAKE_POWER_ON, 100, 0, next);
+    TEST_ASSERT_FALSE(scheduler.shouldSleep(CONFIG.interactiveWindowMs, true));
+    TEST_ASSERT_FALSE(scheduler.shouldSleep(CONFIG.maxAwakeMs - 1, true));
+    TEST_ASSERT_TRUE(scheduler.shouldSleep(CONFIG.maxAwakeMs, true));
+
+    scheduler.activity(100000);
+    TEST_ASSERT_FALSE(scheduler.shouldSleep(100000 + CONFIG.maxAwakeMs - 1, true));
+    TEST_ASSERT_TRUE(scheduler.shouldSleep(100000 + CONFIG.maxAwakeMs, true));
+}
+
+void test_sleep_seconds(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 1000;
+    TEST_ASSERT_EQUAL_UINT32(830, scheduler.sleepSeconds(170, next));
+    TEST_ASSERT_EQUAL_UINT32(1000, next);
+
+    // Overran the slot: skip it rather than wake straight away
+    next = 1900;
+    TEST_ASSERT_EQUAL_UINT32(850, scheduler.sleepSeconds(1950, next));
+    TEST_ASSERT_EQUAL_UINT32(2800, next);
+
+    // Never shorter than the minimum
+    next = 1005;
+    TEST_ASSERT_EQUAL_UINT32(CONFIG.minSleepS, scheduler.sleepSeconds(1000, next));
+}
+
+// SNTP sets the clock mid-cycle, or it's stepped back: a whole interval
+// from now instead of sleeping for decades or not at all
+void test_clock_jumps(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 1900;
+    TEST_ASSERT_EQUAL_UINT32(900, scheduler.sleepSeconds(1700000000u, next));
+    TEST_ASSERT_EQUAL_UINT32(1700000900u, next);
+
+    next = 5000;
+    TEST_ASSERT_EQUAL_UINT32(900, scheduler.sleepSeconds(100, next));
+    TEST_ASSERT_EQUAL_UINT32(1000, next);
+}
+
+// A day of timer cycles, awake 20 s each: the schedule holds its slots
+// instead of drifting by the awake time
+void test_day_without_drift(void) {
+    WakeScheduler scheduler(CONFIG);
+    uint32_t next = 0;
+    uint32_t now = 0;
+    scheduler.wake(WAKE_POWER_ON, now, 0, next);
+    int readings = 1;
+    while (now < 86400) {
+        now += 20;
+        now += scheduler.sleepSeconds(now, next);
+        TEST_ASSERT_EQUAL_UINT32(0, now % CONFIG.intervalS);
+        if (scheduler.wake(WAKE_TIMER, now, 0, next)) readings++;
+    }
+    TEST_ASSERT_EQUAL(86400 / CONFIG.intervalS + 1, readings);
+}
+
+void test_state_seal(void) {
+    DutyCycleState state;
+    memset(&state, 0xA5, sizeof(state));
+    TEST_ASSERT_FALSE(dutyCycleValid(state));  // RTC memory after power-on
+
+    memset(&state, 0, sizeof(state));
+    state.cycles = 3;
+    state.bootCount = 7;
+    state.readingSequence = 42;
+    state.nextReportAt = 1900;
+    dutyCycleSeal(state);
+    TEST_ASSERT_TRUE(dutyCycleValid(state));
+
+    DutyCycleState copy = state;
+    copy.readingSequence++;
+    TEST_ASSERT_FALSE(dutyCycleValid(copy));
+    copy = state;
+    copy.version++;
+    TEST_ASSERT_FALSE(dutyCycleValid(copy));
+    copy = state;
+    copy.size--;
+    TEST_ASSERT_FALSE(dutyCycleValid(copy));
+}
+
+void test_uptime_across_sleep(void) {
+    DutyCycleState state;
+    memset(&state, 0, sizeof(state));
+    state.uptimeMs = 5000;
+    state.sleptAt = 100;
+    TEST_ASSERT_EQUAL_UINT32(65000, dutyCycleUptimeMs(state, 160));
+    TEST_ASSERT_EQUAL_UINT32(5000, dutyCycleUptimeMs(state, 50));  // Clock stepped back
+}
+
+// What a wake inherits: fix, counters and breaker state survive the
+// round trip through the sealed record
+void test_state_round_trip(void) {
+    DutyCycleState state;
+    memset(&state, 0, sizeof(state));
+
+    GnssFix fix;
+    memset(&fix, 0, sizeof(fix));
+    fix.valid = true;
+    fix.latitude = 37.774929;
+    fix.longitude = -122.419418;
+    fix.altitude = 16.0f;
+    fix.utcDate = 171026;
+    fix.utcTime = 10150100;
+    TEST_ASSERT_TRUE(storeFix(fix, state.lastFix));
+
+    TransportHealth wifi(1500, 10000);
+    for (int i = 0; i < BREAKER_FAILURES; i++) wifi.record(false, 10000, 1000);
+    wifi.save(state.health[1]);
+    state.readingSequence = 17;
+    dutyCycleSeal(state);
+
+    DutyCycleState woken;
+    memcpy(&woken, &state, sizeof(woken));
+    TEST_ASSERT_TRUE(dutyCycleValid(woken));
+    TEST_ASSERT_TRUE(storedFixValid(woken.lastFix));
+    TEST_ASSERT_EQUAL(GNSS_START_HOT, chooseGnssStart(&woken.lastFix, woken.lastFix.unixTime + 60));
+    TEST_ASSERT_EQUAL_UINT32(17, woken.readingSequence);
+
+    TransportHealth restored(1500, 10000);
+    restored.restore(woken.health[1], 50);
+    TEST_ASSERT_EQUAL(TransportHealth::OPEN, restored.state());
+    TEST_ASSERT_TRUE(restored.allow(50));  // Due for its probe straight away
+    TEST_ASSERT_EQUAL(TransportHealth::HALF_OPEN, restored.state());
+    TEST_ASSERT_EQUAL_UINT32(wifi.failures(), restored.failures());
+
+    // Slots never saved come back as a fresh transport
+    TransportHealth ble(100, 1000);
+    ble.restore(woken.health[0], 50);
+    TEST_ASSERT_EQUAL(TransportHealth::CLOSED, ble.state());
+}
+
+// Whole record must fit the 8 KB of RTC slow memory with plenty to spare
+void test_state_size(void) {
+    char message[48];
+    snprintf(message, sizeof(message), "DutyCycleState is %u bytes", (unsigned)sizeof(DutyCycleState));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(1024, sizeof(DutyCycleState));
+}
+
+void test_reason_names(void) {
+    TEST_ASSERT_EQUAL_STRING("power", wakeReasonName(WAKE_POWER_ON));
+    TEST_ASSERT_EQUAL_STRING("timer", wakeReasonName(WAKE_TIMER));
+    TEST_ASSERT_EQUAL_STRING("button", wakeReasonName(WAKE_BUTTON));
+    TEST_ASSERT_EQUAL_STRING("touch", wakeReasonName(WAKE_TOUCH));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_power_on_reads_and_schedules);
+    RUN_TEST(test_timer_wake);
+    RUN_TEST(test_timer_wake_without_schedule);
+    RUN_TEST(test_button_and_touch_wakes);
+    RUN_TEST(test_activity_extends_window);
+    RUN_TEST(test_max_awake);
+    RUN_TEST(test_sleep_seconds);
+    RUN_TEST(test_clock_jumps);
+    RUN_TEST(test_day_without_drift);
+    RUN_TEST(test_state_seal);
+    RUN_TEST(test_uptime_across_sleep);
+    RUN_TEST(test_state_round_trip);
+    RUN_TEST(test_state_size);
+    RUN_TEST(test_reason_names);
+    return UNITY_END();
+}
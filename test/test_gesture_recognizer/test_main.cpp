@@ -0,0 +1,237 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "GestureRecognizer.h"
+
+// src/main.cpp's timing
+static const GestureConfig CONFIG = {50, 600, 200};
+
+// Recorded timelines: "t:+" button down, "t:-" button up, "t:T" touch
+// pulse. Events come back as text: P@t press, R@t release, tN tap count,
+// name@t gesture.
+static void replay(GestureRecognizer& recognizer, const char* timeline) {
+    unsigned atMs;
+    char edge;
+    int used;
+    while (sscanf(timeline, " %u:%c%n", &atMs, &edge, &used) == 2) {
+        timeline += used;
+        if (edge == 'T') {
+            recognizer.touchPulse(atMs);
+        } else {
+            recognizer.buttonEdge(atMs, edge == '+');
+        }
+    }
+}
+
+static const char* drain(GestureRecognizer& recognizer) {
+    static char out[512];
+    out[0] = '\0';
+    InputEvent event;
+    while (recognizer.next(event)) {
+        char item[32];
+        switch (event.type) {
+            case INPUT_PRESS: snprintf(item, sizeof(item), "P@%lu ", (unsigned long)event.atMs); break;
+            case INPUT_RELEASE: snprintf(item, sizeof(item), "R@%lu ", (unsigned long)event.atMs); break;
+            case INPUT_TAP: snprintf(item, sizeof(item), "t%u ", event.taps); break;
+            case INPUT_GESTURE:
+                snprintf(item, sizeof(item), "%s@%lu ", gestureName(event.gesture), (unsigned long)event.atMs);
+                break;
+        }
+        strcat(out, item);
+    }
+    return out;
+}
+
+static const char* run(const char* timeline, uint32_t endMs) {
+    GestureRecognizer recognizer(CONFIG);
+    replay(recognizer, timeline);
+    recognizer.advance(endMs);
+    return drain(recognizer);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_single_tap(void) {
+    TEST_ASSERT_EQUAL_STRING("P@100 t1 R@200 single@700 ", run("100:+ 200:-", 2000));
+}
+
+// Contact bounce on press and release: one tap, timed from the last bounce
+void test_bounce(void) {
+    TEST_ASSERT_EQUAL_STRING("P@110 t1 R@255 single@710 ",
+                             run("100:+ 103:- 105:+ 108:- 110:+ 250:- 252:+ 255:-", 2000));
+}
+
+void test_glitch_shorter_than_debounce(void) {
+    TEST_ASSERT_EQUAL_STRING("", run("100:+ 120:-", 2000));
+}
+
+void test_tap_counts(void) {
+    TEST_ASSERT_EQUAL_STRING("P@0 t1 R@100 P@300 t2 R@400 double@900 ", run("0:+ 100:- 300:+ 400:-", 2000));
+    TEST_ASSERT_NOT_NULL(strstr(run("0:+ 60:- 200:+ 260:- 400:+ 460:-", 2000), "t3 R@460 scan@1000 "));
+    TEST_ASSERT_NOT_NULL(
+        strstr(run("0:+ 60:- 200:+ 260:- 400:+ 460:- 600:+ 660:-", 2000), "t4 R@660 ble@1200 "));
+}
+
+// Two sequences back to back, drained together long after
+void test_overlapping_sequences(void) {
+    TEST_ASSERT_EQUAL_STRING(
+        "P@0 t1 R@100 P@300 t2 R@400 double@900 P@1100 t1 R@1150 P@1300 t2 R@1380 P@1500 t3 R@1560 scan@2100 ",
+        run("0:+ 100:- 300:+ 400:- 1100:+ 1150:- 1300:+ 1380:- 1500:+ 1560:-", 3000));
+}
+
+// Five taps report at once; the next press starts over
+void test_five_taps_report_immediately(void) {
+    const char* events = run("0:+ 60:- 150:+ 210:- 300:+ 360:- 450:+ 510:- 600:+ 660:- 800:+ 860:-", 3000);
+    TEST_ASSERT_NOT_NULL(strstr(events, "t5 ota@600 R@660 "));
+    TEST_ASSERT_NOT_NULL(strstr(events, "P@800 t1 R@860 single@1400 "));
+}
+
+// The pad interrupts repeatedly while held: one touch per contact
+void test_touch_held(void) {
+    TEST_ASSERT_EQUAL_STRING("touch@0 touch@400 ", run("0:T 30:T 60:T 90:T 400:T 430:T", 1000));
+}
+
+void test_touch_during_taps(void) {
+    TEST_ASSERT_EQUAL_STRING("P@0 t1 R@80 touch@200 P@300 t2 R@380 double@900 ",
+                             run("0:+ 80:- 200:T 300:+ 380:-", 2000));
+}
+
+// A long press counts at the press; the gesture doesn't wait for release
+void test_held_press(void) {
+    TEST_ASSERT_EQUAL_STRING("P@0 t1 single@600 R@3000 ", run("0:+ 3000:-", 5000));
+}
+
+// The gesture only comes out once advance() has passed the window
+void test_advance_gates_gesture(void) {
+    GestureRecognizer recognizer(CONFIG);
+    replay(recognizer, "0:+ 80:-");
+    recognizer.advance(100);
+    TEST_ASSERT_EQUAL_STRING("P@0 t1 ", drain(recognizer));  // Release not settled yet
+    recognizer.advance(200);
+    TEST_ASSERT_EQUAL_STRING("R@80 ", drain(recognizer));
+    TEST_ASSERT_EQUAL(1, recognizer.pendingTaps());
+    recognizer.advance(599);
+    TEST_ASSERT_EQUAL_STRING("", drain(recognizer));
+    recognizer.advance(600);
+    TEST_ASSERT_EQUAL_STRING("single@600 ", drain(recognizer));
+    TEST_ASSERT_EQUAL(0, recognizer.pendingTaps());
+}
+
+// The press only settles once it has held for the debounce time
+void test_pressed_state(void) {
+    GestureRecognizer recognizer(CONFIG);
+    recognizer.buttonEdge(0, true);
+    recognizer.advance(49);
+    TEST_ASSERT_FALSE(recognizer.pressed());
+    recognizer.advance(50);
+    TEST_ASSERT_TRUE(recognizer.pressed());
+    recognizer.buttonEdge(1000, false);
+    recognizer.advance(1050);
+    TEST_ASSERT_FALSE(recognizer.pressed());
+}
+
+// The loop is stuck in an 8 s upload while the user double-taps and
+// touches. The ISRs queue the edges; drained afterwards they still give
+// the right gestures at the right times.
+void test_taps_survive_a_stalled_loop(void) {
+    EdgeQueue<32> buttons;
+    EdgeQueue<32> touches;
+    const uint32_t tapsAt[] = {1000, 1002, 1004, 1090, 1300, 1390};  // Bouncy press
+    const bool levels[] = {true, false, true, false, true, false};
+    for (int i = 0; i < 6; i++) TEST_ASSERT_TRUE(buttons.push(tapsAt[i], levels[i]));
+    for (uint32_t t = 4000; t < 4300; t += 30) touches.push(t, true);
+
+    GestureRecognizer recognizer(CONFIG);
+    uint32_t now = 9000;  // Loop comes back
+    InputEdge button = {}, touch = {};
+    bool haveButton = buttons.peek(button);
+    bool haveTouch = touches.peek(touch);
+    while (haveButton || haveTouch) {
+        if (haveButton && (!haveTouch || button.atMs <= touch.atMs)) {
+            recognizer.buttonEdge(button.atMs, button.active);
+            buttons.pop();
+            haveButton = buttons.peek(button);
+        } else {
+            recognizer.touchPulse(touch.atMs);
+            touches.pop();
+            haveTouch = touches.peek(touch);
+        }
+    }
+    recognizer.advance(now);
+    TEST_ASSERT_EQUAL_STRING("P@1004 t1 R@1090 P@1300 t2 R@1390 double@1900 touch@4000 ", drain(recognizer));
+    TEST_ASSERT_EQUAL_UINT32(0, recognizer.lostEvents());
+}
+
+void test_edge_queue(void) {
+    EdgeQueue<8> queue;
+    for (uint32_t i = 0; i < 10; i++) queue.push(i, i & 1);
+    TEST_ASSERT_EQUAL_UINT32(3, queue.dropped());  // Capacity is Size - 1
+
+    InputEdge edge;
+    uint32_t count = 0;
+    while (queue.peek(edge)) {
+        TEST_ASSERT_EQUAL_UINT32(count, edge.atMs);
+        TEST_ASSERT_EQUAL(count & 1, edge.active);
+        queue.pop();
+        count++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(7, count);
+    queue.pop();  // Empty: no-op
+    TEST_ASSERT_FALSE(queue.peek(edge));
+
+    // Wraps around
+    for (uint32_t i = 0; i < 20; i++) {
+        TEST_ASSERT_TRUE(queue.push(100 + i, true));
+        TEST_ASSERT_TRUE(queue.peek(edge));
+        TEST_ASSERT_EQUAL_UINT32(100 + i, edge.atMs);
+        queue.pop();
+    }
+}
+
+// More events than the output queue holds before anyone reads them
+void test_event_overflow_counted(void) {
+    GestureRecognizer recognizer(CONFIG);
+    uint32_t t = 0;
+    for (int i = 0; i < 20; i++, t += 1000) {
+        recognizer.buttonEdge(t, true);
+        recognizer.buttonEdge(t + 100, false);
+    }
+    recognizer.advance(t + 1000);
+    TEST_ASSERT_GREATER_THAN(0, recognizer.lostEvents());
+    InputEvent event;
+    int read = 0;
+    while (recognizer.next(event)) read++;
+    TEST_ASSERT_EQUAL(GestureRecognizer::EVENT_QUEUE, read);
+}
+
+void test_gesture_names(void) {
+    TEST_ASSERT_EQUAL_STRING("single", gestureName(GESTURE_SINGLE));
+    TEST_ASSERT_EQUAL_STRING("double", gestureName(GESTURE_DOUBLE));
+    TEST_ASSERT_EQUAL_STRING("scan", gestureName(GESTURE_SCAN));
+    TEST_ASSERT_EQUAL_STRING("ble", gestureName(GESTURE_BLE_TOGGLE));
+    TEST_ASSERT_EQUAL_STRING("ota", gestureName(GESTURE_OTA));
+    TEST_ASSERT_EQUAL_STRING("touch", gestureName(GESTURE_TOUCH));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_tap);
+    RUN_TEST(test_bounce);
+    RUN_TEST(test_glitch_shorter_than_debounce);
+    RUN_TEST(test_tap_counts);
+    RUN_TEST(test_overlapping_sequences);
+    RUN_TEST(test_five_taps_report_immediately);
+    RUN_TEST(test_touch_held);
+    RUN_TEST(test_touch_during_taps);
+    RUN_TEST(test_held_press);
+    RUN_TEST(test_advance_gates_gesture);
+    RUN_TEST(test_pressed_state);
+    RUN_TEST(test_taps_survive_a_stalled_loop);
+    RUN_TEST(test_edge_queue);
+    RUN_TEST(test_event_overflow_counted);
+    RUN_TEST(test_gesture_names);
+    return UNITY_END();
+}
@@ -0,0 +1,409 @@
+#include <unity.h>
+
+#include <deque>
+#include <stdio.h>
+#include <string.h>
+
+#include "AtEngine.h"
+#include "GnssAssist.h"
+#include "NmeaStream.h"
+
+// 2026-09-17 10:15:01 UTC
+static const uint32_t FIX_UNIX = 1789640101;
+
+static GnssFix validFix() {
+    GnssFix fix;
+    memset(&fix, 0, sizeof(fix));
+    fix.valid = true;
+    fix.latitude = 37.774928;
+    fix.longitude = -122.419418;
+    fix.altitude = 16.2f;
+    fix.utcTime = 10150100;
+    fix.utcDate = 170926;
+    return fix;
+}
+
+static StoredFix storedAt(uint32_t unixTime) {
+    StoredFix stored;
+    TEST_ASSERT_TRUE(storeFix(validFix(), stored));
+    stored.unixTime = unixTime;
+    return stored;
+}
+
+// SIM7000 GNSS on simulated time. The engine needs a different time to
+// its first fix depending on how it was started; these are assumptions
+// in line with the module's documented TTFF, not measurements. With
+// AT+CGNSTST=1 it streams a GGA and an RMC every second, without a
+// position until the fix. Power to the modem (and so the engine state)
+// survives an ESP32 reset.
+struct StartTimes {
+    uint32_t coldMs;
+    uint32_t warmMs;
+    uint32_t hotMs;
+};
+
+static const StartTimes SIM7000_TTFF = {35000, 25000, 2000};
+
+class GnssModem : public AtPort {
+public:
+    explicit GnssModem(const StartTimes& ttff)
+        : now(0), powered(false), streaming(false), xtra(false), _ttff(ttff), _startedMs(0), _fixAfterMs(0),
+          _nextEpochMs(0), _lineLength(0) {
+        commands[0] = '\0';
+    }
+
+    int available() {
+        stream();
+        return (int)_output.size();
+    }
+
+    int read() {
+        if (_output.empty()) return -1;
+        char c = _output.front();
+        _output.pop_front();
+        return (uint8_t)c;
+    }
+
+    size_t write(const uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] == '\r') {
+                _line[_lineLength] = '\0';
+                _lineLength = 0;
+                command(_line + 2);
+            } else if (_lineLength < sizeof(_line) - 1) {
+                _line[_lineLength++] = (char)data[i];
+            }
+        }
+        return length;
+    }
+
+    // The ESP32 resets; the modem keeps power and its engine state
+    void hostReset() {
+        streaming = false;
+        _output.clear();
+    }
+
+    void powerCycle() {
+        powered = false;
+        streaming = false;
+        _output.clear();
+    }
+
+    uint32_t now;
+    bool powered;
+    bool streaming;
+    bool xtra;
+    char commands[256];
+
+private:
+    void emit(const char* text) {
+        for (const char* p = text; *p; p++) _output.push_back(*p);
+    }
+
+    void command(const char* at) {
+        strncat(commands, at, sizeof(commands) - strlen(commands) - 2);
+        strcat(commands, ";");
+        if (strcmp(at, "+CGNSPWR?") == 0) {
+            emit(powered ? "\r\n+CGNSPWR: 1\r\n\r\nOK\r\n" : "\r\n+CGNSPWR: 0\r\n\r\nOK\r\n");
+            return;
+        }
+        if (strcmp(at, "+CGNSPWR=1") == 0) {
+            if (!powered) restart(_ttff.coldMs);
+            powered = true;
+        } else if (strcmp(at, "+CGNSHOT") == 0) {
+            restart(_ttff.hotMs);
+        } else if (strcmp(at, "+CGNSWARM") == 0) {
+            restart(_ttff.warmMs);
+        } else if (strcmp(at, "+CGNSXTRA=1") == 0) {
+            xtra = true;
+        } else if (strcmp(at, "+CGNSTST=1") == 0) {
+            streaming = true;
+            _nextEpochMs = now + 1000;
+        }
+        emit("\r\nOK\r\n");
+    }
+
+    void restart(uint32_t ttffMs) {
+        _startedMs = now;
+        _fixAfterMs = ttffMs;
+    }
+
+    void sentence(const char* body) {
+        uint8_t checksum = 0;
+        for (const char* p = body; *p; p++) checksum ^= (uint8_t)*p;
+        char line[NmeaParser::SENTENCE_MAX + 8];
+        snprintf(line, sizeof(line), "$%s*%02X\r\n", body, checksum);
+        emit(line);
+    }
+
+    // One epoch a second while streaming
+    void stream() {
+        while (streaming && powered && (int32_t)(now - _nextEpochMs) >= 0) {
+            uint32_t second = 1 + (_nextEpochMs - _startedMs) / 1000;
+            char utc[16];
+            snprintf(utc, sizeof(utc), "1015%02u.000", (unsigned)(second % 60));
+            char body[96];
+            if (_nextEpochMs - _startedMs >= _fixAfterMs) {
+                snprintf(body, sizeof(body), "GNGGA,%s,3746.4957,N,12225.1651,W,1,07,1.10,16.2,M,-25.6,M,,", utc);
+                sentence(body);
+                snprintf(body, sizeof(body), "GNRMC,%s,A,3746.4957,N,12225.1651,W,0.12,41.20,170926,,,A", utc);
+                sentence(body);
+            } else {
+                snprintf(body, sizeof(body), "GNGGA,%s,,,,,0,0,,,M,,M,,", utc);
+                sentence(body);
+                snprintf(body, sizeof(body), "GNRMC,%s,V,,,,,0.00,0.00,170926,,,N", utc);
+                sentence(body);
+            }
+            _nextEpochMs += 1000;
+        }
+    }
+
+    StartTimes _ttff;
+    uint32_t _startedMs;
+    uint32_t _fixAfterMs;
+    uint32_t _nextEpochMs;
+    std::deque<char> _output;
+    char _line[AT_COMMAND_MAX + 4];
+    size_t _lineLength;
+};
+
+// NVS "gnss"/"fix" as Preferences getBytes()/putBytes() see it
+struct FixBlob {
+    uint8_t bytes[64];
+    size_t length;
+};
+
+struct Boot {
+    GnssStart start;
+    uint32_t ttffMs;
+    GnssFix fix;
+};
+
+static NmeaParser* nmea;
+static GnssFix firstFix;
+
+static void onNmea(const char* line, void* context) {
+    uint32_t nowMs = *(uint32_t*)context;
+    if (nmea->parse(line, nowMs) && nmea->fix().valid && !firstFix.valid) firstFix = nmea->fix();
+}
+
+static void drain(GnssModem& modem, AtEngine& engine) {
+    while (!engine.idle()) {
+        engine.poll(modem.now);
+        modem.now += 5;
+    }
+}
+
+// What startGnss() and publishFix() do on the device: load the saved
+// fix, pick the start, power up and restart the engine, stream NMEA and
+// save the first fix it reports
+static Boot boot(GnssModem& modem, FixBlob& nvs, uint32_t nowUnix) {
+    AtEngine engine(modem);
+    NmeaParser parser;
+    nmea = &parser;
+    memset(&firstFix, 0, sizeof(firstFix));
+    engine.onUrc("$", onNmea, &modem.now);
+    modem.commands[0] = '\0';
+
+    Boot result;
+    AtResult power;
+    AtRequest query("+CGNSPWR?", "+CGNSPWR:");
+    query.result = &power;
+    engine.submit(query);
+    drain(modem, engine);
+
+    if (power.ok() && power.line[0] == '1') {
+        result.start = GNSS_START_RUNNING;
+    } else {
+        StoredFix stored;
+        bool haveFix = nvs.length == sizeof(stored);
+        if (haveFix) memcpy(&stored, nvs.bytes, sizeof(stored));
+        haveFix = haveFix && storedFixValid(stored);
+        result.start = chooseGnssStart(haveFix ? &stored : NULL, nowUnix);
+        engine.submit(AtRequest("+CGNSXTRA=1"));
+        engine.submit(AtRequest("+CGNSPWR=1", NULL, 5000));
+        const char* command = gnssStartCommand(result.start);
+        if (command) engine.submit(AtRequest(command, NULL, 5000));
+    }
+    engine.submit(AtRequest("+CGNSTST=1"));
+    drain(modem, engine);
+
+    uint32_t startedMs = modem.now;
+    while (!firstFix.valid && modem.now - startedMs < 120000) {
+        engine.poll(modem.now);
+        modem.now += 5;
+    }
+    result.ttffMs = firstFix.updatedMs - startedMs;
+    result.fix = firstFix;
+
+    StoredFix save;
+    if (storeFix(firstFix, save)) {
+        memcpy(nvs.bytes, &save, sizeof(save));
+        nvs.length = sizeof(save);
+    }
+    return result;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_unix_time(void) {
+    TEST_ASSERT_EQUAL_UINT32(FIX_UNIX, gnssUnixTime(170926, 10150100));
+    TEST_ASSERT_EQUAL_UINT32(FIX_UNIX, gnssUnixTime(170926, 10150199));  // Hundredths dropped
+    TEST_ASSERT_EQUAL_UINT32(951782400, gnssUnixTime(290200, 0));        // Leap day
+    TEST_ASSERT_EQUAL_UINT32(4102444799u, gnssUnixTime(311299, 23595900));
+    TEST_ASSERT_EQUAL_UINT32(0, gnssUnixTime(0, 10150100));  // No date yet
+    TEST_ASSERT_EQUAL_UINT32(0, gnssUnixTime(171326, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, gnssUnixTime(320926, 0));
+}
+
+void test_store_fix(void) {
+    StoredFix stored;
+    GnssFix fix = validFix();
+    TEST_ASSERT_TRUE(storeFix(fix, stored));
+    TEST_ASSERT_EQUAL_UINT32(STORED_FIX_VERSION, stored.version);
+    TEST_ASSERT_EQUAL_DOUBLE(fix.latitude, stored.latitude);
+    TEST_ASSERT_EQUAL_DOUBLE(fix.longitude, stored.longitude);
+    TEST_ASSERT_EQUAL_FLOAT(fix.altitude, stored.altitude);
+    TEST_ASSERT_EQUAL_UINT32(FIX_UNIX, stored.unixTime);
+    TEST_ASSERT_TRUE(storedFixValid(stored));
+
+    StoredFix untouched = stored;
+    fix.valid = false;
+    TEST_ASSERT_FALSE(storeFix(fix, stored));
+    TEST_ASSERT_EQUAL_MEMORY(&untouched, &stored, sizeof(stored));
+}
+
+void test_stored_fix_validation(void) {
+    StoredFix stored = storedAt(FIX_UNIX);
+    stored.version = STORED_FIX_VERSION + 1;  // Written by other firmware
+    TEST_ASSERT_FALSE(storedFixValid(stored));
+
+    stored = storedAt(FIX_UNIX);
+    stored.latitude = 91;
+    TEST_ASSERT_FALSE(storedFixValid(stored));
+    stored = storedAt(FIX_UNIX);
+    stored.longitude = -180.5;
+    TEST_ASSERT_FALSE(storedFixValid(stored));
+    stored.longitude = 0.0 / 0.0;  // Erased or corrupted blob
+    TEST_ASSERT_FALSE(storedFixValid(stored));
+}
+
+void test_choose_start(void) {
+    StoredFix stored = storedAt(FIX_UNIX);
+    TEST_ASSERT_EQUAL(GNSS_START_COLD, chooseGnssStart(NULL, FIX_UNIX));
+    TEST_ASSERT_EQUAL(GNSS_START_HOT, chooseGnssStart(&stored, FIX_UNIX + 60));
+    TEST_ASSERT_EQUAL(GNSS_START_HOT, chooseGnssStart(&stored, FIX_UNIX + GNSS_HOT_MAX_AGE_S - 1));
+    TEST_ASSERT_EQUAL(GNSS_START_WARM, chooseGnssStart(&stored, FIX_UNIX + GNSS_HOT_MAX_AGE_S));
+    TEST_ASSERT_EQUAL(GNSS_START_WARM, chooseGnssStart(&stored, FIX_UNIX + GNSS_WARM_MAX_AGE_S - 1));
+    TEST_ASSERT_EQUAL(GNSS_START_COLD, chooseGnssStart(&stored, FIX_UNIX + GNSS_WARM_MAX_AGE_S));
+
+    // Without a trustworthy age the position still helps, the ephemeris may not
+    TEST_ASSERT_EQUAL(GNSS_START_WARM, chooseGnssStart(&stored, 0));
+    TEST_ASSERT_EQUAL(GNSS_START_WARM, chooseGnssStart(&stored, FIX_UNIX - 3600));
+    StoredFix undated = storedAt(0);
+    TEST_ASSERT_EQUAL(GNSS_START_WARM, chooseGnssStart(&undated, FIX_UNIX));
+
+    stored.version = 0;
+    TEST_ASSERT_EQUAL(GNSS_START_COLD, chooseGnssStart(&stored, FIX_UNIX + 60));
+}
+
+void test_start_commands(void) {
+    TEST_ASSERT_NULL(gnssStartCommand(GNSS_START_COLD));
+    TEST_ASSERT_NULL(gnssStartCommand(GNSS_START_RUNNING));
+    TEST_ASSERT_EQUAL_STRING("+CGNSWARM", gnssStartCommand(GNSS_START_WARM));
+    TEST_ASSERT_EQUAL_STRING("+CGNSHOT", gnssStartCommand(GNSS_START_HOT));
+    TEST_ASSERT_EQUAL_STRING("cold", gnssStartName(GNSS_START_COLD));
+    TEST_ASSERT_EQUAL_STRING("warm", gnssStartName(GNSS_START_WARM));
+    TEST_ASSERT_EQUAL_STRING("hot", gnssStartName(GNSS_START_HOT));
+    TEST_ASSERT_EQUAL_STRING("running", gnssStartName(GNSS_START_RUNNING));
+}
+
+// First boot starts cold and saves the fix; the next boot an hour later
+// replays it as a hot start and gets a fix in seconds
+void test_saved_fix_replayed_on_next_boot(void) {
+    GnssModem modem(SIM7000_TTFF);
+    FixBlob nvs = {{0}, 0};
+
+    Boot first = boot(modem, nvs, FIX_UNIX - 40);
+    TEST_ASSERT_EQUAL(GNSS_START_COLD, first.start);
+    TEST_ASSERT_TRUE(first.fix.valid);
+    TEST_ASSERT_UINT32_WITHIN(1000, SIM7000_TTFF.coldMs, first.ttffMs);
+    TEST_ASSERT_EQUAL_STRING("+CGNSPWR?;+CGNSXTRA=1;+CGNSPWR=1;+CGNSTST=1;", modem.commands);
+    TEST_ASSERT_EQUAL(sizeof(StoredFix), nvs.length);
+
+    StoredFix saved;
+    memcpy(&saved, nvs.bytes, sizeof(saved));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 37.774928, saved.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, -122.419418, saved.longitude);
+
+    modem.powerCycle();
+    Boot second = boot(modem, nvs, saved.unixTime + 3600);
+    TEST_ASSERT_EQUAL(GNSS_START_HOT, second.start);
+    TEST_ASSERT_EQUAL_STRING("+CGNSPWR?;+CGNSXTRA=1;+CGNSPWR=1;+CGNSHOT;+CGNSTST=1;", modem.commands);
+    TEST_ASSERT_UINT32_WITHIN(1000, SIM7000_TTFF.hotMs, second.ttffMs);
+    TEST_ASSERT_LESS_THAN(first.ttffMs / 5, second.ttffMs);
+
+    char message[80];
+    snprintf(message, sizeof(message), "TTFF cold %lu ms, hot %lu ms", (unsigned long)first.ttffMs,
+             (unsigned long)second.ttffMs);
+    TEST_MESSAGE(message);
+}
+
+// Days later the ephemeris is stale: warm start from the saved position
+void test_old_fix_warm_start(void) {
+    GnssModem modem(SIM7000_TTFF);
+    StoredFix stored = storedAt(FIX_UNIX);
+    FixBlob nvs;
+    memcpy(nvs.bytes, &stored, sizeof(stored));
+    nvs.length = sizeof(stored);
+
+    Boot result = boot(modem, nvs, FIX_UNIX + 3 * 86400);
+    TEST_ASSERT_EQUAL(GNSS_START_WARM, result.start);
+    TEST_ASSERT_NOT_NULL(strstr(modem.commands, "+CGNSWARM;"));
+    TEST_ASSERT_UINT32_WITHIN(1000, SIM7000_TTFF.warmMs, result.ttffMs);
+}
+
+// A blob of the wrong size (older firmware) or contents is ignored
+void test_bad_blob_starts_cold(void) {
+    GnssModem modem(SIM7000_TTFF);
+    StoredFix stored = storedAt(FIX_UNIX);
+    FixBlob nvs;
+    memcpy(nvs.bytes, &stored, sizeof(stored));
+    nvs.length = sizeof(stored) - 4;
+    TEST_ASSERT_EQUAL(GNSS_START_COLD, boot(modem, nvs, FIX_UNIX + 60).start);
+
+    modem.powerCycle();
+    stored.version = 0;
+    memcpy(nvs.bytes, &stored, sizeof(stored));
+    nvs.length = sizeof(stored);
+    TEST_ASSERT_EQUAL(GNSS_START_COLD, boot(modem, nvs, FIX_UNIX + 60).start);
+}
+
+// After an ESP32-only reset the engine is still tracking: it is left
+// alone, and the fix comes on the next epoch
+void test_running_engine_left_alone(void) {
+    GnssModem modem(SIM7000_TTFF);
+    FixBlob nvs = {{0}, 0};
+    boot(modem, nvs, 0);
+
+    modem.hostReset();
+    Boot result = boot(modem, nvs, 0);
+    TEST_ASSERT_EQUAL(GNSS_START_RUNNING, result.start);
+    TEST_ASSERT_EQUAL_STRING("+CGNSPWR?;+CGNSTST=1;", modem.commands);
+    TEST_ASSERT_LESS_OR_EQUAL(1000, result.ttffMs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unix_time);
+    RUN_TEST(test_store_fix);
+    RUN_TEST(test_stored_fix_validation);
+    RUN_TEST(test_choose_start);
+    RUN_TEST(test_start_commands);
+    RUN_TEST(test_saved_fix_replayed_on_next_boot);
+    RUN_TEST(test_old_fix_warm_start);
+    RUN_TEST(test_bad_blob_starts_cold);
+    RUN_TEST(test_running_engine_left_alone);
+    return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "HttpResponseParser.h"
+
+// Shape of what the Salesforce Sites front end sends back
+static const char* const CONTENT_LENGTH =
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Sat, 17 Oct 2026 10:15:01 GMT\r\n"
+    "Content-Type: application/json;charset=UTF-8\r\n"
+    "Content-Length: 16\r\n"
+    "\r\n"
+    "{\"success\":true}";
+
+static const char* const CHUNKED =
+    "HTTP/1.1 201 Created\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "5;ext=1\r\n"
+    "hello\r\n"
+    "B\r\n"
+    ", pipelined\r\n"
+    "0\r\n"
+    "X-Trailer: 1\r\n"
+    "\r\n";
+
+static const char* const CLOSE_DELIMITED =
+    "HTTP/1.0 500 Internal Server Error\r\n"
+    "Content-Type: text/plain\r\n"
+    "\r\n"
+    "boom";
+
+struct Parsed {
+    bool done;
+    bool failed;
+    int status;
+    bool keepAlive;
+    size_t bodyLength;
+    size_t consumed;
+    char body[64];
+};
+
+// Feed text in pieces of `step` bytes, the way a socket read returns
+// them, and close the connection at the end if asked to
+static Parsed parse(const char* text, size_t step, bool close = false) {
+    Parsed out;
+    memset(&out, 0, sizeof(out));
+    HttpResponseParser parser(out.body, sizeof(out.body));
+    size_t length = strlen(text);
+    size_t offset = 0;
+    while (offset < length && !parser.done() && !parser.failed()) {
+        size_t n = step < length - offset ? step : length - offset;
+        size_t used = parser.feed((const uint8_t*)text + offset, n);
+        offset += used;
+        if (used < n) break;  // Parser stopped at the end of the response
+    }
+    if (close && !parser.done() && !parser.failed()) parser.finish();
+    out.done = parser.done();
+    out.failed = parser.failed();
+    out.status = parser.status();
+    out.keepAlive = parser.keepAlive();
+    out.bodyLength = parser.bodyLength();
+    out.consumed = offset;
+    return out;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_content_length(void) {
+    Parsed p = parse(CONTENT_LENGTH, 1000);
+    TEST_ASSERT_TRUE(p.done);
+    TEST_ASSERT_EQUAL(200, p.status);
+    TEST_ASSERT_TRUE(p.keepAlive);
+    TEST_ASSERT_EQUAL_STRING("{\"success\":true}", p.body);
+    TEST_ASSERT_EQUAL(16, p.bodyLength);
+    TEST_ASSERT_EQUAL(strlen(CONTENT_LENGTH), p.consumed);
+}
+
+// Every read size gives the same result as one big read
+void test_split_reads(void) {
+    const char* const responses[] = {CONTENT_LENGTH, CHUNKED};
+    for (size_t r = 0; r < 2; r++) {
+        Parsed whole = parse(responses[r], 1000);
+        for (size_t step = 1; step <= strlen(responses[r]); step++) {
+            Parsed split = parse(responses[r], step);
+            TEST_ASSERT_TRUE(split.done);
+            TEST_ASSERT_EQUAL(whole.status, split.status);
+            TEST_ASSERT_EQUAL(whole.bodyLength, split.bodyLength);
+            TEST_ASSERT_EQUAL_STRING(whole.body, split.body);
+        }
+    }
+}
+
+void test_chunked(void) {
+    Parsed p = parse(CHUNKED, 7);
+    TEST_ASSERT_TRUE(p.done);
+    TEST_ASSERT_EQUAL(201, p.status);
+    TEST_ASSERT_EQUAL_STRING("hello, pipelined", p.body);
+    TEST_ASSERT_EQUAL(16, p.bodyLength);
+    TEST_ASSERT_TRUE(p.keepAlive);
+}
+
+void test_chunked_bad_framing_fails(void) {
+    Parsed p = parse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 4);
+    TEST_ASSERT_TRUE(p.failed);
+    p = parse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX\r\n", 4);
+    TEST_ASSERT_TRUE(p.failed);
+}
+
+void test_close_delimited(void) {
+    Parsed open = parse(CLOSE_DELIMITED, 5);
+    TEST_ASSERT_FALSE(open.done);  // Could be more body until the server closes
+    TEST_ASSERT_FALSE(open.keepAlive);
+
+    Parsed p = parse(CLOSE_DELIMITED, 5, true);
+    TEST_ASSERT_TRUE(p.done);
+    TEST_ASSERT_EQUAL(500, p.status);
+    TEST_ASSERT_EQUAL_STRING("boom", p.body);
+    TEST_ASSERT_FALSE(p.keepAlive);
+}
+
+// A close before a declared length is complete is a failure, not a
+// short body
+void test_close_mid_body_fails(void) {
+    Parsed p = parse("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nshort", 3, true);
+    TEST_ASSERT_TRUE(p.failed);
+    p = parse("HTTP/1.1 200 OK\r\nContent-Le", 3, true);
+    TEST_ASSERT_TRUE(p.failed);
+}
+
+// Two responses back to back on a kept-alive socket: the parser stops
+// at the end of the first and the rest parses as the second
+void test_pipelined_trailing_response(void) {
+    char stream[512];
+    strcpy(stream, CONTENT_LENGTH);
+    strcat(stream, CHUNKED);
+    size_t total = strlen(stream);
+
+    for (size_t step = 1; step <= total; step++) {
+        char body[64];
+        HttpResponseParser parser(body, sizeof(body));
+        size_t offset = 0;
+        int responses = 0;
+        while (offset < total) {
+            size_t n = step < total - offset ? step : total - offset;
+            offset += parser.feed((const uint8_t*)stream + offset, n);
+            if (parser.done()) {
+                responses++;
+                if (responses == 1) {
+                    TEST_ASSERT_EQUAL(200, parser.status());
+                    TEST_ASSERT_EQUAL_STRING("{\"success\":true}", body);
+                    TEST_ASSERT_EQUAL(strlen(CONTENT_LENGTH), offset);
+                    parser.reset();
+                }
+            }
+            TEST_ASSERT_FALSE(parser.failed());
+        }
+        TEST_ASSERT_EQUAL(2, responses);
+        TEST_ASSERT_EQUAL(201, parser.status());
+        TEST_ASSERT_EQUAL_STRING("hello, pipelined", body);
+    }
+}
+
+void test_continue_then_no_content(void) {
+    Parsed p = parse("HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n", 5);
+    TEST_ASSERT_TRUE(p.done);
+    TEST_ASSERT_EQUAL(204, p.status);
+    TEST_ASSERT_FALSE(p.keepAlive);
+    TEST_ASSERT_EQUAL(0, p.bodyLength);
+}
+
+void test_connection_header(void) {
+    Parsed p = parse("HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\nContent-Length: 0\r\n\r\n", 9);
+    TEST_ASSERT_TRUE(p.done);
+    TEST_ASSERT_TRUE(p.keepAlive);
+    p = parse("HTTP/1.1 200 OK\r\nCONNECTION: close\r\ncontent-length: 2\r\n\r\nok", 9);
+    TEST_ASSERT_TRUE(p.done);
+    TEST_ASSERT_FALSE(p.keepAlive);
+    TEST_ASSERT_EQUAL_STRING("ok", p.body);
+}
+
+// A body larger than the buffer is consumed in full and truncated
+void test_body_truncated_to_buffer(void) {
+    char text[256];
+    strcpy(text, "HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\n");
+    size_t header = strlen(text);
+    memset(text + header, 'x', 100);
+    text[header + 100] = '\0';
+
+    char body[8];
+    HttpResponseParser parser(body, sizeof(body));
+    TEST_ASSERT_EQUAL(header + 100, parser.feed((const uint8_t*)text, strlen(text)));
+    TEST_ASSERT_TRUE(parser.done());
+    TEST_ASSERT_EQUAL(100, parser.bodyLength());
+    TEST_ASSERT_EQUAL_STRING("xxxxxxx", body);
+
+    HttpResponseParser discard;
+    discard.feed((const uint8_t*)text, strlen(text));
+    TEST_ASSERT_TRUE(discard.done());
+}
+
+void test_not_http_fails(void) {
+    Parsed p = parse("SSH-2.0-OpenSSH\r\n", 5);
+    TEST_ASSERT_TRUE(p.failed);
+    TEST_ASSERT_EQUAL(0, p.status);
+
+    HttpResponseParser parser;
+    TEST_ASSERT_FALSE(parser.started());
+    parser.finish();
+    TEST_ASSERT_TRUE(parser.failed());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_content_length);
+    RUN_TEST(test_split_reads);
+    RUN_TEST(test_chunked);
+    RUN_TEST(test_chunked_bad_framing_fails);
+    RUN_TEST(test_close_delimited);
+    RUN_TEST(test_close_mid_body_fails);
+    RUN_TEST(test_pipelined_trailing_response);
+    RUN_TEST(test_continue_then_no_content);
+    RUN_TEST(test_connection_header);
+    RUN_TEST(test_body_truncated_to_buffer);
+    RUN_TEST(test_not_http_fails);
+    return UNITY_END();
+}
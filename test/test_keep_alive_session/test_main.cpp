@@ -0,0 +1,296 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "KeepAliveSession.h"
+
+static const int ERROR_SEND_HEADER = -2;  // HTTPClient's codes
+static const int ERROR_CONNECTION_LOST = -5;
+static const int ERROR_READ_TIMEOUT = -11;
+
+static const SessionConfig CONFIG = {300000, 50000};
+
+// Scripted client and server. Each operation takes simulated time; the
+// server can drop the socket without the client noticing, the way an
+// idle keep-alive connection dies.
+class FakeTransport : public SessionTransport {
+public:
+    FakeTransport()
+        : now(1000), address(0x0A000001), dnsOk(true), connectOk(true), socketOpen(false), serverClosed(false),
+          failCode(0), failTimes(0), lookups(0), connects(0), exchanges(0), stops(0), connectedTo(0) {}
+
+    uint32_t nowMs() { return now; }
+
+    bool resolve(const char* host, uint32_t& out) {
+        now += 50;
+        lookups++;
+        if (!dnsOk) return false;
+        out = address;
+        return true;
+    }
+
+    bool connect(uint32_t to, const char* host) {
+        now += 800;  // TLS handshake
+        connects++;
+        if (!connectOk) return false;
+        connectedTo = to;
+        socketOpen = true;
+        serverClosed = false;
+        strcpy(sniHost, host);
+        return true;
+    }
+
+    bool connected() { return socketOpen; }
+
+    void stop() {
+        stops++;
+        socketOpen = false;
+    }
+
+    int exchange(const char* host, const char* path, const char* body, size_t length) {
+        now += 120;
+        exchanges++;
+        strcpy(lastPath, path);
+        if (failTimes > 0) {
+            failTimes--;
+            return failCode;
+        }
+        if (!socketOpen || serverClosed) return ERROR_SEND_HEADER;
+        return body ? 201 : 200;
+    }
+
+    bool failedBeforeResponse(int code) { return code == ERROR_SEND_HEADER || code == ERROR_CONNECTION_LOST; }
+
+    uint32_t now;
+    uint32_t address;
+    bool dnsOk;
+    bool connectOk;
+    bool socketOpen;
+    bool serverClosed;  // Server dropped the socket; the client still thinks it's open
+    int failCode;   // Returned by the next failTimes exchanges
+    int failTimes;
+    int lookups;
+    int connects;
+    int exchanges;
+    int stops;
+    uint32_t connectedTo;
+    char sniHost[64];
+    char lastPath[64];
+};
+
+static int post(KeepAliveSession& session) {
+    return session.request("example.my.salesforce-sites.com", "/services/apexrest/sensor", "{}", 2);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_first_request_resolves_and_connects(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_EQUAL(1, transport.lookups);
+    TEST_ASSERT_EQUAL(1, transport.connects);
+    TEST_ASSERT_EQUAL_UINT32(transport.address, transport.connectedTo);
+    TEST_ASSERT_EQUAL_STRING("example.my.salesforce-sites.com", transport.sniHost);
+    TEST_ASSERT_EQUAL_STRING("/services/apexrest/sensor", transport.lastPath);
+    TEST_ASSERT_FALSE(session.lastReused());
+    TEST_ASSERT_EQUAL_UINT32(800, session.lastHandshakeMs());
+    TEST_ASSERT_EQUAL_UINT32(120, session.lastRequestMs());
+
+    TEST_ASSERT_EQUAL(200, session.request("example.my.salesforce-sites.com", "/firmware", NULL, 0));
+}
+
+void test_keep_alive_reuses_socket(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(201, post(session));
+        transport.now += 10000;
+    }
+    TEST_ASSERT_EQUAL(1, transport.lookups);
+    TEST_ASSERT_EQUAL(1, transport.connects);
+    TEST_ASSERT_EQUAL_UINT32(1, session.handshakes());
+    TEST_ASSERT_EQUAL_UINT32(5, session.requests());
+    TEST_ASSERT_TRUE(session.lastReused());
+}
+
+// Past the idle limit the socket is replaced without waiting for it to
+// fail; the address is still fresh, so no lookup
+void test_idle_socket_replaced(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+    transport.now += CONFIG.idleCloseMs;
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_FALSE(session.lastReused());
+    TEST_ASSERT_EQUAL(2, transport.connects);
+    TEST_ASSERT_EQUAL(1, transport.lookups);
+    TEST_ASSERT_EQUAL(2, transport.exchanges);
+}
+
+void test_closed_socket_reconnects(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+    transport.socketOpen = false;
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_EQUAL(2, transport.connects);
+    TEST_ASSERT_EQUAL(2, transport.exchanges);
+}
+
+// A reused socket the server already dropped fails before any response:
+// one retry on a fresh connection
+void test_stale_socket_retried_once(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+    transport.serverClosed = true;
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_TRUE(session.lastRetried());
+    TEST_ASSERT_FALSE(session.lastReused());
+    TEST_ASSERT_EQUAL(2, transport.connects);
+    TEST_ASSERT_EQUAL(3, transport.exchanges);
+
+    // Next request is back on the new socket
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_TRUE(session.lastReused());
+    TEST_ASSERT_FALSE(session.lastRetried());
+}
+
+// A failure on a fresh connection, or after the response started, is
+// returned as it is: the request may have reached the server
+void test_no_retry_when_not_stale(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    transport.failCode = ERROR_CONNECTION_LOST;
+    transport.failTimes = 1;
+    TEST_ASSERT_EQUAL(ERROR_CONNECTION_LOST, post(session));
+    TEST_ASSERT_EQUAL(1, transport.exchanges);
+
+    TEST_ASSERT_EQUAL(201, post(session));
+    transport.failCode = ERROR_READ_TIMEOUT;
+    transport.failTimes = 1;
+    TEST_ASSERT_EQUAL(ERROR_READ_TIMEOUT, post(session));
+    TEST_ASSERT_FALSE(session.lastRetried());
+    TEST_ASSERT_EQUAL(3, transport.exchanges);
+}
+
+// Stale, and the retry fails too: the retry was on a fresh socket, so
+// its error is final
+void test_retry_happens_only_once(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+    transport.failCode = ERROR_SEND_HEADER;
+    transport.failTimes = 2;
+    TEST_ASSERT_EQUAL(ERROR_SEND_HEADER, post(session));
+    TEST_ASSERT_TRUE(session.lastRetried());
+    TEST_ASSERT_EQUAL(2, transport.connects);
+    TEST_ASSERT_EQUAL(3, transport.exchanges);
+}
+
+void test_dns_cached_for_ttl(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+
+    // Reconnects inside the TTL use the cached address
+    for (int i = 0; i < 4; i++) {
+        transport.now += CONFIG.idleCloseMs;
+        TEST_ASSERT_EQUAL(201, post(session));
+    }
+    TEST_ASSERT_EQUAL(1, transport.lookups);
+    TEST_ASSERT_EQUAL(5, transport.connects);
+
+    // The first reconnect past it resolves again and uses the new address
+    transport.now += CONFIG.dnsTtlMs;
+    transport.address = 0x0A000002;
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_EQUAL(2, transport.lookups);
+    TEST_ASSERT_EQUAL_UINT32(0x0A000002, transport.connectedTo);
+
+    // A kept-alive socket outliving the TTL is still reused
+    for (int i = 0; i < 20; i++) {
+        transport.now += CONFIG.idleCloseMs / 2;
+        TEST_ASSERT_EQUAL(201, post(session));
+        TEST_ASSERT_TRUE(session.lastReused());
+    }
+    TEST_ASSERT_EQUAL(2, transport.lookups);
+}
+
+void test_dns_failure(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    transport.dnsOk = false;
+    TEST_ASSERT_EQUAL(KeepAliveSession::CONNECT_FAILED, post(session));
+    TEST_ASSERT_EQUAL(0, transport.connects);
+    TEST_ASSERT_EQUAL(0, transport.exchanges);
+
+    transport.dnsOk = true;
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_EQUAL(2, transport.lookups);
+}
+
+// A failed connect forgets the address in case the site moved
+void test_connect_failure_forgets_address(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+    transport.socketOpen = false;
+    transport.connectOk = false;
+    TEST_ASSERT_EQUAL(KeepAliveSession::CONNECT_FAILED, post(session));
+    TEST_ASSERT_EQUAL(1, transport.exchanges);
+
+    transport.connectOk = true;
+    transport.address = 0x0A000003;
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_EQUAL(2, transport.lookups);
+    TEST_ASSERT_EQUAL_UINT32(0x0A000003, transport.connectedTo);
+}
+
+void test_other_host_gets_its_own_connection(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_EQUAL(200, session.request("firmware.example.com", "/fw.bin", NULL, 0));
+    TEST_ASSERT_FALSE(session.lastReused());
+    TEST_ASSERT_EQUAL(2, transport.lookups);
+    TEST_ASSERT_EQUAL(2, transport.connects);
+    TEST_ASSERT_EQUAL_STRING("firmware.example.com", transport.sniHost);
+
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_EQUAL(3, transport.lookups);
+}
+
+void test_close_and_long_host(void) {
+    FakeTransport transport;
+    KeepAliveSession session(transport, CONFIG);
+    TEST_ASSERT_EQUAL(201, post(session));
+    session.close();
+    TEST_ASSERT_FALSE(transport.socketOpen);
+    TEST_ASSERT_EQUAL(201, post(session));
+    TEST_ASSERT_EQUAL(2, transport.connects);
+
+    char host[KeepAliveSession::HOST_MAX + 1];
+    memset(host, 'h', sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    TEST_ASSERT_EQUAL(KeepAliveSession::CONNECT_FAILED, session.request(host, "/", NULL, 0));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_request_resolves_and_connects);
+    RUN_TEST(test_keep_alive_reuses_socket);
+    RUN_TEST(test_idle_socket_replaced);
+    RUN_TEST(test_closed_socket_reconnects);
+    RUN_TEST(test_stale_socket_retried_once);
+    RUN_TEST(test_no_retry_when_not_stale);
+    RUN_TEST(test_retry_happens_only_once);
+    RUN_TEST(test_dns_cached_for_ttl);
+    RUN_TEST(test_dns_failure);
+    RUN_TEST(test_connect_failure_forgets_address);
+    RUN_TEST(test_other_host_gets_its_own_connection);
+    RUN_TEST(test_close_and_long_host);
+    return UNITY_END();
+}
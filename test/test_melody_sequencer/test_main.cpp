@@ -0,0 +1,245 @@
+#include <unity.h>
+
+#include "MelodySequencer.h"
+
+// Copies of the note tables in src/main.cpp
+constexpr Note TAP_NOTES[] = {{800, 15}};
+constexpr Note SUCCESS_NOTES[] = {{1200, 60}, {0, 40}, {1500, 80}};
+constexpr Note FAIL_NOTES[] = {{200, 150}, {0, 80}, {150, 200}};
+constexpr Note BLE_CONNECT_NOTES[] = {{523, 60}, {0, 30}, {659, 60}, {0, 30}, {784, 60}, {0, 30}, {1047, 100}};
+constexpr Note WIFI_CONNECT_NOTES[] = {{660, 200}};
+constexpr Note REPEAT_NOTES[] = {{1000, 100}, {0, 100}, {1000, 100}};
+
+constexpr Melody TAP = makeMelody(TAP_NOTES, MELODY_PRIORITY_CLICK);
+constexpr Melody SUCCESS = makeMelody(SUCCESS_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody FAIL = makeMelody(FAIL_NOTES, MELODY_PRIORITY_ALERT);
+constexpr Melody BLE_CONNECT = makeMelody(BLE_CONNECT_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody WIFI_CONNECT = makeMelody(WIFI_CONNECT_NOTES, MELODY_PRIORITY_STATUS);
+constexpr Melody REPEAT = makeMelody(REPEAT_NOTES, MELODY_PRIORITY_STATUS);
+
+static_assert(SUCCESS.length == 3, "makeMelody counts the notes");
+static_assert(FAIL.priority == MELODY_PRIORITY_ALERT, "makeMelody keeps the priority");
+
+// Tone changes as the buzzer saw them
+struct Event {
+    uint32_t atMs;
+    uint16_t frequency;
+};
+
+static uint32_t nowMs;
+static Event events[64];
+static int eventCount;
+
+static void output(uint16_t frequency) {
+    if (eventCount < 64) {
+        events[eventCount].atMs = nowMs;
+        events[eventCount].frequency = frequency;
+        eventCount++;
+    }
+}
+
+// Drive the sequencer the way the buzzer timer does: update() exactly
+// when the returned delay runs out, until it goes idle or endMs
+static void runUntil(MelodySequencer& sequencer, uint32_t endMs) {
+    uint32_t wait = sequencer.update(nowMs);
+    while (wait > 0 && nowMs + wait <= endMs) {
+        nowMs += wait;
+        wait = sequencer.update(nowMs);
+    }
+    if (nowMs < endMs) nowMs = endMs;
+}
+
+static void assertTimeline(const Event* expected, int count) {
+    TEST_ASSERT_EQUAL(count, eventCount);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i].atMs, events[i].atMs);
+        TEST_ASSERT_EQUAL_UINT16(expected[i].frequency, events[i].frequency);
+    }
+}
+
+void setUp(void) {
+    nowMs = 1000;
+    eventCount = 0;
+}
+
+void tearDown(void) {}
+
+void test_melody_duration(void) {
+    TEST_ASSERT_EQUAL_UINT32(180, melodyDuration(SUCCESS));
+    TEST_ASSERT_EQUAL_UINT32(430, melodyDuration(FAIL));
+    TEST_ASSERT_EQUAL_UINT32(370, melodyDuration(BLE_CONNECT));
+}
+
+void test_success_timeline(void) {
+    MelodySequencer sequencer(output);
+    TEST_ASSERT_TRUE(sequencer.play(SUCCESS));
+    TEST_ASSERT_TRUE(sequencer.busy());
+    runUntil(sequencer, 2000);
+    TEST_ASSERT_FALSE(sequencer.busy());
+
+    const Event expected[] = {{1000, 1200}, {1060, 0}, {1100, 1500}, {1180, 0}};
+    assertTimeline(expected, 4);
+}
+
+// play() returns at once; the melody plays out over later updates
+void test_play_does_not_block(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(BLE_CONNECT);
+    TEST_ASSERT_EQUAL_UINT32(60, sequencer.update(nowMs));
+    TEST_ASSERT_EQUAL(1, eventCount);
+    nowMs += 20;
+    TEST_ASSERT_EQUAL_UINT32(40, sequencer.update(nowMs));  // Early update just waits
+    TEST_ASSERT_EQUAL(1, eventCount);
+}
+
+// The same frequency twice across a rest is two notes, but repeated
+// updates never re-send an unchanged tone
+void test_only_changes_reach_output(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(REPEAT);
+    runUntil(sequencer, 2000);
+    const Event expected[] = {{1000, 1000}, {1100, 0}, {1200, 1000}, {1300, 0}};
+    assertTimeline(expected, 4);
+}
+
+void test_equal_priority_queues(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(WIFI_CONNECT);
+    sequencer.play(SUCCESS);
+    runUntil(sequencer, 2000);
+    const Event expected[] = {{1000, 660}, {1200, 1200}, {1260, 0}, {1300, 1500}, {1380, 0}};
+    assertTimeline(expected, 5);
+    TEST_ASSERT_EQUAL_UINT32(0, sequencer.preempted());
+}
+
+// A failure tone cuts off a tap click at once
+void test_alert_preempts_click(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(TAP);
+    sequencer.update(nowMs);
+    nowMs += 5;
+    sequencer.play(FAIL);
+    runUntil(sequencer, 2000);
+
+    const Event expected[] = {{1000, 800}, {1005, 200}, {1155, 0}, {1235, 150}, {1435, 0}};
+    assertTimeline(expected, 5);
+    TEST_ASSERT_EQUAL_UINT32(1, sequencer.preempted());
+}
+
+// A lower priority melody never interrupts; it plays afterwards
+void test_click_waits_behind_status(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(WIFI_CONNECT);
+    sequencer.update(nowMs);
+    nowMs += 50;
+    sequencer.play(TAP);
+    runUntil(sequencer, 2000);
+    const Event expected[] = {{1000, 660}, {1200, 800}, {1215, 0}};
+    assertTimeline(expected, 3);
+}
+
+// Queued melodies come out by priority, FIFO within a priority
+void test_queue_order(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(WIFI_CONNECT);
+    sequencer.update(nowMs);
+    sequencer.play(TAP);
+    sequencer.play(SUCCESS);
+    sequencer.play(REPEAT);
+    runUntil(sequencer, 3000);
+
+    TEST_ASSERT_EQUAL_UINT16(660, events[0].frequency);
+    TEST_ASSERT_EQUAL_UINT16(1200, events[1].frequency);  // SUCCESS
+    TEST_ASSERT_EQUAL_UINT32(1200, events[1].atMs);
+    TEST_ASSERT_EQUAL_UINT16(1000, events[4].frequency);  // REPEAT
+    TEST_ASSERT_EQUAL_UINT32(1380, events[4].atMs);
+    TEST_ASSERT_EQUAL_UINT16(800, events[eventCount - 2].frequency);  // TAP last
+    TEST_ASSERT_EQUAL_UINT32(1680, events[eventCount - 2].atMs);
+}
+
+// A full queue sheds its lowest priority entry for a more important
+// melody and refuses anything no more important than what it holds
+void test_full_queue(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(WIFI_CONNECT);
+    sequencer.update(nowMs);
+    for (int i = 0; i < MelodySequencer::QUEUE_SIZE; i++) TEST_ASSERT_TRUE(sequencer.play(TAP));
+    TEST_ASSERT_FALSE(sequencer.play(TAP));
+    TEST_ASSERT_EQUAL_UINT32(1, sequencer.dropped());
+
+    TEST_ASSERT_TRUE(sequencer.play(SUCCESS));
+    TEST_ASSERT_EQUAL_UINT32(2, sequencer.dropped());
+    runUntil(sequencer, 3000);
+
+    // WIFI_CONNECT, SUCCESS, then the taps that kept their place
+    uint32_t expectedEnd = 1000 + 200 + 180 + (MelodySequencer::QUEUE_SIZE - 1) * 15;
+    TEST_ASSERT_EQUAL_UINT16(0, events[eventCount - 1].frequency);
+    TEST_ASSERT_EQUAL_UINT32(expectedEnd, events[eventCount - 1].atMs);
+}
+
+// A late timer stretches the current note rather than skipping the next
+void test_late_update_stretches_note(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(SUCCESS);
+    sequencer.update(nowMs);
+    nowMs += 75;  // 15 ms late
+    TEST_ASSERT_EQUAL_UINT32(40, sequencer.update(nowMs));
+    nowMs += 40;
+    TEST_ASSERT_EQUAL_UINT32(80, sequencer.update(nowMs));
+    TEST_ASSERT_EQUAL_UINT16(1500, events[eventCount - 1].frequency);
+    TEST_ASSERT_EQUAL_UINT32(1115, events[eventCount - 1].atMs);
+}
+
+void test_stop_silences_and_clears(void) {
+    MelodySequencer sequencer(output);
+    sequencer.play(FAIL);
+    sequencer.play(SUCCESS);
+    sequencer.update(nowMs);
+    sequencer.stop();
+    TEST_ASSERT_FALSE(sequencer.busy());
+    TEST_ASSERT_EQUAL_UINT16(0, events[eventCount - 1].frequency);
+    TEST_ASSERT_EQUAL_UINT32(0, sequencer.update(nowMs + 1000));
+    TEST_ASSERT_EQUAL(2, eventCount);
+}
+
+void test_millis_wraparound(void) {
+    nowMs = UINT32_MAX - 50;
+    MelodySequencer sequencer(output);
+    sequencer.play(SUCCESS);
+    uint32_t wait = sequencer.update(nowMs);
+    int updates = 0;
+    while (wait > 0 && updates < 10) {
+        nowMs += wait;
+        wait = sequencer.update(nowMs);
+        updates++;
+    }
+    TEST_ASSERT_EQUAL(3, updates);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX - 50 + 180, events[3].atMs);
+}
+
+void test_empty_melody_and_no_output(void) {
+    MelodySequencer silent(NULL);
+    Melody empty = {NULL, 0, MELODY_PRIORITY_ALERT};
+    TEST_ASSERT_TRUE(silent.play(empty));
+    TEST_ASSERT_FALSE(silent.busy());
+    silent.play(SUCCESS);
+    TEST_ASSERT_EQUAL_UINT32(60, silent.update(nowMs));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_melody_duration);
+    RUN_TEST(test_success_timeline);
+    RUN_TEST(test_play_does_not_block);
+    RUN_TEST(test_only_changes_reach_output);
+    RUN_TEST(test_equal_priority_queues);
+    RUN_TEST(test_alert_preempts_click);
+    RUN_TEST(test_click_waits_behind_status);
+    RUN_TEST(test_queue_order);
+    RUN_TEST(test_full_queue);
+    RUN_TEST(test_late_update_stretches_note);
+    RUN_TEST(test_stop_silences_and_clears);
+    RUN_TEST(test_millis_wraparound);
+    RUN_TEST(test_empty_melody_and_no_output);
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MoistureFilter.h"
+
+// src/main.cpp's settings and probe calibration
+static const uint8_t MEDIAN_WINDOW = 5;
+static const uint8_t EMA_SHIFT = 3;
+static const uint16_t DRY_MV = 2380;
+static const uint16_t WET_MV = 1100;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_first_sample(void) {
+    MedianEmaFilter filter(MEDIAN_WINDOW, EMA_SHIFT);
+    TEST_ASSERT_EQUAL_UINT16(0, filter.value());
+    TEST_ASSERT_EQUAL_UINT32(0, filter.count());
+    TEST_ASSERT_FALSE(filter.settled());
+
+    // Starts at the first sample rather than climbing from zero
+    filter.add(1500);
+    TEST_ASSERT_EQUAL_UINT16(1500, filter.value());
+}
+
+void test_settles_after_window(void) {
+    MedianEmaFilter filter(MEDIAN_WINDOW, EMA_SHIFT);
+    for (int i = 0; i < MEDIAN_WINDOW - 1; i++) filter.add(1500);
+    TEST_ASSERT_FALSE(filter.settled());
+    filter.add(1500);
+    TEST_ASSERT_TRUE(filter.settled());
+    TEST_ASSERT_EQUAL_UINT16(1500, filter.value());
+}
+
+// Isolated spikes (pump motor, WiFi TX on the supply) never reach the
+// average
+void test_spikes_rejected(void) {
+    MedianEmaFilter filter(MEDIAN_WINDOW, EMA_SHIFT);
+    for (int i = 0; i < 20; i++) filter.add(1500);
+    for (int i = 0; i < 50; i++) filter.add(i % 5 == 0 ? 4000 : 1500);
+    TEST_ASSERT_EQUAL_UINT16(1500, filter.value());
+    filter.add(0);
+    filter.add(1500);
+    TEST_ASSERT_EQUAL_UINT16(1500, filter.value());
+    // Two in a row within the window are still outvoted
+    filter.add(4095);
+    filter.add(4095);
+    filter.add(1500);
+    TEST_ASSERT_EQUAL_UINT16(1500, filter.value());
+}
+
+void test_step_response(void) {
+    MedianEmaFilter filter(MEDIAN_WINDOW, EMA_SHIFT);
+    for (int i = 0; i < 20; i++) filter.add(1500);
+    int samples = 0;
+    while (filter.value() < 1990 && samples < 100) {
+        filter.add(2000);
+        samples++;
+    }
+    // Median delay plus about four EMA time constants
+    TEST_ASSERT_TRUE(samples >= 3);
+    TEST_ASSERT_TRUE(samples <= 40);
+    for (int i = 0; i < 40; i++) filter.add(2000);
+    TEST_ASSERT_UINT16_WITHIN(1, 2000, filter.value());
+
+    for (int i = 0; i < 200; i++) filter.add(1000);
+    TEST_ASSERT_UINT16_WITHIN(1, 1000, filter.value());
+}
+
+// Uniform noise of +/-50 mV plus 5% full-scale spikes
+void test_noisy_signal(void) {
+    MedianEmaFilter filter(MEDIAN_WINDOW, EMA_SHIFT);
+    srand(1);
+    double error = 0;
+    int n = 0;
+    for (int i = 0; i < 10000; i++) {
+        int sample = 1800 + (rand() % 101 - 50);
+        if (rand() % 20 == 0) sample = rand() % 4096;
+        filter.add((uint16_t)sample);
+        if (i > 100) {
+            error += abs((int)filter.value() - 1800);
+            n++;
+        }
+    }
+    char message[64];
+    snprintf(message, sizeof(message), "Mean absolute error %.1f mV", error / n);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(error / n < 15);
+}
+
+void test_window_clamped_and_odd(void) {
+    MedianEmaFilter even(4, 2);
+    for (int i = 0; i < 10; i++) even.add(100);
+    TEST_ASSERT_EQUAL_UINT16(100, even.value());
+
+    MedianEmaFilter zero(0, 0);  // Window 1, no smoothing
+    zero.add(10);
+    zero.add(3000);
+    TEST_ASSERT_EQUAL_UINT16(3000, zero.value());
+    TEST_ASSERT_TRUE(zero.settled());
+
+    MedianEmaFilter large(200, 3);
+    for (int i = 0; i < MedianEmaFilter::MAX_WINDOW - 1; i++) large.add(100);
+    TEST_ASSERT_FALSE(large.settled());
+    large.add(100);
+    TEST_ASSERT_TRUE(large.settled());
+}
+
+void test_full_scale(void) {
+    MedianEmaFilter filter(MEDIAN_WINDOW, EMA_SHIFT);
+    for (int i = 0; i < 100; i++) filter.add(65535);
+    TEST_ASSERT_EQUAL_UINT16(65535, filter.value());
+}
+
+void test_reset(void) {
+    MedianEmaFilter filter(MEDIAN_WINDOW, EMA_SHIFT);
+    for (int i = 0; i < 20; i++) filter.add(1500);
+    filter.reset();
+    TEST_ASSERT_EQUAL_UINT16(0, filter.value());
+    TEST_ASSERT_FALSE(filter.settled());
+    filter.add(900);
+    TEST_ASSERT_EQUAL_UINT16(900, filter.value());
+}
+
+void test_moisture_permille(void) {
+    TEST_ASSERT_EQUAL_UINT16(0, moisturePermille(DRY_MV, DRY_MV, WET_MV));
+    TEST_ASSERT_EQUAL_UINT16(1000, moisturePermille(WET_MV, DRY_MV, WET_MV));
+    TEST_ASSERT_EQUAL_UINT16(500, moisturePermille(1740, DRY_MV, WET_MV));
+    TEST_ASSERT_EQUAL_UINT16(0, moisturePermille(3000, DRY_MV, WET_MV));  // Drier than dry
+    TEST_ASSERT_EQUAL_UINT16(1000, moisturePermille(500, DRY_MV, WET_MV));
+    // The filter's empty value would read fully wet: the firmware
+    // reports no moisture until the first sample instead
+    TEST_ASSERT_EQUAL_UINT16(1000, moisturePermille(0, DRY_MV, WET_MV));
+}
+
+// Micro-benchmark: add() and value() per sample, which the moisture task
+// runs once per DMA frame and readers call at will
+void test_benchmark_add(void) {
+    MedianEmaFilter filter(MEDIAN_WINDOW, EMA_SHIFT);
+    volatile uint16_t sink = 0;
+    const int iterations = 2000000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        filter.add((uint16_t)(1500 + ((unsigned)i * 7919u) % 200u));
+        sink = filter.value();
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    (void)sink;
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    char message[64];
+    snprintf(message, sizeof(message), "%.1f ns per add + value (host)", ns);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(ns < 1000);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_sample);
+    RUN_TEST(test_settles_after_window);
+    RUN_TEST(test_spikes_rejected);
+    RUN_TEST(test_step_response);
+    RUN_TEST(test_noisy_signal);
+    RUN_TEST(test_window_clamped_and_odd);
+    RUN_TEST(test_full_scale);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_moisture_permille);
+    RUN_TEST(test_benchmark_add);
+    return UNITY_END();
+}
@@ -0,0 +1,317 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "NetworkScorer.h"
+
+class FakeBlob : public BlobStorage {
+public:
+    FakeBlob() : length(0), saves(0) {}
+
+    size_t load(void* data, size_t size) {
+        if (length == 0 || length > size) return 0;
+        memcpy(data, bytes, length);
+        return length;
+    }
+
+    bool save(const void* data, size_t n) {
+        saves++;
+        if (n > sizeof(bytes)) return false;
+        memcpy(bytes, data, n);
+        length = n;
+        return true;
+    }
+
+    uint8_t bytes[1024];
+    size_t length;
+    int saves;
+};
+
+static const uint8_t HOME_2G[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+static const uint8_t HOME_5G[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x02};
+static const uint8_t SHED[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x03};
+static const uint8_t CAFE[6] = {0x7C, 0xDF, 0xA1, 0x00, 0x00, 0x04};
+
+static ScanEntry entry(const char* ssid, const uint8_t* bssid, int8_t rssi, uint8_t preference = 50) {
+    ScanEntry e = {ssid, bssid, rssi, preference};
+    return e;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// With no history the signal decides; the caller's preference is worth
+// about 10 dB
+void test_unseen_networks_rank_by_rssi(void) {
+    ScanEntry strong = entry("Home", HOME_2G, -55);
+    ScanEntry weak = entry("Home", HOME_5G, -85);
+    TEST_ASSERT_GREATER_THAN(scoreNetwork(weak, NULL), scoreNetwork(strong, NULL));
+
+    ScanEntry preferred = entry("Home", HOME_2G, -70, 100);
+    ScanEntry open = entry("Cafe", CAFE, -68, 0);
+    TEST_ASSERT_GREATER_THAN(scoreNetwork(open, NULL), scoreNetwork(preferred, NULL));
+    ScanEntry nearOpen = entry("Cafe", CAFE, -55, 0);
+    TEST_ASSERT_GREATER_THAN(scoreNetwork(preferred, NULL), scoreNetwork(nearOpen, NULL));
+}
+
+void test_score_bounds(void) {
+    NetworkStats perfect;
+    memset(&perfect, 0, sizeof(perfect));
+    perfect.attempts = perfect.connects = 32;
+    perfect.posts = perfect.postsOk = 32;
+    perfect.connectMs = 0;
+    ScanEntry best = entry("Home", HOME_2G, -20, 255);
+    TEST_ASSERT_LESS_OR_EQUAL(SCORE_MAX, scoreNetwork(best, &perfect));
+
+    NetworkStats hopeless;
+    memset(&hopeless, 0, sizeof(hopeless));
+    hopeless.attempts = 32;
+    hopeless.posts = 32;
+    ScanEntry worst = entry("Home", HOME_2G, -127, 0);
+    TEST_ASSERT_LESS_THAN(100, scoreNetwork(worst, &hopeless));
+
+    // Clamped at the RSSI ceiling and the preference limit
+    TEST_ASSERT_EQUAL_UINT16(scoreNetwork(entry("Home", HOME_2G, -50, 100), NULL), scoreNetwork(best, NULL));
+}
+
+// One failure doesn't bury a network: the 50% prior keeps it close to
+// an unseen one
+void test_single_failure_is_smoothed(void) {
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    scorer.recordConnect("Home", HOME_2G, false, 7500);
+    ScanEntry home = entry("Home", HOME_2G, -60);
+    uint16_t unseen = scoreNetwork(home, NULL);
+    uint16_t once = scorer.score(home);
+    TEST_ASSERT_LESS_THAN(unseen, once);
+    TEST_ASSERT_GREATER_THAN(unseen - 80, once);
+}
+
+// A strong AP that keeps timing out falls behind a weaker one that
+// connects quickly and posts reliably
+void test_history_overrides_rssi(void) {
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    ScanEntry scan[] = {entry("Home", HOME_5G, -58), entry("Home", HOME_2G, -72)};
+    uint8_t order[2];
+    scorer.rank(scan, 2, order);
+    TEST_ASSERT_EQUAL(0, order[0]);
+
+    for (int i = 0; i < 6; i++) {
+        scorer.recordConnect("Home", HOME_5G, false, 7500);
+        scorer.recordConnect("Home", HOME_2G, true, 1800);
+        scorer.recordPost("Home", HOME_2G, true);
+    }
+    scorer.rank(scan, 2, order);
+    TEST_ASSERT_EQUAL(1, order[0]);
+}
+
+void test_connect_time_matters(void) {
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    for (int i = 0; i < 4; i++) {
+        scorer.recordConnect("Home", HOME_2G, true, 900);
+        scorer.recordConnect("Shed", SHED, true, 6000);
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 900, scorer.find("Home", HOME_2G)->connectMs);
+    TEST_ASSERT_UINT32_WITHIN(1, 6000, scorer.find("Shed", SHED)->connectMs);
+    TEST_ASSERT_GREATER_THAN(scorer.score(entry("Shed", SHED, -65)), scorer.score(entry("Home", HOME_2G, -65)));
+}
+
+// The moving average follows roughly the last four connects
+void test_connect_time_average(void) {
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    scorer.recordConnect("Home", HOME_2G, true, 4000);
+    TEST_ASSERT_EQUAL_UINT16(4000, scorer.find("Home", HOME_2G)->connectMs);
+    scorer.recordConnect("Home", HOME_2G, false, 7500);  // Failures don't count
+    TEST_ASSERT_EQUAL_UINT16(4000, scorer.find("Home", HOME_2G)->connectMs);
+    for (int i = 0; i < 12; i++) scorer.recordConnect("Home", HOME_2G, true, 1000);
+    TEST_ASSERT_UINT32_WITHIN(100, 1000, scorer.find("Home", HOME_2G)->connectMs);
+    scorer.recordConnect("Home", HOME_2G, true, 200000);  // Clamped to 16 bits
+    TEST_ASSERT_LESS_OR_EQUAL(0xFFFF, scorer.find("Home", HOME_2G)->connectMs);
+}
+
+// Counts halve at HISTORY_MAX so an AP that recovers is trusted again
+void test_history_halves(void) {
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    for (int i = 0; i < NetworkScorer::HISTORY_MAX; i++) scorer.recordConnect("Home", HOME_2G, false, 7500);
+    const NetworkStats* stats = scorer.find("Home", HOME_2G);
+    TEST_ASSERT_EQUAL(NetworkScorer::HISTORY_MAX, stats->attempts);
+    scorer.recordConnect("Home", HOME_2G, true, 1000);
+    TEST_ASSERT_EQUAL(NetworkScorer::HISTORY_MAX / 2 + 1, stats->attempts);
+    TEST_ASSERT_EQUAL(1, stats->connects);
+
+    for (int i = 0; i < 3 * NetworkScorer::HISTORY_MAX; i++) scorer.recordPost("Home", HOME_2G, i % 4 != 0);
+    TEST_ASSERT_LESS_OR_EQUAL(NetworkScorer::HISTORY_MAX, stats->posts);
+    TEST_ASSERT_UINT32_WITHIN(3, stats->posts * 3 / 4, stats->postsOk);
+}
+
+// Each BSSID of an SSID has its own history; an unknown BSSID is kept
+// separately from the known ones
+void test_per_bssid_history(void) {
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    scorer.recordConnect("Home", HOME_2G, true, 1000);
+    scorer.recordConnect("Home", NULL, false, 7500);
+    TEST_ASSERT_EQUAL(2, scorer.count());
+    TEST_ASSERT_EQUAL(1, scorer.find("Home", HOME_2G)->connects);
+    TEST_ASSERT_NULL(scorer.find("Home", HOME_5G));
+    TEST_ASSERT_EQUAL(0, scorer.find("Home", NULL)->connects);
+    TEST_ASSERT_NULL(scorer.find("Other", HOME_2G));
+
+    scorer.recordConnect("", HOME_2G, true, 1000);  // Hidden SSIDs aren't tracked
+    scorer.recordPost(NULL, HOME_2G, true);
+    TEST_ASSERT_EQUAL(2, scorer.count());
+}
+
+// Outcomes collect in RAM; flush() writes once and only when dirty
+void test_persistence(void) {
+    FakeBlob blob;
+    {
+        NetworkScorer scorer(blob);
+        TEST_ASSERT_FALSE(scorer.begin());
+        TEST_ASSERT_TRUE(scorer.flush());
+        TEST_ASSERT_EQUAL(0, blob.saves);
+
+        scorer.recordConnect("Home", HOME_2G, true, 1500);
+        scorer.recordPost("Home", HOME_2G, true);
+        scorer.recordConnect("Shed", SHED, false, 7500);
+        TEST_ASSERT_TRUE(scorer.dirty());
+        TEST_ASSERT_TRUE(scorer.flush());
+        TEST_ASSERT_TRUE(scorer.flush());
+        TEST_ASSERT_EQUAL(1, blob.saves);
+        TEST_ASSERT_FALSE(scorer.dirty());
+    }
+
+    NetworkScorer reloaded(blob);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL(2, reloaded.count());
+    const NetworkStats* home = reloaded.find("Home", HOME_2G);
+    TEST_ASSERT_NOT_NULL(home);
+    TEST_ASSERT_EQUAL(1, home->postsOk);
+    TEST_ASSERT_EQUAL_UINT16(1500, home->connectMs);
+
+    // A damaged record is dropped, not half-used
+    blob.bytes[blob.length - 1] ^= 1;
+    NetworkScorer damaged(blob);
+    TEST_ASSERT_FALSE(damaged.begin());
+    TEST_ASSERT_EQUAL(0, damaged.count());
+}
+
+// The least recently used AP makes room, and use order survives a reload
+void test_lru_eviction(void) {
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    char ssid[16];
+    for (int i = 0; i < NetworkScorer::CAPACITY; i++) {
+        snprintf(ssid, sizeof(ssid), "AP-%02d", i);
+        scorer.recordConnect(ssid, NULL, true, 1000);
+    }
+    scorer.recordPost("AP-00", NULL, true);  // Used again: now the newest
+    scorer.flush();
+
+    NetworkScorer reloaded(blob);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    reloaded.recordConnect("New", NULL, true, 1000);
+    TEST_ASSERT_EQUAL(NetworkScorer::CAPACITY, reloaded.count());
+    TEST_ASSERT_NOT_NULL(reloaded.find("AP-00", NULL));
+    TEST_ASSERT_NULL(reloaded.find("AP-01", NULL));
+    TEST_ASSERT_NOT_NULL(reloaded.find("New", NULL));
+}
+
+void test_rank_is_stable(void) {
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    ScanEntry scan[] = {entry("A", NULL, -60), entry("B", NULL, -80), entry("C", NULL, -60), entry("D", NULL, -40)};
+    uint8_t order[4];
+    TEST_ASSERT_EQUAL(4, scorer.rank(scan, 4, order));
+    TEST_ASSERT_EQUAL(3, order[0]);
+    TEST_ASSERT_EQUAL(0, order[1]);  // Tie keeps scan order
+    TEST_ASSERT_EQUAL(2, order[2]);
+    TEST_ASSERT_EQUAL(1, order[3]);
+    TEST_ASSERT_EQUAL(0, scorer.rank(scan, 0, order));
+}
+
+// Simulated site: each AP fails on a fixed pattern (every n-th attempt)
+// and otherwise connects in a fixed time. connectWiFi() tries
+// candidates in order, 7.5 s per failure, until one connects.
+struct SimulatedAp {
+    ScanEntry scan;
+    int failEvery;  // 1 = always fails, 0 = never
+    uint32_t connectMs;
+};
+
+static uint32_t connectInOrder(NetworkScorer* scorer, const SimulatedAp* aps, uint8_t count, int round) {
+    ScanEntry scan[8];
+    uint8_t order[8];
+    for (uint8_t i = 0; i < count; i++) {
+        scan[i] = aps[i].scan;
+        order[i] = i;
+    }
+    if (scorer) scorer->rank(scan, count, order);
+
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const SimulatedAp& ap = aps[order[i]];
+        bool fails = ap.failEvery == 1 || (ap.failEvery > 1 && round % ap.failEvery == 0);
+        uint32_t elapsed = fails ? 7500 : ap.connectMs;
+        total += elapsed;
+        if (scorer) scorer->recordConnect(ap.scan.ssid, ap.scan.bssid, !fails, elapsed);
+        if (!fails) break;
+    }
+    return total;
+}
+
+// Saved-slot order against scored order over a week of hourly connects
+void test_simulated_site(void) {
+    const SimulatedAp site[] = {
+        {entry("Home", HOME_5G, -84, 100), 1, 0},     // Saved first, out of range in the yard
+        {entry("Shed", SHED, -71, 100), 3, 2500},     // Flaky extender
+        {entry("Home", HOME_2G, -66, 100), 0, 1200},  // Reliable
+        {entry("Cafe", CAFE, -88, 0), 0, 3000},       // Open network over the road
+    };
+    const int rounds = 24 * 7;
+
+    uint32_t slotOrderMs = 0;
+    for (int round = 0; round < rounds; round++) slotOrderMs += connectInOrder(NULL, site, 4, round);
+
+    FakeBlob blob;
+    NetworkScorer scorer(blob);
+    scorer.begin();
+    uint32_t scoredMs = 0;
+    for (int round = 0; round < rounds; round++) scoredMs += connectInOrder(&scorer, site, 4, round);
+
+    char message[96];
+    snprintf(message, sizeof(message), "Average connect: saved order %lu ms, scored order %lu ms",
+             (unsigned long)(slotOrderMs / rounds), (unsigned long)(scoredMs / rounds));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(slotOrderMs / 3, scoredMs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unseen_networks_rank_by_rssi);
+    RUN_TEST(test_score_bounds);
+    RUN_TEST(test_single_failure_is_smoothed);
+    RUN_TEST(test_history_overrides_rssi);
+    RUN_TEST(test_connect_time_matters);
+    RUN_TEST(test_connect_time_average);
+    RUN_TEST(test_history_halves);
+    RUN_TEST(test_per_bssid_history);
+    RUN_TEST(test_persistence);
+    RUN_TEST(test_lru_eviction);
+    RUN_TEST(test_rank_is_stable);
+    RUN_TEST(test_simulated_site);
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "NmeaStream.h"
+
+// SIM7000 output with AT+CGNSTST=1: a cold start with no fix, then two
+// epochs with one. The GSV and proprietary sentences are ignored.
+static const char* const RECORDED_LOG[] = {
+    "$GNGGA,101500.000,,,,,0,0,,,M,,M,,*53",
+    "$GNRMC,101500.000,V,,,,,0.00,0.00,170926,,,N*5D",
+    "$GNGSA,A,1,,,,,,,,,,,,,99.9,99.9,99.9,1*0A",
+    "$GPGSV,1,1,02,05,40,083,,12,20,150,,0*68",
+    "$GNGGA,101501.000,3746.4957,N,12225.1651,W,1,07,1.10,16.2,M,-25.6,M,,*76",
+    "$GNGSA,A,3,05,12,15,18,24,25,29,,,,,,1.90,1.10,1.55,1*09",
+    "$GNRMC,101501.000,A,3746.4957,N,12225.1651,W,0.12,41.20,170926,,,A*55",
+    "$GNGGA,101502.000,3746.4960,N,12225.1648,W,1,08,0.95,16.4,M,-25.6,M,,*7C",
+    "$GNRMC,101502.000,A,3746.4960,N,12225.1648,W,27.00,90.00,170926,,,A*62",
+    "$PSIMIPR,W,115200*1C",
+};
+static const size_t LOG_LINES = sizeof(RECORDED_LOG) / sizeof(RECORDED_LOG[0]);
+
+static GnssFix epochs[8];
+static size_t epochCount;
+
+static void collect(NmeaParser& parser, bool completed) {
+    if (completed && epochCount < 8) epochs[epochCount++] = parser.fix();
+}
+
+static void feedLine(NmeaParser& parser, const char* line, uint32_t nowMs) {
+    for (const char* p = line; *p; p++) collect(parser, parser.feed(*p, nowMs));
+    collect(parser, parser.feed('\r', nowMs));
+    collect(parser, parser.feed('\n', nowMs));
+}
+
+void setUp(void) {
+    memset(epochs, 0, sizeof(epochs));
+    epochCount = 0;
+}
+
+void tearDown(void) {}
+
+static void assertRecordedEpochs(const NmeaParser& parser) {
+    TEST_ASSERT_EQUAL(3, epochCount);
+    TEST_ASSERT_EQUAL(0, parser.checksumErrors());
+
+    TEST_ASSERT_FALSE(epochs[0].valid);
+    TEST_ASSERT_EQUAL_UINT32(10150000, epochs[0].utcTime);
+
+    const GnssFix& fix = epochs[1];
+    TEST_ASSERT_TRUE(fix.valid);
+    TEST_ASSERT_EQUAL_UINT32(10150100, fix.utcTime);
+    TEST_ASSERT_EQUAL_UINT32(170926, fix.utcDate);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 37.774928, fix.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, -122.419418, fix.longitude);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 16.2f, fix.altitude);
+    TEST_ASSERT_EQUAL(7, fix.satellitesUsed);
+    TEST_ASSERT_EQUAL(3, fix.fixMode);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.10f, fix.hdop);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.90f, fix.pdop);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.55f, fix.vdop);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.12f * 1.852f, fix.speedKmh);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 41.2f, fix.course);
+
+    TEST_ASSERT_TRUE(epochs[2].valid);
+    TEST_ASSERT_EQUAL(8, epochs[2].satellitesUsed);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 27.0f * 1.852f, epochs[2].speedKmh);
+}
+
+void test_recorded_log_by_line(void) {
+    NmeaParser parser;
+    for (size_t i = 0; i < LOG_LINES; i++) collect(parser, parser.parse(RECORDED_LOG[i], 1000 + i));
+    assertRecordedEpochs(parser);
+    TEST_ASSERT_EQUAL(9, parser.sentences());
+}
+
+void test_recorded_log_by_byte(void) {
+    NmeaParser parser;
+    for (size_t i = 0; i < LOG_LINES; i++) feedLine(parser, RECORDED_LOG[i], 1000 + i);
+    assertRecordedEpochs(parser);
+}
+
+// RMC before GGA completes the epoch just the same, once
+void test_epoch_order_independent(void) {
+    NmeaParser parser;
+    collect(parser, parser.parse(RECORDED_LOG[6], 1));  // RMC 101501
+    collect(parser, parser.parse(RECORDED_LOG[5], 2));  // GSA
+    collect(parser, parser.parse(RECORDED_LOG[4], 3));  // GGA 101501
+    collect(parser, parser.parse(RECORDED_LOG[4], 4));  // Repeat
+    TEST_ASSERT_EQUAL(1, epochCount);
+    TEST_ASSERT_TRUE(epochs[0].valid);
+    TEST_ASSERT_EQUAL_UINT32(3, epochs[0].updatedMs);
+}
+
+void test_bad_checksum_dropped(void) {
+    NmeaParser parser;
+    char line[NmeaParser::SENTENCE_MAX];
+    strcpy(line, RECORDED_LOG[4]);
+    line[20] = '8';  // 3746.4957 -> 3746.8957
+    TEST_ASSERT_FALSE(parser.parse(line, 0));
+    TEST_ASSERT_FALSE(parser.parse("$GNRMC,101501.000,A*ZZ", 0));
+    TEST_ASSERT_EQUAL(2, parser.checksumErrors());
+    TEST_ASSERT_EQUAL(0, parser.sentences());
+}
+
+// Lines cut off anywhere in the checksum, including with the '*' in the
+// last byte the line buffer holds
+void test_truncated_sentences(void) {
+    NmeaParser parser;
+    TEST_ASSERT_FALSE(parser.parse("$GNGGA,101501.000,3746.4957,N", 0));
+    TEST_ASSERT_FALSE(parser.parse("$GNGGA,101501.000,3746.4957,N*", 0));
+    TEST_ASSERT_FALSE(parser.parse("$GNGGA,101501.000,3746.4957,N*7", 0));
+    TEST_ASSERT_EQUAL(3, parser.checksumErrors());
+
+    char line[NmeaParser::SENTENCE_MAX];
+    memset(line, 'A', sizeof(line));
+    memcpy(line, "$GNTXT,", 7);
+    line[NmeaParser::SENTENCE_MAX - 2] = '*';
+    line[NmeaParser::SENTENCE_MAX - 1] = '\0';
+    feedLine(parser, line, 0);
+    TEST_ASSERT_EQUAL(4, parser.checksumErrors());
+    TEST_ASSERT_EQUAL(0, epochCount);
+
+    // The stream recovers on the next sentence
+    feedLine(parser, RECORDED_LOG[4], 1);
+    feedLine(parser, RECORDED_LOG[6], 2);
+    TEST_ASSERT_EQUAL(1, epochCount);
+    TEST_ASSERT_TRUE(epochs[0].valid);
+}
+
+// Longer than the line buffer: the stream keeps the start and drops the
+// sentence; parse() rejects a checksum past SENTENCE_MAX outright
+void test_overlong_sentences(void) {
+    NmeaParser parser;
+    char line[200];
+    strcpy(line, "$GNGGA,101501.000,3746.4957,N,12225.1651,W,1,07,1.10,16.2,M,-25.6,M,,");
+    size_t length = strlen(line);
+    while (length < 180) line[length++] = ',';
+    line[length] = '\0';
+    uint8_t sum = 0;
+    for (const char* p = line + 1; *p; p++) sum ^= (uint8_t)*p;
+    static const char hex[] = "0123456789ABCDEF";
+    line[length++] = '*';
+    line[length++] = hex[sum >> 4];
+    line[length++] = hex[sum & 0x0F];
+    line[length] = '\0';
+
+    TEST_ASSERT_FALSE(parser.parse(line, 0));
+    TEST_ASSERT_EQUAL(1, parser.checksumErrors());
+
+    feedLine(parser, line, 0);
+    TEST_ASSERT_EQUAL(2, parser.checksumErrors());
+    TEST_ASSERT_EQUAL(0, parser.sentences());
+
+    // A '$' mid-line resyncs onto the sentence that follows
+    feedLine(parser, "$GNGGA,1015$GNGGA,101501.000,3746.4957,N,12225.1651,W,1,07,1.10,16.2,M,-25.6,M,,*76", 1);
+    feedLine(parser, RECORDED_LOG[6], 2);
+    TEST_ASSERT_EQUAL(1, epochCount);
+    TEST_ASSERT_TRUE(epochs[0].valid);
+}
+
+void test_lost_fix(void) {
+    NmeaParser parser;
+    collect(parser, parser.parse(RECORDED_LOG[4], 1));
+    collect(parser, parser.parse(RECORDED_LOG[6], 2));
+    collect(parser, parser.parse(RECORDED_LOG[0], 3));  // Quality 0
+    collect(parser, parser.parse("$GNRMC,101503.000,V,,,,,0.00,0.00,170926,,,N*5E", 4));
+    collect(parser, parser.parse("$GNGGA,101503.000,,,,,0,0,,,M,,M,,*50", 5));
+    TEST_ASSERT_EQUAL(2, epochCount);
+    TEST_ASSERT_TRUE(epochs[0].valid);
+    TEST_ASSERT_FALSE(epochs[1].valid);
+}
+
+void test_latest_fix(void) {
+    LatestFix latest;
+    GnssFix out;
+    TEST_ASSERT_FALSE(latest.read(out));
+
+    GnssFix fix;
+    memset(&fix, 0, sizeof(fix));
+    fix.valid = true;
+    fix.latitude = 1.5;
+    latest.publish(fix);
+    TEST_ASSERT_TRUE(latest.read(out));
+    TEST_ASSERT_TRUE(out.valid);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 1.5, out.latitude);
+}
+
+void test_fix_history_interval_by_speed(void) {
+    TEST_ASSERT_EQUAL_UINT32(60000, FixHistory::intervalMs(0.5f));
+    TEST_ASSERT_EQUAL_UINT32(15000, FixHistory::intervalMs(5.0f));
+    TEST_ASSERT_EQUAL_UINT32(5000, FixHistory::intervalMs(30.0f));
+    TEST_ASSERT_EQUAL_UINT32(1000, FixHistory::intervalMs(90.0f));
+
+    FixHistory history;
+    GnssFix fix;
+    memset(&fix, 0, sizeof(fix));
+    TEST_ASSERT_FALSE(history.offer(fix, 0));  // Invalid
+
+    fix.valid = true;
+    TEST_ASSERT_TRUE(history.offer(fix, 0));
+    TEST_ASSERT_FALSE(history.offer(fix, 59999));
+    TEST_ASSERT_TRUE(history.offer(fix, 60000));
+    fix.speedKmh = 90.0f;
+    TEST_ASSERT_TRUE(history.offer(fix, 61000));
+    TEST_ASSERT_EQUAL(3, history.count());
+}
+
+void test_fix_history_wraps(void) {
+    FixHistory history;
+    GnssFix fix;
+    memset(&fix, 0, sizeof(fix));
+    fix.valid = true;
+    fix.speedKmh = 90.0f;
+    for (uint32_t i = 0; i < FixHistory::CAPACITY + 5; i++) {
+        fix.utcTime = i;
+        TEST_ASSERT_TRUE(history.offer(fix, i * 1000));
+    }
+    TEST_ASSERT_EQUAL(FixHistory::CAPACITY, history.count());
+    TEST_ASSERT_EQUAL_UINT32(5, history.at(0).utcTime);
+    TEST_ASSERT_EQUAL_UINT32(FixHistory::CAPACITY + 4, history.at(FixHistory::CAPACITY - 1).utcTime);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_recorded_log_by_line);
+    RUN_TEST(test_recorded_log_by_byte);
+    RUN_TEST(test_epoch_order_independent);
+    RUN_TEST(test_bad_checksum_dropped);
+    RUN_TEST(test_truncated_sentences);
+    RUN_TEST(test_overlong_sentences);
+    RUN_TEST(test_lost_fix);
+    RUN_TEST(test_latest_fix);
+    RUN_TEST(test_fix_history_interval_by_speed);
+    RUN_TEST(test_fix_history_wraps);
+    return UNITY_END();
+}
@@ -0,0 +1,197 @@
+#include <unity.h>
+
+#include <stdio.h>
+
+#include "PowerGovernor.h"
+
+static const uint32_t HOLD_MS = 3000;  // src/main.cpp's POWER_HOLD_MS
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_level_for_demands(void) {
+    TEST_ASSERT_EQUAL(POWER_LOW, powerLevelFor(0));
+    TEST_ASSERT_EQUAL(POWER_MEDIUM, powerLevelFor(1 << POWER_DEMAND_WORK));
+    TEST_ASSERT_EQUAL(POWER_HIGH, powerLevelFor(1 << POWER_DEMAND_TLS));
+    TEST_ASSERT_EQUAL(POWER_HIGH, powerLevelFor(1 << POWER_DEMAND_OTA));
+    TEST_ASSERT_EQUAL(POWER_HIGH, powerLevelFor(1 << POWER_DEMAND_BLE));
+    TEST_ASSERT_EQUAL(POWER_HIGH, powerLevelFor(1 << POWER_DEMAND_BLE | 1 << POWER_DEMAND_WORK));
+}
+
+// Boot starts high; with nothing pending it steps down after the hold
+void test_boot_steps_down_after_hold(void) {
+    PowerGovernor governor(HOLD_MS, POWER_HIGH, 0);
+    TEST_ASSERT_FALSE(governor.update(100));
+    TEST_ASSERT_FALSE(governor.update(100 + HOLD_MS - 1));
+    TEST_ASSERT_EQUAL(POWER_HIGH, governor.level());
+    TEST_ASSERT_TRUE(governor.update(100 + HOLD_MS));
+    TEST_ASSERT_EQUAL(POWER_LOW, governor.level());
+    TEST_ASSERT_EQUAL_UINT32(1, governor.transitions());
+}
+
+void test_steps_up_immediately(void) {
+    PowerGovernor governor(HOLD_MS, POWER_LOW, 0);
+    governor.set(POWER_DEMAND_WORK, true);
+    TEST_ASSERT_TRUE(governor.update(10));
+    TEST_ASSERT_EQUAL(POWER_MEDIUM, governor.level());
+    governor.acquire(POWER_DEMAND_TLS);
+    TEST_ASSERT_TRUE(governor.update(20));
+    TEST_ASSERT_EQUAL(POWER_HIGH, governor.level());
+    TEST_ASSERT_FALSE(governor.update(30));
+}
+
+// Two handshakes overlap: the level holds until both have released
+void test_counted_demands(void) {
+    PowerGovernor governor(HOLD_MS, POWER_LOW, 0);
+    governor.acquire(POWER_DEMAND_TLS);
+    governor.acquire(POWER_DEMAND_TLS);
+    governor.update(0);
+    governor.release(POWER_DEMAND_TLS);
+    TEST_ASSERT_EQUAL(1 << POWER_DEMAND_TLS, governor.demands());
+    TEST_ASSERT_FALSE(governor.update(HOLD_MS * 2));
+    TEST_ASSERT_EQUAL(POWER_HIGH, governor.level());
+    governor.release(POWER_DEMAND_TLS);
+    governor.release(POWER_DEMAND_TLS);  // Extra release is ignored
+    TEST_ASSERT_EQUAL(0, governor.demands());
+    governor.acquire(POWER_DEMAND_TLS);
+    TEST_ASSERT_EQUAL(1 << POWER_DEMAND_TLS, governor.demands());
+}
+
+// Polled demands are on or off, whatever they were set to before
+void test_set_is_not_counted(void) {
+    PowerGovernor governor(HOLD_MS, POWER_LOW, 0);
+    governor.set(POWER_DEMAND_BLE, true);
+    governor.set(POWER_DEMAND_BLE, true);
+    governor.set(POWER_DEMAND_BLE, false);
+    TEST_ASSERT_EQUAL(0, governor.demands());
+}
+
+// Back-to-back jobs don't flap the clock: a demand inside the hold
+// restarts it
+void test_hold_restarts(void) {
+    PowerGovernor governor(HOLD_MS, POWER_LOW, 0);
+    governor.acquire(POWER_DEMAND_TLS);
+    governor.update(0);
+    governor.release(POWER_DEMAND_TLS);
+    TEST_ASSERT_FALSE(governor.update(1000));
+    governor.acquire(POWER_DEMAND_TLS);
+    TEST_ASSERT_FALSE(governor.update(2000));
+    governor.release(POWER_DEMAND_TLS);
+    TEST_ASSERT_FALSE(governor.update(2500));
+    TEST_ASSERT_FALSE(governor.update(2500 + HOLD_MS - 1));
+    TEST_ASSERT_TRUE(governor.update(2500 + HOLD_MS));
+    TEST_ASSERT_EQUAL(POWER_LOW, governor.level());
+    TEST_ASSERT_EQUAL_UINT32(2, governor.transitions());
+}
+
+// From high with work still pending it goes to medium, not low
+void test_steps_down_one_target(void) {
+    PowerGovernor governor(HOLD_MS, POWER_LOW, 0);
+    governor.set(POWER_DEMAND_WORK, true);
+    governor.acquire(POWER_DEMAND_TLS);
+    governor.update(0);
+    governor.release(POWER_DEMAND_TLS);
+    governor.update(100);
+    TEST_ASSERT_TRUE(governor.update(100 + HOLD_MS));
+    TEST_ASSERT_EQUAL(POWER_MEDIUM, governor.level());
+    governor.set(POWER_DEMAND_WORK, false);
+    governor.update(5000);
+    TEST_ASSERT_TRUE(governor.update(5000 + HOLD_MS));
+    TEST_ASSERT_EQUAL(POWER_LOW, governor.level());
+}
+
+void test_time_counters(void) {
+    PowerGovernor governor(HOLD_MS, POWER_HIGH, 0);
+    governor.update(100);
+    governor.update(3100);  // low
+    governor.set(POWER_DEMAND_WORK, true);
+    governor.update(3200);  // medium
+    governor.acquire(POWER_DEMAND_TLS);
+    governor.update(3300);  // high
+    governor.release(POWER_DEMAND_TLS);
+    governor.update(3500);
+    governor.update(6500);  // medium
+    governor.set(POWER_DEMAND_WORK, false);
+    governor.update(7000);
+    governor.update(10000);  // low
+
+    uint32_t now = 14000;
+    uint64_t low = governor.timeInMs(POWER_LOW, now);
+    uint64_t medium = governor.timeInMs(POWER_MEDIUM, now);
+    uint64_t high = governor.timeInMs(POWER_HIGH, now);
+    TEST_ASSERT_EQUAL_UINT32(now, (uint32_t)(low + medium + high));
+    TEST_ASSERT_EQUAL_UINT32(3100 + 3200, (uint32_t)high);
+    TEST_ASSERT_EQUAL_UINT32(100 + 3500, (uint32_t)medium);
+    TEST_ASSERT_EQUAL_UINT32(100 + 4000, (uint32_t)low);
+    TEST_ASSERT_EQUAL_UINT32(5, governor.transitions());
+}
+
+void test_timer_wraparound(void) {
+    uint32_t start = 0xFFFFF000u;
+    PowerGovernor governor(HOLD_MS, POWER_HIGH, start);
+    governor.update(start + 100);
+    TEST_ASSERT_FALSE(governor.update(start + 100 + HOLD_MS - 1));
+    TEST_ASSERT_TRUE(governor.update(start + 100 + HOLD_MS));  // Past zero
+    TEST_ASSERT_EQUAL_UINT32(100 + HOLD_MS, (uint32_t)governor.timeInMs(POWER_HIGH, start + 10000));
+}
+
+void test_level_names(void) {
+    TEST_ASSERT_EQUAL_STRING("low", powerLevelName(POWER_LOW));
+    TEST_ASSERT_EQUAL_STRING("medium", powerLevelName(POWER_MEDIUM));
+    TEST_ASSERT_EQUAL_STRING("high", powerLevelName(POWER_HIGH));
+}
+
+// An hour of one reading a minute: 5 s of network work with a 2 s TLS
+// handshake in it, polled every 100 ms like powerTask(). Current draw
+// per level is a rough figure for an ESP32 with WiFi associated
+// (assumed, not measured here): 240 MHz without modem sleep ~120 mA,
+// 160 MHz with modem sleep ~35 mA, 80 MHz with modem and light sleep
+// ~4 mA average.
+void test_benchmark_hour_of_uploads(void) {
+    const double MA[POWER_LEVELS] = {4, 35, 120};
+    const uint32_t hourMs = 3600000;
+
+    PowerGovernor governor(HOLD_MS, POWER_LOW, 0);
+    for (uint32_t t = 0; t < hourMs; t += 100) {
+        uint32_t phase = t % 60000;
+        governor.set(POWER_DEMAND_WORK, phase < 5000);
+        governor.set(POWER_DEMAND_TLS, phase >= 500 && phase < 2500);
+        governor.update(t);
+    }
+
+    double governedMah = 0;
+    for (int level = 0; level < POWER_LEVELS; level++) {
+        governedMah += MA[level] * governor.timeInMs((PowerLevel)level, hourMs) / 3600000.0;
+    }
+    double fixedMah = MA[POWER_HIGH];
+
+    char message[160];
+    snprintf(message, sizeof(message),
+             "Hour: low=%llus medium=%llus high=%llus transitions=%lu, ~%.1f mAh vs %.0f mAh fixed",
+             (unsigned long long)(governor.timeInMs(POWER_LOW, hourMs) / 1000),
+             (unsigned long long)(governor.timeInMs(POWER_MEDIUM, hourMs) / 1000),
+             (unsigned long long)(governor.timeInMs(POWER_HIGH, hourMs) / 1000),
+             (unsigned long)governor.transitions(), governedMah, fixedMah);
+    TEST_MESSAGE(message);
+    // low, medium, high, then straight back to low: the work ends inside
+    // the hold after the handshake
+    TEST_ASSERT_EQUAL_UINT32(60 * 3, governor.transitions());
+    TEST_ASSERT_TRUE(governor.timeInMs(POWER_LOW, hourMs) > hourMs * 8 / 10);
+    TEST_ASSERT_TRUE(governedMah * 4 < fixedMah);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_level_for_demands);
+    RUN_TEST(test_boot_steps_down_after_hold);
+    RUN_TEST(test_steps_up_immediately);
+    RUN_TEST(test_counted_demands);
+    RUN_TEST(test_set_is_not_counted);
+    RUN_TEST(test_hold_restarts);
+    RUN_TEST(test_steps_down_one_target);
+    RUN_TEST(test_time_counters);
+    RUN_TEST(test_timer_wraparound);
+    RUN_TEST(test_level_names);
+    RUN_TEST(test_benchmark_hour_of_uploads);
+    return UNITY_END();
+}
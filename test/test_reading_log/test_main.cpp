@@ -0,0 +1,413 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ReadingLog.h"
+
+// NOR flash backed by a temporary file. Writes can only clear bits, an
+// erase sets a whole sector to 0xFF, and a power cut can be armed to
+// stop after a given number of written bytes: the write in progress is
+// torn there and everything after it fails until power is restored.
+class FileFlash : public FlashDevice {
+public:
+    FileFlash(uint32_t size, uint32_t sectorSize)
+        : _size(size), _sectorSize(sectorSize), _budget(-1), _powered(true), _erases(0) {
+        _file = tmpfile();
+        uint8_t erased[256];
+        memset(erased, 0xFF, sizeof(erased));
+        for (uint32_t offset = 0; offset < size; offset += sizeof(erased)) fwrite(erased, 1, sizeof(erased), _file);
+        fflush(_file);
+    }
+    ~FileFlash() { fclose(_file); }
+
+    uint32_t size() const { return _size; }
+    uint32_t sectorSize() const { return _sectorSize; }
+
+    bool read(uint32_t offset, void* data, size_t length) {
+        if (!_powered || offset + length > _size) return false;
+        fseek(_file, (long)offset, SEEK_SET);
+        return fread(data, 1, length, _file) == length;
+    }
+
+    bool write(uint32_t offset, const void* data, size_t length) {
+        if (!_powered || offset + length > _size) return false;
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < length; i++) {
+            if (_budget == 0) {
+                _powered = false;
+                return false;
+            }
+            if (_budget > 0) _budget--;
+            uint8_t old;
+            fseek(_file, (long)(offset + i), SEEK_SET);
+            if (fread(&old, 1, 1, _file) != 1) return false;
+            uint8_t programmed = old & bytes[i];
+            fseek(_file, (long)(offset + i), SEEK_SET);
+            fwrite(&programmed, 1, 1, _file);
+        }
+        fflush(_file);
+        return true;
+    }
+
+    bool eraseSector(uint32_t offset) {
+        if (!_powered || offset % _sectorSize != 0 || offset >= _size) return false;
+        uint8_t erased[64];
+        memset(erased, 0xFF, sizeof(erased));
+        fseek(_file, (long)offset, SEEK_SET);
+        for (uint32_t i = 0; i < _sectorSize; i += sizeof(erased)) fwrite(erased, 1, sizeof(erased), _file);
+        fflush(_file);
+        _erases++;
+        return true;
+    }
+
+    // Cut power after this many more written bytes (-1 = never)
+    void cutAfter(long bytes) { _budget = bytes; }
+    void restore() {
+        _budget = -1;
+        _powered = true;
+    }
+    bool powered() const { return _powered; }
+    uint32_t erases() const { return _erases; }
+
+    // Flip bits outside the driver, as bit rot would
+    void corrupt(uint32_t offset, uint8_t mask) {
+        uint8_t byte;
+        fseek(_file, (long)offset, SEEK_SET);
+        if (fread(&byte, 1, 1, _file) != 1) return;
+        byte ^= mask;
+        fseek(_file, (long)offset, SEEK_SET);
+        fwrite(&byte, 1, 1, _file);
+        fflush(_file);
+    }
+
+    void fill(uint8_t value) {
+        fseek(_file, 0, SEEK_SET);
+        for (uint32_t i = 0; i < _size; i++) fputc(value, _file);
+        fflush(_file);
+    }
+
+private:
+    FILE* _file;
+    uint32_t _size;
+    uint32_t _sectorSize;
+    long _budget;
+    bool _powered;
+    uint32_t _erases;
+};
+
+static const uint32_t SECTOR = 256;
+static const uint32_t REGION = 4 * SECTOR;
+
+// 8-byte sector header, 8-byte record header; a 40-byte record takes 48
+struct Record {
+    uint32_t sequence;
+    uint8_t payload[36];
+};
+
+static Record makeRecord(uint32_t sequence) {
+    Record r;
+    r.sequence = sequence;
+    for (size_t i = 0; i < sizeof(r.payload); i++) r.payload[i] = (uint8_t)(sequence * 31 + i);
+    return r;
+}
+
+static void assertRecord(const Record& r, uint32_t sequence) {
+    Record expected = makeRecord(sequence);
+    TEST_ASSERT_EQUAL_UINT32(sequence, r.sequence);
+    TEST_ASSERT_EQUAL_MEMORY(expected.payload, r.payload, sizeof(r.payload));
+}
+
+// Pending records in order, without consuming them
+static uint32_t readAll(ReadingLog& log, uint32_t* sequences, uint32_t max) {
+    uint32_t count = 0;
+    Record r;
+    int length = log.peek(&r, sizeof(r));
+    while (length > 0 && count < max) {
+        TEST_ASSERT_EQUAL(sizeof(Record), length);
+        assertRecord(r, r.sequence);
+        sequences[count++] = r.sequence;
+        length = log.peekNext(&r, sizeof(r));
+    }
+    return count;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_formats_blank_region(void) {
+    FileFlash flash(REGION, SECTOR);
+    ReadingLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    TEST_ASSERT_EQUAL_UINT32(0, log.pending());
+    Record r;
+    TEST_ASSERT_EQUAL(0, log.peek(&r, sizeof(r)));
+    TEST_ASSERT_FALSE(log.pop());
+}
+
+void test_foreign_data_is_formatted(void) {
+    FileFlash flash(REGION, SECTOR);
+    flash.fill(0x5A);
+    ReadingLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    TEST_ASSERT_EQUAL_UINT32(0, log.pending());
+    Record r = makeRecord(1);
+    TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+    TEST_ASSERT_EQUAL(sizeof(r), log.peek(&r, sizeof(r)));
+    assertRecord(r, 1);
+}
+
+void test_append_pop_and_remount(void) {
+    FileFlash flash(REGION, SECTOR);
+    {
+        ReadingLog log(flash);
+        TEST_ASSERT_TRUE(log.mount());
+        for (uint32_t i = 1; i <= 6; i++) {
+            Record r = makeRecord(i);
+            TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+        }
+        TEST_ASSERT_TRUE(log.pop());
+        TEST_ASSERT_TRUE(log.pop());
+        TEST_ASSERT_EQUAL_UINT32(4, log.pending());
+    }
+
+    // Consumed records stay consumed across a reboot
+    ReadingLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    TEST_ASSERT_EQUAL_UINT32(4, log.pending());
+    uint32_t sequences[8];
+    TEST_ASSERT_EQUAL(4, readAll(log, sequences, 8));
+    for (uint32_t i = 0; i < 4; i++) TEST_ASSERT_EQUAL_UINT32(3 + i, sequences[i]);
+
+    Record small;
+    TEST_ASSERT_EQUAL(-1, log.peek(&small, 8));
+}
+
+// A power cut at every byte of an append: after the reboot the record
+// is either fully there or not there at all, and the log keeps working
+void test_power_loss_during_append(void) {
+    for (long cut = 0;; cut++) {
+        FileFlash flash(REGION, SECTOR);
+        {
+            ReadingLog log(flash);
+            TEST_ASSERT_TRUE(log.mount());
+            for (uint32_t i = 1; i <= 3; i++) {
+                Record r = makeRecord(i);
+                TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+            }
+            flash.cutAfter(cut);
+            Record r = makeRecord(4);
+            bool appended = log.append(&r, sizeof(r));
+            if (appended && flash.powered()) {
+                // Cut point past the end of the append: every case covered
+                TEST_ASSERT_GREATER_THAN(40, cut);
+                return;
+            }
+        }
+
+        flash.restore();
+        ReadingLog log(flash);
+        TEST_ASSERT_TRUE(log.mount());
+        uint32_t sequences[8];
+        uint32_t count = readAll(log, sequences, 8);
+        TEST_ASSERT_EQUAL_UINT32(count, log.pending());
+        TEST_ASSERT_TRUE(count == 3 || count == 4);
+        for (uint32_t i = 0; i < count; i++) TEST_ASSERT_EQUAL_UINT32(i + 1, sequences[i]);
+
+        // Appends after recovery land behind whatever survived
+        Record r = makeRecord(5);
+        TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+        count = readAll(log, sequences, 8);
+        TEST_ASSERT_EQUAL_UINT32(5, sequences[count - 1]);
+        TEST_ASSERT_EQUAL(0, log.corrupt());
+    }
+}
+
+// Commit byte states: a cut while consuming leaves the record either
+// pending (delivered again) or consumed, never half of each
+void test_power_loss_during_pop(void) {
+    for (long cut = 0; cut <= 1; cut++) {
+        FileFlash flash(REGION, SECTOR);
+        {
+            ReadingLog log(flash);
+            TEST_ASSERT_TRUE(log.mount());
+            for (uint32_t i = 1; i <= 2; i++) {
+                Record r = makeRecord(i);
+                TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+            }
+            flash.cutAfter(cut);
+            TEST_ASSERT_EQUAL(cut == 1, log.pop());
+        }
+
+        flash.restore();
+        ReadingLog log(flash);
+        TEST_ASSERT_TRUE(log.mount());
+        Record r;
+        TEST_ASSERT_EQUAL(sizeof(r), log.peek(&r, sizeof(r)));
+        assertRecord(r, cut == 1 ? 2 : 1);
+        TEST_ASSERT_EQUAL_UINT32(cut == 1 ? 1 : 2, log.pending());
+    }
+}
+
+// The head moving onto a new sector: a cut anywhere while it is erased
+// and stamped leaves a sector without a valid seq/magic header, which
+// the scan ignores
+void test_power_loss_during_sector_start(void) {
+    // 5 records of 48 bytes fill a sector's 248 usable bytes
+    for (long cut = 0; cut <= 8; cut++) {
+        FileFlash flash(REGION, SECTOR);
+        {
+            ReadingLog log(flash);
+            TEST_ASSERT_TRUE(log.mount());
+            for (uint32_t i = 1; i <= 5; i++) {
+                Record r = makeRecord(i);
+                TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+            }
+            flash.cutAfter(cut);
+            Record r = makeRecord(6);
+            log.append(&r, sizeof(r));
+        }
+
+        flash.restore();
+        ReadingLog log(flash);
+        TEST_ASSERT_TRUE(log.mount());
+        uint32_t sequences[8];
+        uint32_t count = readAll(log, sequences, 8);
+        TEST_ASSERT_EQUAL_UINT32(5, count);
+        TEST_ASSERT_EQUAL_UINT32(5, log.pending());
+
+        Record r = makeRecord(7);
+        TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+        count = readAll(log, sequences, 8);
+        TEST_ASSERT_EQUAL_UINT32(6, count);
+        TEST_ASSERT_EQUAL_UINT32(7, sequences[5]);
+    }
+}
+
+// Writing past the end of the region reuses the oldest sector: its
+// pending records are dropped, the rest stay in order across a remount,
+// and erases are spread over every sector
+void test_wrap_drops_oldest(void) {
+    FileFlash flash(REGION, SECTOR);
+    uint32_t expected[32];
+    uint32_t pending;
+    {
+        ReadingLog log(flash);
+        TEST_ASSERT_TRUE(log.mount());
+        for (uint32_t i = 1; i <= 40; i++) {
+            Record r = makeRecord(i);
+            TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+        }
+        // 4 sectors x 5 records; 2 full wraps drop 20 of 40
+        TEST_ASSERT_EQUAL_UINT32(20, log.dropped());
+        TEST_ASSERT_EQUAL_UINT32(20, log.pending());
+        pending = readAll(log, expected, 32);
+        TEST_ASSERT_EQUAL_UINT32(20, pending);
+        TEST_ASSERT_EQUAL_UINT32(21, expected[0]);
+        TEST_ASSERT_EQUAL_UINT32(40, expected[19]);
+        TEST_ASSERT_TRUE(log.pop());
+        TEST_ASSERT_TRUE(log.pop());
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, flash.erases());
+
+    ReadingLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    TEST_ASSERT_EQUAL_UINT32(pending - 2, log.pending());
+    uint32_t sequences[32];
+    TEST_ASSERT_EQUAL_UINT32(pending - 2, readAll(log, sequences, 32));
+    for (uint32_t i = 0; i < pending - 2; i++) TEST_ASSERT_EQUAL_UINT32(expected[i + 2], sequences[i]);
+
+    // Drain and keep going around the ring
+    while (log.pop()) {
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, log.pending());
+    for (uint32_t i = 41; i <= 45; i++) {
+        Record r = makeRecord(i);
+        TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+    }
+    TEST_ASSERT_EQUAL(5, readAll(log, sequences, 32));
+    TEST_ASSERT_EQUAL_UINT32(41, sequences[0]);
+}
+
+// A record whose payload no longer matches its CRC is retired and
+// skipped rather than delivered
+void test_bit_rot_is_skipped(void) {
+    FileFlash flash(REGION, SECTOR);
+    ReadingLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    for (uint32_t i = 1; i <= 3; i++) {
+        Record r = makeRecord(i);
+        TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+    }
+    flash.corrupt(8 + 48 + 8 + 10, 0x04);  // Second record's payload
+
+    uint32_t sequences[8];
+    TEST_ASSERT_EQUAL(2, readAll(log, sequences, 8));
+    TEST_ASSERT_EQUAL_UINT32(1, sequences[0]);
+    TEST_ASSERT_EQUAL_UINT32(3, sequences[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, log.corrupt());
+    TEST_ASSERT_EQUAL_UINT32(2, log.pending());
+}
+
+// Backlog replay reads a batch ahead with peekNext() and pops it only
+// once the upload succeeded; a failed upload leaves the batch queued
+void test_batch_read_ahead(void) {
+    FileFlash flash(REGION, SECTOR);
+    ReadingLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    for (uint32_t i = 1; i <= 12; i++) {
+        Record r = makeRecord(i);
+        TEST_ASSERT_TRUE(log.append(&r, sizeof(r)));
+    }
+
+    // A batch of 7 crosses from the first sector into the second
+    Record r;
+    uint32_t count = 0;
+    int length = log.peek(&r, sizeof(r));
+    while (length > 0 && count < 7) {
+        assertRecord(r, count + 1);
+        count++;
+        if (count < 7) length = log.peekNext(&r, sizeof(r));
+    }
+    TEST_ASSERT_EQUAL_UINT32(7, count);
+    TEST_ASSERT_EQUAL_UINT32(12, log.pending());  // Upload failed: nothing popped
+
+    // Retry from the start; this time it succeeds
+    TEST_ASSERT_EQUAL(sizeof(r), log.peek(&r, sizeof(r)));
+    assertRecord(r, 1);
+    for (int i = 0; i < 7; i++) TEST_ASSERT_TRUE(log.pop());
+    TEST_ASSERT_EQUAL(sizeof(r), log.peek(&r, sizeof(r)));
+    assertRecord(r, 8);
+
+    // The read-ahead stops at the newest record
+    uint32_t sequences[8];
+    TEST_ASSERT_EQUAL(5, readAll(log, sequences, 8));
+    TEST_ASSERT_EQUAL(0, log.peekNext(&r, sizeof(r)));
+}
+
+void test_rejects_bad_lengths(void) {
+    FileFlash flash(REGION, SECTOR);
+    ReadingLog log(flash);
+    uint8_t data[SECTOR];
+    memset(data, 0, sizeof(data));
+    TEST_ASSERT_FALSE(log.append(data, 4));  // Not mounted
+    TEST_ASSERT_TRUE(log.mount());
+    TEST_ASSERT_FALSE(log.append(data, 0));
+    TEST_ASSERT_FALSE(log.append(data, SECTOR));  // Larger than a sector holds
+    TEST_ASSERT_TRUE(log.append(data, SECTOR - 16));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_formats_blank_region);
+    RUN_TEST(test_foreign_data_is_formatted);
+    RUN_TEST(test_append_pop_and_remount);
+    RUN_TEST(test_power_loss_during_append);
+    RUN_TEST(test_power_loss_during_pop);
+    RUN_TEST(test_power_loss_during_sector_start);
+    RUN_TEST(test_wrap_drops_oldest);
+    RUN_TEST(test_bit_rot_is_skipped);
+    RUN_TEST(test_batch_read_ahead);
+    RUN_TEST(test_rejects_bad_lengths);
+    return UNITY_END();
+}
@@ -0,0 +1,230 @@
+#include <unity.h>
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ReadingSerializer.h"
+
+static const SerializeOptions WIFI = {"ESP32-001", "WiFi", "key"};
+
+// Heap allocations through operator new while counting is on
+static bool countAllocations = false;
+static unsigned allocations = 0;
+
+void* operator new(size_t size) {
+    if (countAllocations) allocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+static SensorReading basicReading() {
+    SensorReading r;
+    memset(&r, 0, sizeof(r));
+    r.temperature = 72.5f;
+    r.humidity = 41.0f;
+    strcpy(r.function, "Single");
+    r.signalQuality = 99;
+    return r;
+}
+
+// Every field present and as long as it can be
+static SensorReading worstCaseReading() {
+    SensorReading r;
+    memset(&r, 0, sizeof(r));
+    r.temperature = -123.4f;
+    r.humidity = 100.0f;
+    memset(r.function, 'f', sizeof(r.function) - 1);
+    memset(r.idempotencyKey, 'k', sizeof(r.idempotencyKey) - 1);
+    r.gpsValid = true;
+    r.latitude = -89.123456f;
+    r.longitude = -179.123456f;
+    r.gpsAltitude = -12345.67f;
+    r.gpsSpeed = 1234.56f;
+    r.gpsSatellites = 99;
+    r.gpsAge = 65535;
+    strcpy(r.gnssStart, "running");
+    r.ttffMs = 4000000000u;
+    r.bootWifiMs = r.bootModemMs = r.bootSensorsMs = r.bootReadyMs = 4000000000u;
+    strcpy(r.wake, "button");
+    r.lastAwakeMs = 4000000000u;
+    strcpy(r.wifiConnect, "scan");
+    r.wifiConnectMs = 4000000000u;
+    strcpy(r.localIP, "255.255.255.255");
+    r.batteryVoltage = 4200;
+    r.batteryAge = 65535;
+    r.signalQuality = 31;
+    r.signalAge = 65535;
+    memset(r.networkOperator, 'o', sizeof(r.networkOperator) - 1);
+    r.operatorAge = 65535;
+    r.capturedAt = 4000000000u;
+    return r;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_basic_reading(void) {
+    SensorReading r = basicReading();
+    char buffer[READING_PAYLOAD_SIZE];
+    size_t length = serializeReading(r, WIFI, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"temperature\":72.5,\"humidity\":41.0,\"deviceId\":\"ESP32-001\",\"function\":\"Single\","
+        "\"connectionType\":\"WiFi\",\"apiKey\":\"key\"}",
+        buffer);
+    TEST_ASSERT_EQUAL(strlen(buffer), length);
+}
+
+void test_optional_fields(void) {
+    SensorReading r = basicReading();
+    r.gpsValid = true;
+    r.latitude = 37.774929f;
+    r.longitude = -122.419418f;
+    r.gpsSatellites = 7;
+    r.batteryVoltage = 3900;
+    r.signalQuality = 18;
+    r.bootReadyMs = 4200;
+    r.ageSeconds = 30;
+    SerializeOptions relay = {"ESP32-001", NULL, NULL};
+    char buffer[READING_PAYLOAD_SIZE];
+    TEST_ASSERT_GREATER_THAN(0, serializeReading(r, relay, buffer, sizeof(buffer)));
+
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"latitude\":37.7749"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"longitude\":-122.4194"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"gpsSatellites\":7"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"batteryVoltage\":3900"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"signalQuality\":18"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"boot\":{\"wifi\":0,\"modem\":0,\"sensors\":0,\"ready\":4200}"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"ageSeconds\":30"));
+    TEST_ASSERT_NULL(strstr(buffer, "connectionType"));
+    TEST_ASSERT_NULL(strstr(buffer, "apiKey"));
+}
+
+void test_escapes_and_non_finite(void) {
+    SensorReading r = basicReading();
+    strcpy(r.function, "a\"b\\c\nd");
+    r.temperature = 0.0f / 0.0f;
+    char buffer[READING_PAYLOAD_SIZE];
+    TEST_ASSERT_GREATER_THAN(0, serializeReading(r, WIFI, buffer, sizeof(buffer)));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"temperature\":null"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"function\":\"a\\\"b\\\\c\\u000ad\""));
+}
+
+void test_worst_case_fits_payload_buffer(void) {
+    SensorReading r = worstCaseReading();
+    SerializeOptions cellular = {"ESP32-001", "Cellular", "LawnMonitor2024SecretKey"};
+    char buffer[READING_PAYLOAD_SIZE];
+    size_t length = serializeReading(r, cellular, buffer, sizeof(buffer));
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_LESS_THAN(READING_PAYLOAD_SIZE, length);
+}
+
+// Every buffer size short of the full length fails cleanly and never
+// writes past the end
+void test_overflow_returns_zero(void) {
+    SensorReading r = worstCaseReading();
+    char full[READING_PAYLOAD_SIZE];
+    size_t length = serializeReading(r, WIFI, full, sizeof(full));
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    char buffer[READING_PAYLOAD_SIZE + 1];
+    for (size_t size = 0; size <= length; size++) {
+        memset(buffer, '#', sizeof(buffer));
+        TEST_ASSERT_EQUAL(0, serializeReading(r, WIFI, buffer, size));
+        TEST_ASSERT_EQUAL('#', buffer[size]);
+        if (size > 0) TEST_ASSERT_TRUE(memchr(buffer, '\0', size) != NULL);
+    }
+    TEST_ASSERT_EQUAL(length, serializeReading(r, WIFI, buffer, length + 1));
+    TEST_ASSERT_EQUAL_STRING(full, buffer);
+}
+
+void test_batch_envelope(void) {
+    SensorReading readings[2] = {basicReading(), basicReading()};
+    strcpy(readings[1].function, "Double");
+    char buffer[2 * READING_PAYLOAD_SIZE];
+    size_t length = serializeBatch(readings, 2, WIFI, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"deviceId\":\"ESP32-001\",\"connectionType\":\"WiFi\",\"readings\":["
+        "{\"temperature\":72.5,\"humidity\":41.0,\"function\":\"Single\"},"
+        "{\"temperature\":72.5,\"humidity\":41.0,\"function\":\"Double\"}"
+        "],\"apiKey\":\"key\"}",
+        buffer);
+    TEST_ASSERT_EQUAL(strlen(buffer), length);
+    TEST_ASSERT_EQUAL(0, serializeBatch(readings, 2, WIFI, buffer, length));
+}
+
+// A full backlog replay of worst-case readings fits the batch buffer,
+// and every entry comes out without the per-upload fields
+void test_full_batch_fits_upload_buffer(void) {
+    SensorReading readings[BACKLOG_BATCH_SIZE];
+    for (size_t i = 0; i < BACKLOG_BATCH_SIZE; i++) readings[i] = worstCaseReading();
+    SerializeOptions cellular = {"ESP32-001", "Cellular", "LawnMonitor2024SecretKey"};
+    static char buffer[BACKLOG_BATCH_SIZE * READING_PAYLOAD_SIZE];
+    size_t length = serializeBatch(readings, BACKLOG_BATCH_SIZE, cellular, buffer, sizeof(buffer));
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    size_t entries = 0;
+    for (const char* p = strstr(buffer, "\"temperature\""); p; p = strstr(p + 1, "\"temperature\"")) entries++;
+    TEST_ASSERT_EQUAL(BACKLOG_BATCH_SIZE, entries);
+    const char* prefix = "{\"deviceId\":\"ESP32-001\",\"connectionType\":\"Cellular\",\"readings\":[{";
+    TEST_ASSERT_EQUAL_STRING_LEN(prefix, buffer, strlen(prefix));
+    const char* suffix = "}],\"apiKey\":\"LawnMonitor2024SecretKey\"}";
+    TEST_ASSERT_EQUAL_STRING(suffix, buffer + length - strlen(suffix));
+    const char* entriesStart = strstr(buffer, "\"readings\"");
+    TEST_ASSERT_NULL(strstr(entriesStart, "\"deviceId\""));
+    TEST_ASSERT_NULL(strstr(entriesStart, "\"connectionType\""));
+    TEST_ASSERT_EQUAL(buffer + length - strlen(suffix) + 3, strstr(buffer, "\"apiKey\""));
+}
+
+void test_empty_batch(void) {
+    char buffer[128];
+    size_t length = serializeBatch(NULL, 0, WIFI, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("{\"deviceId\":\"ESP32-001\",\"connectionType\":\"WiFi\",\"readings\":[],\"apiKey\":\"key\"}",
+                             buffer);
+    TEST_ASSERT_EQUAL(strlen(buffer), length);
+}
+
+// Micro-benchmark: the serializer must not touch the heap
+void test_benchmark_zero_allocations(void) {
+    SensorReading r = worstCaseReading();
+    char buffer[READING_PAYLOAD_SIZE];
+    const int iterations = 20000;
+    size_t total = 0;
+
+    allocations = 0;
+    countAllocations = true;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        r.ttffMs = (uint32_t)i;
+        total += serializeReading(r, WIFI, buffer, sizeof(buffer));
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    countAllocations = false;
+
+    TEST_ASSERT_EQUAL(0, allocations);
+    TEST_ASSERT_GREATER_THAN(0, total);
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    char message[64];
+    snprintf(message, sizeof(message), "%.0f ns per worst-case reading", ns);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_basic_reading);
+    RUN_TEST(test_optional_fields);
+    RUN_TEST(test_escapes_and_non_finite);
+    RUN_TEST(test_worst_case_fits_payload_buffer);
+    RUN_TEST(test_overflow_returns_zero);
+    RUN_TEST(test_batch_envelope);
+    RUN_TEST(test_full_batch_fits_upload_buffer);
+    RUN_TEST(test_empty_batch);
+    RUN_TEST(test_benchmark_zero_allocations);
+    return UNITY_END();
+}
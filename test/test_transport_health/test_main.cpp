@@ -0,0 +1,279 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "TransportHealth.h"
+
+// src/main.cpp seeds the transports with these
+static const uint32_t WIFI_TYPICAL_MS = 1500;
+static const uint32_t WIFI_FAILURE_MS = 10000;  // HTTP timeout
+static const uint32_t CELL_TYPICAL_MS = 6000;
+static const uint32_t CELL_FAILURE_MS = 30000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_breaker_opens_after_consecutive_failures(void) {
+    TransportHealth wifi(WIFI_TYPICAL_MS, WIFI_FAILURE_MS);
+    TEST_ASSERT_EQUAL(TransportHealth::CLOSED, wifi.state());
+    wifi.record(false, 10000, 1000);
+    wifi.record(false, 10000, 2000);
+    TEST_ASSERT_EQUAL(TransportHealth::CLOSED, wifi.state());
+    TEST_ASSERT_TRUE(wifi.allow(2000));
+
+    // A success in between resets the run
+    wifi.record(true, 1200, 3000);
+    wifi.record(false, 10000, 4000);
+    wifi.record(false, 10000, 5000);
+    TEST_ASSERT_EQUAL(TransportHealth::CLOSED, wifi.state());
+    wifi.record(false, 10000, 6000);
+    TEST_ASSERT_EQUAL(TransportHealth::OPEN, wifi.state());
+    TEST_ASSERT_EQUAL(BREAKER_FAILURES, wifi.consecutiveFailures());
+    TEST_ASSERT_FALSE(wifi.allow(6000 + BREAKER_COOLDOWN_MS - 1));
+    TEST_ASSERT_FALSE(wifi.available(6000 + BREAKER_COOLDOWN_MS - 1));
+}
+
+// After the cooldown one probe is let through; its outcome closes the
+// breaker or reopens it with twice the wait
+void test_half_open_probe(void) {
+    TransportHealth wifi(WIFI_TYPICAL_MS, WIFI_FAILURE_MS);
+    for (int i = 0; i < BREAKER_FAILURES; i++) wifi.record(false, 10000, 0);
+
+    uint32_t now = BREAKER_COOLDOWN_MS;
+    TEST_ASSERT_TRUE(wifi.available(now));
+    TEST_ASSERT_EQUAL(TransportHealth::OPEN, wifi.state());  // available() changes nothing
+    TEST_ASSERT_TRUE(wifi.allow(now));
+    TEST_ASSERT_EQUAL(TransportHealth::HALF_OPEN, wifi.state());
+
+    wifi.record(false, 10000, now);
+    TEST_ASSERT_EQUAL(TransportHealth::OPEN, wifi.state());
+    TEST_ASSERT_FALSE(wifi.allow(now + 2 * BREAKER_COOLDOWN_MS - 1));
+    TEST_ASSERT_TRUE(wifi.allow(now + 2 * BREAKER_COOLDOWN_MS));
+    now += 2 * BREAKER_COOLDOWN_MS;
+
+    wifi.record(true, 1400, now);
+    TEST_ASSERT_EQUAL(TransportHealth::CLOSED, wifi.state());
+    TEST_ASSERT_EQUAL(0, wifi.consecutiveFailures());
+
+    // Cooldown is back to the start after recovering
+    for (int i = 0; i < BREAKER_FAILURES; i++) wifi.record(false, 10000, now);
+    TEST_ASSERT_TRUE(wifi.allow(now + BREAKER_COOLDOWN_MS));
+}
+
+void test_cooldown_is_capped(void) {
+    TransportHealth cell(CELL_TYPICAL_MS, CELL_FAILURE_MS);
+    uint32_t now = 0;
+    for (int i = 0; i < BREAKER_FAILURES; i++) cell.record(false, 30000, now);
+    uint32_t cooldown = BREAKER_COOLDOWN_MS;
+    for (int probe = 0; probe < 12; probe++) {
+        now += cooldown;
+        TEST_ASSERT_TRUE(cell.allow(now));
+        cell.record(false, 30000, now);
+        cooldown = cooldown * 2 > BREAKER_COOLDOWN_MAX_MS ? BREAKER_COOLDOWN_MAX_MS : cooldown * 2;
+        TEST_ASSERT_FALSE(cell.allow(now + cooldown - 1));
+    }
+    TEST_ASSERT_EQUAL_UINT32(BREAKER_COOLDOWN_MAX_MS, cooldown);
+    TEST_ASSERT_TRUE(cell.allow(now + BREAKER_COOLDOWN_MAX_MS));
+}
+
+void test_moving_averages(void) {
+    TransportHealth wifi(WIFI_TYPICAL_MS, WIFI_FAILURE_MS);
+    TEST_ASSERT_EQUAL_UINT32(WIFI_TYPICAL_MS, wifi.latencyMs());
+    TEST_ASSERT_EQUAL_UINT16(1000, wifi.successPermille());
+
+    for (int i = 0; i < 30; i++) wifi.record(true, 800, 0);
+    TEST_ASSERT_UINT32_WITHIN(5, 800, wifi.latencyMs());
+
+    wifi.record(false, 10000, 0);
+    TEST_ASSERT_EQUAL_UINT16(875, wifi.successPermille());
+    TEST_ASSERT_EQUAL_UINT32(31, wifi.attempts());
+    TEST_ASSERT_EQUAL_UINT32(1, wifi.failures());
+    wifi.record(true, 800, 0);
+    TEST_ASSERT_GREATER_THAN(875, wifi.successPermille());
+}
+
+// Expected time to deliver: latency plus the failures expected before
+// a success, scaled by link quality
+void test_expected_cost(void) {
+    TransportHealth wifi(WIFI_TYPICAL_MS, WIFI_FAILURE_MS);
+    TEST_ASSERT_EQUAL_UINT32(WIFI_TYPICAL_MS, wifi.expectedCostMs(100));
+    TEST_ASSERT_EQUAL_UINT32(WIFI_TYPICAL_MS + WIFI_FAILURE_MS, wifi.expectedCostMs(50));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, wifi.expectedCostMs(0));
+    TEST_ASSERT_EQUAL_UINT32(wifi.expectedCostMs(100), wifi.expectedCostMs(200));  // Clamped
+
+    uint32_t healthy = wifi.expectedCostMs(100);
+    for (int i = 0; i < 4; i++) wifi.record(false, 10000, 0);
+    TEST_ASSERT_GREATER_THAN(5 * healthy, wifi.expectedCostMs(100));
+}
+
+void test_p95_latency(void) {
+    TransportHealth cell(CELL_TYPICAL_MS, CELL_FAILURE_MS);
+    TEST_ASSERT_EQUAL_UINT32(2 * CELL_TYPICAL_MS, cell.p95LatencyMs());
+    for (uint32_t i = 1; i <= 4; i++) cell.record(true, i * 1000, 0);
+    TEST_ASSERT_EQUAL_UINT32(2 * CELL_TYPICAL_MS, cell.p95LatencyMs());  // Too few samples
+
+    for (uint32_t i = 5; i <= 20; i++) cell.record(true, i * 1000, 0);
+    TEST_ASSERT_EQUAL_UINT32(19000, cell.p95LatencyMs());
+
+    // The ring keeps the last LATENCY_SAMPLES; failures don't enter it
+    for (int i = 0; i < TransportHealth::LATENCY_SAMPLES; i++) cell.record(true, 3000, 0);
+    cell.record(false, 30000, 0);
+    TEST_ASSERT_EQUAL_UINT32(3000, cell.p95LatencyMs());
+}
+
+void test_csq_quality(void) {
+    TEST_ASSERT_EQUAL(50, csqQuality(99));
+    TEST_ASSERT_EQUAL(50, csqQuality(-1));
+    TEST_ASSERT_EQUAL(50, csqQuality(32));
+    TEST_ASSERT_EQUAL(100, csqQuality(31));
+    TEST_ASSERT_EQUAL(100, csqQuality(15));
+    TEST_ASSERT_EQUAL(80, csqQuality(14));
+    TEST_ASSERT_EQUAL(50, csqQuality(5));
+    TEST_ASSERT_EQUAL(20, csqQuality(2));
+    TEST_ASSERT_EQUAL(5, csqQuality(0));
+}
+
+void test_rank_by_cost(void) {
+    TransportHealth ble(2500, 8000), wifi(WIFI_TYPICAL_MS, WIFI_FAILURE_MS), cell(CELL_TYPICAL_MS, CELL_FAILURE_MS);
+    const TransportHealth* health[] = {&ble, &wifi, &cell};
+    uint8_t order[3];
+
+    uint8_t quality[] = {100, 100, 100};
+    TEST_ASSERT_EQUAL(3, rankTransports(health, quality, 3, 0, order));
+    TEST_ASSERT_EQUAL(1, order[0]);
+    TEST_ASSERT_EQUAL(0, order[1]);
+    TEST_ASSERT_EQUAL(2, order[2]);
+
+    // No relay phone connected, WiFi down
+    uint8_t partial[] = {0, 0, 100};
+    TEST_ASSERT_EQUAL(1, rankTransports(health, partial, 3, 0, order));
+    TEST_ASSERT_EQUAL(2, order[0]);
+}
+
+// Weak cellular coverage pushes it behind a slower but reliable relay
+void test_csq_weighs_cellular(void) {
+    TransportHealth ble(8000, 10000), cell(CELL_TYPICAL_MS, CELL_FAILURE_MS);
+    const TransportHealth* health[] = {&ble, &cell};
+    uint8_t order[2];
+    uint8_t strong[] = {100, csqQuality(20)};
+    rankTransports(health, strong, 2, 0, order);
+    TEST_ASSERT_EQUAL(1, order[0]);
+    uint8_t weak[] = {100, csqQuality(3)};
+    rankTransports(health, weak, 2, 0, order);
+    TEST_ASSERT_EQUAL(0, order[0]);
+}
+
+// An open breaker drops out of the ranking; once due, it goes first so
+// the probe runs while the others are there to fall back on
+void test_rank_open_and_probe(void) {
+    TransportHealth wifi(WIFI_TYPICAL_MS, WIFI_FAILURE_MS), cell(CELL_TYPICAL_MS, CELL_FAILURE_MS);
+    const TransportHealth* health[] = {&wifi, &cell};
+    uint8_t quality[] = {100, 100};
+    uint8_t order[2];
+    for (int i = 0; i < BREAKER_FAILURES; i++) wifi.record(false, 10000, 0);
+
+    TEST_ASSERT_EQUAL(1, rankTransports(health, quality, 2, 1000, order));
+    TEST_ASSERT_EQUAL(1, order[0]);
+
+    TEST_ASSERT_EQUAL(2, rankTransports(health, quality, 2, BREAKER_COOLDOWN_MS, order));
+    TEST_ASSERT_EQUAL(0, order[0]);
+}
+
+// Deep sleep: state survives, and an open breaker wakes due for a probe
+void test_save_restore(void) {
+    TransportHealth wifi(WIFI_TYPICAL_MS, WIFI_FAILURE_MS);
+    for (int i = 0; i < 8; i++) wifi.record(true, 900 + i * 10, 0);
+    for (int i = 0; i < BREAKER_FAILURES; i++) wifi.record(false, 10000, 0);
+    TransportHealthState state;
+    wifi.save(state);
+
+    TransportHealth woken(WIFI_TYPICAL_MS, WIFI_FAILURE_MS);
+    woken.restore(state, 50);
+    TEST_ASSERT_EQUAL(TransportHealth::OPEN, woken.state());
+    TEST_ASSERT_TRUE(woken.allow(50));
+    TEST_ASSERT_EQUAL(wifi.successPermille(), woken.successPermille());
+    TEST_ASSERT_EQUAL(wifi.latencyMs(), woken.latencyMs());
+    TEST_ASSERT_EQUAL(wifi.p95LatencyMs(), woken.p95LatencyMs());
+    TEST_ASSERT_EQUAL(wifi.attempts(), woken.attempts());
+
+    // Garbage from a cold boot's RTC memory is ignored
+    TransportHealth fresh(WIFI_TYPICAL_MS, WIFI_FAILURE_MS);
+    memset(&state, 0xA5, sizeof(state));
+    fresh.restore(state, 0);
+    TEST_ASSERT_EQUAL(TransportHealth::CLOSED, fresh.state());
+    TEST_ASSERT_EQUAL_UINT32(0, fresh.attempts());
+}
+
+void test_state_names(void) {
+    TEST_ASSERT_EQUAL_STRING("closed", breakerStateName(TransportHealth::CLOSED));
+    TEST_ASSERT_EQUAL_STRING("open", breakerStateName(TransportHealth::OPEN));
+    TEST_ASSERT_EQUAL_STRING("half-open", breakerStateName(TransportHealth::HALF_OPEN));
+}
+
+// WiFi stays associated but its upstream is broken for two hours;
+// readings every minute. Fixed order waits out the WiFi timeout on every
+// reading before falling back to cellular; the breaker stops paying it
+// after three and only probes now and then.
+void test_simulated_upstream_outage(void) {
+    const uint32_t minute = 60000;
+    const int readings = 180;
+    const int outageStart = 30;
+    const int outageEnd = 150;
+
+    uint32_t fixedMs = 0;
+    for (int r = 0; r < readings; r++) {
+        bool wifiUp = r < outageStart || r >= outageEnd;
+        fixedMs += wifiUp ? WIFI_TYPICAL_MS : WIFI_FAILURE_MS + CELL_TYPICAL_MS;
+    }
+
+    TransportHealth wifi(WIFI_TYPICAL_MS, WIFI_FAILURE_MS), cell(CELL_TYPICAL_MS, CELL_FAILURE_MS);
+    TransportHealth* transports[] = {&wifi, &cell};
+    const TransportHealth* health[] = {&wifi, &cell};
+    uint8_t quality[] = {100, csqQuality(18)};
+    uint32_t rankedMs = 0;
+    int wifiAttemptsInOutage = 0;
+    for (int r = 0; r < readings; r++) {
+        uint32_t now = (uint32_t)r * minute;
+        bool wifiUp = r < outageStart || r >= outageEnd;
+        uint8_t order[2];
+        uint8_t count = rankTransports(health, quality, 2, now, order);
+        for (uint8_t i = 0; i < count; i++) {
+            TransportHealth* t = transports[order[i]];
+            if (!t->allow(now)) continue;
+            bool ok = order[i] == 1 || wifiUp;
+            uint32_t elapsed = order[i] == 1 ? CELL_TYPICAL_MS : (ok ? WIFI_TYPICAL_MS : WIFI_FAILURE_MS);
+            t->record(ok, elapsed, now);
+            rankedMs += elapsed;
+            if (order[i] == 0 && !wifiUp) wifiAttemptsInOutage++;
+            if (ok) break;
+        }
+    }
+    TEST_ASSERT_EQUAL(TransportHealth::CLOSED, wifi.state());  // Back after the outage
+
+    char message[128];
+    snprintf(message, sizeof(message), "Delivery time: fixed order %lu s, ranked %lu s; WiFi tries in outage %d of %d",
+             (unsigned long)(fixedMs / 1000), (unsigned long)(rankedMs / 1000), wifiAttemptsInOutage,
+             outageEnd - outageStart);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(outageEnd - outageStart, wifiAttemptsInOutage * 5);
+    TEST_ASSERT_LESS_THAN(fixedMs * 2 / 3, rankedMs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_breaker_opens_after_consecutive_failures);
+    RUN_TEST(test_half_open_probe);
+    RUN_TEST(test_cooldown_is_capped);
+    RUN_TEST(test_moving_averages);
+    RUN_TEST(test_expected_cost);
+    RUN_TEST(test_p95_latency);
+    RUN_TEST(test_csq_quality);
+    RUN_TEST(test_rank_by_cost);
+    RUN_TEST(test_csq_weighs_cellular);
+    RUN_TEST(test_rank_open_and_probe);
+    RUN_TEST(test_save_restore);
+    RUN_TEST(test_state_names);
+    RUN_TEST(test_simulated_upstream_outage);
+    return UNITY_END();
+}
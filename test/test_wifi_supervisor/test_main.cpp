@@ -0,0 +1,376 @@
+#include <unity.h>
+
+#include <stdio.h>
+
+#include "WifiSupervisor.h"
+
+// src/main.cpp's defaults
+static const WifiSupervisorConfig CONFIG = {2000, 300000, 8, 1800000};
+
+// Stands in for WiFi.onEvent and the radio: events queue up for the
+// owner, and an attempt connects only while an AP is in range. Each
+// attempt costs a full scan and connect.
+class FakeLink {
+public:
+    static const uint32_t ATTEMPT_MS = 6000;
+
+    FakeLink() : inRange(false), associated(false), pending(NONE), scans(0) {}
+
+    enum Event { NONE, UP, DOWN };
+
+    // The driver's own association or drop, as WiFi.onEvent reports it
+    void driverUp() {
+        associated = true;
+        pending = UP;
+    }
+    void driverDown() {
+        associated = false;
+        pending = DOWN;
+    }
+
+    Event take() {
+        Event event = pending;
+        pending = NONE;
+        return event;
+    }
+
+    bool connect() {
+        scans++;
+        associated = inRange;
+        return associated;
+    }
+
+    bool inRange;
+    bool associated;
+    Event pending;
+    int scans;
+};
+
+// The owner's side, shaped like superviseWifi()
+static void supervise(WifiSupervisor& supervisor, FakeLink& link, uint32_t& now) {
+    FakeLink::Event event = link.take();
+    if (event == FakeLink::DOWN || (supervisor.state() == WIFI_LINK_UP && !link.associated)) {
+        supervisor.linkDown(now);
+    }
+    if (link.associated && (event == FakeLink::UP || supervisor.state() != WIFI_LINK_UP)) {
+        supervisor.linkUp(now);
+    }
+    if (!supervisor.shouldConnect(now)) return;
+    bool connected = link.connect();
+    now += FakeLink::ATTEMPT_MS;
+    link.take();
+    supervisor.attemptFinished(connected, now);
+}
+
+static int upCalls = 0;
+static void countUp(void* context) {
+    upCalls++;
+    if (context) (*(int*)context)++;
+}
+
+void setUp(void) { upCalls = 0; }
+void tearDown(void) {}
+
+void test_first_attempt_is_immediate(void) {
+    WifiSupervisor supervisor(CONFIG, 1);
+    TEST_ASSERT_EQUAL(WIFI_LINK_DOWN, supervisor.state());
+    TEST_ASSERT_TRUE(supervisor.shouldConnect(0));
+    TEST_ASSERT_EQUAL(WIFI_LINK_CONNECTING, supervisor.state());
+    TEST_ASSERT_FALSE(supervisor.shouldConnect(0));  // One attempt at a time
+    supervisor.attemptFinished(true, 5000);
+    TEST_ASSERT_EQUAL(WIFI_LINK_UP, supervisor.state());
+    TEST_ASSERT_EQUAL_UINT32(1, supervisor.attempts());
+    TEST_ASSERT_FALSE(supervisor.shouldConnect(100000));
+}
+
+// Each delay lies between half and all of the doubled base, capped
+void test_backoff_doubles_with_jitter(void) {
+    WifiSupervisorConfig config = {2000, 20000, 20, 1800000};
+    for (uint32_t seed = 1; seed <= 50; seed++) {
+        WifiSupervisor supervisor(config, seed * 7919);
+        uint32_t now = 0;
+        uint32_t delay = config.baseDelayMs;
+        for (int attempt = 0; attempt < 10; attempt++) {
+            TEST_ASSERT_TRUE(supervisor.shouldConnect(now));
+            supervisor.attemptFinished(false, now);
+            uint32_t wait = supervisor.retryInMs(now);
+            TEST_ASSERT_TRUE(wait >= delay / 2);
+            TEST_ASSERT_TRUE(wait <= delay);
+            TEST_ASSERT_FALSE(supervisor.shouldConnect(now + wait - 1));
+            now += wait;
+            delay = delay * 2 > config.maxDelayMs ? config.maxDelayMs : delay * 2;
+        }
+    }
+}
+
+// Devices seeded differently don't retry in lockstep
+void test_jitter_spreads_a_fleet(void) {
+    const int devices = 32;
+    uint32_t firstRetry[devices];
+    for (int d = 0; d < devices; d++) {
+        WifiSupervisor supervisor(CONFIG, 0x1234u + d * 2654435761u);
+        supervisor.shouldConnect(0);
+        supervisor.attemptFinished(false, 0);
+        supervisor.shouldConnect(supervisor.retryInMs(0));
+        supervisor.attemptFinished(false, 0);
+        firstRetry[d] = supervisor.retryInMs(0);
+    }
+    int distinct = 0;
+    for (int d = 0; d < devices; d++) {
+        bool seen = false;
+        for (int e = 0; e < d; e++) seen = seen || firstRetry[e] == firstRetry[d];
+        if (!seen) distinct++;
+    }
+    TEST_ASSERT_GREATER_THAN(devices * 3 / 4, distinct);
+}
+
+void test_same_seed_same_schedule(void) {
+    WifiSupervisor a(CONFIG, 42), b(CONFIG, 42);
+    uint32_t now = 0;
+    for (int i = 0; i < 5; i++) {
+        a.shouldConnect(now);
+        b.shouldConnect(now);
+        a.attemptFinished(false, now);
+        b.attemptFinished(false, now);
+        TEST_ASSERT_EQUAL_UINT32(a.retryInMs(now), b.retryInMs(now));
+        now += a.retryInMs(now);
+    }
+}
+
+// The firmware constructs it with seed 0 during static init and seeds it
+// once the radio is on; that matches constructing with the seed
+void test_seed_later(void) {
+    WifiSupervisor late(CONFIG, 0), early(CONFIG, 0xC0FFEEu);
+    late.seed(0xC0FFEEu);
+    uint32_t now = 0;
+    for (int i = 0; i < 5; i++) {
+        late.shouldConnect(now);
+        early.shouldConnect(now);
+        late.attemptFinished(false, now);
+        early.attemptFinished(false, now);
+        TEST_ASSERT_EQUAL_UINT32(early.retryInMs(now), late.retryInMs(now));
+        now += early.retryInMs(now);
+    }
+
+    // Seed 0 still jitters
+    WifiSupervisor zero(CONFIG, 0);
+    zero.seed(0);
+    zero.shouldConnect(0);
+    zero.attemptFinished(false, 0);
+    zero.shouldConnect(zero.retryInMs(0));
+    zero.attemptFinished(false, 0);
+    TEST_ASSERT_TRUE(zero.retryInMs(0) >= CONFIG.baseDelayMs);
+    TEST_ASSERT_TRUE(zero.retryInMs(0) <= 2 * CONFIG.baseDelayMs);
+}
+
+void test_budget_then_rest(void) {
+    WifiSupervisor supervisor(CONFIG, 3);
+    uint32_t now = 0;
+    for (int i = 0; i < CONFIG.budget; i++) {
+        while (!supervisor.shouldConnect(now)) now += 1000;
+        supervisor.attemptFinished(false, now);
+    }
+    TEST_ASSERT_EQUAL(WIFI_LINK_RESTING, supervisor.state());
+    TEST_ASSERT_EQUAL(CONFIG.budget, supervisor.failures());
+    TEST_ASSERT_EQUAL_UINT32(CONFIG.restMs, supervisor.retryInMs(now));
+    TEST_ASSERT_FALSE(supervisor.shouldConnect(now + CONFIG.restMs - 1));
+
+    // After the rest, a fresh budget starting from the base delay
+    TEST_ASSERT_TRUE(supervisor.shouldConnect(now + CONFIG.restMs));
+    TEST_ASSERT_EQUAL(0, supervisor.failures());
+    supervisor.attemptFinished(false, now + CONFIG.restMs);
+    TEST_ASSERT_EQUAL(WIFI_LINK_DOWN, supervisor.state());
+    TEST_ASSERT_TRUE(supervisor.retryInMs(now + CONFIG.restMs) <= CONFIG.baseDelayMs);
+}
+
+// A drop while up waits one base delay for the driver to reassociate
+void test_drop_waits_base_delay(void) {
+    WifiSupervisor supervisor(CONFIG, 5);
+    supervisor.linkUp(0);
+    TEST_ASSERT_EQUAL(WIFI_LINK_UP, supervisor.state());
+    supervisor.linkDown(10000);
+    TEST_ASSERT_EQUAL(WIFI_LINK_DOWN, supervisor.state());
+    TEST_ASSERT_EQUAL_UINT32(CONFIG.baseDelayMs, supervisor.retryInMs(10000));
+    TEST_ASSERT_FALSE(supervisor.shouldConnect(10000 + CONFIG.baseDelayMs - 1));
+
+    // The driver managed it: no attempt needed
+    supervisor.linkUp(11000);
+    TEST_ASSERT_FALSE(supervisor.shouldConnect(20000));
+    TEST_ASSERT_EQUAL_UINT32(0, supervisor.attempts());
+}
+
+// linkDown only applies to an up link; attempts report their own result
+void test_down_ignored_unless_up(void) {
+    WifiSupervisor supervisor(CONFIG, 9);
+    supervisor.shouldConnect(0);
+    supervisor.attemptFinished(false, 0);
+    uint32_t wait = supervisor.retryInMs(0);
+    supervisor.linkDown(0);
+    TEST_ASSERT_EQUAL_UINT32(wait, supervisor.retryInMs(0));
+    TEST_ASSERT_EQUAL(1, supervisor.failures());
+
+    supervisor.shouldConnect(wait);
+    supervisor.linkDown(wait);
+    TEST_ASSERT_EQUAL(WIFI_LINK_CONNECTING, supervisor.state());
+}
+
+// Up on its own during an attempt wins over the attempt's failure
+void test_up_during_attempt(void) {
+    WifiSupervisor supervisor(CONFIG, 11);
+    TEST_ASSERT_TRUE(supervisor.shouldConnect(0));
+    supervisor.linkUp(3000);
+    supervisor.attemptFinished(false, 6000);
+    TEST_ASSERT_EQUAL(WIFI_LINK_UP, supervisor.state());
+    TEST_ASSERT_EQUAL(0, supervisor.failures());
+}
+
+void test_reset(void) {
+    WifiSupervisor supervisor(CONFIG, 13);
+    uint32_t now = 0;
+    for (int i = 0; i < CONFIG.budget; i++) {
+        while (!supervisor.shouldConnect(now)) now += 1000;
+        supervisor.attemptFinished(false, now);
+    }
+    TEST_ASSERT_EQUAL(WIFI_LINK_RESTING, supervisor.state());
+    supervisor.reset(now);
+    TEST_ASSERT_EQUAL(WIFI_LINK_DOWN, supervisor.state());
+    TEST_ASSERT_EQUAL(0, supervisor.failures());
+    TEST_ASSERT_TRUE(supervisor.shouldConnect(now));
+
+    // Ignored mid-attempt and while up
+    supervisor.reset(now);
+    TEST_ASSERT_EQUAL(WIFI_LINK_CONNECTING, supervisor.state());
+    supervisor.attemptFinished(true, now);
+    supervisor.reset(now);
+    TEST_ASSERT_EQUAL(WIFI_LINK_UP, supervisor.state());
+}
+
+void test_listeners_on_each_up(void) {
+    WifiSupervisor supervisor(CONFIG, 17);
+    int second = 0;
+    TEST_ASSERT_TRUE(supervisor.addListener(countUp, NULL));
+    TEST_ASSERT_TRUE(supervisor.addListener(countUp, &second));
+    for (int i = 2; i < WifiSupervisor::MAX_LISTENERS; i++) TEST_ASSERT_TRUE(supervisor.addListener(countUp, NULL));
+    TEST_ASSERT_FALSE(supervisor.addListener(countUp, NULL));
+
+    supervisor.linkUp(0);
+    supervisor.linkUp(100);  // Already up: no repeat
+    TEST_ASSERT_EQUAL(WifiSupervisor::MAX_LISTENERS, upCalls);
+    TEST_ASSERT_EQUAL(1, second);
+
+    supervisor.linkDown(200);
+    supervisor.shouldConnect(200 + CONFIG.baseDelayMs);
+    supervisor.attemptFinished(true, 5000);
+    TEST_ASSERT_EQUAL(2, second);
+}
+
+void test_timer_wraparound(void) {
+    WifiSupervisor supervisor(CONFIG, 19);
+    uint32_t now = 0xFFFFF000u;
+    supervisor.linkUp(now);
+    supervisor.linkDown(now);
+    TEST_ASSERT_FALSE(supervisor.shouldConnect(now + 100));
+    TEST_ASSERT_EQUAL_UINT32(CONFIG.baseDelayMs - 100, supervisor.retryInMs(now + 100));
+    TEST_ASSERT_TRUE(supervisor.shouldConnect(now + CONFIG.baseDelayMs));  // Past zero
+}
+
+void test_state_names(void) {
+    TEST_ASSERT_EQUAL_STRING("down", wifiLinkStateName(WIFI_LINK_DOWN));
+    TEST_ASSERT_EQUAL_STRING("connecting", wifiLinkStateName(WIFI_LINK_CONNECTING));
+    TEST_ASSERT_EQUAL_STRING("up", wifiLinkStateName(WIFI_LINK_UP));
+    TEST_ASSERT_EQUAL_STRING("resting", wifiLinkStateName(WIFI_LINK_RESTING));
+}
+
+// Driven through the fake event source: the AP goes away for a while,
+// the driver drops and later reassociates on its own once
+void test_fake_event_source(void) {
+    WifiSupervisor supervisor(CONFIG, 23);
+    supervisor.addListener(countUp, NULL);
+    FakeLink link;
+    link.inRange = true;
+    uint32_t now = 0;
+
+    supervise(supervisor, link, now);
+    TEST_ASSERT_EQUAL(WIFI_LINK_UP, supervisor.state());
+    TEST_ASSERT_EQUAL(1, upCalls);
+
+    link.inRange = false;
+    link.driverDown();
+    for (int i = 0; i < 600; i++, now += 1000) supervise(supervisor, link, now);
+    TEST_ASSERT_NOT_EQUAL(WIFI_LINK_UP, supervisor.state());
+    int scansWhileAway = link.scans - 1;
+    TEST_ASSERT_GREATER_THAN(0, scansWhileAway);
+    TEST_ASSERT_TRUE(scansWhileAway <= CONFIG.budget);
+
+    link.inRange = true;
+    link.driverUp();
+    supervise(supervisor, link, now);
+    TEST_ASSERT_EQUAL(WIFI_LINK_UP, supervisor.state());
+    TEST_ASSERT_EQUAL(2, upCalls);
+    TEST_ASSERT_EQUAL(scansWhileAway + 1, link.scans);
+
+    // A drop the event task missed is caught by the status poll
+    link.associated = false;
+    now += 1000;
+    supervise(supervisor, link, now);
+    TEST_ASSERT_EQUAL(WIFI_LINK_DOWN, supervisor.state());
+    now += CONFIG.baseDelayMs;
+    supervise(supervisor, link, now);
+    TEST_ASSERT_EQUAL(WIFI_LINK_UP, supervisor.state());
+    TEST_ASSERT_EQUAL(3, upCalls);
+}
+
+// No AP in range for an hour, loop polled every 10 ms. The old loop
+// rescanned whenever the link was down, so it was scanning nearly all
+// the time; the supervisor spends its budget and then rests.
+void test_benchmark_no_ap_hour(void) {
+    const uint32_t hourMs = 3600000;
+    const uint32_t loopMs = 10;
+
+    int oldScans = 0;
+    uint64_t oldBusyMs = 0;
+    for (uint32_t now = 0; now < hourMs; now += loopMs) {
+        oldScans++;
+        oldBusyMs += FakeLink::ATTEMPT_MS;
+        now += FakeLink::ATTEMPT_MS;
+    }
+
+    WifiSupervisor supervisor(CONFIG, 29);
+    FakeLink link;
+    uint64_t busyMs = 0;
+    uint32_t now = 0;
+    while (now < hourMs) {
+        uint32_t before = now;
+        supervise(supervisor, link, now);
+        busyMs += now - before;
+        now += loopMs;
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "No AP for 1 h: old loop %d scans (%.1f%% busy), supervisor %d (%.1f%% busy)",
+             oldScans, 100.0 * oldBusyMs / hourMs, link.scans, 100.0 * busyMs / hourMs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(link.scans <= 2 * CONFIG.budget);
+    TEST_ASSERT_LESS_THAN(oldScans / 20, link.scans);
+    TEST_ASSERT_TRUE(busyMs * 20 < hourMs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_attempt_is_immediate);
+    RUN_TEST(test_backoff_doubles_with_jitter);
+    RUN_TEST(test_jitter_spreads_a_fleet);
+    RUN_TEST(test_same_seed_same_schedule);
+    RUN_TEST(test_seed_later);
+    RUN_TEST(test_budget_then_rest);
+    RUN_TEST(test_drop_waits_base_delay);
+    RUN_TEST(test_down_ignored_unless_up);
+    RUN_TEST(test_up_during_attempt);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_listeners_on_each_up);
+    RUN_TEST(test_timer_wraparound);
+    RUN_TEST(test_state_names);
+    RUN_TEST(test_fake_event_source);
+    RUN_TEST(test_benchmark_no_ap_hour);
+    return UNITY_END();
+}